@@ -6,16 +6,16 @@
 */
 #include "commitfilesview.h"
 
-#include <gitprocess.h>
+#include <gitservice.h>
 
 #include <QDebug>
 #include <QDir>
 #include <QMimeDatabase>
 #include <QPainter>
-#include <QProcess>
 #include <QStyledItemDelegate>
 #include <QUrl>
 #include <QVBoxLayout>
+#include <QtConcurrentRun>
 
 #include <KColorScheme>
 #include <KLocalizedString>
@@ -262,18 +262,12 @@ static void createFileTree(QStandardItem *parent, const QString &basePath, const
 
 static std::optional<QString> getGitCmdOutput(const QString &workDir, const QStringList &args)
 {
-    QProcess git;
-    if (!setupGitProcess(git, workDir, args)) {
-        return {};
-    }
-    git.start(QProcess::ReadOnly);
-    if (git.waitForStarted() && git.waitForFinished(-1)) {
-        if (git.exitStatus() != QProcess::NormalExit || git.exitCode() != 0) {
-            return std::nullopt;
-        }
-        return {QString::fromUtf8(git.readAllStandardOutput().trimmed())};
+    // only used for the repository layout, that doesn't change
+    const GitResult result = GitService::self().run(workDir, args, true);
+    if (!result.ok()) {
+        return std::nullopt;
     }
-    return {};
+    return {QString::fromUtf8(result.standardOutput.trimmed())};
 }
 
 static std::optional<QString> getDotGitPath(const QString &repo)
@@ -360,46 +354,37 @@ CommitDiffTreeView::CommitDiffTreeView(QWidget *parent)
     m_tree.setItemDelegate(new DiffStyleDelegate(this));
 
     connect(&m_tree, &QTreeView::clicked, this, &CommitDiffTreeView::showDiff);
+    connect(&m_fileTreeWatcher, &QFutureWatcher<CommitFileTree>::finished, this, &CommitDiffTreeView::fileTreeReady);
 }
 
-void CommitDiffTreeView::openCommit(const QString &hash, const QString &filePath)
-{
-    m_commitHash = hash;
-
-    QProcess *git = new QProcess(this);
-    if (!setupGitProcess(*git,
-                         QFileInfo(filePath).absolutePath(),
-                         {QStringLiteral("show"), hash, QStringLiteral("--numstat"), QStringLiteral("--pretty=oneline"), QStringLiteral("-z")})) {
-        delete git;
-        return;
-    }
-    connect(git, &QProcess::finished, this, [this, git, filePath](int e, QProcess::ExitStatus s) {
-        git->deleteLater();
-        if (e != 0 || s != QProcess::NormalExit) {
-            return;
-        }
-        auto contents = git->readAllStandardOutput();
-        int firstNull = contents.indexOf(char(0x00));
-        if (firstNull == -1) {
-            return;
-        }
-        QByteArray numstat = contents.mid(firstNull + 1);
-        createFileTreeForCommit(filePath, numstat);
-    });
-    git->start();
-}
-
-void CommitDiffTreeView::createFileTreeForCommit(const QString &filePath, const QByteArray &rawNumStat)
+/**
+ * Build the file tree for the commit, runs in a worker thread.
+ * The items have no model yet, nothing is shared with the GUI thread.
+ */
+static CommitFileTree createFileTreeForCommit(const QString &hash, const QString &filePath)
 {
+    CommitFileTree result;
     QFileInfo fi(filePath);
     QString path = fi.absolutePath();
     auto value = getDotGitPath(path);
     if (value.has_value()) {
-        m_gitDir = value.value();
+        result.gitDir = value.value();
+    }
+
+    // a commit never changes, the result can be reused
+    const GitResult git =
+        GitService::self().run(path, {QStringLiteral("show"), hash, QStringLiteral("--numstat"), QStringLiteral("--pretty=oneline"), QStringLiteral("-z")}, true);
+    if (!git.ok()) {
+        return result;
+    }
+    const auto &contents = git.standardOutput;
+    int firstNull = contents.indexOf(char(0x00));
+    if (firstNull == -1) {
+        return result;
     }
 
     QStandardItem root;
-    createFileTree(&root, m_gitDir, parseNumStat(rawNumStat));
+    createFileTree(&root, result.gitDir, parseNumStat(contents.mid(firstNull + 1)));
 
     // Remove nodes that have only one item. i.e.,
     // - kate
@@ -435,6 +420,28 @@ void CommitDiffTreeView::createFileTreeForCommit(const QString &filePath, const
         }
     }
 
+    result.root = std::make_shared<QStandardItem>();
+    result.root->appendColumn(tree);
+    return result;
+}
+
+void CommitDiffTreeView::openCommit(const QString &hash, const QString &filePath)
+{
+    m_commitHash = hash;
+
+    // a still running build for another commit is just ignored
+    m_fileTreeWatcher.setFuture(QtConcurrent::run(createFileTreeForCommit, hash, filePath));
+}
+
+void CommitDiffTreeView::fileTreeReady()
+{
+    CommitFileTree result = m_fileTreeWatcher.result();
+    if (!result.root) {
+        return;
+    }
+
+    m_gitDir = result.gitDir;
+    QList<QStandardItem *> tree = result.root->takeColumn(0);
     m_model.clear();
     m_model.invisibleRootItem()->appendColumn(tree);
 
@@ -444,17 +451,10 @@ void CommitDiffTreeView::createFileTreeForCommit(const QString &filePath, const
 void CommitDiffTreeView::showDiff(const QModelIndex &idx)
 {
     const QString file = idx.data(FileItem::Path).toString();
-    QProcess git;
-    if (!setupGitProcess(git, m_gitDir, {QStringLiteral("show"), m_commitHash, QStringLiteral("--"), file})) {
+    const GitResult result = GitService::self().run(m_gitDir, {QStringLiteral("show"), m_commitHash, QStringLiteral("--"), file}, true);
+    if (!result.ok()) {
         return;
     }
-    git.start(QProcess::ReadOnly);
-
-    if (git.waitForStarted() && git.waitForFinished(-1)) {
-        if (git.exitStatus() != QProcess::NormalExit || git.exitCode() != 0) {
-            return;
-        }
-    }
 
-    Q_EMIT showDiffRequested(git.readAllStandardOutput());
+    Q_EMIT showDiffRequested(result.standardOutput);
 }
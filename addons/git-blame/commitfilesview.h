@@ -1,17 +1,29 @@
 #ifndef GIT_BLAME_FILE_TREE_VIEW
 #define GIT_BLAME_FILE_TREE_VIEW
 
+#include <QFutureWatcher>
 #include <QPushButton>
 #include <QStandardItemModel>
 #include <QTreeView>
 #include <QWidget>
 
+#include <memory>
+
 struct GitFileItem {
     QByteArray file;
     int linesAdded;
     int linesRemoved;
 };
 
+/**
+ * File tree of a commit, built in a worker thread
+ */
+struct CommitFileTree {
+    QString gitDir;
+    // the items are in its first column, deleted with it if nobody takes them
+    std::shared_ptr<QStandardItem> root;
+};
+
 /**
  * This class provides a way to show the diff tree for
  * a commit.
@@ -31,6 +43,7 @@ public:
 
     /**
      * open treeview for commit with @p hash
+     * the tree is built in the background, the view is updated once it is done
      * @filePath can be path of any file in the repo
      */
     void openCommit(const QString &hash, const QString &filePath);
@@ -38,11 +51,9 @@ public:
     Q_SIGNAL void closeRequested();
     Q_SIGNAL void showDiffRequested(const QByteArray &diffContents);
 
-public:
-    void createFileTreeForCommit(const QString &filePath, const QByteArray &rawNumStat);
-
 private Q_SLOTS:
     void showDiff(const QModelIndex &idx);
+    void fileTreeReady();
 
 private:
     QPushButton m_backBtn;
@@ -50,6 +61,7 @@ private:
     QStandardItemModel m_model;
     QString m_gitDir;
     QString m_commitHash;
+    QFutureWatcher<CommitFileTree> m_fileTreeWatcher;
 };
 
 #endif
@@ -10,6 +10,7 @@
 #include <gitprocess.h>
 
 #include <algorithm>
+#include <numeric>
 
 #include <KActionCollection>
 #include <KConfigGroup>
@@ -24,6 +25,7 @@
 #include <KTextEditor/View>
 
 #include <QFileInfo>
+#include <QTextCodec>
 #include <QUrl>
 
 #include <QFontMetrics>
@@ -36,6 +38,16 @@ static bool isUncomittedLine(const QByteArray &hash)
     return hash == "hash" || hash == "0000000000000000000000000000000000000000";
 }
 
+/**
+ * Files with more lines get the visible lines blamed first
+ */
+static constexpr int VisibleLinesFirstThreshold = 5000;
+
+/**
+ * With more edited ranges we rather blame the whole file again after a save
+ */
+static constexpr int MaxReblameRanges = 100;
+
 GitBlameInlineNoteProvider::GitBlameInlineNoteProvider(KateGitBlamePluginView *pluginView)
     : KTextEditor::InlineNoteProvider()
     , m_pluginView(pluginView)
@@ -52,7 +64,7 @@ GitBlameInlineNoteProvider::~GitBlameInlineNoteProvider()
 
 QVector<int> GitBlameInlineNoteProvider::inlineNotes(int line) const
 {
-    if (!m_pluginView->hasBlameInfo()) {
+    if (!m_pluginView->hasBlameInfo(line)) {
         return QVector<int>();
     }
 
@@ -141,6 +153,11 @@ void GitBlameInlineNoteProvider::setMode(KateGitBlameMode mode)
     Q_EMIT inlineNotesReset();
 }
 
+void GitBlameInlineNoteProvider::updateNotes()
+{
+    Q_EMIT inlineNotesReset();
+}
+
 K_PLUGIN_FACTORY_WITH_JSON(KateGitBlamePluginFactory, "kategitblameplugin.json", registerPlugin<KateGitBlamePlugin>();)
 
 KateGitBlamePlugin::KateGitBlamePlugin(QObject *parent, const QList<QVariant> &)
@@ -157,8 +174,7 @@ KateGitBlamePluginView::KateGitBlamePluginView(KateGitBlamePlugin *plugin, KText
     : QObject(plugin)
     , m_mainWindow(mainwindow)
     , m_inlineNoteProvider(this)
-    , m_blameInfoProc(this)
-    , m_showProc(this)
+    , m_blameProcess(this)
     , m_tooltip(this)
 {
     KXMLGUIClient::setComponentName(QStringLiteral("kategitblameplugin"), i18n("Git Blame"));
@@ -186,9 +202,12 @@ KateGitBlamePluginView::KateGitBlamePluginView(KateGitBlamePlugin *plugin, KText
 
     connect(m_mainWindow, &KTextEditor::MainWindow::viewChanged, this, &KateGitBlamePluginView::viewChanged);
 
-    connect(&m_blameInfoProc, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &KateGitBlamePluginView::blameFinished);
+    connect(&m_blameProcess, &QProcess::readyReadStandardOutput, this, &KateGitBlamePluginView::readBlameOutput);
+    connect(&m_blameProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &KateGitBlamePluginView::blameFinished);
 
-    connect(&m_showProc, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &KateGitBlamePluginView::showFinished);
+    m_notesUpdateTimer.setSingleShot(true);
+    m_notesUpdateTimer.setInterval(100);
+    connect(&m_notesUpdateTimer, &QTimer::timeout, &m_inlineNoteProvider, &GitBlameInlineNoteProvider::updateNotes);
 
     m_inlineNoteProvider.setMode(KateGitBlameMode::SingleLine);
 }
@@ -196,10 +215,8 @@ KateGitBlamePluginView::KateGitBlamePluginView(KateGitBlamePlugin *plugin, KText
 KateGitBlamePluginView::~KateGitBlamePluginView()
 {
     // ensure to kill, we segfault otherwise
-    m_blameInfoProc.kill();
-    m_blameInfoProc.waitForFinished();
-    m_showProc.kill();
-    m_showProc.waitForFinished();
+    stopBlameProcess();
+    GitService::self().cancel(m_showRequest);
 
     m_mainWindow->guiFactory()->removeClient(this);
 }
@@ -238,47 +255,121 @@ void KateGitBlamePluginView::viewChanged(KTextEditor::View *view)
 
     qobject_cast<KTextEditor::InlineNoteInterface *>(view)->registerInlineNoteProvider(&m_inlineNoteProvider);
 
-    startBlameProcess(url);
+    startBlameProcess(view);
 }
 
-void KateGitBlamePluginView::startBlameProcess(const QUrl &url)
+void KateGitBlamePluginView::startBlameProcess(KTextEditor::View *view)
 {
     // same document? maybe split view? => no work to do, reuse the result we already have
-    if (m_blameUrl == url) {
+    KTextEditor::Document *doc = view->document();
+    if (m_blameUrl == doc->url()) {
         return;
     }
 
     // clear everything
-    m_blameUrl.clear();
-    m_blamedLines.clear();
-    m_blameInfoForHash.clear();
+    stopBlameProcess();
+    m_blameUrl = doc->url();
+    m_commits.clear();
+    m_commitForHash.clear();
+    m_blameQueue.clear();
+    trackDocument(doc);
+
+    const int lines = doc->lines();
+    m_blamedLines.assign(lines, -1);
+    m_lineMap.resize(lines);
+    std::iota(m_lineMap.begin(), m_lineMap.end(), 0);
+
+    // blame what is shown, not what is on disk
+    m_blameContents.clear();
+    if (doc->isModified()) {
+        QTextCodec *codec = QTextCodec::codecForName(doc->encoding().toUtf8());
+        m_blameContents = codec ? codec->fromUnicode(doc->text()) : doc->text().toUtf8();
+    }
+
+    // large files take a while, show something for the visible lines first
+    if (lines > VisibleLinesFirstThreshold) {
+        const int first = std::max(0, view->firstDisplayedLine());
+        const int last = std::min(lines - 1, std::max(first, view->lastDisplayedLine()));
+        m_blameQueue.push_back({{first, last}});
+
+        std::vector<std::pair<int, int>> rest;
+        if (first > 0) {
+            rest.emplace_back(0, first - 1);
+        }
+        if (last < lines - 1) {
+            rest.emplace_back(last + 1, lines - 1);
+        }
+        if (!rest.empty()) {
+            m_blameQueue.push_back(std::move(rest));
+        }
+    } else {
+        m_blameQueue.push_back({});
+    }
+
+    runNextBlame();
+}
 
-    // Kill any existing process...
-    if (m_blameInfoProc.state() != QProcess::NotRunning) {
-        m_blameInfoProc.kill();
-        m_blameInfoProc.waitForFinished();
+void KateGitBlamePluginView::runNextBlame()
+{
+    if (m_blameQueue.empty() || m_blameUrl.isEmpty()) {
+        return;
     }
+    const auto ranges = std::move(m_blameQueue.front());
+    m_blameQueue.erase(m_blameQueue.begin());
 
-    const QFileInfo fi{url.toLocalFile()};
-    if (!setupGitProcess(m_blameInfoProc, fi.absolutePath(), {QStringLiteral("blame"), QStringLiteral("-p"), fi.absoluteFilePath()})) {
+    // --incremental reports the lines as soon as they are blamed
+    QStringList args{QStringLiteral("blame"), QStringLiteral("--incremental")};
+    for (const auto &range : ranges) {
+        args << QStringLiteral("-L") << QStringLiteral("%1,%2").arg(range.first + 1).arg(range.second + 1);
+    }
+    if (!m_blameContents.isNull()) {
+        args << QStringLiteral("--contents") << QStringLiteral("-");
+    }
+
+    const QFileInfo fi{m_blameUrl.toLocalFile()};
+    args << QStringLiteral("--") << fi.absoluteFilePath();
+    if (!setupGitProcess(m_blameProcess, fi.absolutePath(), args)) {
         return;
     }
-    m_blameInfoProc.start(QIODevice::ReadOnly);
-    m_blameUrl = url;
+
+    m_blameBuffer.clear();
+    m_entryLineCount = 0;
+    if (m_blameContents.isNull()) {
+        m_blameProcess.start(QIODevice::ReadOnly);
+    } else {
+        m_blameProcess.start(QIODevice::ReadWrite);
+        m_blameProcess.write(m_blameContents);
+        m_blameProcess.closeWriteChannel();
+    }
 }
 
-void KateGitBlamePluginView::startShowProcess(const QUrl &url, const QString &hash)
+void KateGitBlamePluginView::stopBlameProcess()
 {
-    if (m_showProc.state() != QProcess::NotRunning) {
-        // Wait for the previous process to be done...
-        return;
+    // we don't want the results of the old process
+    const QSignalBlocker blocker(m_blameProcess);
+    if (m_blameProcess.state() != QProcess::NotRunning) {
+        m_blameProcess.kill();
+        m_blameProcess.waitForFinished();
     }
+    m_blameBuffer.clear();
+}
 
+void KateGitBlamePluginView::startShowProcess(const QUrl &url, const QString &hash)
+{
+    // only the last requested commit is of interest
+    GitService::self().cancel(m_showRequest);
+
+    // a commit never changes, the result can be reused
     const QFileInfo fi{url.toLocalFile()};
-    if (!setupGitProcess(m_showProc, fi.absolutePath(), {QStringLiteral("show"), hash, QStringLiteral("--numstat")})) {
-        return;
-    }
-    m_showProc.start(QIODevice::ReadOnly);
+    m_showRequest = GitService::self().request(
+        fi.absolutePath(),
+        {QStringLiteral("show"), hash, QStringLiteral("--numstat")},
+        this,
+        [this, hash](const GitResult &result) {
+            showFinished(hash, result);
+        },
+        GitService::Interactive,
+        true);
 }
 
 void KateGitBlamePluginView::showCommitInfo(const QString &hash, KTextEditor::View *view)
@@ -287,21 +378,6 @@ void KateGitBlamePluginView::showCommitInfo(const QString &hash, KTextEditor::Vi
     startShowProcess(view->document()->url(), hash);
 }
 
-static int nextBlockStart(const QByteArray &out, int from)
-{
-    int next = out.indexOf('\t', from);
-    // tab must be the first character in line for next block
-    if (next > 0 && out[next - 1] != '\n') {
-        next++;
-        // move forward one line
-        next = out.indexOf('\n', next);
-        // try to look for another tab char
-        next = out.indexOf('\t', next);
-        // if not found => end
-    }
-    return next;
-}
-
 void KateGitBlamePluginView::sendMessage(const QString &text, bool error)
 {
     QVariantMap genericMessage;
@@ -312,147 +388,243 @@ void KateGitBlamePluginView::sendMessage(const QString &text, bool error)
     Q_EMIT message(genericMessage);
 }
 
+void KateGitBlamePluginView::readBlameOutput()
+{
+    m_blameBuffer += m_blameProcess.readAllStandardOutput();
+
+    // only complete lines, the rest waits for the next chunk
+    int start = 0;
+    for (int end = m_blameBuffer.indexOf('\n'); end != -1; end = m_blameBuffer.indexOf('\n', start)) {
+        parseBlameLine(m_blameBuffer.mid(start, end - start));
+        start = end + 1;
+    }
+    m_blameBuffer.remove(0, start);
+}
+
+void KateGitBlamePluginView::parseBlameLine(const QByteArray &line)
+{
+    /**
+     * This is our git blame --incremental output parser.
+     *
+     * Each entry starts with the commit and the lines it covers:
+     *
+     * 5c7f27a0915a9b20dc9f683d0d85b6e4b829bc85 1 1 5
+     *
+     * followed by the commit info, only for the first entry of a commit, and
+     * ends with the filename. The entries arrive in no particular order.
+     * We store the commit info separately so that it doesn't need to be duplicated,
+     * for each line we just store the index of its commit.
+     */
+    if (m_entryLineCount == 0) {
+        const QList<QByteArray> parts = line.split(' ');
+        constexpr int hashLen = 40;
+        if (parts.size() != 4 || parts[0].size() != hashLen) {
+            qWarning() << "Git blame: Invalid blame output : No entry start";
+            return;
+        }
+
+        const QByteArray &hash = parts[0];
+        auto it = m_commitForHash.constFind(hash);
+        if (it == m_commitForHash.cend()) {
+            CommitInfo commitInfo;
+            commitInfo.hash = hash;
+            m_commits.push_back(commitInfo);
+            it = m_commitForHash.insert(hash, int(m_commits.size()) - 1);
+        }
+        m_entryCommit = it.value();
+        m_entryLine = parts[2].toInt() - 1;
+        m_entryLineCount = parts[3].toInt();
+        return;
+    }
+
+    // KTextEditor removes all \r characters in the internal buffers
+    QByteArray value = line;
+    if (value.endsWith('\r')) {
+        value.chop(1);
+    }
+
+    CommitInfo &commitInfo = m_commits[m_entryCommit];
+    if (value.startsWith("author ")) {
+        commitInfo.authorName = QString::fromUtf8(value.mid(sizeof("author ") - 1));
+    } else if (value.startsWith("author-time ")) {
+        commitInfo.authorDate = QDateTime::fromSecsSinceEpoch(value.mid(sizeof("author-time ") - 1).toLongLong());
+    } else if (value.startsWith("summary ")) {
+        commitInfo.summary = value.mid(sizeof("summary ") - 1);
+    } else if (value.startsWith("filename ")) {
+        // entry complete
+        const int end = std::min(m_entryLine + m_entryLineCount, int(m_blamedLines.size()));
+        for (int i = std::max(0, m_entryLine); i < end; ++i) {
+            m_blamedLines[i] = m_entryCommit;
+        }
+        m_entryLineCount = 0;
+        if (!m_notesUpdateTimer.isActive()) {
+            m_notesUpdateTimer.start();
+        }
+    }
+}
+
 void KateGitBlamePluginView::blameFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
     // we ignore errors, we might just not be in a git repo, parsing errors is hard, as they are translated
     // switching to english is no good idea either, as the user will likely not understand it then anyways
     if (exitCode != 0 || exitStatus != QProcess::NormalExit) {
+        m_blameQueue.clear();
         return;
     }
 
-    QByteArray out = m_blameInfoProc.readAllStandardOutput();
-    out.replace("\r", ""); // KTextEditor removes all \r characters in the internal buffers
-    // printf("recieved output: %d for: git %s\n", out.size(), qPrintable(m_blameInfoProc.arguments().join(QLatin1Char(' '))));
+    readBlameOutput();
+    runNextBlame();
+}
+
+void KateGitBlamePluginView::trackDocument(KTextEditor::Document *document)
+{
+    if (m_blameDocument == document) {
+        return;
+    }
+    if (m_blameDocument) {
+        disconnect(m_blameDocument, nullptr, this, nullptr);
+    }
+    m_blameDocument = document;
 
     /**
-     * This is out git blame output parser.
-     *
-     * The output contains info about each line of text and commit info
-     * for that line. We store the commit info separately in a hash-map
-     * so that they don't need to be duplicated. For each line we store
-     * its line text and short commit. Text is needed because if you
-     * modify the doc, we use it to figure out where the original blame
-     * line is. The short commit is used to fetch the full commit from
-     * the hashmap
+     * Edits only shift the lines, no need to compare any text.
+     * Edited lines are not committed, a save blames them again.
      */
-
-    int start = 0;
-    int next = out.indexOf('\t');
-    next = out.indexOf('\n', next);
-
-    while (next != -1) {
-        //         printf("Block: (Size: %d) %s\n\n", (next - start), out.mid(start, next - start).constData());
-
-        CommitInfo commitInfo;
-        BlamedLine lineInfo;
-
-        /**
-         * Parse hash and line numbers
-         *
-         * 5c7f27a0915a9b20dc9f683d0d85b6e4b829bc85 1 1 5
-         */
-        int pos = out.indexOf(' ', start);
-        constexpr int hashLen = 40;
-        if (pos == -1 || (pos - start) != hashLen) {
-            printf("no proper hash\n");
-            break;
+    connect(document, &KTextEditor::Document::textInserted, this, [this](KTextEditor::Document *, const KTextEditor::Cursor &position, const QString &text) {
+        const int newLines = text.count(QLatin1Char('\n'));
+        if (position.column() == 0 && newLines > 0 && text.endsWith(QLatin1Char('\n'))) {
+            insertLines(position.line(), newLines);
+            return;
+        }
+        editLine(position.line());
+        insertLines(position.line() + 1, newLines);
+    });
+    connect(document, &KTextEditor::Document::textRemoved, this, [this](KTextEditor::Document *, const KTextEditor::Range &range, const QString &) {
+        const int removedLines = range.end().line() - range.start().line();
+        if (range.start().column() == 0 && range.end().column() == 0) {
+            removeLines(range.start().line(), removedLines);
+            return;
         }
-        QByteArray hash = out.mid(start, pos - start);
-
-        // skip to line end,
-        // we don't care about line no etc here
-        int from = pos + 1;
-        pos = out.indexOf('\n', from);
-        if (pos == -1) {
-            qWarning() << "Git blame: Invalid blame output : No new line";
-            break;
+        editLine(range.start().line());
+        removeLines(range.start().line() + 1, removedLines);
+    });
+    connect(document, &KTextEditor::Document::lineWrapped, this, [this](KTextEditor::Document *doc, const KTextEditor::Cursor &position) {
+        if (position.column() == 0) {
+            insertLines(position.line(), 1);
+            return;
         }
-        pos++;
-
-        lineInfo.shortCommitHash = hash.mid(0, 7);
-
-        m_blamedLines.push_back(lineInfo);
-
-        // are we done because this line references the commit instead of
-        // containing the content?
-        if (out[pos] == '\t') {
-            pos++; // skip \t
-            from = pos;
-            pos = out.indexOf('\n', from); // go to line end
-            m_blamedLines.back().lineText = out.mid(from, pos - from);
-
-            start = next + 1;
-            next = nextBlockStart(out, start);
-            if (next == -1)
-                break;
-            next = out.indexOf('\n', next);
-            continue;
+        if (doc->lineLength(position.line() + 1) != 0) {
+            editLine(position.line());
         }
+        insertLines(position.line() + 1, 1);
+    });
+    connect(document, &KTextEditor::Document::lineUnwrapped, this, [this](KTextEditor::Document *, int line) {
+        removeLines(line, 1);
+        editLine(line - 1);
+    });
 
-        /**
-         * Parse actual commit
-         */
-        commitInfo.hash = hash;
-
-        // author Xyz
-        constexpr int authorLen = sizeof("author ") - 1;
-        pos += authorLen;
-        from = pos;
-        pos = out.indexOf('\n', pos);
-
-        commitInfo.authorName = QString::fromUtf8(out.mid(from, pos - from));
-        pos++;
-
-        // author-time timestamp
-        constexpr int authorTimeLen = sizeof("author-time ") - 1;
-        pos = out.indexOf("author-time ", pos);
-        if (pos == -1) {
-            qWarning() << "Invalid commit while git-blameing";
-            break;
+    connect(document, &KTextEditor::Document::documentSavedOrUploaded, this, [this](KTextEditor::Document *doc, bool saveAs) {
+        if (saveAs) {
+            // another file, start from scratch
+            m_blameUrl.clear();
+            if (auto view = m_mainWindow->activeView(); view && view->document() == doc) {
+                startBlameProcess(view);
+            }
+            return;
+        }
+        reblameEditedLines(doc);
+    });
+    connect(document, &KTextEditor::Document::reloaded, this, [this](KTextEditor::Document *doc) {
+        m_blameUrl.clear();
+        if (auto view = m_mainWindow->activeView(); view && view->document() == doc) {
+            startBlameProcess(view);
         }
-        pos += authorTimeLen;
-        from = pos;
-        pos = out.indexOf('\n', from);
+    });
+}
 
-        qint64 timestamp = out.mid(from, pos - from).toLongLong();
-        commitInfo.authorDate = QDateTime::fromSecsSinceEpoch(timestamp);
+void KateGitBlamePluginView::insertLines(int line, int count)
+{
+    if (count <= 0 || line < 0 || line > int(m_lineMap.size())) {
+        return;
+    }
+    m_lineMap.insert(m_lineMap.begin() + line, count, -1);
+}
 
-        constexpr int summaryLen = sizeof("summary ") - 1;
-        pos = out.indexOf("summary ", pos);
-        pos += summaryLen;
-        from = pos;
-        pos = out.indexOf('\n', pos);
+void KateGitBlamePluginView::removeLines(int line, int count)
+{
+    if (count <= 0 || line < 0 || line >= int(m_lineMap.size())) {
+        return;
+    }
+    const auto begin = m_lineMap.begin() + line;
+    m_lineMap.erase(begin, begin + std::min(count, int(m_lineMap.size()) - line));
+}
 
-        commitInfo.summary = out.mid(from, pos - from);
-        //         printf("Commit{\n %s,\n %s,\n %s,\n %s\n}\n", qPrintable(commitInfo.commitHash), qPrintable(commitInfo.name),
-        //         qPrintable(commitInfo.date.toString()), qPrintable(commitInfo.title));
+void KateGitBlamePluginView::editLine(int line)
+{
+    if (line >= 0 && line < int(m_lineMap.size())) {
+        m_lineMap[line] = -1;
+    }
+}
+
+void KateGitBlamePluginView::reblameEditedLines(KTextEditor::Document *document)
+{
+    // nothing to update, e.g. no git repository
+    if (m_commits.empty() || m_blameUrl != document->url()) {
+        return;
+    }
 
-        m_blameInfoForHash[lineInfo.shortCommitHash] = commitInfo;
+    // the saved file is what we blame from now on
+    m_blameContents.clear();
 
-        from = pos;
-        pos = out.indexOf('\t', from);
-        from = pos + 1;
-        pos = out.indexOf('\n', from);
-        m_blamedLines.back().lineText = out.mid(from, pos - from);
+    // still running, the old line numbers are of no use, start from scratch
+    const int lines = document->lines();
+    if (m_blameProcess.state() != QProcess::NotRunning || !m_blameQueue.empty()) {
+        stopBlameProcess();
+        m_blameQueue.clear();
+        m_blamedLines.assign(lines, -1);
+        m_lineMap.resize(lines);
+        std::iota(m_lineMap.begin(), m_lineMap.end(), 0);
+        m_blameQueue.push_back({});
+        runNextBlame();
+        return;
+    }
 
-        start = next + 1;
-        next = nextBlockStart(out, start);
-        if (next == -1)
-            break;
-        next = out.indexOf('\n', next);
+    // keep the blame of the unchanged lines, collect the edited ones
+    std::vector<int> blamedLines(lines, -1);
+    std::vector<std::pair<int, int>> ranges;
+    for (int line = 0; line < lines; ++line) {
+        const int blamedLine = line < int(m_lineMap.size()) ? m_lineMap[line] : -1;
+        if (blamedLine >= 0 && blamedLine < int(m_blamedLines.size())) {
+            blamedLines[line] = m_blamedLines[blamedLine];
+        } else if (!ranges.empty() && ranges.back().second == line - 1) {
+            ranges.back().second = line;
+        } else {
+            ranges.emplace_back(line, line);
+        }
     }
+    m_blamedLines = std::move(blamedLines);
+    m_lineMap.resize(lines);
+    std::iota(m_lineMap.begin(), m_lineMap.end(), 0);
+
+    if (ranges.empty()) {
+        return;
+    }
+    if (ranges.size() > size_t(MaxReblameRanges)) {
+        ranges.clear();
+    }
+    m_blameQueue.push_back(std::move(ranges));
+    runNextBlame();
 }
 
-void KateGitBlamePluginView::showFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void KateGitBlamePluginView::showFinished(const QString &hash, const GitResult &result)
 {
-    if (exitCode != 0 || exitStatus != QProcess::NormalExit) {
+    if (!result.ok()) {
         QString text = i18n("Git blame, show commit failed.");
-        sendMessage(text + QStringLiteral("\n") + QString::fromUtf8(m_showProc.readAllStandardError()), true);
+        sendMessage(text + QStringLiteral("\n") + QString::fromUtf8(result.standardError), true);
         return;
     }
 
-    QString stdOut = QString::fromUtf8(m_showProc.readAllStandardOutput());
-    QStringList args = m_showProc.arguments();
+    QString stdOut = QString::fromUtf8(result.standardOutput);
 
     int titleStart = 0;
     for (int i = 0; i < 4; ++i) {
@@ -474,74 +646,48 @@ void KateGitBlamePluginView::showFinished(int exitCode, QProcess::ExitStatus exi
     if (dateIdx != -1) {
         int newLine = stdOut.indexOf(QLatin1Char('\n'), dateIdx);
         if (newLine != -1) {
-            QString btn = QLatin1String("\n<a href=\"%1\">Click To Show Commit In Tree View</a>\n").arg(args[1]);
+            QString btn = QLatin1String("\n<a href=\"%1\">Click To Show Commit In Tree View</a>\n").arg(hash);
             stdOut.insert(newLine + 1, btn);
         }
     }
 
-    if (!m_showHash.isEmpty() && m_showHash != args[1]) {
-        startShowProcess(m_mainWindow->activeView()->document()->url(), m_showHash);
-        return;
-    }
+    // a newer request would have canceled us
     if (!m_showHash.isEmpty()) {
         m_showHash.clear();
         m_tooltip.show(stdOut, m_mainWindow->activeView());
     }
 }
 
-bool KateGitBlamePluginView::hasBlameInfo() const
+int KateGitBlamePluginView::commitForLine(int lineNr) const
 {
-    return !m_blamedLines.empty();
-}
-
-const CommitInfo &KateGitBlamePluginView::blameInfo(int lineNr)
-{
-    if (m_blamedLines.empty() || m_blameInfoForHash.isEmpty() || !activeDocument()) {
-        return blameGetUpdateInfo(-1);
+    if (lineNr < 0 || lineNr >= int(m_lineMap.size())) {
+        return -1;
     }
-
-    int totalBlamedLines = m_blamedLines.size();
-
-    int adjustedLineNr = lineNr + m_lineOffset;
-    const QByteArray lineText = activeDocument()->line(lineNr).toUtf8();
-
-    if (adjustedLineNr >= 0 && adjustedLineNr < totalBlamedLines) {
-        if (m_blamedLines[adjustedLineNr].lineText == lineText) {
-            return blameGetUpdateInfo(adjustedLineNr);
-        }
-    }
-
-    // search for the line 100 lines before and after until it matches
-    m_lineOffset = 0;
-    while (m_lineOffset < 100 && lineNr + m_lineOffset >= 0 && lineNr + m_lineOffset < totalBlamedLines) {
-        if (m_blamedLines[lineNr + m_lineOffset].lineText == lineText) {
-            return blameGetUpdateInfo(lineNr + m_lineOffset);
-        }
-        m_lineOffset++;
+    const int blamedLine = m_lineMap[lineNr];
+    if (blamedLine < 0 || blamedLine >= int(m_blamedLines.size())) {
+        return -1;
     }
+    return m_blamedLines[blamedLine];
+}
 
-    m_lineOffset = 0;
-    while (m_lineOffset > -100 && lineNr + m_lineOffset >= 0 && (lineNr + m_lineOffset) < totalBlamedLines) {
-        if (m_blamedLines[lineNr + m_lineOffset].lineText == lineText) {
-            return blameGetUpdateInfo(lineNr + m_lineOffset);
-        }
-        m_lineOffset--;
+bool KateGitBlamePluginView::hasBlameInfo(int lineNr) const
+{
+    if (m_commits.empty() || lineNr < 0 || lineNr >= int(m_lineMap.size())) {
+        return false;
     }
 
-    return blameGetUpdateInfo(-1);
+    // edited lines are not committed, lines not blamed yet get no info until they are
+    return m_lineMap[lineNr] < 0 || commitForLine(lineNr) >= 0;
 }
 
-const CommitInfo &KateGitBlamePluginView::blameGetUpdateInfo(int lineNr)
+const CommitInfo &KateGitBlamePluginView::blameInfo(int lineNr) const
 {
     static const CommitInfo dummy{"hash", i18n("Not Committed Yet"), QDateTime::currentDateTime(), {}};
-    if (m_blamedLines.empty() || lineNr < 0 || lineNr >= (int)m_blamedLines.size()) {
+    const int commit = commitForLine(lineNr);
+    if (commit < 0) {
         return dummy;
     }
-
-    auto &commitInfo = m_blamedLines[lineNr];
-
-    Q_ASSERT(m_blameInfoForHash.contains(commitInfo.shortCommitHash));
-    return m_blameInfoForHash[commitInfo.shortCommitHash];
+    return m_commits[commit];
 }
 
 void KateGitBlamePluginView::setToolTipIgnoreKeySequence(QKeySequence sequence)
@@ -14,16 +14,20 @@
 #include <KTextEditor/MainWindow>
 #include <KTextEditor/Plugin>
 
-#include <QProcess>
+#include <gitservice.h>
 
 #include <QDateTime>
 #include <QHash>
 #include <QList>
 #include <QLocale>
+#include <QProcess>
 #include <QRegularExpression>
+#include <QTimer>
 #include <QVariant>
 #include <QVector>
 
+#include <vector>
+
 enum class KateGitBlameMode { None, SingleLine, AllLines, Count = AllLines };
 
 struct CommitInfo {
@@ -33,11 +37,6 @@ struct CommitInfo {
     QByteArray summary;
 };
 
-struct BlamedLine {
-    QByteArray shortCommitHash;
-    QByteArray lineText;
-};
-
 class KateGitBlamePluginView;
 class GitBlameTooltip;
 
@@ -55,6 +54,11 @@ public:
     void cycleMode();
     void setMode(KateGitBlameMode mode);
 
+    /**
+     * Repaint the notes, e.g. after more blame info arrived
+     */
+    void updateNotes();
+
 private:
     KateGitBlamePluginView *m_pluginView;
     QLocale m_locale;
@@ -80,9 +84,12 @@ public:
     QPointer<KTextEditor::View> activeView() const;
     QPointer<KTextEditor::Document> activeDocument() const;
 
-    bool hasBlameInfo() const;
+    /**
+     * @return is there blame info for the line, true for edited lines, they are not committed
+     */
+    bool hasBlameInfo(int lineNr) const;
 
-    const CommitInfo &blameInfo(int lineNr);
+    const CommitInfo &blameInfo(int lineNr) const;
 
     void showCommitInfo(const QString &hash, KTextEditor::View *view);
 
@@ -97,30 +104,70 @@ private:
 
     void viewChanged(KTextEditor::View *view);
 
-    void startBlameProcess(const QUrl &url);
+    void startBlameProcess(KTextEditor::View *view);
+    void runNextBlame();
+    void readBlameOutput();
+    void parseBlameLine(const QByteArray &line);
     void blameFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void stopBlameProcess();
+
+    /**
+     * Keep the mapping of document lines to blamed lines up to date
+     */
+    void trackDocument(KTextEditor::Document *document);
+    void insertLines(int line, int count);
+    void removeLines(int line, int count);
+    void editLine(int line);
+
+    /**
+     * Blame the lines edited since the last blame, after a save
+     */
+    void reblameEditedLines(KTextEditor::Document *document);
+
+    int commitForLine(int lineNr) const;
 
     void startShowProcess(const QUrl &url, const QString &hash);
-    void showFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void showFinished(const QString &hash, const GitResult &result);
 
     void createToolView();
     void hideToolView();
 
     void showDiffForFile(const QByteArray &diffContents);
 
-    const CommitInfo &blameGetUpdateInfo(int lineNr);
-
     KTextEditor::MainWindow *m_mainWindow;
 
     GitBlameInlineNoteProvider m_inlineNoteProvider;
 
-    QProcess m_blameInfoProc;
-    QProcess m_showProc;
-    QHash<QByteArray, CommitInfo> m_blameInfoForHash;
-    std::vector<BlamedLine> m_blamedLines;
+    GitService::RequestId m_showRequest = 0;
+
+    /**
+     * git blame --incremental, streamed in
+     */
+    QProcess m_blameProcess;
+    // incomplete last line of the output
+    QByteArray m_blameBuffer;
+    // line ranges for the next blame runs, an empty list blames all lines
+    std::vector<std::vector<std::pair<int, int>>> m_blameQueue;
+    // contents to blame if the document was modified, else the file is blamed
+    QByteArray m_blameContents;
+    // the entry being parsed, its lines are set once it is complete
+    int m_entryCommit = -1;
+    int m_entryLine = 0;
+    int m_entryLineCount = 0;
+
+    // commits, lines refer to them by index
+    std::vector<CommitInfo> m_commits;
+    QHash<QByteArray, int> m_commitForHash;
+    // commit of each line of the blamed file, -1 if not yet known
+    std::vector<int> m_blamedLines;
+    // line in the blamed file for each document line, -1 for edited lines
+    std::vector<int> m_lineMap;
+
     QUrl m_blameUrl;
+    QPointer<KTextEditor::Document> m_blameDocument;
     QPointer<KTextEditor::View> m_lastView;
-    int m_lineOffset{0};
+    // don't repaint for each chunk of blame output
+    QTimer m_notesUpdateTimer;
     GitBlameTooltip m_tooltip;
     QString m_showHash;
     class CommitDiffTreeView *m_commitFilesView;
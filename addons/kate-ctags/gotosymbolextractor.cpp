@@ -0,0 +1,213 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#include "gotosymbolextractor.h"
+
+#include <KLocalizedString>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+GotoSymbolExtractor::GotoSymbolExtractor(QObject *parent)
+    : QObject(parent)
+    , m_symbols(100000)
+{
+}
+
+GotoSymbolExtractor::~GotoSymbolExtractor()
+{
+    // running ctags processes are killed with us, their results are of no interest
+    const auto processes = findChildren<QProcess *>();
+    for (auto process : processes) {
+        disconnect(process, nullptr, this, nullptr);
+    }
+}
+
+QByteArray GotoSymbolExtractor::contentHash(const QString &filePath)
+{
+    const QFileInfo info(filePath);
+    auto it = m_hashes.find(filePath);
+    if (it != m_hashes.end() && it->lastModified == info.lastModified() && it->size == info.size()) {
+        return it->hash;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_hashes.remove(filePath);
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&file);
+
+    HashedFile &hashed = m_hashes[filePath];
+    hashed.lastModified = info.lastModified();
+    hashed.size = info.size();
+    hashed.hash = hash.result();
+    return hashed.hash;
+}
+
+bool GotoSymbolExtractor::symbols(const QString &filePath, QVector<SymbolItem> &symbols)
+{
+    const QByteArray hash = contentHash(filePath);
+    if (hash.isEmpty()) {
+        return false;
+    }
+
+    if (const auto cached = m_symbols.object(hash)) {
+        symbols = *cached;
+        return true;
+    }
+    return false;
+}
+
+void GotoSymbolExtractor::extract(const QStringList &filePaths)
+{
+    // only look at files that are neither cached nor on the way
+    QHash<QString, QByteArray> files;
+    for (const auto &filePath : filePaths) {
+        if (m_pending.contains(filePath) || files.contains(filePath)) {
+            continue;
+        }
+        const QByteArray hash = contentHash(filePath);
+        if (!hash.isEmpty() && !m_symbols.contains(hash)) {
+            files.insert(filePath, hash);
+        }
+    }
+    if (files.isEmpty()) {
+        return;
+    }
+
+    // only use ctags from PATH
+    static const auto fullExecutablePath = QStandardPaths::findExecutable(QStringLiteral("ctags"));
+    if (fullExecutablePath.isEmpty()) {
+        for (auto it = files.cbegin(); it != files.cend(); ++it) {
+            Q_EMIT extractionFailed(it.key(), i18n("CTags executable not found."));
+        }
+        return;
+    }
+
+    // one ctags run for all files, the input file is part of each line
+    QStringList arguments = {QStringLiteral("-x"), QStringLiteral("--_xformat=%{input}\t%{name}%{signature}\t%{kind}\t%{line}")};
+    for (auto it = files.cbegin(); it != files.cend(); ++it) {
+        arguments.push_back(it.key());
+        m_pending.insert(it.key());
+    }
+
+    auto process = new QProcess(this);
+    connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, [this, process, files](int exitCode, QProcess::ExitStatus status) {
+        process->deleteLater();
+        if (status != QProcess::NormalExit) {
+            for (auto it = files.cbegin(); it != files.cend(); ++it) {
+                m_pending.remove(it.key());
+                Q_EMIT extractionFailed(it.key(), i18n("CTags executable failed to execute."));
+            }
+            return;
+        }
+
+        // the output may be incomplete, caching it would hide the symbols until the file changes
+        if (exitCode != 0) {
+            const QString error = i18n("The CTags program exited with code %1: %2", exitCode, QString::fromLocal8Bit(process->readAllStandardError()));
+            for (auto it = files.cbegin(); it != files.cend(); ++it) {
+                m_pending.remove(it.key());
+                Q_EMIT extractionFailed(it.key(), error);
+            }
+            return;
+        }
+
+        // files without symbols are cached, too
+        const auto symbols = parseOutput(process->readAllStandardOutput());
+        for (auto it = files.cbegin(); it != files.cend(); ++it) {
+            const QVector<SymbolItem> fileSymbols = symbols.value(it.key());
+            m_symbols.insert(it.value(), new QVector<SymbolItem>(fileSymbols), std::max(1, fileSymbols.size()));
+            m_pending.remove(it.key());
+            Q_EMIT symbolsExtracted(it.key(), fileSymbols);
+        }
+    });
+    connect(process, &QProcess::errorOccurred, this, [this, process, files](QProcess::ProcessError error) {
+        // finished is emitted for the other errors
+        if (error != QProcess::FailedToStart) {
+            return;
+        }
+        process->deleteLater();
+        for (auto it = files.cbegin(); it != files.cend(); ++it) {
+            m_pending.remove(it.key());
+            Q_EMIT extractionFailed(it.key(), i18n("CTags executable failed to execute."));
+        }
+    });
+    process->start(fullExecutablePath, arguments);
+}
+
+QHash<QString, QVector<SymbolItem>> GotoSymbolExtractor::parseOutput(const QByteArray &out)
+{
+    static const QIcon nsIcon = QIcon::fromTheme(QStringLiteral("code-block"));
+    static const QIcon classIcon = QIcon::fromTheme(QStringLiteral("code-class"));
+    static const QIcon funcIcon = QIcon::fromTheme(QStringLiteral("code-function"));
+    static const QIcon varIcon = QIcon::fromTheme(QStringLiteral("code-variable"));
+    static const QIcon defIcon = nsIcon;
+
+    QHash<QString, QVector<SymbolItem>> symItems;
+    const auto tags = out.split('\n');
+    for (const auto &tag : tags) {
+        const auto items = tag.split('\t');
+        if (items.count() < 4 || items.at(2).isEmpty()) {
+            continue;
+        }
+
+        SymbolItem item;
+        item.name = QLatin1String(items.at(1));
+        // this happens in markdown names for some reason
+        if (item.name.endsWith(QLatin1Char('-'))) {
+            item.name.chop(1);
+        }
+
+        const QByteArray &kind = items.at(2);
+        switch (kind.at(0)) {
+        case 'f':
+            item.icon = funcIcon;
+            break;
+        case 'm':
+            if (kind == "method") {
+                item.icon = funcIcon;
+            } else {
+                item.icon = defIcon;
+            }
+            break;
+        case 'g':
+            if (kind == "getter") {
+                item.icon = funcIcon;
+            } else {
+                item.icon = defIcon;
+            }
+            break;
+        case 'c':
+        case 's':
+            if (kind == "class" || kind == "struct") {
+                item.icon = classIcon;
+            } else {
+                item.icon = defIcon;
+            }
+            break;
+        case 'n':
+            if (kind == "namespace") {
+                item.icon = nsIcon;
+            }
+            break;
+        case 'v':
+            item.icon = varIcon;
+            break;
+        default:
+            item.icon = defIcon;
+            break;
+        }
+
+        item.line = items.at(3).toInt();
+        symItems[QString::fromLocal8Bit(items.at(0))].append(item);
+    }
+    return symItems;
+}
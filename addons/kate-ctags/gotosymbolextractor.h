@@ -0,0 +1,99 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef GOTOSYMBOLEXTRACTOR_H
+#define GOTOSYMBOLEXTRACTOR_H
+
+#include <QCache>
+#include <QDateTime>
+#include <QHash>
+#include <QIcon>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct SymbolItem {
+    QString name;
+    int line;
+    QIcon icon;
+};
+
+/**
+ * Extracts the symbols of local files with ctags, for the local goto symbol view.
+ *
+ * ctags runs asynchronously, several files are handled by one ctags run.
+ * The results are cached by file content, unchanged files are never extracted twice.
+ */
+class GotoSymbolExtractor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GotoSymbolExtractor(QObject *parent = nullptr);
+    ~GotoSymbolExtractor() override;
+
+    /**
+     * Get the cached symbols of a file.
+     * @param filePath local file
+     * @param symbols the symbols, if the file didn't change since they were extracted
+     * @return are the symbols cached?
+     */
+    bool symbols(const QString &filePath, QVector<SymbolItem> &symbols);
+
+    /**
+     * Extract the symbols of all given files, that are not cached or being extracted, with one ctags run.
+     * symbolsExtracted or extractionFailed is emitted for each file once done.
+     * @param filePaths local files
+     */
+    void extract(const QStringList &filePaths);
+
+Q_SIGNALS:
+    /**
+     * The symbols of the file are extracted, they are cached, too.
+     */
+    void symbolsExtracted(const QString &filePath, const QVector<SymbolItem> &symbols);
+
+    /**
+     * ctags could not be run for the file or failed, nothing is cached.
+     * @param error translated message
+     */
+    void extractionFailed(const QString &filePath, const QString &error);
+
+private:
+    /**
+     * @return hash of the file content, only computed again if the file did change
+     */
+    QByteArray contentHash(const QString &filePath);
+
+    /**
+     * Parse the output of ctags into the symbols per file.
+     */
+    static QHash<QString, QVector<SymbolItem>> parseOutput(const QByteArray &out);
+
+    struct HashedFile {
+        QDateTime lastModified;
+        qint64 size = 0;
+        QByteArray hash;
+    };
+
+    /**
+     * content hashes of the files seen so far
+     */
+    QHash<QString, HashedFile> m_hashes;
+
+    /**
+     * symbols by content hash, the cost is the number of symbols
+     */
+    QCache<QByteArray, QVector<SymbolItem>> m_symbols;
+
+    /**
+     * files a ctags run is going on for
+     */
+    QSet<QString> m_pending;
+};
+
+#endif // GOTOSYMBOLEXTRACTOR_H
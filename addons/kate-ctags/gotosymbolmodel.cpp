@@ -6,13 +6,22 @@
 #include "gotosymbolmodel.h"
 
 #include <KLocalizedString>
-#include <QDebug>
-#include <QProcess>
-#include <QStandardPaths>
 
-GotoSymbolModel::GotoSymbolModel(QObject *parent)
+GotoSymbolModel::GotoSymbolModel(GotoSymbolExtractor *extractor, QObject *parent)
     : QAbstractTableModel(parent)
+    , m_extractor(extractor)
 {
+    // only the results for the file shown matter, the others are cached for later
+    connect(m_extractor, &GotoSymbolExtractor::symbolsExtracted, this, [this](const QString &filePath, const QVector<SymbolItem> &symbols) {
+        if (filePath == m_filePath) {
+            setSymbols(symbols);
+        }
+    });
+    connect(m_extractor, &GotoSymbolExtractor::extractionFailed, this, [this](const QString &filePath, const QString &error) {
+        if (filePath == m_filePath) {
+            setError(error);
+        }
+    });
 }
 
 int GotoSymbolModel::columnCount(const QModelIndex &) const
@@ -49,102 +58,34 @@ QVariant GotoSymbolModel::data(const QModelIndex &index, int role) const
 
 void GotoSymbolModel::refresh(const QString &filePath)
 {
-    static const QIcon nsIcon = QIcon::fromTheme(QStringLiteral("code-block"));
-    static const QIcon classIcon = QIcon::fromTheme(QStringLiteral("code-class"));
-    static const QIcon funcIcon = QIcon::fromTheme(QStringLiteral("code-function"));
-    static const QIcon varIcon = QIcon::fromTheme(QStringLiteral("code-variable"));
-    static const QIcon defIcon = nsIcon;
+    m_filePath = filePath;
 
-    beginResetModel();
-    m_rows.clear();
-    endResetModel();
-
-    // only use ctags from PATH
-    static const auto fullExecutablePath = QStandardPaths::findExecutable(QStringLiteral("ctags"));
-    if (fullExecutablePath.isEmpty()) {
-        beginResetModel();
-        m_rows.append(SymbolItem{i18n("CTags executable not found."), -1, QIcon()});
-        endResetModel();
+    QVector<SymbolItem> symbols;
+    if (m_extractor->symbols(filePath, symbols)) {
+        setSymbols(symbols);
         return;
     }
 
-    QProcess p;
-    p.start(fullExecutablePath, {QStringLiteral("-x"), QStringLiteral("--_xformat=%{name}%{signature}\t%{kind}\t%{line}"), filePath});
+    beginResetModel();
+    m_rows.clear();
+    endResetModel();
+    m_extractor->extract({filePath});
+}
 
-    QByteArray out;
-    if (p.waitForFinished()) {
-        out = p.readAllStandardOutput();
+void GotoSymbolModel::setSymbols(const QVector<SymbolItem> &symbols)
+{
+    beginResetModel();
+    if (!symbols.isEmpty()) {
+        m_rows = symbols;
     } else {
-        beginResetModel();
-        m_rows.append(SymbolItem{i18n("CTags executable failed to execute."), -1, QIcon()});
-        endResetModel();
-        return;
-    }
-
-    QVector<SymbolItem> symItems;
-    const auto tags = out.split('\n');
-    symItems.reserve(tags.size());
-    for (const auto &tag : tags) {
-        const auto items = tag.split('\t');
-        if (items.isEmpty() || items.count() < 3) {
-            continue;
-        }
-
-        SymbolItem item;
-        item.name = QLatin1String(items.at(0));
-        // this happens in markdown names for some reason
-        if (item.name.endsWith(QLatin1Char('-'))) {
-            item.name.chop(1);
-        }
-
-        switch (items.at(1).at(0)) {
-        case 'f':
-            item.icon = funcIcon;
-            break;
-        case 'm':
-            if (items.at(1) == "method") {
-                item.icon = funcIcon;
-            } else {
-                item.icon = defIcon;
-            }
-            break;
-        case 'g':
-            if (items.at(1) == "getter") {
-                item.icon = funcIcon;
-            } else {
-                item.icon = defIcon;
-            }
-            break;
-        case 'c':
-        case 's':
-            if (items.at(1) == "class" || items.at(1) == "struct") {
-                item.icon = classIcon;
-            } else {
-                item.icon = defIcon;
-            }
-            break;
-        case 'n':
-            if (items.at(1) == "namespace") {
-                item.icon = nsIcon;
-            }
-            break;
-        case 'v':
-            item.icon = varIcon;
-            break;
-        default:
-            item.icon = defIcon;
-            break;
-        }
-
-        item.line = items.at(2).toInt();
-        symItems.append(item);
+        m_rows = {SymbolItem{i18n("CTags was unable to parse this file."), -1, QIcon()}};
     }
+    endResetModel();
+}
 
+void GotoSymbolModel::setError(const QString &error)
+{
     beginResetModel();
-    if (!symItems.isEmpty()) {
-        m_rows = std::move(symItems);
-    } else {
-        m_rows.append(SymbolItem{i18n("CTags was unable to parse this file."), -1, QIcon()});
-    }
+    m_rows = {SymbolItem{error, -1, QIcon()}};
     endResetModel();
 }
@@ -6,31 +6,35 @@
 #ifndef GOTOSYMBOLMODEL_H
 #define GOTOSYMBOLMODEL_H
 
+#include "gotosymbolextractor.h"
+
 #include <QAbstractTableModel>
-#include <QIcon>
 #include <QString>
 #include <QVector>
 
-struct SymbolItem {
-    QString name;
-    int line;
-    QIcon icon;
-};
-
 class GotoSymbolModel : public QAbstractTableModel
 {
     Q_OBJECT
 
 public:
-    explicit GotoSymbolModel(QObject *parent = nullptr);
+    explicit GotoSymbolModel(GotoSymbolExtractor *extractor, QObject *parent = nullptr);
 
     int columnCount(const QModelIndex &parent = QModelIndex()) const override;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role) const override;
 
+    /**
+     * Show the symbols of the file.
+     * Cached symbols are shown at once, else the model is empty until ctags is done.
+     */
     void refresh(const QString &filePath);
 
 private:
+    void setSymbols(const QVector<SymbolItem> &symbols);
+    void setError(const QString &error);
+
+    GotoSymbolExtractor *const m_extractor;
+    QString m_filePath;
     QVector<SymbolItem> m_rows;
 };
 
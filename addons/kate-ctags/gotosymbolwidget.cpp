@@ -155,7 +155,7 @@ GotoSymbolWidget::GotoSymbolWidget(KTextEditor::MainWindow *mainWindow, KateCTag
     m_proxyModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
     m_proxyModel->setFilterKeyColumn(0);
 
-    m_symbolsModel = new GotoSymbolModel(this);
+    m_symbolsModel = new GotoSymbolModel(pluginView->symbolExtractor(), this);
     m_globalSymbolsModel = new GotoGlobalSymbolModel(this);
 
     m_proxyModel->setSourceModel(m_symbolsModel);
@@ -172,6 +172,13 @@ GotoSymbolWidget::GotoSymbolWidget(KTextEditor::MainWindow *mainWindow, KateCTag
     connect(m_treeView, &QTreeView::activated, this, &GotoSymbolWidget::slotReturnPressed);
     connect(m_proxyModel, &QSortFilterProxyModel::rowsInserted, this, &GotoSymbolWidget::reselectFirst);
     connect(m_proxyModel, &QSortFilterProxyModel::rowsRemoved, this, &GotoSymbolWidget::reselectFirst);
+    // the local symbols arrive once ctags is done, unless they are cached
+    connect(m_symbolsModel, &GotoSymbolModel::modelReset, this, [this]() {
+        if (mode == Local) {
+            updateViewGeometry();
+            reselectFirst();
+        }
+    });
 
     QVBoxLayout *layout = new QVBoxLayout();
     layout->setSpacing(0);
@@ -229,8 +236,6 @@ void GotoSymbolWidget::showSymbols(const QString &filePath)
     changeMode(Local);
     oldPos = m_mainWindow->activeView()->cursorPosition();
     m_symbolsModel->refresh(filePath);
-    updateViewGeometry();
-    reselectFirst();
 }
 
 void GotoSymbolWidget::showGlobalSymbols(const QString &tagFilePath)
@@ -252,8 +257,12 @@ void GotoSymbolWidget::loadGlobalSymbols(const QString &text)
         return;
     }
 
-    QString currentWord = text;
-    Tags::TagList list = Tags::getPartialMatchesNoi8n(m_tagFile, currentWord);
+    // the proxy model filters by all words, the tags only need to start with the first one
+    // a prefix is a binary search in the sorted index, no scan of all tags per keystroke
+    // keep the list short, the view and the filtering can't cope with millions of rows
+    const int maxSymbols = 2000;
+    const QString currentWord = text.section(QLatin1Char(' '), 0, 0, QString::SectionSkipEmpty);
+    Tags::TagList list = Tags::getMatchesNoi8n(m_tagFile, currentWord, TagsIndex::PrefixMatch, maxSymbols);
 
     if (list.isEmpty()) {
         return;
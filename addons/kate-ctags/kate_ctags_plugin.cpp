@@ -222,7 +222,8 @@ void KateCTagsConfigPage::updateGlobalDB()
         return;
     }
 
-    QString commandLine = QStringLiteral("%1 -f %2 %3").arg(m_confUi.cmdEdit->text(), file, targets);
+    // ctags writes a new file, the current one might be mapped by the tags index
+    QString commandLine = QStringLiteral("%1 -f %2 %3").arg(m_confUi.cmdEdit->text(), file + QStringLiteral(".new"), targets);
     QStringList arguments = m_proc.splitCommand(commandLine);
     QString command = arguments.takeFirst();
     m_proc.start(command, arguments);
@@ -244,6 +245,13 @@ void KateCTagsConfigPage::updateDone(int exitCode, QProcess::ExitStatus status)
         KMessageBox::error(this, i18n("The CTags command exited with code %1", exitCode));
     }
 
+    const QString file = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/katectags/common_db");
+    if (status == QProcess::NormalExit && exitCode == 0) {
+        TagsIndex::replaceTagsFile(file + QStringLiteral(".new"), file);
+    } else {
+        QFile::remove(file + QStringLiteral(".new"));
+    }
+
     m_confUi.updateDB->setDisabled(false);
     QApplication::restoreOverrideCursor();
 }
@@ -29,6 +29,7 @@
 
 #include <KActionCollection>
 #include <KConfigGroup>
+#include <KTextEditor/Editor>
 #include <KXMLGUIFactory>
 #include <QMenu>
 
@@ -37,6 +38,8 @@
 #include <KStringHandler>
 #include <QStandardPaths>
 
+#include <algorithm>
+
 /******************************************************************/
 KateCTagsView::KateCTagsView(KTextEditor::Plugin *plugin, KTextEditor::MainWindow *mainWin)
     : QObject(mainWin)
@@ -134,6 +137,12 @@ KateCTagsView::KateCTagsView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
     });
 
     m_gotoSymbWidget.reset(new GotoSymbolWidget(mainWin, this));
+
+    // extract the local symbols of all open documents in the background, the local symbol view opens at once then
+    m_symbolExtractTimer.setSingleShot(true);
+    m_symbolExtractTimer.setInterval(1000);
+    connect(&m_symbolExtractTimer, &QTimer::timeout, this, &KateCTagsView::extractOpenDocumentSymbols);
+    connect(mainWin, &KTextEditor::MainWindow::viewChanged, &m_symbolExtractTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
     auto openLocal = actionCollection()->addAction(QStringLiteral("open_local_gts"));
     openLocal->setText(i18n("Go To Local Symbol"));
     actionCollection()->setDefaultShortcut(openLocal, Qt::CTRL | Qt::ALT | Qt::Key_P);
@@ -146,6 +155,23 @@ KateCTagsView::KateCTagsView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
 
     connect(m_ctagsUi.inputEdit, &QLineEdit::textChanged, this, &KateCTagsView::startEditTmr);
 
+    connect(&m_tagsUpdater, &TagsUpdater::finished, this, &KateCTagsView::incrementalUpdateDone);
+    m_ctagsUi.updateOnSave->setEnabled(false);
+    connect(m_ctagsUi.incrementalUpdate, &QCheckBox::toggled, m_ctagsUi.updateOnSave, &QCheckBox::setEnabled);
+
+    // update the database a bit after saving, saving all documents triggers just one update
+    m_saveUpdateTimer.setSingleShot(true);
+    m_saveUpdateTimer.setInterval(2000);
+    connect(&m_saveUpdateTimer, &QTimer::timeout, this, &KateCTagsView::updateAfterSave);
+    const auto watchDocument = [this](KTextEditor::Document *document) {
+        connect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateCTagsView::documentSaved);
+    };
+    const auto documents = KTextEditor::Editor::instance()->application()->documents();
+    for (auto document : documents) {
+        watchDocument(document);
+    }
+    connect(KTextEditor::Editor::instance()->application(), &KTextEditor::Application::documentCreated, this, watchDocument);
+
     m_editTimer.setSingleShot(true);
     connect(&m_editTimer, &QTimer::timeout, this, &KateCTagsView::editLookUp);
 
@@ -208,6 +234,9 @@ void KateCTagsView::readSessionConfig(const KConfigGroup &cg)
 
     QString sessionDB = cg.readEntry("SessionDatabase", QString());
     m_ctagsUi.tagsFile->setText(sessionDB);
+
+    m_ctagsUi.incrementalUpdate->setChecked(cg.readEntry("SessionIncrementalUpdate", false));
+    m_ctagsUi.updateOnSave->setChecked(cg.readEntry("SessionUpdateOnSave", false));
 }
 
 /******************************************************************/
@@ -223,6 +252,8 @@ void KateCTagsView::writeSessionConfig(KConfigGroup &cg)
     }
 
     cg.writeEntry("SessionDatabase", m_ctagsUi.tagsFile->text());
+    cg.writeEntry("SessionIncrementalUpdate", m_ctagsUi.incrementalUpdate->isChecked());
+    cg.writeEntry("SessionUpdateOnSave", m_ctagsUi.updateOnSave->isChecked());
 
     cg.sync();
 }
@@ -512,17 +543,13 @@ void KateCTagsView::startEditTmr()
 /******************************************************************/
 void KateCTagsView::updateSessionDB()
 {
-    if (m_proc.state() != QProcess::NotRunning) {
+    if (m_proc.state() != QProcess::NotRunning || m_tagsUpdater.isRunning()) {
         return;
     }
 
     QString targets;
-    QString target;
-    for (int i = 0; i < m_ctagsUi.targetList->count(); i++) {
-        target = m_ctagsUi.targetList->item(i)->text();
-        if (target.endsWith(QLatin1Char('/')) || target.endsWith(QLatin1Char('\\'))) {
-            target = target.left(target.size() - 1);
-        }
+    const QStringList targetList = sessionTargets();
+    for (const auto &target : targetList) {
         targets += QLatin1Char('\"') + target + QLatin1String("\" ");
     }
 
@@ -542,7 +569,17 @@ void KateCTagsView::updateSessionDB()
         return;
     }
 
-    QString commandLine = QStringLiteral("%1 -f %2 %3").arg(m_ctagsUi.cmdEdit->text(), m_ctagsUi.tagsFile->text(), targets);
+    // only the tags of new or changed files are generated, in the background
+    if (m_ctagsUi.incrementalUpdate->isChecked()) {
+        m_tagsUpdater.start(m_ctagsUi.tagsFile->text(), m_ctagsUi.cmdEdit->text(), targetList);
+        m_ctagsUi.updateButton->setDisabled(true);
+        m_ctagsUi.updateButton2->setDisabled(true);
+        return;
+    }
+
+    // ctags writes a new file, the current one might be mapped by the tags index
+    m_generatedTagsFile = m_ctagsUi.tagsFile->text();
+    QString commandLine = QStringLiteral("%1 -f %2 %3").arg(m_ctagsUi.cmdEdit->text(), m_generatedTagsFile + QStringLiteral(".new"), targets);
     QStringList arguments = m_proc.splitCommand(commandLine);
     QString command = arguments.takeFirst();
     m_proc.start(command, arguments);
@@ -565,11 +602,90 @@ void KateCTagsView::updateDone(int exitCode, QProcess::ExitStatus status)
         KMessageBox::error(m_toolView, i18n("The CTags program exited with code %1: %2", exitCode, QString::fromLocal8Bit(m_proc.readAllStandardError())));
     }
 
+    const QString newTagsFile = m_generatedTagsFile + QStringLiteral(".new");
+    if (status == QProcess::NormalExit && exitCode == 0) {
+        TagsIndex::replaceTagsFile(newTagsFile, m_generatedTagsFile);
+    } else {
+        QFile::remove(newTagsFile);
+    }
+
     m_ctagsUi.updateButton->setDisabled(false);
     m_ctagsUi.updateButton2->setDisabled(false);
     QApplication::restoreOverrideCursor();
 }
 
+/******************************************************************/
+void KateCTagsView::incrementalUpdateDone(const QString &error)
+{
+    m_ctagsUi.updateButton->setDisabled(false);
+    m_ctagsUi.updateButton2->setDisabled(false);
+
+    if (!error.isEmpty()) {
+        if (m_quietUpdate) {
+            qCWarning(KTECTAGS) << error;
+        } else {
+            KMessageBox::error(m_toolView, error);
+        }
+    }
+    m_quietUpdate = false;
+
+    // documents saved during the update
+    if (m_updateAfterSave) {
+        m_updateAfterSave = false;
+        m_saveUpdateTimer.start();
+    }
+}
+
+/******************************************************************/
+void KateCTagsView::documentSaved(KTextEditor::Document *document)
+{
+    if (!m_ctagsUi.incrementalUpdate->isChecked() || !m_ctagsUi.updateOnSave->isChecked() || m_ctagsUi.tagsFile->text().isEmpty()
+        || !document->url().isLocalFile()) {
+        return;
+    }
+
+    // only files of the targets are in the database
+    const QString fileName = document->url().toLocalFile();
+    const QStringList targets = sessionTargets();
+    const bool inTargets = std::any_of(targets.cbegin(), targets.cend(), [&fileName](const QString &target) {
+        return fileName == target || fileName.startsWith(target + QLatin1Char('/'));
+    });
+    if (inTargets) {
+        m_saveUpdateTimer.start();
+    }
+}
+
+/******************************************************************/
+void KateCTagsView::updateAfterSave()
+{
+    if (m_proc.state() != QProcess::NotRunning || m_tagsUpdater.isRunning()) {
+        m_updateAfterSave = true;
+        return;
+    }
+
+    // no message boxes popping up while typing
+    if (m_tagsUpdater.start(m_ctagsUi.tagsFile->text(), m_ctagsUi.cmdEdit->text(), sessionTargets())) {
+        m_quietUpdate = true;
+        m_ctagsUi.updateButton->setDisabled(true);
+        m_ctagsUi.updateButton2->setDisabled(true);
+    }
+}
+
+/******************************************************************/
+QStringList KateCTagsView::sessionTargets() const
+{
+    QStringList targets;
+    QString target;
+    for (int i = 0; i < m_ctagsUi.targetList->count(); i++) {
+        target = m_ctagsUi.targetList->item(i)->text();
+        if (target.endsWith(QLatin1Char('/')) || target.endsWith(QLatin1Char('\\'))) {
+            target = target.left(target.size() - 1);
+        }
+        targets.push_back(target);
+    }
+    return targets;
+}
+
 /******************************************************************/
 void KateCTagsView::addTagTarget()
 {
@@ -650,6 +766,18 @@ void KateCTagsView::showSymbols()
     m_gotoSymbWidget->setFocus();
 }
 
+void KateCTagsView::extractOpenDocumentSymbols()
+{
+    QStringList filePaths;
+    const auto documents = KTextEditor::Editor::instance()->application()->documents();
+    for (auto document : documents) {
+        if (document->url().isLocalFile()) {
+            filePaths.push_back(document->url().toLocalFile());
+        }
+    }
+    m_symbolExtractor.extract(filePaths);
+}
+
 void KateCTagsView::showGlobalSymbols()
 {
     m_gotoSymbWidget->showGlobalSymbols(m_ctagsUi.tagsFile->text());
@@ -37,9 +37,11 @@
 #include <QTimer>
 
 #include "tags.h"
+#include "tagsupdater.h"
 
 #include "ui_kate_ctags.h"
 
+#include "gotosymbolextractor.h"
 #include "gotosymbolwidget.h"
 
 const static QString DEFAULT_CTAGS_CMD = QStringLiteral("ctags -R --c++-types=+px --extra=+q --excmd=pattern --exclude=Makefile --exclude=.");
@@ -65,6 +67,11 @@ public:
 
     void jumpToTag(const QString &file, const QString &pattern, const QString &word);
 
+    GotoSymbolExtractor *symbolExtractor()
+    {
+        return &m_symbolExtractor;
+    }
+
 public Q_SLOTS:
     void gotoDefinition();
     void gotoDeclaration();
@@ -80,6 +87,7 @@ public Q_SLOTS:
 
     void updateSessionDB();
     void updateDone(int exitCode, QProcess::ExitStatus status);
+    void incrementalUpdateDone(const QString &error);
 
 protected:
     bool eventFilter(QObject *obj, QEvent *ev) override;
@@ -89,9 +97,13 @@ private Q_SLOTS:
     void handleEsc(QEvent *e);
     void showSymbols();
     void showGlobalSymbols();
+    void extractOpenDocumentSymbols();
+    void documentSaved(KTextEditor::Document *document);
+    void updateAfterSave();
 
 private:
     bool listContains(const QString &target);
+    QStringList sessionTargets() const;
 
     QString currentWord();
 
@@ -103,6 +115,8 @@ private:
     QPointer<KTextEditor::MainWindow> m_mWin;
     QPointer<QWidget> m_toolView;
     Ui::kateCtags m_ctagsUi{};
+    GotoSymbolExtractor m_symbolExtractor;
+    QTimer m_symbolExtractTimer;
     std::unique_ptr<GotoSymbolWidget> m_gotoSymbWidget;
 
     QPointer<KActionMenu> m_menu;
@@ -111,6 +125,15 @@ private:
     QAction *m_lookup;
 
     QProcess m_proc;
+    QString m_generatedTagsFile;
+
+    /**
+     * incremental updates of the session database, after saving they run without message boxes
+     */
+    TagsUpdater m_tagsUpdater;
+    QTimer m_saveUpdateTimer;
+    bool m_quietUpdate = false;
+    bool m_updateAfterSave = false;
     QString m_commonDB;
 
     QTimer m_editTimer;
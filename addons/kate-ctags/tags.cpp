@@ -6,12 +6,6 @@
  *                                                                         *
  ***************************************************************************/
 #include "tags.h"
-#include <stdio.h>
-
-namespace ctags
-{
-#include "readtags.h"
-}
 
 #include "ctagskinds.h"
 
@@ -31,56 +25,30 @@ Tags::TagEntry::TagEntry(const QString &tag, const QString &type, const QString
 
 bool Tags::hasTag(const QString &tag)
 {
-    ctags::tagFileInfo info;
-    ctags::tagFile *file = ctags::tagsOpen(_tagsfile.toLocal8Bit().constData(), &info);
-    ctags::tagEntry entry;
-
-    bool found = (ctags::tagsFind(file, &entry, tag.toLocal8Bit().constData(), TAG_FULLMATCH | TAG_OBSERVECASE) == ctags::TagSuccess);
-
-    ctags::tagsClose(file);
-
-    return found;
+    return TagsIndex::index(_tagsfile)->count(tag, TagsIndex::ExactMatch) > 0;
 }
 
 bool Tags::hasTag(const QString &fileName, const QString &tag)
 {
     setTagsFile(fileName);
-    ctags::tagFileInfo info;
-    ctags::tagFile *file = ctags::tagsOpen(_tagsfile.toLocal8Bit().constData(), &info);
-    ctags::tagEntry entry;
-
-    bool found = (ctags::tagsFind(file, &entry, tag.toLocal8Bit().constData(), TAG_FULLMATCH | TAG_OBSERVECASE) == ctags::TagSuccess);
-
-    ctags::tagsClose(file);
-
-    return found;
+    return hasTag(tag);
 }
 
 unsigned int Tags::numberOfMatches(const QString &tagpart, bool partial)
 {
-    unsigned int n = 0;
-
     if (tagpart.isEmpty()) {
         return 0;
     }
 
-    ctags::tagFileInfo info;
-    ctags::tagFile *file = ctags::tagsOpen(_tagsfile.toLocal8Bit().constData(), &info);
-    ctags::tagEntry entry;
-
-    QByteArray tagpartBArray = tagpart.toLocal8Bit(); // for holding the char *
-    if (ctags::tagsFind(file, &entry, tagpartBArray.data(), TAG_OBSERVECASE | (partial ? TAG_PARTIALMATCH : TAG_FULLMATCH)) == ctags::TagSuccess) {
-        do {
-            n++;
-        } while (ctags::tagsFindNext(file, &entry) == ctags::TagSuccess);
-    }
-
-    ctags::tagsClose(file);
-
-    return n;
+    return TagsIndex::index(_tagsfile)->count(tagpart, partial ? TagsIndex::PrefixMatch : TagsIndex::ExactMatch);
 }
 
 Tags::TagList Tags::getPartialMatchesNoi8n(const QString &tagFile, const QString &tagpart)
+{
+    return getMatchesNoi8n(tagFile, tagpart, TagsIndex::PrefixMatch);
+}
+
+Tags::TagList Tags::getMatchesNoi8n(const QString &tagFile, const QString &tagpart, TagsIndex::MatchType matchType, int maxMatches)
 {
     setTagsFile(tagFile);
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
@@ -106,26 +74,19 @@ Tags::TagList Tags::getPartialMatchesNoi8n(const QString &tagFile, const QString
         return list;
     }
 
-    ctags::tagFileInfo info;
-    ctags::tagFile *file = ctags::tagsOpen(_tagsfile.toLocal8Bit().constData(), &info);
-    ctags::tagEntry entry;
-
-    QByteArray tagpartBArray = tagpart.toLocal8Bit(); // for holding the char *
-    if (ctags::tagsFind(file, &entry, tagpartBArray.data(), TAG_OBSERVECASE | TAG_PARTIALMATCH) == ctags::TagSuccess) {
-        do {
-            QString file = QString::fromLocal8Bit(entry.file);
-            QString type(CTagsKinds::findKindNoi18n(entry.kind, getExtension(file)));
+    const auto tags = TagsIndex::index(_tagsfile)->matches(tagpart, matchType, maxMatches);
+    list.reserve(tags.size());
+    for (const auto &entry : tags) {
+        QString file = QString::fromLocal8Bit(entry.file);
+        QString type(CTagsKinds::findKindNoi18n(entry.kind.isEmpty() ? nullptr : entry.kind.constData(), getExtension(file)));
 
-            if (type.isEmpty() && file.endsWith(QLatin1String("Makefile"))) {
-                type = QStringLiteral("macro");
-            }
+        if (type.isEmpty() && file.endsWith(QLatin1String("Makefile"))) {
+            type = QStringLiteral("macro");
+        }
 
-            list << TagEntry(QString::fromLocal8Bit(entry.name), type, file, QString::fromLocal8Bit(entry.address.pattern));
-        } while (ctags::tagsFindNext(file, &entry) == ctags::TagSuccess);
+        list << TagEntry(QString::fromLocal8Bit(entry.name), type, file, QString::fromLocal8Bit(entry.pattern));
     }
 
-    ctags::tagsClose(file);
-
     return list;
 }
 
@@ -137,26 +98,18 @@ Tags::TagList Tags::getMatches(const QString &tagpart, bool partial, const QStri
         return list;
     }
 
-    ctags::tagFileInfo info;
-    ctags::tagFile *file = ctags::tagsOpen(_tagsfile.toLocal8Bit().constData(), &info);
-    ctags::tagEntry entry;
-
-    QByteArray tagpartBArray = tagpart.toLocal8Bit(); // for holding the char *
-    if (ctags::tagsFind(file, &entry, tagpartBArray.data(), TAG_OBSERVECASE | (partial ? TAG_PARTIALMATCH : TAG_FULLMATCH)) == ctags::TagSuccess) {
-        do {
-            QString file = QString::fromLocal8Bit(entry.file);
-            QString type(CTagsKinds::findKind(entry.kind, file.section(QLatin1Char('.'), -1)));
-
-            if (type.isEmpty() && file.endsWith(QLatin1String("Makefile"))) {
-                type = QStringLiteral("macro");
-            }
-            if (types.isEmpty() || types.contains(QString::fromLocal8Bit(entry.kind))) {
-                list << TagEntry(QString::fromLocal8Bit(entry.name), type, file, QString::fromLocal8Bit(entry.address.pattern));
-            }
-        } while (ctags::tagsFindNext(file, &entry) == ctags::TagSuccess);
-    }
+    const auto tags = TagsIndex::index(_tagsfile)->matches(tagpart, partial ? TagsIndex::PrefixMatch : TagsIndex::ExactMatch);
+    for (const auto &entry : tags) {
+        QString file = QString::fromLocal8Bit(entry.file);
+        QString type(CTagsKinds::findKind(entry.kind.isEmpty() ? nullptr : entry.kind.constData(), file.section(QLatin1Char('.'), -1)));
 
-    ctags::tagsClose(file);
+        if (type.isEmpty() && file.endsWith(QLatin1String("Makefile"))) {
+            type = QStringLiteral("macro");
+        }
+        if (types.isEmpty() || types.contains(QString::fromLocal8Bit(entry.kind))) {
+            list << TagEntry(QString::fromLocal8Bit(entry.name), type, file, QString::fromLocal8Bit(entry.pattern));
+        }
+    }
 
     return list;
 }
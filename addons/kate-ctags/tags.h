@@ -9,6 +9,8 @@
 #ifndef TAGS_H
 #define TAGS_H
 
+#include "tagsindex.h"
+
 #include <QString>
 #include <QStringList>
 #include <QVector>
@@ -57,6 +59,15 @@ public:
     static TagList getMatches(const QString &file, const QString &tagpart, bool partial, const QStringList &types = QStringList());
     static TagList getPartialMatchesNoi8n(const QString &tagFile, const QString &tagpart);
 
+    /**
+     * Find tags with untranslated types, used by the goto symbol view.
+     * @param tagFile the tag database filename
+     * @param tagpart pattern to match the tag names against
+     * @param matchType how to match
+     * @param maxMatches stop after that many matches, -1 for no limit
+     */
+    static TagList getMatchesNoi8n(const QString &tagFile, const QString &tagpart, TagsIndex::MatchType matchType, int maxMatches = -1);
+
 private:
     static QString _tagsfile;
 };
@@ -0,0 +1,332 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#include "tagsindex.h"
+
+#include <kfts_fuzzy_match.h>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace
+{
+/**
+ * byte-wise comparison like the C locale sorting of ctags
+ */
+int compareNames(const char *l, int lSize, const char *r, int rSize)
+{
+    const int res = std::memcmp(l, r, std::min(lSize, rSize));
+    return res != 0 ? res : lSize - rSize;
+}
+
+char toLowerAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+/**
+ * case-insensitive for ASCII, the needle is lower case already
+ */
+bool containsLowered(const char *haystack, int haystackSize, const QByteArray &needle)
+{
+    const int last = haystackSize - needle.size();
+    for (int i = 0; i <= last; ++i) {
+        int j = 0;
+        while (j < needle.size() && toLowerAscii(haystack[i + j]) == needle[j]) {
+            ++j;
+        }
+        if (j == needle.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+std::shared_ptr<const TagsIndex> TagsIndex::index(const QString &tagsFileName)
+{
+    static QMutex mutex;
+    static QHash<QString, std::shared_ptr<const TagsIndex>> indices;
+
+    const QFileInfo info(tagsFileName);
+    QMutexLocker locker(&mutex);
+    auto &cached = indices[tagsFileName];
+    if (!cached || cached->m_lastModified != info.lastModified() || cached->m_size != info.size()) {
+        cached.reset(new TagsIndex(tagsFileName));
+    }
+    return cached;
+}
+
+bool TagsIndex::replaceTagsFile(const QString &newFileName, const QString &tagsFileName)
+{
+    // QFile::rename doesn't overwrite and removing first leaves a moment without tags file,
+    // replace it in one step, the old file is only unlinked, mappings of it stay intact
+#ifdef Q_OS_WIN
+    const bool replaced = MoveFileExW(reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(newFileName).utf16()),
+                                      reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(tagsFileName).utf16()),
+                                      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    const bool replaced = std::rename(QFile::encodeName(newFileName).constData(), QFile::encodeName(tagsFileName).constData()) == 0;
+#endif
+    if (!replaced) {
+        QFile::remove(newFileName);
+    }
+    return replaced;
+}
+
+TagsIndex::TagsIndex(const QString &tagsFileName)
+    : m_file(tagsFileName)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QFileInfo info(m_file);
+    m_lastModified = info.lastModified();
+    m_size = m_file.size();
+
+    // empty or special files can't be mapped
+    // on Windows an open or mapped file can't be replaced, the content is read and the file closed
+#ifndef Q_OS_WIN
+    if (uchar *mapped = m_size > 0 ? m_file.map(0, m_size) : nullptr) {
+        m_begin = reinterpret_cast<const char *>(mapped);
+        m_end = m_begin + m_size;
+    } else
+#endif
+    {
+        m_buffer = m_file.readAll();
+        m_begin = m_buffer.constData();
+        m_end = m_begin + m_buffer.size();
+#ifdef Q_OS_WIN
+        m_file.close();
+#endif
+    }
+
+    // collect the tag lines, skip the pseudo tags and broken lines
+    bool sorted = true;
+    Name last{nullptr, 0};
+    for (const char *line = m_begin; line < m_end;) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(line, '\n', m_end - line));
+        if (!lineEnd) {
+            lineEnd = m_end;
+        }
+
+        const char *tab = static_cast<const char *>(std::memchr(line, '\t', lineEnd - line));
+        if (tab && tab > line && !(lineEnd - line >= 2 && line[0] == '!' && line[1] == '_')) {
+            const Name current{line, int(tab - line)};
+            if (sorted && last.data && compareNames(last.data, last.size, current.data, current.size) > 0) {
+                sorted = false;
+            }
+            last = current;
+            m_lines.push_back(line - m_begin);
+        }
+        line = lineEnd + 1;
+    }
+
+    // unsorted files, e.g. generated with --sort=no or case-folded, are sorted here once
+    if (!sorted) {
+        std::stable_sort(m_lines.begin(), m_lines.end(), [this](qint64 l, qint64 r) {
+            const Name lName = name(l);
+            const Name rName = name(r);
+            return compareNames(lName.data, lName.size, rName.data, rName.size) < 0;
+        });
+    }
+}
+
+TagsIndex::~TagsIndex() = default;
+
+TagsIndex::Name TagsIndex::name(qint64 offset) const
+{
+    // indexed lines always have a tab after the name
+    const char *begin = m_begin + offset;
+    const char *tab = static_cast<const char *>(std::memchr(begin, '\t', m_end - begin));
+    return {begin, int(tab - begin)};
+}
+
+TagsIndex::Tag TagsIndex::tag(qint64 offset) const
+{
+    const char *begin = m_begin + offset;
+    const char *end = static_cast<const char *>(std::memchr(begin, '\n', m_end - begin));
+    if (!end) {
+        end = m_end;
+    }
+    if (end > begin && end[-1] == '\r') {
+        --end;
+    }
+
+    // same parsing as readtags: name, file, address and the optional extension fields
+    Tag tag;
+    const char *tab = static_cast<const char *>(std::memchr(begin, '\t', end - begin));
+    tag.name = QByteArray(begin, tab - begin);
+
+    const char *p = tab + 1;
+    tab = static_cast<const char *>(std::memchr(p, '\t', end - p));
+    if (!tab) {
+        tag.file = QByteArray(p, end - p);
+        return tag;
+    }
+    tag.file = QByteArray(p, tab - p);
+
+    // the address is a search pattern or a line number
+    p = tab + 1;
+    const char *addressEnd = p;
+    if (p < end && (*p == '/' || *p == '?')) {
+        const char delimiter = *p;
+        ++addressEnd;
+        while (addressEnd < end && (*addressEnd != delimiter || addressEnd[-1] == '\\')) {
+            ++addressEnd;
+        }
+        if (addressEnd < end) {
+            ++addressEnd;
+        }
+    } else {
+        while (addressEnd < end && *addressEnd >= '0' && *addressEnd <= '9') {
+            ++addressEnd;
+        }
+    }
+    tag.pattern = QByteArray(p, addressEnd - p);
+
+    // the kind is either a field without key or the "kind" field
+    if (end - addressEnd < 2 || addressEnd[0] != ';' || addressEnd[1] != '"') {
+        return tag;
+    }
+    for (p = addressEnd + 2; p < end;) {
+        while (p < end && *p == '\t') {
+            ++p;
+        }
+        const char *fieldEnd = static_cast<const char *>(std::memchr(p, '\t', end - p));
+        if (!fieldEnd) {
+            fieldEnd = end;
+        }
+        if (fieldEnd > p) {
+            const char *colon = static_cast<const char *>(std::memchr(p, ':', fieldEnd - p));
+            if (!colon) {
+                tag.kind = QByteArray(p, fieldEnd - p);
+            } else if (colon - p == 4 && std::memcmp(p, "kind", 4) == 0) {
+                tag.kind = QByteArray(colon + 1, fieldEnd - colon - 1);
+            }
+        }
+        p = fieldEnd;
+    }
+    return tag;
+}
+
+void TagsIndex::forEachMatch(const QByteArray &pattern, MatchType type, const std::function<bool(qint64)> &func) const
+{
+    if (type == SubstringMatch) {
+        QByteArray needle = pattern;
+        std::transform(needle.begin(), needle.end(), needle.begin(), toLowerAscii);
+        for (const qint64 line : m_lines) {
+            const Name n = name(line);
+            if (containsLowered(n.data, n.size, needle) && !func(line)) {
+                return;
+            }
+        }
+        return;
+    }
+
+    // exact and prefix matches are one range of the sorted lines
+    auto it = std::lower_bound(m_lines.cbegin(), m_lines.cend(), pattern, [this](qint64 line, const QByteArray &pattern) {
+        const Name n = name(line);
+        return compareNames(n.data, n.size, pattern.constData(), pattern.size()) < 0;
+    });
+    for (; it != m_lines.cend(); ++it) {
+        const Name n = name(*it);
+        const bool match = type == ExactMatch ? compareNames(n.data, n.size, pattern.constData(), pattern.size()) == 0
+                                              : (n.size >= pattern.size() && std::memcmp(n.data, pattern.constData(), pattern.size()) == 0);
+        if (!match || !func(*it)) {
+            return;
+        }
+    }
+}
+
+std::vector<qint64> TagsIndex::fuzzyMatches(const QString &pattern, int maxMatches) const
+{
+    std::vector<qint64> result;
+    if (pattern.isEmpty() || maxMatches == 0) {
+        return result;
+    }
+
+    // like in quick open, the first character must match, that avoids decoding most names
+    const QChar first = pattern.at(0);
+    const bool asciiFirst = first.unicode() < 128;
+    const char firstLower = toLowerAscii(char(first.unicode()));
+
+    std::vector<std::pair<int, qint64>> scored;
+    for (const qint64 line : m_lines) {
+        const Name n = name(line);
+        if (asciiFirst && toLowerAscii(n.data[0]) != firstLower) {
+            continue;
+        }
+        int score = 0;
+        if (kfts::fuzzy_match(pattern, QString::fromLocal8Bit(n.data, n.size), score)) {
+            scored.emplace_back(score, line);
+        }
+    }
+
+    const size_t keep = maxMatches < 0 ? scored.size() : std::min<size_t>(maxMatches, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + keep, scored.end(), [](const auto &l, const auto &r) {
+        return l.first > r.first;
+    });
+    result.reserve(keep);
+    for (size_t i = 0; i < keep; ++i) {
+        result.push_back(scored[i].second);
+    }
+    return result;
+}
+
+QVector<TagsIndex::Tag> TagsIndex::matches(const QString &pattern, MatchType type, int maxMatches) const
+{
+    QVector<Tag> tags;
+    if (pattern.isEmpty() || maxMatches == 0) {
+        return tags;
+    }
+
+    if (type == FuzzyMatch) {
+        const auto lines = fuzzyMatches(pattern, maxMatches);
+        tags.reserve(int(lines.size()));
+        for (const qint64 line : lines) {
+            tags.push_back(tag(line));
+        }
+        return tags;
+    }
+
+    forEachMatch(pattern.toLocal8Bit(), type, [this, &tags, maxMatches](qint64 line) {
+        tags.push_back(tag(line));
+        return maxMatches < 0 || tags.size() < maxMatches;
+    });
+    return tags;
+}
+
+int TagsIndex::count(const QString &pattern, MatchType type) const
+{
+    if (pattern.isEmpty()) {
+        return 0;
+    }
+
+    if (type == FuzzyMatch) {
+        return int(fuzzyMatches(pattern, -1).size());
+    }
+
+    int n = 0;
+    forEachMatch(pattern.toLocal8Bit(), type, [&n](qint64) {
+        ++n;
+        return true;
+    });
+    return n;
+}
@@ -0,0 +1,150 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef TAGSINDEX_H
+#define TAGSINDEX_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * Read-only index of a ctags file.
+ *
+ * The tags file is memory-mapped once (read once on Windows), only the offsets of the lines are kept,
+ * sorted by tag name. Lookups don't open or read the file again, prefix and exact
+ * lookups are binary searches, substring and fuzzy lookups scan the names only.
+ *
+ * Indices are shared process wide and reloaded if the tags file changes. A tags file
+ * must not be rewritten in place while it is indexed, use replaceTagsFile().
+ */
+class TagsIndex
+{
+public:
+    enum MatchType {
+        ExactMatch, ///< name equals the pattern, case-sensitive
+        PrefixMatch, ///< name starts with the pattern, case-sensitive
+        SubstringMatch, ///< name contains the pattern, case-insensitive
+        FuzzyMatch ///< name fuzzy matches the pattern like in quick open, best matches first
+    };
+
+    /**
+     * One line of the tags file, the strings are still in the local 8 bit encoding.
+     */
+    struct Tag {
+        QByteArray name;
+        QByteArray file;
+        QByteArray pattern; ///< search pattern or line number
+        QByteArray kind; ///< empty if not known
+    };
+
+    /**
+     * Get the index of a tags file.
+     * Loads the file the first time or if it did change since the last load.
+     * Thread-safe, the returned index is immutable and stays usable if the file is reloaded.
+     * @param tagsFileName ctags file
+     * @return index, invalid if the file can't be read
+     */
+    static std::shared_ptr<const TagsIndex> index(const QString &tagsFileName);
+
+    /**
+     * Move a newly generated tags file to its final place, atomically replacing the old one.
+     * The old file is unlinked and not truncated, so indices still mapping it stay valid.
+     * @param newFileName the new tags file, it is removed in any case
+     * @param tagsFileName the tags file to replace
+     * @return success?
+     */
+    static bool replaceTagsFile(const QString &newFileName, const QString &tagsFileName);
+
+    ~TagsIndex();
+
+    TagsIndex(const TagsIndex &) = delete;
+    TagsIndex &operator=(const TagsIndex &) = delete;
+
+    /**
+     * @return could the tags file be read?
+     */
+    bool isValid() const
+    {
+        return m_begin != nullptr;
+    }
+
+    /**
+     * @return number of tags
+     */
+    int size() const
+    {
+        return int(m_lines.size());
+    }
+
+    /**
+     * Find the tags matching the pattern.
+     * @param pattern pattern to match the tag names against
+     * @param type how to match
+     * @param maxMatches stop after that many matches, -1 for no limit
+     * @return matching tags, sorted by name, for fuzzy matching best matches first
+     */
+    QVector<Tag> matches(const QString &pattern, MatchType type, int maxMatches = -1) const;
+
+    /**
+     * Count the tags matching the pattern, without decoding them.
+     * @param pattern pattern to match the tag names against
+     * @param type how to match
+     * @return number of matching tags
+     */
+    int count(const QString &pattern, MatchType type) const;
+
+private:
+    explicit TagsIndex(const QString &tagsFileName);
+
+    /**
+     * Call func for the offsets of all tags matching the pattern, in name order.
+     * Stops if func returns false. Not usable for fuzzy matching.
+     */
+    void forEachMatch(const QByteArray &pattern, MatchType type, const std::function<bool(qint64)> &func) const;
+
+    /**
+     * Offsets of the best fuzzy matches, best first.
+     */
+    std::vector<qint64> fuzzyMatches(const QString &pattern, int maxMatches) const;
+
+    /**
+     * Name of a tag, pointing into the file content.
+     */
+    struct Name {
+        const char *data;
+        int size;
+    };
+    Name name(qint64 offset) const;
+
+    /**
+     * @return the fully parsed line at the offset
+     */
+    Tag tag(qint64 offset) const;
+
+    QFile m_file;
+    QDateTime m_lastModified;
+    qint64 m_size = 0;
+
+    /**
+     * the file content: mapped, or read into m_buffer if mapping is impossible
+     */
+    QByteArray m_buffer;
+    const char *m_begin = nullptr;
+    const char *m_end = nullptr;
+
+    /**
+     * offsets of the tag lines, sorted by name, in file order for equal names
+     */
+    std::vector<qint64> m_lines;
+};
+
+#endif // TAGSINDEX_H
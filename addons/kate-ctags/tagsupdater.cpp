@@ -0,0 +1,393 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#include "tagsupdater.h"
+
+#include <KLocalizedString>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QHash>
+#include <QProcess>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <atomic>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+/**
+ * persistent per-file tags cache format, bump version on changes
+ */
+const quint32 CacheMagic = 0x4b435453;
+const quint32 CacheVersion = 1;
+
+/**
+ * files passed to one ctags process, chunks are indexed in parallel
+ */
+const int ChunkSize = 1000;
+
+/**
+ * header of the databases we write, the lines are sorted byte-wise
+ */
+const char TagsHeader[] =
+    "!_TAG_FILE_FORMAT\t2\t/extended format; --format=1 will not append ;\" to lines/\n"
+    "!_TAG_FILE_SORTED\t1\t/0=unsorted, 1=sorted, 2=foldcase/\n";
+
+/**
+ * tags of one file, as cached between updates
+ */
+struct FileTags {
+    qint64 lastModified = 0;
+    qint64 size = 0;
+    QByteArray tags;
+    bool needsIndexing = false; ///< new or changed, tags are the outdated ones if any
+};
+
+/**
+ * result of one or more ctags runs
+ */
+struct CtagsRun {
+    QString error;
+    bool inputError = false; ///< ctags ran but failed, maybe because of one of the files
+    QHash<QString, QByteArray> tags;
+    QStringList failedFiles;
+};
+
+/**
+ * Get the file field of a tag line: name TAB file TAB address...
+ */
+std::string_view tagFileField(std::string_view line)
+{
+    const auto start = line.find('\t');
+    if (start == std::string_view::npos) {
+        return {};
+    }
+    const auto end = line.find('\t', start + 1);
+    return line.substr(start + 1, (end == std::string_view::npos) ? std::string_view::npos : end - start - 1);
+}
+
+/**
+ * Split tags into lines, the views point into the given data.
+ */
+void appendTagLines(const QByteArray &tags, std::vector<std::string_view> &lines)
+{
+    std::string_view data(tags.constData(), tags.size());
+    while (!data.empty()) {
+        const auto end = data.find('\n');
+        const auto line = data.substr(0, end);
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+        if (end == std::string_view::npos) {
+            break;
+        }
+        data.remove_prefix(end + 1);
+    }
+}
+
+/**
+ * Run ctags for the given files, the output is split per file.
+ * ctags is killed if the update is canceled meanwhile.
+ */
+CtagsRun runCtags(const QString &program, const QStringList &options, const QStringList &files, const std::atomic<bool> &canceled)
+{
+    CtagsRun run;
+    if (canceled) {
+        run.error = i18n("The update was canceled.");
+        return run;
+    }
+
+    QProcess ctags;
+    ctags.start(program, QStringList{QStringLiteral("-L"), QStringLiteral("-"), QStringLiteral("-f"), QStringLiteral("-")} + options);
+    if (!ctags.waitForStarted()) {
+        run.error = i18n("Failed to run \"%1\". exitStatus = %2", program, ctags.exitStatus());
+        return run;
+    }
+
+    ctags.write(files.join(QLatin1Char('\n')).toLocal8Bit());
+    ctags.closeWriteChannel();
+
+    // poll to be able to kill ctags if the update is canceled
+    while (ctags.state() != QProcess::NotRunning && !ctags.waitForFinished(100)) {
+        if (canceled) {
+            ctags.kill();
+            ctags.waitForFinished();
+            run.error = i18n("The update was canceled.");
+            return run;
+        }
+    }
+    if (ctags.exitStatus() != QProcess::NormalExit) {
+        run.error = i18n("The CTags executable crashed.");
+        run.inputError = true;
+        return run;
+    }
+    if (ctags.exitCode() != 0) {
+        run.error = i18n("The CTags program exited with code %1: %2", ctags.exitCode(), QString::fromLocal8Bit(ctags.readAllStandardError()));
+        run.inputError = true;
+        return run;
+    }
+
+    const QByteArray output = ctags.readAllStandardOutput();
+    std::vector<std::string_view> lines;
+    appendTagLines(output, lines);
+    for (const auto &line : lines) {
+        if (line.substr(0, 2) == "!_") {
+            continue;
+        }
+        const auto file = tagFileField(line);
+        QByteArray &fileTags = run.tags[QString::fromLocal8Bit(file.data(), file.size())];
+        fileTags.append(line.data(), line.size());
+        fileTags.append('\n');
+    }
+    return run;
+}
+
+/**
+ * Index files ctags failed for with the given error, the halves are indexed again,
+ * one bad file only fails itself and not the whole chunk.
+ * If both halves fail the same way, the files are not looked at one by one, likely all of them fail.
+ */
+CtagsRun bisect(const QString &program, const QStringList &options, const QStringList &files, const QString &error, const std::atomic<bool> &canceled)
+{
+    const int half = files.size() / 2;
+    const QStringList halves[] = {files.mid(0, half), files.mid(half)};
+    CtagsRun runs[] = {runCtags(program, options, halves[0], canceled), runCtags(program, options, halves[1], canceled)};
+
+    CtagsRun run;
+    if (runs[0].error == error && runs[1].error == error) {
+        run.error = error;
+        run.failedFiles = files;
+        return run;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        if (!runs[i].error.isEmpty() && runs[i].inputError && halves[i].size() > 1 && !canceled) {
+            runs[i] = bisect(program, options, halves[i], runs[i].error, canceled);
+        } else if (!runs[i].error.isEmpty()) {
+            runs[i].failedFiles = halves[i];
+        }
+        run.tags.insert(runs[i].tags);
+        run.failedFiles += runs[i].failedFiles;
+        if (run.error.isEmpty()) {
+            run.error = runs[i].error;
+        }
+    }
+    return run;
+}
+
+/**
+ * Index the given files, on failure the files ctags fails for are searched.
+ */
+CtagsRun indexFiles(const QString &program, const QStringList &options, const QStringList &files, const std::atomic<bool> &canceled)
+{
+    CtagsRun run = runCtags(program, options, files, canceled);
+    if (run.error.isEmpty()) {
+        return run;
+    }
+    if (!run.inputError || files.size() == 1 || canceled) {
+        run.failedFiles = files;
+        return run;
+    }
+    return bisect(program, options, files, run.error, canceled);
+}
+}
+
+TagsUpdater::TagsUpdater(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<QString>::finished, this, [this]() {
+        Q_EMIT finished(m_watcher.result());
+    });
+}
+
+TagsUpdater::~TagsUpdater()
+{
+    // the database must not be left behind half written, running ctags processes are killed
+    disconnect(&m_watcher, nullptr, this, nullptr);
+    m_canceled = true;
+    m_watcher.waitForFinished();
+}
+
+bool TagsUpdater::start(const QString &tagsFile, const QString &command, const QStringList &targets)
+{
+    if (isRunning()) {
+        return false;
+    }
+
+    m_canceled = false;
+    m_watcher.setFuture(QtConcurrent::run(&TagsUpdater::update, tagsFile, command, targets, &m_canceled));
+    return true;
+}
+
+QString TagsUpdater::update(const QString &tagsFile, const QString &command, const QStringList &targets, const std::atomic<bool> *canceled)
+{
+    // the configured command, we pass the files ourselves
+    QStringList options = QProcess::splitCommand(command);
+    if (options.isEmpty()) {
+        return i18n("No CTags command configured");
+    }
+    const QString program = QStandardPaths::findExecutable(options.takeFirst());
+    if (program.isEmpty()) {
+        return i18n("CTags executable not found.");
+    }
+    options.removeAll(QStringLiteral("-R"));
+    options.removeAll(QStringLiteral("--recurse"));
+    options.removeAll(QStringLiteral("--recurse=yes"));
+
+    // all files of the targets, hidden ones are skipped like ctags does for --exclude=.
+    std::vector<std::pair<QString, FileTags>> entries;
+    QSet<QString> seen;
+    for (const auto &target : targets) {
+        const QFileInfo info(target);
+        if (info.isFile()) {
+            if (!seen.contains(info.absoluteFilePath())) {
+                seen.insert(info.absoluteFilePath());
+                entries.emplace_back(info.absoluteFilePath(), FileTags());
+            }
+            continue;
+        }
+        QDirIterator it(target, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString fileName = it.next();
+            if (!seen.contains(fileName)) {
+                seen.insert(fileName);
+                entries.emplace_back(fileName, FileTags());
+            }
+        }
+    }
+    seen.clear();
+
+    // read the per-file tags of the last update, it is just a cache, on any error or another command we start from scratch
+    const QString cacheFileName = tagsFile + QStringLiteral(".cache");
+    QHash<QString, FileTags> cached;
+    QFile cacheFile(cacheFileName);
+    if (cacheFile.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&cacheFile);
+        quint32 magic = 0;
+        quint32 version = 0;
+        QString cachedCommand;
+        quint32 count = 0;
+        stream >> magic >> version >> cachedCommand >> count;
+        if (magic == CacheMagic && version == CacheVersion && cachedCommand == command) {
+            for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+                QString fileName;
+                FileTags entry;
+                stream >> fileName >> entry.lastModified >> entry.size >> entry.tags;
+                cached[fileName] = entry;
+            }
+        }
+        if (stream.status() != QDataStream::Ok) {
+            cached.clear();
+        }
+        cacheFile.close();
+    }
+
+    // re-use cached tags of unchanged files, stat them in parallel
+    // the stamp is taken before ctags runs, files changed meanwhile are indexed again next time
+    QtConcurrent::blockingMap(entries, [&cached](std::pair<QString, FileTags> &item) {
+        auto &[fileName, entry] = item;
+        const QFileInfo info(fileName);
+        entry.lastModified = info.lastModified().toMSecsSinceEpoch();
+        entry.size = info.size();
+        const auto it = cached.constFind(fileName);
+        if (it != cached.cend()) {
+            // outdated tags are still better than none if ctags fails for the file
+            entry.tags = it->tags;
+        }
+        entry.needsIndexing = it == cached.cend() || it->lastModified != entry.lastModified || it->size != entry.size;
+    });
+    cached.clear();
+
+    // run ctags for all changed files, in chunks in parallel
+    QStringList changedFiles;
+    for (const auto &[fileName, entry] : entries) {
+        if (entry.needsIndexing) {
+            changedFiles.push_back(fileName);
+        }
+    }
+    QString error;
+    if (!changedFiles.isEmpty()) {
+        // a broken command fails for all files, find that out with one run and not by trying each file
+        const CtagsRun probe = runCtags(program, options, QStringList(), *canceled);
+        if (!probe.error.isEmpty()) {
+            return probe.error;
+        }
+
+        QVector<QStringList> chunks;
+        for (int i = 0; i < changedFiles.size(); i += ChunkSize) {
+            chunks.push_back(changedFiles.mid(i, ChunkSize));
+        }
+        const auto runs = QtConcurrent::blockingMapped<QVector<CtagsRun>>(chunks, [&program, &options, canceled](const QStringList &chunk) {
+            return indexFiles(program, options, chunk, *canceled);
+        });
+
+        // nobody waits for the result any longer
+        if (*canceled) {
+            return QString();
+        }
+
+        QSet<QString> failed;
+        QHash<QString, QByteArray> tags;
+        for (const auto &run : runs) {
+            if (!run.error.isEmpty()) {
+                error = run.error;
+            }
+            for (const auto &file : run.failedFiles) {
+                failed.insert(file);
+            }
+            tags.insert(run.tags);
+        }
+        QtConcurrent::blockingMap(entries, [&failed, &tags](std::pair<QString, FileTags> &item) {
+            auto &[fileName, entry] = item;
+            if (!entry.needsIndexing || failed.contains(fileName)) {
+                return;
+            }
+            entry.tags = tags.value(fileName);
+            entry.needsIndexing = false;
+        });
+    }
+
+    // write the updated cache back, atomically
+    // files ctags failed for keep their old tags with an invalid stamp, they are retried next time
+    QSaveFile saveFile(cacheFileName);
+    if (saveFile.open(QIODevice::WriteOnly)) {
+        QDataStream stream(&saveFile);
+        stream << CacheMagic << CacheVersion << command << quint32(entries.size());
+        for (const auto &[fileName, entry] : entries) {
+            stream << fileName << entry.lastModified << (entry.needsIndexing ? qint64(-1) : entry.size) << entry.tags;
+        }
+        saveFile.commit();
+    }
+
+    // merge all into the sorted database, it replaces the old one atomically
+    // the old file is only unlinked, indices still mapping it stay valid
+    std::vector<std::string_view> lines;
+    for (const auto &[fileName, entry] : entries) {
+        appendTagLines(entry.tags, lines);
+    }
+    std::sort(lines.begin(), lines.end());
+
+    QSaveFile file(tagsFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return i18n("Cannot write the CTags database %1", tagsFile);
+    }
+    file.write(TagsHeader);
+    for (const auto &line : lines) {
+        file.write(line.data(), line.size());
+        file.write("\n", 1);
+    }
+    if (!file.commit()) {
+        return i18n("Cannot write the CTags database %1", tagsFile);
+    }
+    return error;
+}
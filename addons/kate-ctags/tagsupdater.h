@@ -0,0 +1,76 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+#ifndef TAGSUPDATER_H
+#define TAGSUPDATER_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+
+/**
+ * Incremental update of a tags database in the background.
+ *
+ * The tags of each file are cached next to the database, with the modification time and
+ * size of the file. Only new or changed files of the targets are passed to ctags, in parallel
+ * chunks. Files ctags fails for keep their former tags and are retried with the next update.
+ * The cached and the new tags are merged into the byte-wise sorted database, which
+ * atomically replaces the old one.
+ */
+class TagsUpdater : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TagsUpdater(QObject *parent = nullptr);
+
+    /**
+     * Cancels a running update and waits for it, the database stays as it was.
+     */
+    ~TagsUpdater() override;
+
+    /**
+     * Start an update, if none is running.
+     * @param tagsFile the database to update
+     * @param command the ctags command as configured, recursion is done by us
+     * @param targets folders and files to index
+     * @return is the update started?
+     */
+    bool start(const QString &tagsFile, const QString &command, const QStringList &targets);
+
+    /**
+     * @return is an update running?
+     */
+    bool isRunning() const
+    {
+        return m_watcher.isRunning();
+    }
+
+Q_SIGNALS:
+    /**
+     * The update is done.
+     * @param error translated error message, empty on success
+     */
+    void finished(const QString &error);
+
+private:
+    /**
+     * The update itself, runs in the global thread pool.
+     * @return error message, empty on success
+     */
+    static QString update(const QString &tagsFile, const QString &command, const QStringList &targets, const std::atomic<bool> *canceled);
+
+    QFutureWatcher<QString> m_watcher;
+
+    /**
+     * set to stop a running update, polled by the workers
+     */
+    std::atomic<bool> m_canceled{false};
+};
+
+#endif // TAGSUPDATER_H
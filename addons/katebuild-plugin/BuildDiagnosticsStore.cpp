@@ -0,0 +1,117 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>   *
+ *                                                                         *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ ***************************************************************************/
+
+#include "BuildDiagnosticsStore.h"
+
+#include <KTextEditor/Document>
+#include <KTextEditor/MovingInterface>
+
+#include <algorithm>
+
+int BuildDiagnosticsStore::add(const BuildDiagnostic &diagnostic)
+{
+    const int index = int(m_entries.size());
+    m_entries.push_back({diagnostic, nullptr});
+
+    // only diagnostics with a location can be navigated to
+    if (diagnostic.fileName.isEmpty() || diagnostic.line <= 0) {
+        ++m_unlocated[diagnostic.category];
+        return index;
+    }
+
+    m_located[diagnostic.category].push_back(index);
+    m_allLocated.push_back(index);
+    m_byFile[diagnostic.fileName].push_back(index);
+    return index;
+}
+
+void BuildDiagnosticsStore::clear()
+{
+    m_entries.clear();
+    for (auto &located : m_located) {
+        located.clear();
+    }
+    m_allLocated.clear();
+    std::fill(std::begin(m_unlocated), std::end(m_unlocated), 0);
+    m_byFile.clear();
+    m_tracked.clear();
+}
+
+const std::vector<int> &BuildDiagnosticsStore::diagnosticsForFile(const QString &fileName) const
+{
+    static const std::vector<int> none;
+    const auto it = m_byFile.constFind(fileName);
+    return (it != m_byFile.cend()) ? *it : none;
+}
+
+int BuildDiagnosticsStore::next(int index, BuildDiagnostic::Category minCategory) const
+{
+    int result = -1;
+    for (int category = minCategory; category <= BuildDiagnostic::CategoryError; ++category) {
+        const auto &located = m_located[category];
+        const auto it = std::upper_bound(located.cbegin(), located.cend(), index);
+        if (it != located.cend() && (result < 0 || *it < result)) {
+            result = *it;
+        }
+    }
+    return result;
+}
+
+int BuildDiagnosticsStore::previous(int index, BuildDiagnostic::Category minCategory) const
+{
+    int result = -1;
+    for (int category = minCategory; category <= BuildDiagnostic::CategoryError; ++category) {
+        const auto &located = m_located[category];
+        const auto it = std::lower_bound(located.cbegin(), located.cend(), index);
+        if (it != located.cbegin()) {
+            result = std::max(result, *(it - 1));
+        }
+    }
+    return result;
+}
+
+int BuildDiagnosticsStore::located(int index) const
+{
+    const auto it = std::upper_bound(m_allLocated.cbegin(), m_allLocated.cend(), index);
+    return (it != m_allLocated.cbegin()) ? *(it - 1) : -1;
+}
+
+KTextEditor::Cursor BuildDiagnosticsStore::position(int index) const
+{
+    const Entry &entry = m_entries[index];
+    if (entry.cursor) {
+        return entry.cursor->toCursor();
+    }
+    return KTextEditor::Cursor(entry.diagnostic.line - 1, std::max(0, entry.diagnostic.column - 1));
+}
+
+void BuildDiagnosticsStore::track(KTextEditor::Document *document)
+{
+    auto iface = qobject_cast<KTextEditor::MovingInterface *>(document);
+    if (!iface) {
+        return;
+    }
+
+    // diagnostics might have been added since the last call
+    const auto &indices = diagnosticsForFile(document->url().toLocalFile());
+    for (int index : indices) {
+        Entry &entry = m_entries[index];
+        if (!entry.cursor) {
+            entry.cursor.reset(iface->newMovingCursor(position(index)));
+        }
+    }
+    m_tracked.insert(document, indices);
+}
+
+void BuildDiagnosticsStore::untrack(KTextEditor::Document *document)
+{
+    // the url might have changed meanwhile, use the diagnostics we did track
+    const std::vector<int> indices = m_tracked.take(document);
+    for (int index : indices) {
+        m_entries[index].cursor.reset();
+    }
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>   *
+ *                                                                         *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ ***************************************************************************/
+
+#ifndef BuildDiagnosticsStore_h
+#define BuildDiagnosticsStore_h
+
+#include "BuildOutputParser.h"
+
+#include <KTextEditor/Cursor>
+#include <KTextEditor/MovingCursor>
+
+#include <QHash>
+
+#include <memory>
+#include <vector>
+
+namespace KTextEditor
+{
+class Document;
+}
+
+/**
+ * All diagnostics of a build, in the order of the output.
+ * The index of a diagnostic is its row in the error list.
+ *
+ * Indexed by file and by category, that way the marks of a document and the
+ * navigation to the next or previous message don't need to look at all of them.
+ */
+class BuildDiagnosticsStore
+{
+public:
+    /**
+     * Add a diagnostic at the end.
+     * @return its index
+     */
+    int add(const BuildDiagnostic &diagnostic);
+
+    /**
+     * Remove all diagnostics.
+     */
+    void clear();
+
+    int size() const
+    {
+        return int(m_entries.size());
+    }
+
+    const BuildDiagnostic &diagnostic(int index) const
+    {
+        return m_entries[index].diagnostic;
+    }
+
+    /**
+     * @return number of diagnostics of the given category
+     */
+    int count(BuildDiagnostic::Category category) const
+    {
+        return int(m_located[category].size()) + m_unlocated[category];
+    }
+
+    /**
+     * @return indices of the diagnostics with a location in the given file, in output order
+     */
+    const std::vector<int> &diagnosticsForFile(const QString &fileName) const;
+
+    /**
+     * Next diagnostic with a location after the given index.
+     * @param index start index, -1 to start at the beginning
+     * @param minCategory only diagnostics with at least this category are considered
+     * @return index of the diagnostic, -1 if there is none
+     */
+    int next(int index, BuildDiagnostic::Category minCategory) const;
+
+    /**
+     * Previous diagnostic with a location before the given index.
+     * @param index start index, size() to start at the end
+     * @param minCategory only diagnostics with at least this category are considered
+     * @return index of the diagnostic, -1 if there is none
+     */
+    int previous(int index, BuildDiagnostic::Category minCategory) const;
+
+    /**
+     * @return the given diagnostic if it has a location, else the previous one with a location, -1 if there is none
+     */
+    int located(int index) const;
+
+    /**
+     * Location of the diagnostic in the document, follows the edits once it is tracked.
+     */
+    KTextEditor::Cursor position(int index) const;
+
+    /**
+     * Track the locations of the diagnostics in the document with moving cursors.
+     * Does nothing if the document doesn't support them, already tracked diagnostics are kept.
+     * Tracking must be stopped before the document is deleted.
+     */
+    void track(KTextEditor::Document *document);
+
+    /**
+     * Stop tracking the locations in the document, e.g. before it is reloaded or deleted.
+     */
+    void untrack(KTextEditor::Document *document);
+
+private:
+    struct Entry {
+        BuildDiagnostic diagnostic;
+        std::unique_ptr<KTextEditor::MovingCursor> cursor;
+    };
+
+    std::vector<Entry> m_entries;
+
+    /**
+     * indices of the diagnostics with location, one list per category and one for all
+     */
+    std::vector<int> m_located[BuildDiagnostic::CategoryError + 1];
+    std::vector<int> m_allLocated;
+    int m_unlocated[BuildDiagnostic::CategoryError + 1] = {};
+
+    /**
+     * indices of the diagnostics with location by file name
+     */
+    QHash<QString, std::vector<int>> m_byFile;
+
+    /**
+     * indices of the diagnostics with moving cursor by document
+     */
+    QHash<KTextEditor::Document *, std::vector<int>> m_tracked;
+};
+
+#endif
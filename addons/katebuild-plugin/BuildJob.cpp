@@ -0,0 +1,129 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>   *
+ *                                                                         *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ ***************************************************************************/
+
+#include "BuildJob.h"
+
+#include <KLocalizedString>
+
+#include <QThread>
+
+BuildJob::BuildJob(const QString &name, const QString &workDir, const QString &command, const QStringList &searchPaths, QObject *parent)
+    : QObject(parent)
+    , m_name(name)
+    , m_workDir(workDir)
+    , m_command(command)
+    , m_searchPaths(searchPaths)
+{
+    m_process.setOutputChannelMode(KProcess::SeparateChannels);
+    connect(&m_process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, [this](int exitCode) {
+        processExited(exitCode);
+    });
+    connect(&m_process, &KProcess::readyReadStandardError, this, [this]() {
+        readOutput(true);
+    });
+    connect(&m_process, &KProcess::readyReadStandardOutput, this, [this]() {
+        readOutput(false);
+    });
+}
+
+BuildJob::~BuildJob()
+{
+    if (m_process.state() != QProcess::NotRunning) {
+        m_process.terminate();
+        m_process.waitForFinished();
+    }
+
+    // the parser lives in its thread, queued calls for it are dropped once it is gone
+    if (m_parser) {
+        if (m_parser->thread()->isRunning()) {
+            m_parser->deleteLater();
+        } else {
+            delete m_parser;
+        }
+    }
+}
+
+bool BuildJob::start(QThread *parserThread)
+{
+    Q_ASSERT(m_state == Queued);
+    m_state = Running;
+
+    // ninja build tool sends all output to stdout,
+    // so follow https://github.com/ninja-build/ninja/issues/1537 to separate ninja and compiler output
+    auto env = QProcessEnvironment::systemEnvironment();
+    const auto nstatus = QStringLiteral("NINJA_STATUS");
+    auto curr = env.value(nstatus, QStringLiteral("[%f/%t] "));
+    // add marker to search on later on
+    env.insert(nstatus, BuildOutputParser::NinjaPrefix + curr);
+
+    // the parser lives in its own thread, it gets the output via queued calls
+    m_parser = new BuildOutputParser(m_workDir, m_searchPaths);
+    m_parser->moveToThread(parserThread);
+    connect(m_parser, &BuildOutputParser::outputParsed, this, [this](const QStringList &lines, const QVector<BuildDiagnostic> &diagnostics) {
+        m_output.appendLines(lines);
+        Q_EMIT diagnosticsParsed(diagnostics);
+    });
+    connect(m_parser, &BuildOutputParser::finished, this, &BuildJob::setFinished);
+
+    m_process.setProcessEnvironment(env);
+    m_process.setWorkingDirectory(m_workDir);
+    m_process.setShellCommand(m_command);
+    m_process.start();
+
+    if (!m_process.waitForStarted(500)) {
+        m_errorString = i18n("Failed to run \"%1\". exitStatus = %2", m_command, m_process.exitStatus());
+        m_exitCode = -1;
+        m_state = Finished;
+        return false;
+    }
+    return true;
+}
+
+void BuildJob::stop()
+{
+    switch (m_state) {
+    case Queued:
+        m_cancelled = true;
+        m_state = Finished;
+        Q_EMIT finished();
+        break;
+    case Running:
+        m_cancelled = true;
+        m_process.terminate();
+        break;
+    case Finished:
+        break;
+    }
+}
+
+void BuildJob::readOutput(bool stdErr)
+{
+    const QByteArray data = stdErr ? m_process.readAllStandardError() : m_process.readAllStandardOutput();
+    if (!data.isEmpty()) {
+        QMetaObject::invokeMethod(
+            m_parser,
+            [parser = m_parser, data, stdErr]() {
+                parser->addOutput(data, stdErr);
+            },
+            Qt::QueuedConnection);
+    }
+}
+
+void BuildJob::processExited(int exitCode)
+{
+    // the job is done once the parser is done with the remaining output
+    m_exitCode = exitCode;
+    readOutput(false);
+    readOutput(true);
+    QMetaObject::invokeMethod(m_parser, &BuildOutputParser::finish, Qt::QueuedConnection);
+}
+
+void BuildJob::setFinished()
+{
+    m_state = Finished;
+    Q_EMIT finished();
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>   *
+ *                                                                         *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ ***************************************************************************/
+
+#ifndef BuildJob_h
+#define BuildJob_h
+
+#include "BuildOutputModel.h"
+#include "BuildOutputParser.h"
+
+#include <KProcess>
+
+#include <QObject>
+
+class QThread;
+
+/**
+ * Build of one target: its process, the parser of its output and the output itself.
+ */
+class BuildJob : public QObject
+{
+    Q_OBJECT
+public:
+    enum State { Queued, Running, Finished };
+
+    /**
+     * @param name name of the target, for the user
+     * @param workDir directory to run the command in
+     * @param command shell command to run
+     * @param searchPaths further directories to look for the files in the messages, see BuildOutputParser
+     */
+    BuildJob(const QString &name, const QString &workDir, const QString &command, const QStringList &searchPaths, QObject *parent = nullptr);
+    ~BuildJob() override;
+
+    const QString &name() const
+    {
+        return m_name;
+    }
+
+    const QString &workDir() const
+    {
+        return m_workDir;
+    }
+
+    const QString &command() const
+    {
+        return m_command;
+    }
+
+    State state() const
+    {
+        return m_state;
+    }
+
+    /**
+     * @return exit code of the command, only valid once finished
+     */
+    int exitCode() const
+    {
+        return m_exitCode;
+    }
+
+    /**
+     * @return was the job stopped before it did finish?
+     */
+    bool wasCancelled() const
+    {
+        return m_cancelled;
+    }
+
+    /**
+     * @return why the command could not be started, empty if it did run
+     */
+    const QString &errorString() const
+    {
+        return m_errorString;
+    }
+
+    /**
+     * @return the full output of the build
+     */
+    BuildOutputModel *output()
+    {
+        return &m_output;
+    }
+
+    /**
+     * Start the command of a queued job.
+     * @param parserThread the output is parsed in this thread
+     * @return false if it could not be started, the job is finished then, but finished is not emitted
+     */
+    bool start(QThread *parserThread);
+
+    /**
+     * Stop the job, finished is emitted once it is done.
+     * Queued jobs are finished at once.
+     */
+    void stop();
+
+Q_SIGNALS:
+    /**
+     * New diagnostics in the output, the output lines are already added.
+     */
+    void diagnosticsParsed(const QVector<BuildDiagnostic> &diagnostics);
+
+    /**
+     * The process did exit and all of its output is parsed.
+     */
+    void finished();
+
+private:
+    void readOutput(bool stdErr);
+    void processExited(int exitCode);
+    void setFinished();
+
+    const QString m_name;
+    const QString m_workDir;
+    const QString m_command;
+    const QStringList m_searchPaths;
+
+    State m_state = Queued;
+    int m_exitCode = 0;
+    bool m_cancelled = false;
+    QString m_errorString;
+
+    KProcess m_process;
+    BuildOutputParser *m_parser = nullptr;
+    BuildOutputModel m_output;
+};
+
+#endif
@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>   *
+ *                                                                         *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ ***************************************************************************/
+
+#include "BuildOutputModel.h"
+
+#include <algorithm>
+
+int BuildOutputModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_lines.size());
+}
+
+QVariant BuildOutputModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= int(m_lines.size())) {
+        return QVariant();
+    }
+
+    // long lines are elided in the view, show them in full as tooltip
+    if (role == Qt::DisplayRole || role == Qt::ToolTipRole) {
+        return m_lines[index.row()];
+    }
+    return QVariant();
+}
+
+void BuildOutputModel::appendLines(const QStringList &lines)
+{
+    if (lines.isEmpty()) {
+        return;
+    }
+
+    const int first = int(m_lines.size());
+    beginInsertRows(QModelIndex(), first, first + lines.size() - 1);
+    m_lines.insert(m_lines.end(), lines.cbegin(), lines.cend());
+    endInsertRows();
+}
+
+void BuildOutputModel::clear()
+{
+    beginResetModel();
+    m_lines.clear();
+    endResetModel();
+}
+
+QString BuildOutputModel::text(const QModelIndexList &indexes) const
+{
+    std::vector<int> rows;
+    rows.reserve(indexes.size());
+    for (const auto &index : indexes) {
+        if (index.isValid() && index.row() < int(m_lines.size())) {
+            rows.push_back(index.row());
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+
+    QString text;
+    for (int row : rows) {
+        text += m_lines[row];
+        text += QLatin1Char('\n');
+    }
+    return text;
+}
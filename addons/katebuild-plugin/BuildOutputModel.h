@@ -0,0 +1,48 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>   *
+ *                                                                         *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ ***************************************************************************/
+
+#ifndef BuildOutputModel_h
+#define BuildOutputModel_h
+
+#include <QAbstractListModel>
+#include <QStringList>
+
+#include <vector>
+
+/**
+ * Append-only model for the full output of a build, one row per line.
+ * Shown in a list view with uniform item sizes, that way only the visible lines are laid out.
+ */
+class BuildOutputModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    using QAbstractListModel::QAbstractListModel;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    /**
+     * Add lines at the end, with just one insertion.
+     */
+    void appendLines(const QStringList &lines);
+
+    /**
+     * Remove all lines.
+     */
+    void clear();
+
+    /**
+     * @return the lines of the given rows, separated by newlines, e.g. for the clipboard
+     */
+    QString text(const QModelIndexList &indexes) const;
+
+private:
+    std::vector<QString> m_lines;
+};
+
+#endif
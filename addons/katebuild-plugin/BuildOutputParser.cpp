@@ -0,0 +1,193 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>   *
+ *                                                                         *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ ***************************************************************************/
+
+#include "BuildOutputParser.h"
+
+#include <KLocalizedString>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpressionMatch>
+
+const QString BuildOutputParser::NinjaPrefix = QStringLiteral("[ninja-detection]");
+
+BuildOutputParser::BuildOutputParser(const QString &workDir, const QStringList &searchPaths)
+    : m_makeDir(workDir)
+    , m_searchPaths(searchPaths)
+    // NOTE this will not allow spaces in file names.
+    // e.g. from gcc: "main.cpp:14: error: cannot convert ‘std::string’ to ‘int’ in return"
+    // e.g. from gcc: "main.cpp:14:8: error: cannot convert ‘std::string’ to ‘int’ in return"
+    // e.g. from icpc: "main.cpp(14): error: no suitable conversion function from "std::string" to "int" exists"
+    // e.g. from clang: ""main.cpp(14,8): fatal error: 'boost/scoped_array.hpp' file not found"
+    , m_filenameDetector(QStringLiteral("((?:[a-np-zA-Z]:[\\\\/])?[^\\s:(]+)[:\\(](\\d+)[,:]?(\\d+)?[\\):]* (.*)"))
+    , m_newDirDetector(QStringLiteral("make\\[.+\\]: .+ '(.*)'"))
+    // The strings are twice in case kate is translated but not make.
+    // One expression per category, that way each message is scanned just twice.
+    , m_errorDetector(QStringLiteral("\\b(?:error|%1)\\b|undefined reference|%2")
+                          .arg(QRegularExpression::escape(i18nc("The same word as 'make' uses to mark an error.", "error")),
+                               QRegularExpression::escape(i18nc("The same word as 'ld' uses to mark an ...", "undefined reference"))))
+    , m_warningDetector(QStringLiteral("\\b(?:warning|%1)\\b")
+                            .arg(QRegularExpression::escape(i18nc("The same word as 'make' uses to mark a warning.", "warning"))))
+{
+    m_makeDirStack.push(m_makeDir);
+}
+
+void BuildOutputParser::addOutput(const QByteArray &data, bool stdErr)
+{
+    // only decode complete lines, a chunk might end in the middle of a multi-byte character
+    QByteArray &pending = m_pendingOutput[stdErr];
+    const int end = data.lastIndexOf('\n');
+    if (end < 0) {
+        pending += data;
+        return;
+    }
+
+    pending += QByteArray::fromRawData(data.constData(), end + 1);
+    const QByteArray text = pending;
+    pending = data.mid(end + 1);
+    parseText(text, stdErr);
+
+    Q_EMIT outputParsed(m_lines, m_diagnostics);
+    m_lines.clear();
+    m_diagnostics.clear();
+}
+
+void BuildOutputParser::finish()
+{
+    for (bool stdErr : {false, true}) {
+        QByteArray &pending = m_pendingOutput[stdErr];
+        if (!pending.isEmpty()) {
+            pending += '\n';
+            parseText(pending, stdErr);
+            pending.clear();
+        }
+    }
+
+    if (!m_lines.isEmpty()) {
+        Q_EMIT outputParsed(m_lines, m_diagnostics);
+        m_lines.clear();
+        m_diagnostics.clear();
+    }
+    Q_EMIT finished();
+}
+
+void BuildOutputParser::parseText(const QByteArray &text, bool stdErr)
+{
+    // FIXME This works for utf8 but not for all charsets
+    QString output = QString::fromUtf8(text);
+    output.remove(QLatin1Char('\r'));
+
+    // handle one line at a time, the text ends with a newline
+    int start = 0;
+    int end = 0;
+    while ((end = output.indexOf(QLatin1Char('\n'), start)) >= 0) {
+        parseLine(QStringView(output).mid(start, end - start), stdErr);
+        start = end + 1;
+    }
+}
+
+void BuildOutputParser::parseLine(QStringView line, bool stdErr)
+{
+    if (stdErr) {
+        m_lines.push_back(line.toString());
+        m_diagnostics.push_back(parseMessage(line));
+        return;
+    }
+
+    // ninja build tool sends all output to stdout, its status lines are marked
+    const bool ninjaOutput = line.startsWith(NinjaPrefix);
+    m_ninjaBuildDetected |= ninjaOutput;
+    if (ninjaOutput) {
+        line = line.mid(NinjaPrefix.length());
+    }
+    m_lines.push_back(line.toString());
+
+    const QRegularExpressionMatch match = m_newDirDetector.match(line);
+    if (match.hasMatch()) {
+        QString newDir = match.captured(1);
+        if ((m_makeDirStack.size() > 1) && (m_makeDirStack.top() == newDir)) {
+            m_makeDirStack.pop();
+            newDir = m_makeDirStack.top();
+        } else {
+            m_makeDirStack.push(newDir);
+        }
+
+        m_makeDir = newDir;
+    } else if (m_ninjaBuildDetected && !ninjaOutput) {
+        m_diagnostics.push_back(parseMessage(line));
+    }
+}
+
+BuildDiagnostic BuildOutputParser::parseMessage(QStringView line)
+{
+    BuildDiagnostic diagnostic;
+
+    // look for a filename
+    const QRegularExpressionMatch match = m_filenameDetector.match(line);
+    if (!match.hasMatch()) {
+        diagnostic.message = line.toString();
+        diagnostic.category = category(diagnostic.message);
+        return diagnostic;
+    }
+
+    diagnostic.fileName = resolveFileName(match.captured(1));
+    diagnostic.line = match.captured(2).toInt();
+    diagnostic.column = match.captured(3).toInt();
+    diagnostic.message = match.captured(4);
+    diagnostic.category = category(diagnostic.message);
+    return diagnostic;
+}
+
+BuildDiagnostic::Category BuildOutputParser::category(const QString &message) const
+{
+    if (message.contains(m_warningDetector)) {
+        return BuildDiagnostic::CategoryWarning;
+    }
+    if (message.contains(m_errorDetector)) {
+        return BuildDiagnostic::CategoryError;
+    }
+    return BuildDiagnostic::CategoryInfo;
+}
+
+QString BuildOutputParser::resolveFileName(const QString &fileName)
+{
+    // the same files show up again and again, avoid to stat them for each message
+    const QString key = m_makeDir + QChar(0) + fileName;
+    const auto it = m_resolvedFileNames.constFind(key);
+    if (it != m_resolvedFileNames.cend()) {
+        return *it;
+    }
+
+    QString filename = fileName;
+#ifdef Q_OS_WIN
+    // convert '\' to '/' so the concatenation works
+    filename = QFileInfo(filename).filePath();
+#endif
+
+    // add path to file
+    if (QFile::exists(m_makeDir + QLatin1Char('/') + filename)) {
+        filename = m_makeDir + QLatin1Char('/') + filename;
+    }
+
+    // If we still do not have a file name try the extra search paths
+    int i = 1;
+    while (!QFile::exists(filename) && i < m_searchPaths.size()) {
+        if (QFile::exists(m_searchPaths[i] + QLatin1Char('/') + filename)) {
+            filename = m_searchPaths[i] + QLatin1Char('/') + filename;
+        }
+        i++;
+    }
+
+    // get canonical path, if possible, to avoid duplicated opened files
+    const QString canonicalFilePath = QFileInfo(filename).canonicalFilePath();
+    if (!canonicalFilePath.isEmpty()) {
+        filename = canonicalFilePath;
+    }
+
+    m_resolvedFileNames.insert(key, filename);
+    return filename;
+}
@@ -0,0 +1,110 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>   *
+ *                                                                         *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ ***************************************************************************/
+
+#ifndef BuildOutputParser_h
+#define BuildOutputParser_h
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QRegularExpression>
+#include <QStack>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * One message of the build, e.g. a compiler error.
+ * Lines that are no compiler message are diagnostics without file, too.
+ */
+struct BuildDiagnostic {
+    enum Category { CategoryInfo, CategoryWarning, CategoryError };
+
+    QString fileName;
+    int line = 0;
+    int column = 0;
+    QString message;
+    Category category = CategoryInfo;
+};
+
+Q_DECLARE_METATYPE(BuildDiagnostic)
+
+/**
+ * Parser for the output of one build.
+ *
+ * Meant to live in a worker thread, the output is fed in as it arrives via queued calls.
+ * Splits the output into lines, tracks the directory changes of make, finds the file names
+ * and resolves them and classifies the messages. The results are emitted in batches.
+ */
+class BuildOutputParser : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Marker added to the ninja status lines, to separate them from the compiler output.
+     */
+    static const QString NinjaPrefix;
+
+    /**
+     * @param workDir directory the build runs in
+     * @param searchPaths further directories to look for relative file names, the first one is skipped
+     */
+    BuildOutputParser(const QString &workDir, const QStringList &searchPaths);
+
+    /**
+     * Parse the next chunk of the output.
+     * Only complete lines are handled, the rest waits for the next chunk of the same channel.
+     * @param data raw output of the build process
+     * @param stdErr is this from the error channel?
+     */
+    void addOutput(const QByteArray &data, bool stdErr);
+
+    /**
+     * The build is done, parse the remaining incomplete lines and emit finished.
+     */
+    void finish();
+
+Q_SIGNALS:
+    /**
+     * Result of one chunk.
+     * @param lines the output lines for the log, without the ninja marker
+     * @param diagnostics the messages found in the lines
+     */
+    void outputParsed(const QStringList &lines, const QVector<BuildDiagnostic> &diagnostics);
+
+    /**
+     * All output is parsed.
+     */
+    void finished();
+
+private:
+    void parseText(const QByteArray &text, bool stdErr);
+    void parseLine(QStringView line, bool stdErr);
+    BuildDiagnostic parseMessage(QStringView line);
+    BuildDiagnostic::Category category(const QString &message) const;
+    QString resolveFileName(const QString &fileName);
+
+    QByteArray m_pendingOutput[2];
+    QStringList m_lines;
+    QVector<BuildDiagnostic> m_diagnostics;
+
+    QString m_makeDir;
+    QStack<QString> m_makeDirStack;
+    const QStringList m_searchPaths;
+    bool m_ninjaBuildDetected = false;
+
+    /**
+     * resolved file names, by make directory and file name as printed
+     */
+    QHash<QString, QString> m_resolvedFileNames;
+
+    const QRegularExpression m_filenameDetector;
+    const QRegularExpression m_newDirDetector;
+    const QRegularExpression m_errorDetector;
+    const QRegularExpression m_warningDetector;
+};
+
+#endif
@@ -0,0 +1,102 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>   *
+ *                                                                         *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ ***************************************************************************/
+
+#include "BuildScheduler.h"
+
+#include <algorithm>
+
+BuildScheduler::BuildScheduler(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<QVector<BuildDiagnostic>>();
+    m_parserThread.setObjectName(QStringLiteral("BuildOutputParser"));
+    m_parserThread.start();
+}
+
+BuildScheduler::~BuildScheduler()
+{
+    // the jobs stop their processes, the thread deletes the parsers when it finishes
+    m_jobs.clear();
+    m_parserThread.quit();
+    m_parserThread.wait();
+}
+
+void BuildScheduler::setMaxParallelJobs(int jobs)
+{
+    m_maxParallelJobs = std::max(1, jobs);
+    startJobs();
+}
+
+BuildJob *BuildScheduler::add(const QString &name, const QString &workDir, const QString &command, const QStringList &searchPaths)
+{
+    m_jobs.push_back(std::make_unique<BuildJob>(name, workDir, command, searchPaths));
+    m_busy = true;
+    BuildJob *job = m_jobs.back().get();
+    connect(job, &BuildJob::finished, this, [this, job]() {
+        Q_EMIT jobFinished(job);
+        startJobs();
+    });
+    startJobs();
+    return job;
+}
+
+void BuildScheduler::stop()
+{
+    // no queued job may start while the others are stopped
+    m_stopping = true;
+    for (size_t i = 0; i < m_jobs.size(); ++i) {
+        m_jobs[i]->stop();
+    }
+    m_stopping = false;
+    startJobs();
+}
+
+bool BuildScheduler::isBusy() const
+{
+    return std::any_of(m_jobs.cbegin(), m_jobs.cend(), [](const auto &job) {
+        return job->state() != BuildJob::Finished;
+    });
+}
+
+void BuildScheduler::clear()
+{
+    Q_ASSERT(!isBusy());
+    m_jobs.clear();
+}
+
+void BuildScheduler::startJobs()
+{
+    if (m_stopping) {
+        return;
+    }
+
+    int running = std::count_if(m_jobs.cbegin(), m_jobs.cend(), [](const auto &job) {
+        return job->state() == BuildJob::Running;
+    });
+
+    // the signals might add further jobs, don't hold iterators
+    for (size_t i = 0; i < m_jobs.size() && running < m_maxParallelJobs; ++i) {
+        BuildJob *job = m_jobs[i].get();
+        if (job->state() != BuildJob::Queued) {
+            continue;
+        }
+
+        if (job->start(&m_parserThread)) {
+            ++running;
+            Q_EMIT jobStarted(job);
+        } else {
+            Q_EMIT jobFinished(job);
+        }
+    }
+
+    // report once when the last job is done
+    const bool busy = isBusy();
+    if (m_busy && !busy) {
+        m_busy = false;
+        Q_EMIT allFinished();
+    }
+}
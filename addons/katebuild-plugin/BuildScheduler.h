@@ -0,0 +1,99 @@
+/***************************************************************************
+ *   This file is part of Kate build plugin                                *
+ *   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>   *
+ *                                                                         *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ ***************************************************************************/
+
+#ifndef BuildScheduler_h
+#define BuildScheduler_h
+
+#include "BuildJob.h"
+
+#include <QObject>
+#include <QThread>
+
+#include <memory>
+#include <vector>
+
+/**
+ * Runs the build jobs, not more than the configured number of them at the same time.
+ * Further jobs are queued and started in the order they were added.
+ *
+ * The jobs are kept until they are cleared, the jobs added since then form one build
+ * whose results are shown together.
+ */
+class BuildScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BuildScheduler(QObject *parent = nullptr);
+    ~BuildScheduler() override;
+
+    int maxParallelJobs() const
+    {
+        return m_maxParallelJobs;
+    }
+
+    /**
+     * Set the number of jobs that may run at the same time, queued jobs are started if it grows.
+     */
+    void setMaxParallelJobs(int jobs);
+
+    /**
+     * Add a job, it is started as soon as the number of running jobs allows it.
+     * @return the job, owned by the scheduler
+     */
+    BuildJob *add(const QString &name, const QString &workDir, const QString &command, const QStringList &searchPaths);
+
+    /**
+     * Stop all jobs, the queued ones are finished at once.
+     */
+    void stop();
+
+    /**
+     * @return is some job queued or running?
+     */
+    bool isBusy() const;
+
+    /**
+     * Remove all jobs, only allowed if not busy.
+     */
+    void clear();
+
+    /**
+     * @return all jobs since the last clear, in the order they were added
+     */
+    const std::vector<std::unique_ptr<BuildJob>> &jobs() const
+    {
+        return m_jobs;
+    }
+
+Q_SIGNALS:
+    void jobStarted(BuildJob *job);
+
+    /**
+     * The job is done, or could not be started at all.
+     */
+    void jobFinished(BuildJob *job);
+
+    /**
+     * All jobs are done.
+     */
+    void allFinished();
+
+private:
+    void startJobs();
+
+    std::vector<std::unique_ptr<BuildJob>> m_jobs;
+    int m_maxParallelJobs = 1;
+    bool m_busy = false;
+    bool m_stopping = false;
+
+    /**
+     * the output of all jobs is parsed in this thread
+     */
+    QThread m_parserThread;
+};
+
+#endif
@@ -24,19 +24,23 @@
 
 #include "plugin_katebuild.h"
 
+#include <algorithm>
 #include <cassert>
 
+#include <QComboBox>
 #include <QCompleter>
 #include <QDir>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QIcon>
 #include <QKeyEvent>
-#include <QRegularExpressionMatch>
 #include <QScrollBar>
+#include <QSpinBox>
 #include <QString>
 
 #include <QAction>
+#include <QApplication>
+#include <QClipboard>
 
 #include <KActionCollection>
 #include <KTextEditor/Application>
@@ -60,9 +64,8 @@ static const QString DefConfClean;
 static const QString DefTargetName = QStringLiteral("all");
 static const QString DefBuildCmd = QStringLiteral("make");
 static const QString DefCleanCmd = QStringLiteral("make clean");
-static const QString NinjaPrefix = QStringLiteral("[ninja-detection]");
 
-static QIcon messageIcon(KateBuildView::ErrorCategory severity)
+static QIcon messageIcon(BuildDiagnostic::Category severity)
 {
     // clang-format off
 #define RETURN_CACHED_ICON(name, fallbackname) \
@@ -73,9 +76,9 @@ static QIcon messageIcon(KateBuildView::ErrorCategory severity)
     }
     // clang-format on
     switch (severity) {
-    case KateBuildView::CategoryError:
+    case BuildDiagnostic::CategoryError:
         RETURN_CACHED_ICON("data-error", "dialog-error")
-    case KateBuildView::CategoryWarning:
+    case BuildDiagnostic::CategoryWarning:
         RETURN_CACHED_ICON("data-warning", "dialog-warning")
     default:
         break;
@@ -83,12 +86,20 @@ static QIcon messageIcon(KateBuildView::ErrorCategory severity)
     return QIcon();
 }
 
-struct ItemData {
-    // ensure destruction, but not inadvertently so by a variant value copy
-    QSharedPointer<KTextEditor::MovingCursor> cursor;
-};
-
-Q_DECLARE_METATYPE(ItemData)
+/**
+ * least category of the diagnostics shown in the given display mode
+ */
+static BuildDiagnostic::Category minCategory(int displayMode)
+{
+    switch (displayMode) {
+    case KateBuildView::OnlyErrors:
+        return BuildDiagnostic::CategoryError;
+    case KateBuildView::ErrorsAndWarnings:
+        return BuildDiagnostic::CategoryWarning;
+    default:
+        return BuildDiagnostic::CategoryInfo;
+    }
+}
 
 /******************************************************************/
 KateBuildPlugin::KateBuildPlugin(QObject *parent, const VariantList &)
@@ -109,18 +120,8 @@ KateBuildView::KateBuildView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
     , m_win(mw)
     , m_buildWidget(nullptr)
     , m_outputWidgetWidth(0)
-    , m_proc(this)
-    , m_stdOut()
-    , m_stdErr()
     , m_buildCancelled(false)
     , m_displayModeBeforeBuild(1)
-    // NOTE this will not allow spaces in file names.
-    // e.g. from gcc: "main.cpp:14: error: cannot convert ‘std::string’ to ‘int’ in return"
-    // e.g. from gcc: "main.cpp:14:8: error: cannot convert ‘std::string’ to ‘int’ in return"
-    // e.g. from icpc: "main.cpp(14): error: no suitable conversion function from "std::string" to "int" exists"
-    // e.g. from clang: ""main.cpp(14,8): fatal error: 'boost/scoped_array.hpp' file not found"
-    , m_filenameDetector(QStringLiteral("((?:[a-np-zA-Z]:[\\\\/])?[^\\s:(]+)[:\\(](\\d+)[,:]?(\\d+)?[\\):]* (.*)"))
-    , m_newDirDetector(QStringLiteral("make\\[.+\\]: .+ '(.*)'"))
 {
     KXMLGUIClient::setComponentName(QStringLiteral("katebuild"), i18n("Kate Build Plugin"));
     setXMLFile(QStringLiteral("ui.rc"));
@@ -185,8 +186,19 @@ KateBuildView::KateBuildView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
 
     connect(m_buildUi.errTreeWidget, &QTreeWidget::itemClicked, this, &KateBuildView::slotErrorSelected);
 
-    m_buildUi.plainTextEdit->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
-    m_buildUi.plainTextEdit->setReadOnly(true);
+    m_buildUi.buildOutputView->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    a = new QAction(QIcon::fromTheme(QStringLiteral("edit-copy")), i18n("Copy"), m_buildUi.buildOutputView);
+    a->setShortcut(QKeySequence::Copy);
+    a->setShortcutContext(Qt::WidgetShortcut);
+    connect(a, &QAction::triggered, this, &KateBuildView::copyOutput);
+    m_buildUi.buildOutputView->addAction(a);
+    m_buildUi.buildOutputView->setContextMenuPolicy(Qt::ActionsContextMenu);
+    // keep following the output while the view is at its end
+    connect(m_buildUi.buildOutputView->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+        m_followOutput = value == m_buildUi.buildOutputView->verticalScrollBar()->maximum();
+    });
+    m_buildUi.buildJobCombo->setVisible(false);
+    connect(m_buildUi.buildJobCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &KateBuildView::slotShowJobOutput);
     slotDisplayMode(FullOutput);
 
     auto updateEditorColors = [this](KTextEditor::Editor *e) {
@@ -196,12 +208,12 @@ KateBuildView::KateBuildView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
         auto bg = QColor::fromRgba(theme.editorColor(KSyntaxHighlighting::Theme::EditorColorRole::BackgroundColor));
         auto fg = QColor::fromRgba(theme.textColor(KSyntaxHighlighting::Theme::TextStyle::Normal));
         auto sel = QColor::fromRgba(theme.editorColor(KSyntaxHighlighting::Theme::EditorColorRole::TextSelection));
-        auto pal = m_buildUi.plainTextEdit->palette();
+        auto pal = m_buildUi.buildOutputView->palette();
         pal.setColor(QPalette::Base, bg);
         pal.setColor(QPalette::Text, fg);
         pal.setColor(QPalette::Highlight, sel);
         pal.setColor(QPalette::HighlightedText, fg);
-        m_buildUi.plainTextEdit->setPalette(pal);
+        m_buildUi.buildOutputView->setPalette(pal);
     };
     connect(KTextEditor::Editor::instance(), &KTextEditor::Editor::configChanged, this, updateEditorColors);
 
@@ -220,10 +232,9 @@ KateBuildView::KateBuildView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
     connect(m_targetsUi->buildButton, &QToolButton::clicked, this, &KateBuildView::slotBuildActiveTarget);
     connect(m_targetsUi, &TargetsUi::enterPressed, this, &KateBuildView::slotBuildActiveTarget);
 
-    m_proc.setOutputChannelMode(KProcess::SeparateChannels);
-    connect(&m_proc, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &KateBuildView::slotProcExited);
-    connect(&m_proc, &KProcess::readyReadStandardError, this, &KateBuildView::slotReadReadyStdErr);
-    connect(&m_proc, &KProcess::readyReadStandardOutput, this, &KateBuildView::slotReadReadyStdOut);
+    connect(m_targetsUi->parallelBuilds, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), &m_scheduler, &BuildScheduler::setMaxParallelJobs);
+    connect(&m_scheduler, &BuildScheduler::jobFinished, this, &KateBuildView::slotJobFinished);
+    connect(&m_scheduler, &BuildScheduler::allFinished, this, &KateBuildView::slotBuildsFinished);
 
     connect(m_win, &KTextEditor::MainWindow::unhandledShortcutOverride, this, &KateBuildView::handleEsc);
     connect(m_win, &KTextEditor::MainWindow::viewChanged, this, &KateBuildView::slotViewChanged);
@@ -244,10 +255,6 @@ KateBuildView::KateBuildView(KTextEditor::Plugin *plugin, KTextEditor::MainWindo
 /******************************************************************/
 KateBuildView::~KateBuildView()
 {
-    if (m_proc.state() != QProcess::NotRunning) {
-        m_proc.terminate();
-        m_proc.waitForFinished();
-    }
     m_win->guiFactory()->removeClient(this);
     delete m_toolView;
 }
@@ -314,6 +321,8 @@ void KateBuildView::readSessionConfig(const KConfigGroup &cg)
     auto showMarks = cg.readEntry(QStringLiteral("Show Marks"), false);
     m_showMarks->setChecked(showMarks);
 
+    m_targetsUi->parallelBuilds->setValue(cg.readEntry(QStringLiteral("Parallel Builds"), 1));
+
     // Add project targets, if any
     slotAddProjectTarget();
 }
@@ -359,6 +368,7 @@ void KateBuildView::writeSessionConfig(KConfigGroup &cg)
     cg.writeEntry(QStringLiteral("Active Target Index"), set);
     cg.writeEntry(QStringLiteral("Active Target Command"), setRow);
     cg.writeEntry(QStringLiteral("Show Marks"), m_showMarks->isChecked());
+    cg.writeEntry(QStringLiteral("Parallel Builds"), m_targetsUi->parallelBuilds->value());
 
     // Restore project targets, if any
     slotAddProjectTarget();
@@ -367,55 +377,43 @@ void KateBuildView::writeSessionConfig(KConfigGroup &cg)
 /******************************************************************/
 void KateBuildView::slotNext()
 {
-    const int itemCount = m_buildUi.errTreeWidget->topLevelItemCount();
-    if (itemCount == 0) {
-        return;
-    }
-
     QTreeWidgetItem *item = m_buildUi.errTreeWidget->currentItem();
     if (item && item->isHidden()) {
         item = nullptr;
     }
 
-    int i = (item == nullptr) ? -1 : m_buildUi.errTreeWidget->indexOfTopLevelItem(item);
-
-    while (++i < itemCount) {
-        item = m_buildUi.errTreeWidget->topLevelItem(i);
-        // Search item which fit view settings and has desired data
-        if (!item->text(1).isEmpty() && !item->isHidden() && item->data(1, Qt::UserRole).toInt()) {
-            m_buildUi.errTreeWidget->setCurrentItem(item);
-            m_buildUi.errTreeWidget->scrollToItem(item);
-            slotErrorSelected(item);
-            return;
-        }
+    // next diagnostic which fits the view settings and has a location
+    const int current = item ? item->data(0, DiagnosticIndexRole).toInt() : -1;
+    const int next = m_diagnostics.next(current, minCategory(m_buildUi.displayModeSlider->value()));
+    if (next < 0) {
+        return;
     }
+
+    item = m_buildUi.errTreeWidget->topLevelItem(next);
+    m_buildUi.errTreeWidget->setCurrentItem(item);
+    m_buildUi.errTreeWidget->scrollToItem(item);
+    slotErrorSelected(item);
 }
 
 /******************************************************************/
 void KateBuildView::slotPrev()
 {
-    const int itemCount = m_buildUi.errTreeWidget->topLevelItemCount();
-    if (itemCount == 0) {
-        return;
-    }
-
     QTreeWidgetItem *item = m_buildUi.errTreeWidget->currentItem();
     if (item && item->isHidden()) {
         item = nullptr;
     }
 
-    int i = (item == nullptr) ? itemCount : m_buildUi.errTreeWidget->indexOfTopLevelItem(item);
-
-    while (--i >= 0) {
-        item = m_buildUi.errTreeWidget->topLevelItem(i);
-        // Search item which fit view settings and has desired data
-        if (!item->text(1).isEmpty() && !item->isHidden() && item->data(1, Qt::UserRole).toInt()) {
-            m_buildUi.errTreeWidget->setCurrentItem(item);
-            m_buildUi.errTreeWidget->scrollToItem(item);
-            slotErrorSelected(item);
-            return;
-        }
+    // previous diagnostic which fits the view settings and has a location
+    const int current = item ? item->data(0, DiagnosticIndexRole).toInt() : m_diagnostics.size();
+    const int previous = m_diagnostics.previous(current, minCategory(m_buildUi.displayModeSlider->value()));
+    if (previous < 0) {
+        return;
     }
+
+    item = m_buildUi.errTreeWidget->topLevelItem(previous);
+    m_buildUi.errTreeWidget->setCurrentItem(item);
+    m_buildUi.errTreeWidget->scrollToItem(item);
+    slotErrorSelected(item);
 }
 
 #ifdef Q_OS_WIN
@@ -459,28 +457,15 @@ void KateBuildView::slotErrorSelected(QTreeWidgetItem *item)
     // Avoid garish highlighting of the selected line
     m_win->activeView()->setFocus();
 
-    // Search the item where the data we need is stored
-    while (!item->data(1, Qt::UserRole).toInt()) {
-        item = m_buildUi.errTreeWidget->itemAbove(item);
-        if (!item) {
-            return;
-        }
-    }
-
-    // get stuff
-    QString filename = item->data(0, Qt::UserRole).toString();
-    if (filename.isEmpty()) {
+    // Search the diagnostic with a location, messages without one belong to the one above
+    const int index = m_diagnostics.located(item->data(0, DiagnosticIndexRole).toInt());
+    if (index < 0) {
         return;
     }
 
-    int line = item->data(1, Qt::UserRole).toInt();
-    int column = item->data(2, Qt::UserRole).toInt();
-    // check with moving cursor
-    auto data = item->data(0, DataRole).value<ItemData>();
-    if (data.cursor) {
-        line = data.cursor->line();
-        column = data.cursor->column();
-    }
+    // get stuff, the position follows the edits of the document
+    QString filename = m_diagnostics.diagnostic(index).fileName;
+    const KTextEditor::Cursor position = m_diagnostics.position(index);
 
 #ifdef Q_OS_WIN
     filename = caseFixed(filename);
@@ -499,59 +484,59 @@ void KateBuildView::slotErrorSelected(QTreeWidgetItem *item)
     m_win->openUrl(QUrl::fromLocalFile(filename));
 
     // do it ;)
-    m_win->activeView()->setCursorPosition(KTextEditor::Cursor(line - 1, column - 1));
+    m_win->activeView()->setCursorPosition(position);
 }
 
 /******************************************************************/
-void KateBuildView::addError(const QString &filename, const QString &line, const QString &column, const QString &message)
+QTreeWidgetItem *KateBuildView::errorItem(int index) const
 {
-    ErrorCategory errorCategory = CategoryInfo;
-    QTreeWidgetItem *item = new QTreeWidgetItem(m_buildUi.errTreeWidget);
+    const BuildDiagnostic &diagnostic = m_diagnostics.diagnostic(index);
+    QTreeWidgetItem *item = new QTreeWidgetItem;
     item->setBackground(1, Qt::gray);
-    static QRegularExpression errorRegExp(QStringLiteral("\berror\b"));
-    static QRegularExpression errorRegExpTr(QStringLiteral("\b%1\b").arg(i18nc("The same word as 'make' uses to mark an error.", "error")));
-    // The strings are twice in case kate is translated but not make.
-    if (message.contains(errorRegExp) || message.contains(errorRegExpTr) || message.contains(QLatin1String("undefined reference"))
-        || message.contains(i18nc("The same word as 'ld' uses to mark an ...", "undefined reference"))) {
-        errorCategory = CategoryError;
+    switch (diagnostic.category) {
+    case BuildDiagnostic::CategoryError:
         item->setForeground(1, Qt::red);
-        m_numErrors++;
-        item->setHidden(false);
-    }
-    static QRegularExpression warningRegExp(QStringLiteral("\bwarning\b"));
-    static QRegularExpression warningRegExpTr(QStringLiteral("\b%1\b").arg(i18nc("The same word as 'make' uses to mark a warning.", "warning")));
-    if (message.contains(warningRegExp) || message.contains(warningRegExpTr)) {
-        errorCategory = CategoryWarning;
+        break;
+    case BuildDiagnostic::CategoryWarning:
         item->setForeground(1, Qt::yellow);
-        m_numWarnings++;
-        item->setHidden(m_buildUi.displayModeSlider->value() > 2);
+        break;
+    case BuildDiagnostic::CategoryInfo:
+        break;
     }
     item->setTextAlignment(1, Qt::AlignRight);
 
     // visible text
     // remove path from visible file name
-    QFileInfo file(filename);
+    QFileInfo file(diagnostic.fileName);
 
     item->setText(0, file.fileName());
-    item->setText(1, line);
-    item->setText(2, message);
+    item->setText(1, QString::number(diagnostic.line));
+    item->setText(2, diagnostic.message);
 
     // used to read from when activating an item
-    item->setData(0, Qt::UserRole, filename);
-    item->setData(1, Qt::UserRole, line);
-    item->setData(2, Qt::UserRole, column);
-
-    if (errorCategory == CategoryInfo) {
-        item->setHidden(m_buildUi.displayModeSlider->value() > 1);
-    }
-
-    item->setData(0, ErrorRole, errorCategory);
+    item->setData(0, DiagnosticIndexRole, index);
 
     // add tooltips in all columns
     // The enclosing <qt>...</qt> enables word-wrap for long error messages
-    item->setData(0, Qt::ToolTipRole, filename);
-    item->setData(1, Qt::ToolTipRole, QStringLiteral("<qt>%1</qt>").arg(message));
-    item->setData(2, Qt::ToolTipRole, QStringLiteral("<qt>%1</qt>").arg(message));
+    item->setData(0, Qt::ToolTipRole, diagnostic.fileName);
+    item->setData(1, Qt::ToolTipRole, QStringLiteral("<qt>%1</qt>").arg(diagnostic.message));
+    item->setData(2, Qt::ToolTipRole, QStringLiteral("<qt>%1</qt>").arg(diagnostic.message));
+    return item;
+}
+
+/******************************************************************/
+void KateBuildView::copyOutput()
+{
+    const int index = m_buildUi.buildJobCombo->currentIndex();
+    if (index < 0 || index >= int(m_scheduler.jobs().size())) {
+        return;
+    }
+
+    BuildOutputModel *output = m_scheduler.jobs()[index]->output();
+    const QString text = output->text(m_buildUi.buildOutputView->selectionModel()->selectedRows());
+    if (!text.isEmpty()) {
+        QApplication::clipboard()->setText(text);
+    }
 }
 
 void KateBuildView::clearMarks()
@@ -586,29 +571,22 @@ void KateBuildView::addMarks(KTextEditor::Document *doc, bool mark)
         return;
     }
 
-    QTreeWidgetItemIterator it(m_buildUi.errTreeWidget, QTreeWidgetItemIterator::All);
-    while (*it) {
-        QTreeWidgetItem *item = *it;
-        ++it;
+    // add moving cursors so link between message and location
+    // is not broken by document changes
+    m_diagnostics.track(doc);
 
-        auto filename = item->data(0, Qt::UserRole).toString();
-        auto url = QUrl::fromLocalFile(filename);
-        if (url != doc->url()) {
-            continue;
-        }
-
-        auto line = item->data(1, Qt::UserRole).toInt();
-        if (mark) {
-            ErrorCategory category = static_cast<ErrorCategory>(item->data(0, ErrorRole).toInt());
+    if (mark) {
+        for (int index : m_diagnostics.diagnosticsForFile(doc->url().toLocalFile())) {
+            const BuildDiagnostic::Category category = m_diagnostics.diagnostic(index).category;
             KTextEditor::MarkInterface::MarkTypes markType{};
 
             switch (category) {
-            case CategoryError: {
+            case BuildDiagnostic::CategoryError: {
                 markType = KTextEditor::MarkInterface::Error;
                 iface->setMarkDescription(markType, i18n("Error"));
                 break;
             }
-            case CategoryWarning: {
+            case BuildDiagnostic::CategoryWarning: {
                 markType = KTextEditor::MarkInterface::Warning;
                 iface->setMarkDescription(markType, i18n("Warning"));
                 break;
@@ -619,23 +597,10 @@ void KateBuildView::addMarks(KTextEditor::Document *doc, bool mark)
 
             if (markType) {
                 iface->setMarkIcon(markType, messageIcon(category));
-                iface->addMark(line - 1, markType);
+                iface->addMark(m_diagnostics.position(index).line(), markType);
             }
             m_markedDocs.insert(doc, doc);
         }
-
-        // add moving cursor so link between message and location
-        // is not broken by document changes
-        if (miface) {
-            auto data = item->data(0, DataRole).value<ItemData>();
-            if (!data.cursor) {
-                auto column = item->data(2, Qt::UserRole).toInt();
-                data.cursor.reset(miface->newMovingCursor({line, column}));
-                QVariant var;
-                var.setValue(data);
-                item->setData(0, DataRole, var);
-            }
-        }
     }
 
     // ensure cleanup
@@ -663,34 +628,15 @@ void KateBuildView::addMarks(KTextEditor::Document *doc, bool mark)
 
 void KateBuildView::slotInvalidateMoving(KTextEditor::Document *doc)
 {
-    QTreeWidgetItemIterator it(m_buildUi.errTreeWidget, QTreeWidgetItemIterator::All);
-    while (*it) {
-        QTreeWidgetItem *item = *it;
-        ++it;
-
-        auto data = item->data(0, DataRole).value<ItemData>();
-        if (data.cursor && data.cursor->document() == doc) {
-            item->setData(0, DataRole, 0);
-        }
-    }
+    m_diagnostics.untrack(doc);
 }
 
 void KateBuildView::slotMarkClicked(KTextEditor::Document *doc, KTextEditor::Mark mark, bool &handled)
 {
     auto tree = m_buildUi.errTreeWidget;
-    QTreeWidgetItemIterator it(tree, QTreeWidgetItemIterator::All);
-    while (*it) {
-        QTreeWidgetItem *item = *it;
-        ++it;
-
-        auto filename = item->data(0, Qt::UserRole).toString();
-        auto line = item->data(1, Qt::UserRole).toInt();
-        // prefer moving cursor's opinion if so available
-        auto data = item->data(0, DataRole).value<ItemData>();
-        if (data.cursor) {
-            line = data.cursor->line();
-        }
-        if (line - 1 == mark.line && QUrl::fromLocalFile(filename) == doc->url()) {
+    for (int index : m_diagnostics.diagnosticsForFile(doc->url().toLocalFile())) {
+        if (m_diagnostics.position(index).line() == mark.line) {
+            QTreeWidgetItem *item = tree->topLevelItem(index);
             tree->blockSignals(true);
             tree->setCurrentItem(item);
             tree->scrollToItem(item, QAbstractItemView::PositionAtCenter);
@@ -757,63 +703,54 @@ bool KateBuildView::checkLocal(const QUrl &dir)
 void KateBuildView::clearBuildResults()
 {
     clearMarks();
-    m_buildUi.plainTextEdit->clear();
     m_buildUi.errTreeWidget->clear();
-    m_stdOut.clear();
-    m_stdErr.clear();
-    m_numErrors = 0;
-    m_numWarnings = 0;
-    m_make_dir_stack.clear();
+    m_diagnostics.clear();
+
+    // the output view must not show the output of the removed jobs
+    m_buildUi.buildJobCombo->clear();
+    m_buildUi.buildJobCombo->setVisible(false);
+    m_scheduler.clear();
 }
 
 /******************************************************************/
-bool KateBuildView::startProcess(const QString &dir, const QString &command)
+bool KateBuildView::startBuild(const QString &name, const QString &dir, const QString &command, const QStringList &searchPaths)
 {
-    if (m_proc.state() != QProcess::NotRunning) {
-        return false;
+    // the same command might still be queued or running
+    for (const auto &job : m_scheduler.jobs()) {
+        if (job->state() != BuildJob::Finished && job->workDir() == dir && job->command() == command) {
+            displayBuildResult(i18n("Already building..."), KTextEditor::Message::Warning);
+            return false;
+        }
     }
 
-    // clear previous runs
-    clearBuildResults();
-
-    // activate the output tab
-    m_buildUi.u_tabWidget->setCurrentIndex(1);
-    m_displayModeBeforeBuild = m_buildUi.displayModeSlider->value();
-    m_buildUi.displayModeSlider->setValue(0);
-    m_win->showToolView(m_toolView);
-
-    QFont font = Utils::editorFont();
-    m_buildUi.errTreeWidget->setFont(font);
-    m_buildUi.plainTextEdit->setFont(font);
+    // a new build, unless the target is added to the running one
+    if (!m_scheduler.isBusy()) {
+        // clear previous runs
+        clearBuildResults();
+        m_currentlyBuildingTarget.clear();
+        m_buildCancelled = false;
 
-    // set working directory
-    m_make_dir = dir;
-    m_make_dir_stack.push(m_make_dir);
+        // activate the output tab
+        m_buildUi.u_tabWidget->setCurrentIndex(1);
+        m_displayModeBeforeBuild = m_buildUi.displayModeSlider->value();
+        m_buildUi.displayModeSlider->setValue(0);
+        m_win->showToolView(m_toolView);
 
-    if (!QFile::exists(m_make_dir)) {
-        KMessageBox::error(nullptr, i18n("Cannot run command: %1\nWork path does not exist: %2", command, m_make_dir));
-        return false;
+        QFont font = Utils::editorFont();
+        m_buildUi.errTreeWidget->setFont(font);
+        m_buildUi.buildOutputView->setFont(font);
     }
 
-    // ninja build tool sends all output to stdout,
-    // so follow https://github.com/ninja-build/ninja/issues/1537 to separate ninja and compiler output
-    auto env = QProcessEnvironment::systemEnvironment();
-    const auto nstatus = QStringLiteral("NINJA_STATUS");
-    auto curr = env.value(nstatus, QStringLiteral("[%f/%t] "));
-    // add marker to search on later on
-    env.insert(nstatus, NinjaPrefix + curr);
-    m_ninjaBuildDetected = false;
-
-    m_proc.setProcessEnvironment(env);
-    m_proc.setWorkingDirectory(m_make_dir);
-    m_proc.setShellCommand(command);
-    m_proc.start();
-
-    if (!m_proc.waitForStarted(500)) {
-        KMessageBox::error(nullptr, i18n("Failed to run \"%1\". exitStatus = %2", command, m_proc.exitStatus()));
+    if (!QFile::exists(dir)) {
+        KMessageBox::error(nullptr, i18n("Cannot run command: %1\nWork path does not exist: %2", command, dir));
         return false;
     }
 
+    m_currentlyBuildingTarget = m_currentlyBuildingTarget.isEmpty() ? name : m_currentlyBuildingTarget + QStringLiteral(", ") + name;
+    QString msg = i18n("Building target <b>%1</b> ...", m_currentlyBuildingTarget);
+    m_buildUi.buildStatusLabel->setText(msg);
+    m_buildUi.buildStatusLabel2->setText(msg);
+
     m_buildUi.cancelBuildButton->setEnabled(true);
     m_buildUi.cancelBuildButton2->setEnabled(true);
     m_buildUi.buildAgainButton->setEnabled(false);
@@ -821,18 +758,25 @@ bool KateBuildView::startProcess(const QString &dir, const QString &command)
 
     m_targetsUi->setCursor(Qt::BusyCursor);
 
+    // the job is started at once if the number of running builds allows it
+    BuildJob *job = m_scheduler.add(name, dir, command, searchPaths);
+    connect(job, &BuildJob::diagnosticsParsed, this, &KateBuildView::slotDiagnosticsParsed);
+
+    // each target has its own output
+    m_buildUi.buildJobCombo->addItem(name);
+    m_buildUi.buildJobCombo->setVisible(m_buildUi.buildJobCombo->count() > 1);
     return true;
 }
 
 /******************************************************************/
 bool KateBuildView::slotStop()
 {
-    if (m_proc.state() != QProcess::NotRunning) {
+    if (m_scheduler.isBusy()) {
         m_buildCancelled = true;
         QString msg = i18n("Building <b>%1</b> cancelled", m_currentlyBuildingTarget);
         m_buildUi.buildStatusLabel->setText(msg);
         m_buildUi.buildStatusLabel2->setText(msg);
-        m_proc.terminate();
+        m_scheduler.stop();
         return true;
     }
     return false;
@@ -883,24 +827,42 @@ void KateBuildView::slotSelectTarget()
 /******************************************************************/
 bool KateBuildView::buildCurrentTarget()
 {
-    if (m_proc.state() != QProcess::NotRunning) {
-        displayBuildResult(i18n("Already building..."), KTextEditor::Message::Warning);
+    const QModelIndex current = m_targetsUi->targetsView->currentIndex();
+    m_previousIndex = current;
+    if (!current.isValid()) {
+        KMessageBox::sorry(nullptr, i18n("No target available for building."));
         return false;
     }
 
-    const QFileInfo docFInfo(docUrl().toLocalFile()); // docUrl() saves the current document
+    // all selected targets, if the current one is part of the selection
+    QModelIndexList targets;
+    const QModelIndexList selected = m_targetsUi->targetsView->selectionModel()->selectedIndexes();
+    for (const auto &index : selected) {
+        const QModelIndex target = index.siblingAtColumn(0);
+        if (!targets.contains(target)) {
+            targets.push_back(target);
+        }
+    }
+    if (!targets.contains(current.siblingAtColumn(0))) {
+        targets = {current};
+    }
 
-    QModelIndex ind = m_targetsUi->targetsView->currentIndex();
-    m_previousIndex = ind;
-    if (!ind.isValid()) {
-        KMessageBox::sorry(nullptr, i18n("No target available for building."));
-        return false;
+    bool started = false;
+    for (const auto &target : qAsConst(targets)) {
+        started |= buildTarget(target);
     }
+    return started;
+}
+
+/******************************************************************/
+bool KateBuildView::buildTarget(const QModelIndex &ind)
+{
+    const QFileInfo docFInfo(docUrl().toLocalFile()); // docUrl() saves the current document
 
     QString buildCmd = TargetModel::command(ind);
     QString cmdName = TargetModel::cmdName(ind);
-    m_searchPaths = TargetModel::workDir(ind).split(QLatin1Char(';'));
-    QString workDir = m_searchPaths.isEmpty() ? QString() : m_searchPaths.first();
+    const QStringList searchPaths = TargetModel::workDir(ind).split(QLatin1Char(';'));
+    QString workDir = searchPaths.isEmpty() ? QString() : searchPaths.first();
     QString targetSet = TargetModel::targetName(ind);
 
     QString dir = workDir;
@@ -929,12 +891,7 @@ bool KateBuildView::buildCurrentTarget()
         buildCmd.replace(QStringLiteral("%f"), docFInfo.absoluteFilePath());
         buildCmd.replace(QStringLiteral("%d"), docFInfo.absolutePath());
     }
-    m_currentlyBuildingTarget = QStringLiteral("%1: %2").arg(targetSet, cmdName);
-    m_buildCancelled = false;
-    QString msg = i18n("Building target <b>%1</b> ...", m_currentlyBuildingTarget);
-    m_buildUi.buildStatusLabel->setText(msg);
-    m_buildUi.buildStatusLabel2->setText(msg);
-    return startProcess(dir, buildCmd);
+    return startBuild(QStringLiteral("%1: %2").arg(targetSet, cmdName), dir, buildCmd, searchPaths);
 }
 
 /******************************************************************/
@@ -974,7 +931,15 @@ void KateBuildView::displayMessage(const QString &msg, KTextEditor::Message::Mes
 }
 
 /******************************************************************/
-void KateBuildView::slotProcExited(int exitCode, QProcess::ExitStatus)
+void KateBuildView::slotJobFinished(BuildJob *job)
+{
+    if (!job->errorString().isEmpty()) {
+        KMessageBox::error(nullptr, job->errorString());
+    }
+}
+
+/******************************************************************/
+void KateBuildView::slotBuildsFinished()
 {
     m_targetsUi->unsetCursor();
     m_buildUi.cancelBuildButton->setEnabled(false);
@@ -982,10 +947,17 @@ void KateBuildView::slotProcExited(int exitCode, QProcess::ExitStatus)
     m_buildUi.buildAgainButton->setEnabled(true);
     m_buildUi.buildAgainButton2->setEnabled(true);
 
+    const auto &jobs = m_scheduler.jobs();
+    const bool failed = std::any_of(jobs.cbegin(), jobs.cend(), [](const auto &job) {
+        return job->exitCode() != 0;
+    });
+
     QString buildStatus = i18n("Building <b>%1</b> completed.", m_currentlyBuildingTarget);
+    const int numErrors = m_diagnostics.count(BuildDiagnostic::CategoryError);
+    const int numWarnings = m_diagnostics.count(BuildDiagnostic::CategoryWarning);
 
     // did we get any errors?
-    if (m_numErrors || m_numWarnings || (exitCode != 0)) {
+    if (numErrors || numWarnings || failed) {
         m_buildUi.u_tabWidget->setCurrentIndex(1);
         if (m_buildUi.displayModeSlider->value() == 0) {
             m_buildUi.displayModeSlider->setValue(m_displayModeBeforeBuild > 0 ? m_displayModeBeforeBuild : 1);
@@ -998,17 +970,17 @@ void KateBuildView::slotProcExited(int exitCode, QProcess::ExitStatus)
         m_win->showToolView(m_toolView);
     }
 
-    if (m_numErrors || m_numWarnings) {
+    if (numErrors || numWarnings) {
         QStringList msgs;
-        if (m_numErrors) {
-            msgs << i18np("Found one error.", "Found %1 errors.", m_numErrors);
+        if (numErrors) {
+            msgs << i18np("Found one error.", "Found %1 errors.", numErrors);
             buildStatus = i18n("Building <b>%1</b> had errors.", m_currentlyBuildingTarget);
-        } else if (m_numWarnings) {
-            msgs << i18np("Found one warning.", "Found %1 warnings.", m_numWarnings);
+        } else if (numWarnings) {
+            msgs << i18np("Found one warning.", "Found %1 warnings.", numWarnings);
             buildStatus = i18n("Building <b>%1</b> had warnings.", m_currentlyBuildingTarget);
         }
-        displayBuildResult(msgs.join(QLatin1Char('\n')), m_numErrors ? KTextEditor::Message::Error : KTextEditor::Message::Warning);
-    } else if (exitCode != 0) {
+        displayBuildResult(msgs.join(QLatin1Char('\n')), numErrors ? KTextEditor::Message::Error : KTextEditor::Message::Warning);
+    } else if (failed) {
         displayBuildResult(i18n("Build failed."), KTextEditor::Message::Warning);
     } else {
         displayBuildResult(i18n("Build completed without problems."), KTextEditor::Message::Positive);
@@ -1024,128 +996,45 @@ void KateBuildView::slotProcExited(int exitCode, QProcess::ExitStatus)
 }
 
 /******************************************************************/
-void KateBuildView::slotReadReadyStdOut()
+void KateBuildView::slotDiagnosticsParsed(const QVector<BuildDiagnostic> &diagnostics)
 {
-    // read data from procs stdout and add
-    // the text to the end of the output
-    // FIXME This works for utf8 but not for all charsets
-    QString l = QString::fromUtf8(m_proc.readAllStandardOutput());
-
-    l.remove(QLatin1Char('\r'));
-    m_stdOut += l;
-
-    // Remove the Ninja workaround string
-    l.remove(NinjaPrefix);
-    m_buildUi.plainTextEdit->moveCursor(QTextCursor::End);
-    m_buildUi.plainTextEdit->insertPlainText(l);
-
-    // handle one line at a time
-    do {
-        const int end = m_stdOut.indexOf(QLatin1Char('\n'));
-        if (end < 0) {
-            break;
-        }
-
-        QStringView line = QStringView(m_stdOut).mid(0, end);
-        const bool ninjaOutput = line.startsWith(NinjaPrefix);
-        m_ninjaBuildDetected |= ninjaOutput;
-        if (ninjaOutput) {
-            line = line.mid(NinjaPrefix.length());
-        }
-        // qDebug() << line;
-
-        QRegularExpressionMatch match = m_newDirDetector.match(line);
-
-        if (match.hasMatch()) {
-            // qDebug() << "Enter/Exit dir found";
-            QString newDir = match.captured(1);
-            // qDebug () << "New dir = " << newDir;
-
-            if ((m_make_dir_stack.size() > 1) && (m_make_dir_stack.top() == newDir)) {
-                m_make_dir_stack.pop();
-                newDir = m_make_dir_stack.top();
-            } else {
-                m_make_dir_stack.push(newDir);
-            }
-
-            m_make_dir = newDir;
-        } else if (m_ninjaBuildDetected && !ninjaOutput) {
-            processLine(line);
-        }
-
-        m_stdOut.remove(0, end + 1);
-    } while (1);
-}
-
-/******************************************************************/
-void KateBuildView::slotReadReadyStdErr()
-{
-    // FIXME This works for utf8 but not for all charsets
-    QString l = QString::fromUtf8(m_proc.readAllStandardError());
-    l.remove(QLatin1Char('\r'));
-    m_buildUi.plainTextEdit->moveCursor(QTextCursor::End);
-    m_buildUi.plainTextEdit->insertPlainText(l);
-    m_stdErr += l;
-
-    do {
-        const int end = m_stdErr.indexOf(QLatin1Char('\n'));
-        if (end < 0) {
-            break;
-        }
-        const QString line = m_stdErr.mid(0, end);
-        processLine(line);
+    // the diagnostics of all jobs are merged into one list
+    QList<QTreeWidgetItem *> items;
+    items.reserve(diagnostics.size());
+    for (const auto &diagnostic : diagnostics) {
+        items.push_back(errorItem(m_diagnostics.add(diagnostic)));
+    }
+    m_buildUi.errTreeWidget->addTopLevelItems(items);
 
-        m_stdErr.remove(0, end + 1);
-    } while (1);
+    // items can only be hidden once they are in the tree
+    const BuildDiagnostic::Category shownCategory = minCategory(m_buildUi.displayModeSlider->value());
+    for (auto item : qAsConst(items)) {
+        const int index = item->data(0, DiagnosticIndexRole).toInt();
+        item->setHidden(m_diagnostics.diagnostic(index).category < shownCategory);
+    }
 }
 
 /******************************************************************/
-void KateBuildView::processLine(QStringView line)
+void KateBuildView::slotShowJobOutput(int index)
 {
-    // qDebug() << line ;
-
-    // look for a filename
-    QRegularExpressionMatch match = m_filenameDetector.match(line);
-
-    if (!match.hasMatch()) {
-        addError(QString(), QStringLiteral("0"), QString(), line.toString());
-        // kDebug() << "A filename was not found in the line ";
-        return;
-    }
-
-    QString filename = match.captured(1);
-    const QString line_n = match.captured(2);
-    const QString col_n = match.captured(3);
-    const QString msg = match.captured(4);
-
-#ifdef Q_OS_WIN
-    // convert '\' to '/' so the concatenation works
-    filename = QFileInfo(filename).filePath();
-#endif
-
-    // qDebug() << "File Name:"<<m_make_dir << filename << " msg:"<< msg;
-    // add path to file
-    if (QFile::exists(m_make_dir + QLatin1Char('/') + filename)) {
-        filename = m_make_dir + QLatin1Char('/') + filename;
-    }
-
-    // If we still do not have a file name try the extra search paths
-    int i = 1;
-    while (!QFile::exists(filename) && i < m_searchPaths.size()) {
-        if (QFile::exists(m_searchPaths[i] + QLatin1Char('/') + filename)) {
-            filename = m_searchPaths[i] + QLatin1Char('/') + filename;
-        }
-        i++;
-    }
-
-    // get canonical path, if possible, to avoid duplicated opened files
-    auto canonicalFilePath(QFileInfo(filename).canonicalFilePath());
-    if (!canonicalFilePath.isEmpty()) {
-        filename = canonicalFilePath;
+    QListView *view = m_buildUi.buildOutputView;
+    disconnect(m_followOutputConnection);
+
+    // the view doesn't delete the selection model of the previous output
+    QItemSelectionModel *selectionModel = view->selectionModel();
+    BuildJob *job = (index >= 0 && index < int(m_scheduler.jobs().size())) ? m_scheduler.jobs()[index].get() : nullptr;
+    view->setModel(job ? job->output() : nullptr);
+    delete selectionModel;
+
+    if (job) {
+        m_followOutputConnection = connect(job->output(), &QAbstractItemModel::rowsInserted, this, [this]() {
+            if (m_followOutput) {
+                m_buildUi.buildOutputView->scrollToBottom();
+            }
+        });
+        view->scrollToBottom();
+        m_followOutput = true;
     }
-
-    // Now we have the data we need show the error/warning
-    addError(filename, line_n, col_n, msg);
 }
 
 /******************************************************************/
@@ -1208,7 +1097,7 @@ void KateBuildView::slotDisplayMode(int mode)
 {
     QTreeWidget *tree = m_buildUi.errTreeWidget;
     tree->setVisible(mode != 0);
-    m_buildUi.plainTextEdit->setVisible(mode == 0);
+    m_buildUi.buildOutputView->setVisible(mode == 0);
 
     QString modeText;
     switch (mode) {
@@ -1231,24 +1120,11 @@ void KateBuildView::slotDisplayMode(int mode)
         return;
     }
 
+    // the items are in the order of the diagnostics
+    const BuildDiagnostic::Category shownCategory = minCategory(mode);
     const int itemCount = tree->topLevelItemCount();
-
     for (int i = 0; i < itemCount; i++) {
-        QTreeWidgetItem *item = tree->topLevelItem(i);
-
-        const ErrorCategory errorCategory = static_cast<ErrorCategory>(item->data(0, ErrorRole).toInt());
-
-        switch (errorCategory) {
-        case CategoryInfo:
-            item->setHidden(mode > 1);
-            break;
-        case CategoryWarning:
-            item->setHidden(mode > 2);
-            break;
-        case CategoryError:
-            item->setHidden(false);
-            break;
-        }
+        tree->topLevelItem(i)->setHidden(m_diagnostics.diagnostic(i).category < shownCategory);
     }
 }
 
@@ -22,11 +22,8 @@
 ** MA 02110-1301, USA.
 */
 
-#include <KProcess>
 #include <QHash>
 #include <QPointer>
-#include <QRegularExpression>
-#include <QStack>
 #include <QString>
 
 #include <KTextEditor/Document>
@@ -40,6 +37,8 @@
 #include <KConfigGroup>
 #include <KXMLGUIClient>
 
+#include "BuildDiagnosticsStore.h"
+#include "BuildScheduler.h"
 #include "targets.h"
 #include "ui_build.h"
 
@@ -53,9 +52,7 @@ class KateBuildView : public QObject, public KXMLGUIClient, public KTextEditor::
 public:
     enum ResultDetails { FullOutput, ParsedOutput, ErrorsAndWarnings, OnlyErrors };
 
-    enum TreeWidgetRoles { ErrorRole = Qt::UserRole + 1, DataRole };
-
-    enum ErrorCategory { CategoryInfo, CategoryWarning, CategoryError };
+    enum TreeWidgetRoles { DiagnosticIndexRole = Qt::UserRole + 1 };
 
     KateBuildView(KTextEditor::Plugin *plugin, KTextEditor::MainWindow *mw);
     ~KateBuildView() override;
@@ -78,9 +75,10 @@ private Q_SLOTS:
     bool slotStop();
 
     // Parse output
-    void slotProcExited(int exitCode, QProcess::ExitStatus exitStatus);
-    void slotReadReadyStdErr();
-    void slotReadReadyStdOut();
+    void slotJobFinished(BuildJob *job);
+    void slotBuildsFinished();
+    void slotDiagnosticsParsed(const QVector<BuildDiagnostic> &diagnostics);
+    void slotShowJobOutput(int index);
 
     // Selecting warnings/errors
     void slotNext();
@@ -117,9 +115,10 @@ private:
 #ifdef Q_OS_WIN
     QString caseFixed(const QString &path);
 #endif
-    void processLine(QStringView line);
-    void addError(const QString &filename, const QString &line, const QString &column, const QString &message);
-    bool startProcess(const QString &dir, const QString &command);
+    QTreeWidgetItem *errorItem(int index) const;
+    void copyOutput();
+    bool buildTarget(const QModelIndex &ind);
+    bool startBuild(const QString &name, const QString &dir, const QString &command, const QStringList &searchPaths);
     bool checkLocal(const QUrl &dir);
     void clearBuildResults();
 
@@ -135,20 +134,26 @@ private:
     QWidget *m_buildWidget;
     int m_outputWidgetWidth;
     TargetsUi *m_targetsUi;
-    KProcess m_proc;
-    QString m_stdOut;
-    QString m_stdErr;
     QString m_currentlyBuildingTarget;
     bool m_buildCancelled;
     int m_displayModeBeforeBuild;
-    QString m_make_dir;
-    QStack<QString> m_make_dir_stack;
-    QStringList m_searchPaths;
-    QRegularExpression m_filenameDetector;
-    bool m_ninjaBuildDetected = false;
-    QRegularExpression m_newDirDetector;
-    unsigned int m_numErrors = 0;
-    unsigned int m_numWarnings = 0;
+
+    /**
+     * runs the builds of the targets, the jobs since the last clear belong to the current build
+     */
+    BuildScheduler m_scheduler;
+
+    /**
+     * should the output view follow new output?
+     */
+    bool m_followOutput = true;
+    QMetaObject::Connection m_followOutputConnection;
+
+    /**
+     * diagnostics of the current build, the rows of the error list
+     */
+    BuildDiagnosticsStore m_diagnostics;
+
     QString m_prevItemContent;
     QModelIndex m_previousIndex;
     QPointer<KTextEditor::Message> m_infoMessage;
@@ -12,8 +12,11 @@
 #include <QEvent>
 #include <QIcon>
 #include <QKeyEvent>
+#include <QThread>
 #include <qnamespace.h>
 
+#include <algorithm>
+
 TargetsUi::TargetsUi(QObject *view, QWidget *parent)
     : QWidget(parent)
 {
@@ -47,7 +50,12 @@ TargetsUi::TargetsUi(QObject *view, QWidget *parent)
 
     buildButton = new QToolButton(this);
     buildButton->setIcon(QIcon::fromTheme(QStringLiteral("run-build")));
-    buildButton->setToolTip(i18n("Build selected target"));
+    buildButton->setToolTip(i18n("Build selected targets"));
+
+    parallelBuilds = new QSpinBox(this);
+    parallelBuilds->setRange(1, std::max(1, QThread::idealThreadCount()));
+    parallelBuilds->setPrefix(i18nc("Prefix of the number of parallel builds", "Parallel: "));
+    parallelBuilds->setToolTip(i18n("Number of targets built at the same time, further targets are queued"));
 
     targetsView = new QTreeView(this);
     targetsView->setAlternatingRowColors(true);
@@ -56,6 +64,7 @@ TargetsUi::TargetsUi(QObject *view, QWidget *parent)
     m_delegate = new TargetHtmlDelegate(view);
     targetsView->setItemDelegate(m_delegate);
     targetsView->setSelectionBehavior(QAbstractItemView::SelectItems);
+    targetsView->setSelectionMode(QAbstractItemView::ExtendedSelection);
     targetsView->setEditTriggers(QAbstractItemView::AnyKeyPressed | QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
     targetsView->expandAll();
     targetsView->resizeColumnToContents(0);
@@ -66,6 +75,7 @@ TargetsUi::TargetsUi(QObject *view, QWidget *parent)
     tLayout->addWidget(targetCombo);
     tLayout->addWidget(targetFilterEdit);
     tLayout->addWidget(buildButton);
+    tLayout->addWidget(parallelBuilds);
     tLayout->addSpacing(20);
     tLayout->addWidget(addButton);
     tLayout->addWidget(newTarget);
@@ -15,6 +15,7 @@
 #include <QGridLayout>
 #include <QLabel>
 #include <QLineEdit>
+#include <QSpinBox>
 #include <QToolButton>
 #include <QTreeView>
 #include <QWidget>
@@ -39,6 +40,7 @@ public:
 
     QToolButton *addButton;
     QToolButton *buildButton;
+    QSpinBox *parallelBuilds;
 
 public Q_SLOTS:
     void targetSetSelected(int index);
@@ -0,0 +1,177 @@
+/*
+   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+   SPDX-License-Identifier: LGPL-2.0-only
+*/
+
+#include "resultblocktest.h"
+#include "resultblock.h"
+
+#include <QDataStream>
+#include <QDate>
+#include <QTest>
+
+QTEST_MAIN(ResultBlockTest)
+
+namespace
+{
+/**
+ * same value and same type, QVariant::operator== converts between types
+ */
+void compareValue(const QVariant &actual, const QVariant &expected)
+{
+    QCOMPARE(actual.isNull(), expected.isNull());
+    if (expected.isNull()) {
+        return;
+    }
+    QCOMPARE(actual.userType(), expected.userType());
+    QCOMPARE(actual, expected);
+}
+
+void compareBlock(const ResultBlock &block, const QVector<QVector<QVariant>> &rows)
+{
+    QCOMPARE(block.rowCount(), rows.size());
+    for (int row = 0; row < rows.size(); ++row) {
+        for (int column = 0; column < rows.at(row).size(); ++column) {
+            compareValue(block.value(row, column), rows.at(row).at(column));
+        }
+    }
+}
+
+ResultBlock makeBlock(int columns, const QVector<QVector<QVariant>> &rows)
+{
+    ResultBlock block(columns);
+    for (const auto &row : rows) {
+        block.appendRow(row);
+    }
+    return block;
+}
+}
+
+void ResultBlockTest::testTypedColumns()
+{
+    const QVector<QVector<QVariant>> rows = {
+        {QVariant(1), QVariant(1.5), QVariant(QStringLiteral("a")), QVariant(true), QVariant(qulonglong(18446744073709551615ULL))},
+        {QVariant(-7), QVariant(-0.25), QVariant(QString::fromUtf8("\xc3\xa9t\xc3\xa9")), QVariant(false), QVariant(qulonglong(0))},
+        {QVariant(2147483647), QVariant(1e300), QVariant(QStringLiteral("longer text")), QVariant(true), QVariant(qulonglong(42))},
+    };
+
+    const ResultBlock block = makeBlock(5, rows);
+    compareBlock(block, rows);
+    QVERIFY(!block.isFull());
+}
+
+void ResultBlockTest::testMixedTypes()
+{
+    // the first values are stored typed, the others force the fallback to variants
+    const QVector<QVector<QVariant>> rows = {
+        {QVariant(1), QVariant(QStringLiteral("x")), QVariant(2.5)},
+        {QVariant(), QVariant(QStringLiteral("y")), QVariant(3.5)},
+        {QVariant(2), QVariant(3), QVariant(qlonglong(4))},
+        {QVariant(QStringLiteral("three")), QVariant(), QVariant(QByteArray("blob"))},
+        {QVariant(qlonglong(4)), QVariant(QStringLiteral("z")), QVariant(QDate(2022, 2, 22))},
+        {QVariant(), QVariant(), QVariant()},
+    };
+
+    compareBlock(makeBlock(3, rows), rows);
+}
+
+void ResultBlockTest::testLeadingNulls()
+{
+    // the type of a column is only known with its first non-null value
+    const QVector<QVector<QVariant>> rows = {
+        {QVariant(), QVariant(), QVariant(), QVariant()},
+        {QVariant(), QVariant(), QVariant(), QVariant()},
+        {QVariant(1), QVariant(QStringLiteral("a")), QVariant(0.5), QVariant()},
+        {QVariant(), QVariant(), QVariant(), QVariant()},
+        {QVariant(2), QVariant(QStringLiteral("b")), QVariant(1.5), QVariant()},
+    };
+
+    compareBlock(makeBlock(4, rows), rows);
+}
+
+void ResultBlockTest::testEmptyAndNullStrings()
+{
+    const QVector<QVector<QVariant>> rows = {
+        {QVariant(QString())},
+        {QVariant(QLatin1String(""))},
+        {QVariant(QStringLiteral("a"))},
+        {QVariant(QString())},
+        {QVariant(QLatin1String(""))},
+    };
+
+    ResultBlock block = makeBlock(1, rows);
+    compareBlock(block, rows);
+
+    // the empty strings are no NULLs
+    QVERIFY(block.value(0, 0).isNull());
+    QVERIFY(!block.value(1, 0).isNull());
+    QCOMPARE(block.value(1, 0).toString(), QString());
+    QVERIFY(block.value(3, 0).isNull());
+    QVERIFY(!block.value(4, 0).isNull());
+}
+
+void ResultBlockTest::testRoundTrip()
+{
+    // a full block with typed, text, mixed and only null columns
+    QVector<QVector<QVariant>> rows;
+    for (int i = 0; i < ResultBlock::Capacity; ++i) {
+        QVector<QVariant> row;
+        row.push_back(i % 10 == 0 ? QVariant() : QVariant(i));
+        row.push_back(QVariant(i * 0.5));
+        row.push_back(i % 7 == 0 ? QVariant(QLatin1String("")) : QVariant(QStringLiteral("row %1").arg(i)));
+        row.push_back(i % 3 == 0 ? QVariant(QByteArray::number(i)) : QVariant(i));
+        row.push_back(QVariant());
+        row.push_back(QVariant(i % 2 == 0));
+        rows.push_back(row);
+    }
+
+    const ResultBlock block = makeBlock(6, rows);
+    QVERIFY(block.isFull());
+
+    QByteArray data;
+    {
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << block;
+        QCOMPARE(stream.status(), QDataStream::Ok);
+    }
+
+    ResultBlock read;
+    {
+        QDataStream stream(data);
+        stream >> read;
+        QCOMPARE(stream.status(), QDataStream::Ok);
+        QVERIFY(stream.atEnd());
+    }
+
+    QVERIFY(read.isFull());
+    compareBlock(read, rows);
+    QVERIFY(!read.value(7, 2).isNull());
+    QCOMPARE(read.value(7, 2).toString(), QString());
+
+    // an empty block
+    QByteArray emptyData;
+    {
+        QDataStream stream(&emptyData, QIODevice::WriteOnly);
+        stream << ResultBlock(3);
+    }
+    ResultBlock empty;
+    QDataStream stream(emptyData);
+    stream >> empty;
+    QCOMPARE(stream.status(), QDataStream::Ok);
+    QCOMPARE(empty.rowCount(), 0);
+}
+
+void ResultBlockTest::testMemoryUsage()
+{
+    ResultBlock block(2);
+    const qint64 emptyUsage = block.memoryUsage();
+    QVERIFY(emptyUsage > 0);
+
+    for (int i = 0; i < 100; ++i) {
+        block.appendRow({QVariant(i), QVariant(QByteArray(1000, 'x'))});
+    }
+
+    // the data of blobs is accounted for, too
+    QVERIFY(block.memoryUsage() > emptyUsage + 100 * 1000);
+}
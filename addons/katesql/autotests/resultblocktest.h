@@ -0,0 +1,25 @@
+/*
+   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+   SPDX-License-Identifier: LGPL-2.0-only
+*/
+
+#ifndef RESULTBLOCKTEST_H
+#define RESULTBLOCKTEST_H
+
+#include <QObject>
+
+class ResultBlockTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testTypedColumns();
+    void testMixedTypes();
+    void testLeadingNulls();
+    void testEmptyAndNullStrings();
+    void testRoundTrip();
+    void testMemoryUsage();
+};
+
+#endif // RESULTBLOCKTEST_H
@@ -6,12 +6,40 @@ SPDX-License-Identifier: LGPL-2.0-only
 
 #include "cachedsqlquerymodel.h"
 
-#include <QDebug>
+#include <QDataStream>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 
-CachedSqlQueryModel::CachedSqlQueryModel(QObject *parent, int cacheCapacity)
-    : QSqlQueryModel(parent)
-    , cache(cacheCapacity)
+namespace
 {
+/// blocks loaded ahead in the direction of scrolling
+const int PrefetchBlocks = 2;
+}
+
+CachedSqlQueryModel::CachedSqlQueryModel(QObject *parent, qint64 memoryBudget)
+    : QAbstractTableModel(parent)
+    , m_memoryBudget(memoryBudget)
+{
+}
+
+CachedSqlQueryModel::~CachedSqlQueryModel()
+{
+    // the temporary file must not go away while blocks are read from it
+    const auto watchers = findChildren<QFutureWatcherBase *>();
+    for (auto watcher : watchers) {
+        watcher->waitForFinished();
+    }
+}
+
+int CachedSqlQueryModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rowCount;
+}
+
+int CachedSqlQueryModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_columns.size();
 }
 
 QVariant CachedSqlQueryModel::data(const QModelIndex &item, int role) const
@@ -20,88 +48,271 @@ QVariant CachedSqlQueryModel::data(const QModelIndex &item, int role) const
         return QVariant();
     }
 
-    if (role == Qt::EditRole) {
-        return QSqlQueryModel::data(item, role);
+    if (role != Qt::DisplayRole && role != Qt::EditRole) {
+        return QVariant();
     }
 
-    if (role != Qt::DisplayRole) {
+    const int index = item.row() / ResultBlock::Capacity;
+
+    touch(index);
+
+    if (role == Qt::DisplayRole && !m_blocks[index].data) {
+        loadInBackground(index);
         return QVariant();
     }
 
-    const int row = item.row();
+    const ResultBlock *b = block(index);
 
-    return record(row).value(item.column());
+    return b ? b->value(item.row() % ResultBlock::Capacity, item.column()) : QVariant();
 }
 
-QSqlRecord CachedSqlQueryModel::record(int row) const
+QVariant CachedSqlQueryModel::headerData(int section, Qt::Orientation orientation, int role) const
 {
-    // if cache capacity is set to 0, don't use cache
-    if (cacheCapacity() == 0) {
-        return QSqlQueryModel::record(row);
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < m_columns.size()) {
+        return m_columns.at(section);
     }
 
-    const int lookAhead = cacheCapacity() / 5;
-    const int halfLookAhead = lookAhead / 2;
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
 
-    if (row > cache.lastIndex()) {
-        if (row - cache.lastIndex() > lookAhead) {
-            cacheRecords(row - halfLookAhead, qMin(rowCount(), row + halfLookAhead));
-        } else {
-            int until = qMin(rowCount(), cache.lastIndex() + lookAhead);
+bool CachedSqlQueryModel::isCached(int row) const
+{
+    const size_t index = row / ResultBlock::Capacity;
 
-            while (cache.lastIndex() < until) {
-                cache.append(QSqlQueryModel::record(cache.lastIndex() + 1));
-            }
+    return index < m_blocks.size() && m_blocks[index].data;
+}
+
+void CachedSqlQueryModel::clear()
+{
+    setColumns(QStringList());
+}
+
+void CachedSqlQueryModel::setColumns(const QStringList &columns)
+{
+    beginResetModel();
+
+    m_columns = columns;
+    m_rowCount = 0;
+    m_blocks.clear();
+    m_spillFile.reset();
+    m_memory = 0;
+    m_lastBlock = 0;
+    m_direction = 1;
+    ++m_generation;
+
+    endResetModel();
+}
+
+void CachedSqlQueryModel::appendRows(const QVector<QVector<QVariant>> &rows)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), m_rowCount, m_rowCount + rows.size() - 1);
+
+    // the last block is always in memory
+    const size_t first = m_blocks.empty() ? 0 : m_blocks.size() - 1;
+
+    for (const auto &row : rows) {
+        if (m_blocks.empty() || m_blocks.back().data->isFull()) {
+            Block b;
+            b.data = std::make_shared<ResultBlock>(m_columns.size());
+            b.lastUsed = ++m_tick;
+            m_blocks.push_back(b);
         }
-    } else if (row < cache.firstIndex()) {
-        if (cache.firstIndex() - row > lookAhead) {
-            cacheRecords(qMax(0, row - halfLookAhead), row + halfLookAhead);
-        } else {
-            int until = qMax(0, cache.firstIndex() - lookAhead);
-
-            while (cache.firstIndex() > until) {
-                cache.prepend(QSqlQueryModel::record(cache.firstIndex() - 1));
-            }
+
+        m_blocks.back().data->appendRow(row);
+        ++m_rowCount;
+    }
+
+    for (size_t i = first; i < m_blocks.size(); ++i) {
+        Block &b = m_blocks[i];
+        m_memory -= b.memory;
+        b.memory = b.data->memoryUsage();
+        m_memory += b.memory;
+    }
+
+    enforceMemoryBudget(int(m_blocks.size()) - 1);
+
+    endInsertRows();
+}
+
+qint64 CachedSqlQueryModel::memoryBudget() const
+{
+    return m_memoryBudget;
+}
+
+void CachedSqlQueryModel::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = bytes;
+
+    enforceMemoryBudget(m_lastBlock);
+}
+
+const ResultBlock *CachedSqlQueryModel::block(int index) const
+{
+    Block &b = m_blocks[index];
+
+    if (!b.data && b.offset >= 0) {
+        if (const auto data = readBlock(m_spillFile->fileName(), b.offset)) {
+            insertBlock(index, data);
         }
     }
 
-    return cache.at(row);
+    return b.data.get();
 }
 
-void CachedSqlQueryModel::clear()
+void CachedSqlQueryModel::touch(int index) const
 {
-    clearCache();
+    m_blocks[index].lastUsed = ++m_tick;
+
+    if (index == m_lastBlock) {
+        return;
+    }
+
+    m_direction = (index > m_lastBlock) ? 1 : -1;
+    m_lastBlock = index;
+
+    for (int i = 1; i <= PrefetchBlocks; ++i) {
+        const int ahead = index + i * m_direction;
 
-    QSqlQueryModel::clear();
+        if (ahead < 0 || ahead >= int(m_blocks.size())) {
+            break;
+        }
+
+        loadInBackground(ahead);
+    }
 }
 
-void CachedSqlQueryModel::cacheRecords(int from, int to) const
+void CachedSqlQueryModel::loadInBackground(int index) const
 {
-    qDebug() << "caching records from" << from << "to" << to;
+    Block &b = m_blocks[index];
 
-    for (int i = from; i <= to; ++i) {
-        cache.insert(i, QSqlQueryModel::record(i));
+    if (b.data || b.loading || b.offset < 0) {
+        return;
     }
+
+    b.loading = true;
+
+    // loading doesn't change the contents of the model
+    auto self = const_cast<CachedSqlQueryModel *>(this);
+    auto watcher = new QFutureWatcher<std::shared_ptr<ResultBlock>>(self);
+    const int generation = m_generation;
+
+    connect(watcher, &QFutureWatcherBase::finished, self, [self, watcher, index, generation]() {
+        watcher->deleteLater();
+        self->blockLoaded(index, generation, watcher->result());
+    });
+
+    watcher->setFuture(QtConcurrent::run(&CachedSqlQueryModel::readBlock, m_spillFile->fileName(), b.offset));
+}
+
+void CachedSqlQueryModel::blockLoaded(int index, int generation, const std::shared_ptr<ResultBlock> &data)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    Block &b = m_blocks[index];
+    b.loading = false;
+
+    // loaded meanwhile by someone waiting for it
+    if (!data || b.data) {
+        return;
+    }
+
+    b.lastUsed = ++m_tick;
+    insertBlock(index, data);
+
+    const int firstRow = index * ResultBlock::Capacity;
+    Q_EMIT dataChanged(this->index(firstRow, 0), this->index(firstRow + data->rowCount() - 1, columnCount() - 1));
 }
 
-void CachedSqlQueryModel::clearCache()
+void CachedSqlQueryModel::insertBlock(int index, const std::shared_ptr<ResultBlock> &data) const
 {
-    cache.clear();
+    Block &b = m_blocks[index];
+    b.data = data;
+    b.memory = data->memoryUsage();
+    m_memory += b.memory;
+
+    enforceMemoryBudget(index);
 }
 
-int CachedSqlQueryModel::cacheCapacity() const
+void CachedSqlQueryModel::enforceMemoryBudget(int keep) const
 {
-    return cache.capacity();
+    while (m_memory > m_memoryBudget) {
+        // the least recently used one, the last block is still filled
+        int victim = -1;
+
+        for (int i = 0; i + 1 < int(m_blocks.size()); ++i) {
+            const Block &b = m_blocks[i];
+
+            if (i != keep && b.data && (victim < 0 || b.lastUsed < m_blocks[victim].lastUsed)) {
+                victim = i;
+            }
+        }
+
+        if (victim < 0) {
+            return;
+        }
+
+        // blocks don't change once full, they are written only once
+        Block &b = m_blocks[victim];
+
+        if (b.offset < 0 && !writeBlock(b)) {
+            return;
+        }
+
+        m_memory -= b.memory;
+        b.memory = 0;
+        b.data.reset();
+    }
 }
 
-void CachedSqlQueryModel::setCacheCapacity(int capacity)
+bool CachedSqlQueryModel::writeBlock(Block &block) const
 {
-    qDebug() << "cache capacity set to" << capacity;
+    // without a temporary file all blocks stay in memory
+    if (!m_spillFile) {
+        m_spillFile = std::make_unique<QTemporaryFile>();
+        m_spillFile->open();
+    }
+
+    if (!m_spillFile->isOpen()) {
+        return false;
+    }
 
-    cache.setCapacity(capacity);
+    const qint64 offset = m_spillFile->size();
+
+    if (!m_spillFile->seek(offset)) {
+        return false;
+    }
+
+    QDataStream stream(m_spillFile.get());
+    stream << *block.data;
+
+    // the blocks are read with other file handles
+    if (stream.status() != QDataStream::Ok || !m_spillFile->flush()) {
+        return false;
+    }
+
+    block.offset = offset;
+
+    return true;
 }
 
-void CachedSqlQueryModel::queryChange()
+std::shared_ptr<ResultBlock> CachedSqlQueryModel::readBlock(const QString &fileName, qint64 offset)
 {
-    clearCache();
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(offset)) {
+        return nullptr;
+    }
+
+    auto data = std::make_shared<ResultBlock>();
+
+    QDataStream stream(&file);
+    stream >> *data;
+
+    return (stream.status() == QDataStream::Ok) ? data : nullptr;
 }
@@ -7,33 +7,82 @@ SPDX-License-Identifier: LGPL-2.0-only
 #ifndef CACHEDSQLQUERYMODEL_H
 #define CACHEDSQLQUERYMODEL_H
 
-#include <QContiguousCache>
-#include <QSqlQueryModel>
-#include <QSqlRecord>
+#include "resultblock.h"
 
-class CachedSqlQueryModel : public QSqlQueryModel
+#include <QAbstractTableModel>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QVariant>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+/**
+ * Holds the rows of a result set, they are appended as they are fetched.
+ *
+ * The rows are stored in blocks. Only as many blocks as the memory budget allows are kept in memory,
+ * the others are written to a temporary file. When scrolling, the blocks ahead are loaded in the background.
+ */
+class CachedSqlQueryModel : public QAbstractTableModel
 {
     Q_OBJECT
 public:
-    explicit CachedSqlQueryModel(QObject *parent = nullptr, int cacheCapacity = 1000);
+    explicit CachedSqlQueryModel(QObject *parent = nullptr, qint64 memoryBudget = 256 * 1024 * 1024);
+    ~CachedSqlQueryModel() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
 
+    /// Qt::DisplayRole is empty for rows not in memory, they are loaded in the background
+    /// Qt::EditRole waits for them
     QVariant data(const QModelIndex &item, int role = Qt::DisplayRole) const override;
-    QSqlRecord record(int row) const;
-    void clear() override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
-    int cacheCapacity() const;
+    void clear();
 
-public Q_SLOTS:
-    void clearCache();
-    void setCacheCapacity(int);
+    /// is the row in memory?
+    bool isCached(int row) const;
 
-protected:
-    void queryChange() override;
+    qint64 memoryBudget() const;
+
+public Q_SLOTS:
+    void setColumns(const QStringList &columns);
+    void appendRows(const QVector<QVector<QVariant>> &rows);
+    void setMemoryBudget(qint64 bytes);
 
 private:
-    void cacheRecords(int from, int to) const;
+    struct Block {
+        std::shared_ptr<ResultBlock> data; // null if not in memory
+        qint64 offset = -1; // position in the temporary file, -1 if not written yet
+        qint64 memory = 0;
+        quint64 lastUsed = 0;
+        bool loading = false;
+    };
+
+    const ResultBlock *block(int index) const;
+    void touch(int index) const;
+    void loadInBackground(int index) const;
+    void blockLoaded(int index, int generation, const std::shared_ptr<ResultBlock> &data);
+    void insertBlock(int index, const std::shared_ptr<ResultBlock> &data) const;
+    void enforceMemoryBudget(int keep) const;
+    bool writeBlock(Block &block) const;
+    static std::shared_ptr<ResultBlock> readBlock(const QString &fileName, qint64 offset);
+
+    QStringList m_columns;
+    int m_rowCount = 0;
+    qint64 m_memoryBudget;
+
+    // the cache is filled and trimmed on reading
+    mutable std::vector<Block> m_blocks;
+    mutable std::unique_ptr<QTemporaryFile> m_spillFile;
+    mutable qint64 m_memory = 0;
+    mutable quint64 m_tick = 0;
+    mutable int m_lastBlock = 0;
+    mutable int m_direction = 1;
 
-    mutable QContiguousCache<QSqlRecord> cache;
+    /// results of loads for a former result set are dropped
+    int m_generation = 0;
 };
 
 #endif // CACHEDSQLQUERYMODEL_H
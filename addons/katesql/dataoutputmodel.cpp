@@ -21,7 +21,7 @@ inline bool isNumeric(const QVariant::Type type)
 }
 
 DataOutputModel::DataOutputModel(QObject *parent)
-    : CachedSqlQueryModel(parent, 1000)
+    : CachedSqlQueryModel(parent)
 {
     m_useSystemLocale = false;
 
@@ -40,19 +40,12 @@ DataOutputModel::~DataOutputModel()
     qDeleteAll(m_styles);
 }
 
-void DataOutputModel::clear()
-{
-    beginResetModel();
-
-    CachedSqlQueryModel::clear();
-
-    endResetModel();
-}
-
 void DataOutputModel::readConfig()
 {
     KConfigGroup config(KSharedConfig::openConfig(), "KateSQLPlugin");
 
+    setMemoryBudget(config.readEntry("ResultsMemoryBudget", 256) * qint64(1024 * 1024));
+
     KConfigGroup group = config.group("OutputCustomization");
 
     KColorScheme scheme(QPalette::Active, KColorScheme::View);
@@ -98,7 +91,12 @@ QVariant DataOutputModel::data(const QModelIndex &index, int role) const
         return CachedSqlQueryModel::data(index, role);
     }
 
-    const QVariant value(CachedSqlQueryModel::data(index, Qt::DisplayRole));
+    // rows not in memory are shown once loaded in the background, only the export waits for them
+    if (role != Qt::UserRole && !isCached(index.row())) {
+        return CachedSqlQueryModel::data(index, role);
+    }
+
+    const QVariant value(CachedSqlQueryModel::data(index, Qt::EditRole));
     const QVariant::Type type = value.type();
 
     if (value.isNull()) {
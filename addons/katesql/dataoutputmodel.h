@@ -28,7 +28,6 @@ public:
 
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
 
-    void clear() override;
     void readConfig();
 
 private:
@@ -28,8 +28,6 @@
 #include <QHeaderView>
 #include <QLayout>
 #include <QSize>
-#include <QSqlError>
-#include <QSqlQuery>
 #include <QStyle>
 #include <QTextStream>
 #include <QTime>
@@ -101,29 +99,32 @@ DataOutputWidget::~DataOutputWidget()
 {
 }
 
-void DataOutputWidget::showQueryResultSets(QSqlQuery &query)
+void DataOutputWidget::showQueryResultSets(const QStringList &columns)
 {
     /// TODO: loop resultsets if > 1
-    /// NOTE from Qt Documentation:
-    /// When one of the statements is a non-select statement a count of affected rows
-    /// may be available instead of a result set.
 
-    if (!query.isSelect() || query.lastError().isValid()) {
-        return;
-    }
-
-    m_model->setQuery(query);
+    m_model->setColumns(columns);
 
     m_isEmpty = false;
 
-    QTimer::singleShot(0, this, &DataOutputWidget::resizeColumnsToContents);
+    // the columns are sized to the first rows, later ones don't change them
+    m_resizeColumns = true;
 
     raise();
 }
 
+void DataOutputWidget::appendRows(const QVector<QVector<QVariant>> &rows)
+{
+    m_model->appendRows(rows);
+
+    if (m_resizeColumns) {
+        m_resizeColumns = false;
+        QTimer::singleShot(0, this, &DataOutputWidget::resizeColumnsToContents);
+    }
+}
+
 void DataOutputWidget::clearResults()
 {
-    // avoid crash when calling QSqlQueryModel::clear() after removing connection from the QSqlDatabase list
     if (m_isEmpty) {
         return;
     }
@@ -175,10 +176,6 @@ void DataOutputWidget::slotCopySelected()
         return;
     }
 
-    while (m_model->canFetchMore()) {
-        m_model->fetchMore();
-    }
-
     if (!m_view->selectionModel()->hasSelection()) {
         m_view->selectAll();
     }
@@ -199,10 +196,6 @@ void DataOutputWidget::slotExport()
         return;
     }
 
-    while (m_model->canFetchMore()) {
-        m_model->fetchMore();
-    }
-
     if (!m_view->selectionModel()->hasSelection()) {
         m_view->selectAll();
     }
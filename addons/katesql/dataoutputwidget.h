@@ -9,10 +9,12 @@
 
 class QTextStream;
 class QVBoxLayout;
-class QSqlQuery;
 class DataOutputModel;
 class DataOutputView;
 
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
 #include <QWidget>
 
 class DataOutputWidget : public QWidget
@@ -43,7 +45,8 @@ public:
     }
 
 public Q_SLOTS:
-    void showQueryResultSets(QSqlQuery &query);
+    void showQueryResultSets(const QStringList &columns);
+    void appendRows(const QVector<QVector<QVariant>> &rows);
     void resizeColumnsToContents();
     void resizeRowsToContents();
     void clearResults();
@@ -60,6 +63,7 @@ private:
     DataOutputView *m_view;
 
     bool m_isEmpty;
+    bool m_resizeColumns = false;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(DataOutputWidget::Options)
@@ -14,6 +14,8 @@
 #include <QBoxLayout>
 #include <QCheckBox>
 #include <QGroupBox>
+#include <QLabel>
+#include <QSpinBox>
 
 KateSQLConfigPage::KateSQLConfigPage(QWidget *parent)
     : KTextEditor::ConfigPage(parent)
@@ -22,6 +24,21 @@ KateSQLConfigPage::KateSQLConfigPage(QWidget *parent)
 
     m_box = new QCheckBox(i18nc("@option:check", "Save and restore connections in Kate session"), this);
 
+    QHBoxLayout *memoryLayout = new QHBoxLayout();
+
+    m_memoryBudget = new QSpinBox(this);
+    m_memoryBudget->setRange(16, 65536);
+    m_memoryBudget->setSingleStep(64);
+    m_memoryBudget->setSuffix(i18nc("@item:valuesuffix", " MiB"));
+    m_memoryBudget->setToolTip(i18nc("@info:tooltip", "Rows of query results beyond this are kept in a temporary file"));
+
+    QLabel *memoryLabel = new QLabel(i18nc("@label:spinbox", "Memory for query results:"), this);
+    memoryLabel->setBuddy(m_memoryBudget);
+
+    memoryLayout->addWidget(memoryLabel);
+    memoryLayout->addWidget(m_memoryBudget);
+    memoryLayout->addStretch();
+
     QGroupBox *stylesGroupBox = new QGroupBox(i18nc("@title:group", "Output Customization"), this);
     QVBoxLayout *stylesLayout = new QVBoxLayout(stylesGroupBox);
 
@@ -30,6 +47,7 @@ KateSQLConfigPage::KateSQLConfigPage(QWidget *parent)
     stylesLayout->addWidget(m_outputStyleWidget);
 
     layout->addWidget(m_box);
+    layout->addLayout(memoryLayout);
     layout->addWidget(stylesGroupBox, 1);
 
     setLayout(layout);
@@ -37,6 +55,7 @@ KateSQLConfigPage::KateSQLConfigPage(QWidget *parent)
     reset();
 
     connect(m_box, &QCheckBox::stateChanged, this, &KateSQLConfigPage::changed);
+    connect(m_memoryBudget, QOverload<int>::of(&QSpinBox::valueChanged), this, &KateSQLConfigPage::changed);
     connect(m_outputStyleWidget, &OutputStyleWidget::changed, this, &KateSQLConfigPage::changed);
 }
 
@@ -64,6 +83,7 @@ void KateSQLConfigPage::apply()
     KConfigGroup config(KSharedConfig::openConfig(), "KateSQLPlugin");
 
     config.writeEntry("SaveConnections", m_box->isChecked());
+    config.writeEntry("ResultsMemoryBudget", m_memoryBudget->value());
 
     m_outputStyleWidget->writeConfig();
 
@@ -77,6 +97,7 @@ void KateSQLConfigPage::reset()
     KConfigGroup config(KSharedConfig::openConfig(), "KateSQLPlugin");
 
     m_box->setChecked(config.readEntry("SaveConnections", true));
+    m_memoryBudget->setValue(config.readEntry("ResultsMemoryBudget", 256));
 
     m_outputStyleWidget->readConfig();
 }
@@ -86,5 +107,6 @@ void KateSQLConfigPage::defaults()
     KConfigGroup config(KSharedConfig::openConfig(), "KateSQLPlugin");
 
     config.revertToDefault("SaveConnections");
+    config.revertToDefault("ResultsMemoryBudget");
     config.revertToDefault("OutputCustomization");
 }
@@ -9,6 +9,7 @@
 
 class OutputStyleWidget;
 class QCheckBox;
+class QSpinBox;
 
 #include "katesqlplugin.h"
 
@@ -36,6 +37,7 @@ public Q_SLOTS:
 private:
     KateSQLPlugin *m_plugin = nullptr;
     QCheckBox *m_box;
+    QSpinBox *m_memoryBudget;
     OutputStyleWidget *m_outputStyleWidget;
 
 Q_SIGNALS:
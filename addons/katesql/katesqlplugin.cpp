@@ -14,6 +14,7 @@
 #include <KLocalizedString>
 
 #include <QIcon>
+#include <QThread>
 
 K_PLUGIN_FACTORY_WITH_JSON(KateSQLFactory, "katesql.json", registerPlugin<KateSQLPlugin>();)
 
@@ -25,6 +26,12 @@ KateSQLPlugin::KateSQLPlugin(QObject *parent, const QList<QVariant> &)
 
 KateSQLPlugin::~KateSQLPlugin()
 {
+    // query threads of closed views, their statements could not be interrupted
+    // they run our code, so they must be done before the plugin goes away
+    const auto threads = findChildren<QThread *>(QString(), Qt::FindDirectChildrenOnly);
+    for (auto thread : threads) {
+        thread->wait();
+    }
 }
 
 QObject *KateSQLPlugin::createView(KTextEditor::MainWindow *mainWindow)
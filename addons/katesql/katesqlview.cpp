@@ -33,14 +33,14 @@
 
 #include <QApplication>
 #include <QMenu>
-#include <QSqlQuery>
+#include <QSqlDatabase>
 #include <QString>
 #include <QVBoxLayout>
 #include <QWidgetAction>
 
 KateSQLView::KateSQLView(KTextEditor::Plugin *plugin, KTextEditor::MainWindow *mw)
     : QObject(mw)
-    , m_manager(new SQLManager(this))
+    , m_manager(new SQLManager(plugin, this))
     , m_mainWindow(mw)
 {
     KXMLGUIClient::setComponentName(QStringLiteral("katesql"), i18n("Kate SQL Plugin"));
@@ -81,6 +81,9 @@ KateSQLView::KateSQLView(KTextEditor::Plugin *plugin, KTextEditor::MainWindow *m
     connect(m_manager, &SQLManager::error, this, &KateSQLView::slotError);
     connect(m_manager, &SQLManager::success, this, &KateSQLView::slotSuccess);
     connect(m_manager, &SQLManager::queryActivated, this, &KateSQLView::slotQueryActivated);
+    connect(m_manager, &SQLManager::queryRowsFetched, m_outputWidget->dataOutputWidget(), &DataOutputWidget::appendRows);
+    connect(m_manager, &SQLManager::queryProgress, m_outputWidget, &KateSQLOutputWidget::showQueryProgress);
+    connect(m_manager, &SQLManager::queryRunningChanged, this, &KateSQLView::slotQueryRunningChanged);
     connect(m_manager, &SQLManager::connectionCreated, this, &KateSQLView::slotConnectionCreated);
     connect(m_manager, &SQLManager::connectionAboutToBeClosed, this, &KateSQLView::slotConnectionAboutToBeClosed);
     connect(m_connectionsComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &KateSQLView::slotConnectionChanged);
@@ -133,12 +136,12 @@ void KateSQLView::setupActions()
     action->setIcon(QIcon::fromTheme(QStringLiteral("quickopen")));
     connect(action, &QAction::triggered, this, &KateSQLView::slotRunQuery);
 
-    /// TODO: stop sql query
-    //   action = collection->addAction("sql_stop");
-    //   action->setText( i18n("Stop query") );
-    //   action->setIcon( KIcon("process-stop") );
-    //   action->setShortcut( QKeySequence(Qt::ALT | Qt::Key_F5) );
-    //   connect( action , SIGNAL(triggered()) , this , SLOT(stopQuery()));
+    action = collection->addAction(QStringLiteral("query_stop"));
+    action->setText(i18nc("@action:inmenu", "Stop query"));
+    action->setIcon(QIcon::fromTheme(QStringLiteral("process-stop")));
+    collection->setDefaultShortcut(action, QKeySequence(Qt::ALT | Qt::Key_F5));
+    action->setEnabled(false);
+    connect(action, &QAction::triggered, this, &KateSQLView::slotStopQuery);
 }
 
 void KateSQLView::slotSQLMenuAboutToShow()
@@ -285,7 +288,7 @@ void KateSQLView::slotConnectionReconnect()
 
 void KateSQLView::slotConnectionAboutToBeClosed(const QString &name)
 {
-    /// must delete the QSqlQuery object inside the model before closing connection
+    /// the results of a connection that goes away are outdated
 
     if (name == m_currentResultsetConnection) {
         m_outputWidget->dataOutputWidget()->clearResults();
@@ -320,6 +323,17 @@ void KateSQLView::slotRunQuery()
     m_manager->runQuery(text, connection);
 }
 
+void KateSQLView::slotStopQuery()
+{
+    m_manager->cancelQuery();
+}
+
+void KateSQLView::slotQueryRunningChanged(bool running)
+{
+    action("query_stop")->setEnabled(running);
+    m_outputWidget->setQueryRunning(running);
+}
+
 void KateSQLView::slotError(const QString &message)
 {
     m_outputWidget->textOutputWidget()->showErrorMessage(message);
@@ -334,15 +348,13 @@ void KateSQLView::slotSuccess(const QString &message)
     m_mainWindow->showToolView(m_outputToolView);
 }
 
-void KateSQLView::slotQueryActivated(QSqlQuery &query, const QString &connection)
+void KateSQLView::slotQueryActivated(const QStringList &columns, const QString &connection)
 {
-    if (query.isSelect()) {
-        m_currentResultsetConnection = connection;
+    m_currentResultsetConnection = connection;
 
-        m_outputWidget->dataOutputWidget()->showQueryResultSets(query);
-        m_outputWidget->setCurrentWidget(m_outputWidget->dataOutputWidget());
-        m_mainWindow->showToolView(m_outputToolView);
-    }
+    m_outputWidget->dataOutputWidget()->showQueryResultSets(columns);
+    m_outputWidget->setCurrentWidget(m_outputWidget->dataOutputWidget());
+    m_mainWindow->showToolView(m_outputToolView);
 }
 
 void KateSQLView::slotConnectionCreated(const QString &name)
@@ -26,7 +26,6 @@ class SQLManager;
 class KConfigBase;
 class KComboBox;
 
-class QSqlQuery;
 class QActionGroup;
 
 #include <KXMLGUIClient>
@@ -57,9 +56,11 @@ public Q_SLOTS:
     void slotConnectionReconnect();
     void slotConnectionChanged(int currentIndex);
     void slotRunQuery();
+    void slotStopQuery();
+    void slotQueryRunningChanged(bool running);
     void slotError(const QString &message);
     void slotSuccess(const QString &message);
-    void slotQueryActivated(QSqlQuery &query, const QString &connection);
+    void slotQueryActivated(const QStringList &columns, const QString &connection);
     void slotConnectionCreated(const QString &name);
     void slotGlobalSettingsChanged();
     void slotSQLMenuAboutToShow();
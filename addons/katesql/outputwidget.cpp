@@ -10,14 +10,40 @@
 #include "textoutputwidget.h"
 #include <KLocalizedString>
 
+#include <QLabel>
+
 KateSQLOutputWidget::KateSQLOutputWidget(QWidget *parent)
     : QTabWidget(parent)
 
 {
     addTab(m_textOutputWidget = new TextOutputWidget(this), QIcon::fromTheme(QStringLiteral("view-list-text")), i18nc("@title:window", "SQL Text Output"));
     addTab(m_dataOutputWidget = new DataOutputWidget(this), QIcon::fromTheme(QStringLiteral("view-form-table")), i18nc("@title:window", "SQL Data Output"));
+
+    // visible in both tabs, only while a query runs
+    m_progressLabel = new QLabel(this);
+    m_progressLabel->setContentsMargins(0, 0, 4, 0);
+    m_progressLabel->hide();
+    setCornerWidget(m_progressLabel, Qt::TopRightCorner);
 }
 
 KateSQLOutputWidget::~KateSQLOutputWidget()
 {
 }
+
+void KateSQLOutputWidget::showQueryProgress(int rows, int totalRows, qint64 msecs)
+{
+    const QString seconds = QString::number(msecs / 1000.0, 'f', 1);
+
+    if (rows < 0) {
+        m_progressLabel->setText(i18nc("@info", "Executing query... %1 s", seconds));
+    } else if (totalRows >= 0) {
+        m_progressLabel->setText(i18nc("@info", "Fetched %1 of %2 records... %3 s", rows, totalRows, seconds));
+    } else {
+        m_progressLabel->setText(i18ncp("@info", "Fetched %1 record... %2 s", "Fetched %1 records... %2 s", rows, seconds));
+    }
+}
+
+void KateSQLOutputWidget::setQueryRunning(bool running)
+{
+    m_progressLabel->setVisible(running);
+}
@@ -12,6 +12,7 @@
 
 class TextOutputWidget;
 class DataOutputWidget;
+class QLabel;
 
 class KateSQLOutputWidget : public QTabWidget
 {
@@ -31,9 +32,14 @@ public:
         return m_dataOutputWidget;
     }
 
+public Q_SLOTS:
+    void showQueryProgress(int rows, int totalRows, qint64 msecs);
+    void setQueryRunning(bool running);
+
 private:
     TextOutputWidget *m_textOutputWidget;
     DataOutputWidget *m_dataOutputWidget;
+    QLabel *m_progressLabel;
 };
 
 #endif
@@ -0,0 +1,165 @@
+/*
+   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+   SPDX-License-Identifier: LGPL-2.0-only
+*/
+
+#include "queryworker.h"
+
+#include <QElapsedTimer>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+namespace
+{
+/**
+ * rows are sent when that many are fetched or the interval passed, whatever comes first
+ */
+const int BatchSize = 1000;
+const int BatchInterval = 100;
+
+bool isPostgreSql(const QString &driver)
+{
+    return driver.startsWith(QLatin1String("QPSQL"));
+}
+
+bool isMySql(const QString &driver)
+{
+    return driver.startsWith(QLatin1String("QMYSQL")) || driver.startsWith(QLatin1String("QMARIADB"));
+}
+}
+
+QueryWorker::QueryWorker(const QString &connection)
+    : m_connection(connection)
+    , m_cloneName(QStringLiteral("katesql-query-%1").arg(quintptr(this)))
+{
+}
+
+QueryWorker::~QueryWorker()
+{
+    if (QSqlDatabase::contains(m_cloneName)) {
+        QSqlDatabase::removeDatabase(m_cloneName);
+    }
+}
+
+QSqlDatabase QueryWorker::database()
+{
+    if (!QSqlDatabase::contains(m_cloneName)) {
+        QSqlDatabase::cloneDatabase(m_connection, m_cloneName);
+    }
+
+    return QSqlDatabase::database(m_cloneName, false);
+}
+
+void QueryWorker::exec(int id, const QString &text)
+{
+    if (isCancelled(id)) {
+        return;
+    }
+
+    QSqlDatabase db = database();
+
+    if (!db.isOpen()) {
+        if (!db.open()) {
+            Q_EMIT failed(id, db.lastError().text(), true);
+            return;
+        }
+
+        // the session id is needed to interrupt our statements from another connection
+        QSqlQuery session(db);
+        if (isPostgreSql(db.driverName())) {
+            session.exec(QStringLiteral("SELECT pg_backend_pid()"));
+        } else if (isMySql(db.driverName())) {
+            session.exec(QStringLiteral("SELECT CONNECTION_ID()"));
+        }
+        m_sessionId = session.next() ? session.value(0).toLongLong() : -1;
+    }
+
+    QSqlQuery query(db);
+
+    // we never seek back, drivers can drop the fetched rows
+    query.setForwardOnly(true);
+
+    if (!query.prepare(text) || !query.exec()) {
+        const QSqlError err = query.lastError();
+        Q_EMIT failed(id, err.text(), err.type() == QSqlError::ConnectionError);
+        return;
+    }
+
+    if (!query.isSelect()) {
+        Q_EMIT finished(id, false, query.numRowsAffected());
+        return;
+    }
+
+    const QSqlRecord record = query.record();
+    QStringList columns;
+    columns.reserve(record.count());
+    for (int i = 0; i < record.count(); ++i) {
+        columns.push_back(record.fieldName(i));
+    }
+
+    const int totalRows = query.driver()->hasFeature(QSqlDriver::QuerySize) ? query.size() : -1;
+    Q_EMIT columnsFetched(id, columns, totalRows);
+
+    QVector<QVector<QVariant>> rows;
+    rows.reserve(BatchSize);
+
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+
+    while (query.next()) {
+        if (isCancelled(id)) {
+            return;
+        }
+
+        QVector<QVariant> row(columns.size());
+        for (int i = 0; i < columns.size(); ++i) {
+            row[i] = query.value(i);
+        }
+        rows.push_back(std::move(row));
+
+        if (rows.size() >= BatchSize || batchTimer.hasExpired(BatchInterval)) {
+            Q_EMIT rowsFetched(id, rows);
+            rows.clear();
+            rows.reserve(BatchSize);
+            batchTimer.restart();
+        }
+    }
+
+    if (!rows.isEmpty()) {
+        Q_EMIT rowsFetched(id, rows);
+    }
+
+    // errors while fetching end the result set early
+    if (query.lastError().isValid()) {
+        const QSqlError err = query.lastError();
+        Q_EMIT failed(id, err.text(), err.type() == QSqlError::ConnectionError);
+        return;
+    }
+
+    Q_EMIT finished(id, true, -1);
+}
+
+bool QueryWorker::interrupt()
+{
+    const qint64 session = m_sessionId;
+    if (session < 0) {
+        return false;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database(m_connection, false);
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    QSqlQuery query(db);
+    if (isPostgreSql(db.driverName())) {
+        return query.exec(QStringLiteral("SELECT pg_cancel_backend(%1)").arg(session));
+    }
+    if (isMySql(db.driverName())) {
+        return query.exec(QStringLiteral("KILL QUERY %1").arg(session));
+    }
+    return false;
+}
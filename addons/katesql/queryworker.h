@@ -0,0 +1,95 @@
+/*
+   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+   SPDX-License-Identifier: LGPL-2.0-only
+*/
+
+#ifndef QUERYWORKER_H
+#define QUERYWORKER_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include <atomic>
+
+/**
+ * Executes the queries of one connection in its own thread.
+ *
+ * A connection can only be used in the thread that created it, the worker uses a clone
+ * of the connection made in its thread. The rows of a result set are streamed in batches.
+ * Queries are identified by an id, which is passed with all results.
+ */
+class QueryWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param connection name of the connection to clone, it must be open already
+     */
+    explicit QueryWorker(const QString &connection);
+
+    /**
+     * Removes the clone, must happen in the thread of the worker.
+     */
+    ~QueryWorker() override;
+
+    /**
+     * Execute a query, must be invoked in the thread of the worker.
+     */
+    void exec(int id, const QString &text);
+
+    /**
+     * Cancel a query, can be called from any thread.
+     * The rows are no longer fetched, a statement that is executed already is not interrupted.
+     */
+    void cancel(int id)
+    {
+        m_cancelledId = id;
+    }
+
+    /**
+     * Interrupt the statement being executed by the worker, if any.
+     * Must be called in the thread of the original connection, which is used to ask the server for it.
+     * Only PostgreSQL and MySQL/MariaDB can do that, others just go on.
+     * @return could the server be asked?
+     */
+    bool interrupt();
+
+Q_SIGNALS:
+    /**
+     * The query has a result set, its rows follow.
+     * @param totalRows number of rows, -1 if the driver doesn't report it
+     */
+    void columnsFetched(int id, const QStringList &columns, int totalRows);
+
+    void rowsFetched(int id, const QVector<QVector<QVariant>> &rows);
+
+    /**
+     * The query is done, all rows have been fetched.
+     */
+    void finished(int id, bool isSelect, int numRowsAffected);
+
+    void failed(int id, const QString &message, bool connectionError);
+
+private:
+    bool isCancelled(int id) const
+    {
+        return m_cancelledId >= id;
+    }
+
+    QSqlDatabase database();
+
+    const QString m_connection;
+    const QString m_cloneName;
+    std::atomic<int> m_cancelledId{-1};
+
+    /// server side id of the session of the clone, -1 if unknown
+    std::atomic<qint64> m_sessionId{-1};
+};
+
+#endif // QUERYWORKER_H
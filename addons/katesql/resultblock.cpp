@@ -0,0 +1,245 @@
+/*
+   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+   SPDX-License-Identifier: LGPL-2.0-only
+*/
+
+#include "resultblock.h"
+
+#include <QDataStream>
+
+ResultBlock::ResultBlock(int columns)
+    : m_columns(columns)
+{
+}
+
+ResultBlock::Column::Storage ResultBlock::storageFor(int type)
+{
+    switch (type) {
+    case QVariant::Bool:
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+        return Column::Integer;
+    case QVariant::Double:
+        return Column::Real;
+    case QVariant::String:
+        return Column::Text;
+    default:
+        return Column::Variant;
+    }
+}
+
+void ResultBlock::appendRow(const QVector<QVariant> &row)
+{
+    Q_ASSERT(!isFull());
+
+    for (int i = 0; i < m_columns.size(); ++i) {
+        m_columns[i].append(row.value(i), m_rowCount);
+    }
+
+    ++m_rowCount;
+}
+
+void ResultBlock::Column::append(const QVariant &value, int row)
+{
+    if (value.isNull()) {
+        nulls.setBit(row);
+        appendDefault();
+        return;
+    }
+
+    const int valueType = value.userType();
+
+    // the first value decides how the column is stored, the rows before were null
+    if (storage == Empty) {
+        storage = storageFor(valueType);
+        type = valueType;
+        for (int i = 0; i < row; ++i) {
+            appendDefault();
+        }
+    } else if (storage != Variant && type != valueType) {
+        toVariants(row);
+    }
+
+    switch (storage) {
+    case Integer:
+        integers.push_back(valueType == QVariant::ULongLong ? qint64(value.toULongLong()) : value.toLongLong());
+        break;
+    case Real:
+        reals.push_back(value.toDouble());
+        break;
+    case Text:
+        text.append(value.toString().toUtf8());
+        textEnds.push_back(quint32(text.size()));
+        break;
+    default:
+        variants.push_back(value);
+        break;
+    }
+}
+
+void ResultBlock::Column::appendDefault()
+{
+    switch (storage) {
+    case Empty:
+        break;
+    case Integer:
+        integers.push_back(0);
+        break;
+    case Real:
+        reals.push_back(0);
+        break;
+    case Text:
+        textEnds.push_back(quint32(text.size()));
+        break;
+    case Variant:
+        variants.push_back(QVariant());
+        break;
+    }
+}
+
+QVariant ResultBlock::Column::value(int row) const
+{
+    if (storage == Empty || nulls.testBit(row)) {
+        return QVariant();
+    }
+
+    switch (storage) {
+    case Integer: {
+        const qint64 v = integers.at(row);
+        switch (type) {
+        case QVariant::Bool:
+            return QVariant(v != 0);
+        case QVariant::Int:
+            return QVariant(int(v));
+        case QVariant::UInt:
+            return QVariant(uint(v));
+        case QVariant::ULongLong:
+            return QVariant(qulonglong(v));
+        default:
+            return QVariant(qlonglong(v));
+        }
+    }
+    case Real:
+        return QVariant(reals.at(row));
+    case Text: {
+        const quint32 begin = row > 0 ? textEnds.at(row - 1) : 0;
+        return QVariant(QString::fromUtf8(text.constData() + begin, int(textEnds.at(row) - begin)));
+    }
+    default:
+        return variants.at(row);
+    }
+}
+
+void ResultBlock::Column::toVariants(int rows)
+{
+    QVector<QVariant> values;
+    values.reserve(Capacity);
+    for (int i = 0; i < rows; ++i) {
+        values.push_back(value(i));
+    }
+
+    storage = Variant;
+    type = QVariant::Invalid;
+    integers = QVector<qint64>();
+    reals = QVector<double>();
+    text = QByteArray();
+    textEnds = QVector<quint32>();
+    variants = values;
+}
+
+QVariant ResultBlock::value(int row, int column) const
+{
+    return m_columns.at(column).value(row);
+}
+
+qint64 ResultBlock::memoryUsage() const
+{
+    qint64 usage = sizeof(ResultBlock);
+
+    for (const Column &column : m_columns) {
+        usage += sizeof(Column) + column.nulls.size() / 8;
+        usage += column.integers.capacity() * qint64(sizeof(qint64));
+        usage += column.reals.capacity() * qint64(sizeof(double));
+        usage += column.text.capacity() + column.textEnds.capacity() * qint64(sizeof(quint32));
+        usage += column.variants.capacity() * qint64(sizeof(QVariant));
+
+        // the data of large variants lives on the heap, like blobs
+        for (const QVariant &v : column.variants) {
+            if (v.userType() == QVariant::ByteArray) {
+                usage += v.toByteArray().size();
+            } else if (v.userType() == QVariant::String) {
+                usage += v.toString().size() * qint64(sizeof(QChar));
+            }
+        }
+    }
+
+    return usage;
+}
+
+QDataStream &operator<<(QDataStream &stream, const ResultBlock &block)
+{
+    stream << qint32(block.m_rowCount) << qint32(block.m_columns.size());
+
+    for (const ResultBlock::Column &column : block.m_columns) {
+        stream << quint8(column.storage) << qint32(column.type) << column.nulls;
+
+        switch (column.storage) {
+        case ResultBlock::Column::Empty:
+            break;
+        case ResultBlock::Column::Integer:
+            stream << column.integers;
+            break;
+        case ResultBlock::Column::Real:
+            stream << column.reals;
+            break;
+        case ResultBlock::Column::Text:
+            stream << column.text << column.textEnds;
+            break;
+        case ResultBlock::Column::Variant:
+            stream << column.variants;
+            break;
+        }
+    }
+
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, ResultBlock &block)
+{
+    qint32 rowCount = 0;
+    qint32 columnCount = 0;
+    stream >> rowCount >> columnCount;
+
+    block.m_rowCount = rowCount;
+    block.m_columns = QVector<ResultBlock::Column>(columnCount);
+
+    for (ResultBlock::Column &column : block.m_columns) {
+        quint8 storage = 0;
+        qint32 type = 0;
+        stream >> storage >> type >> column.nulls;
+        column.storage = ResultBlock::Column::Storage(storage);
+        column.type = type;
+
+        switch (column.storage) {
+        case ResultBlock::Column::Empty:
+            break;
+        case ResultBlock::Column::Integer:
+            stream >> column.integers;
+            break;
+        case ResultBlock::Column::Real:
+            stream >> column.reals;
+            break;
+        case ResultBlock::Column::Text:
+            stream >> column.text >> column.textEnds;
+            break;
+        case ResultBlock::Column::Variant:
+            stream >> column.variants;
+            break;
+        }
+    }
+
+    return stream;
+}
@@ -0,0 +1,75 @@
+/*
+   SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+   SPDX-License-Identifier: LGPL-2.0-only
+*/
+
+#ifndef RESULTBLOCK_H
+#define RESULTBLOCK_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QVariant>
+#include <QVector>
+
+class QDataStream;
+
+/**
+ * The values of consecutive rows of a result set, stored per column.
+ *
+ * Integers, booleans, reals and strings are kept in plain arrays, a column falls back
+ * to variants once it has values of other or mixed types. There is no per row metadata.
+ */
+class ResultBlock
+{
+public:
+    /// rows per block, only the last block of a result set has less
+    static const int Capacity = 1024;
+
+    explicit ResultBlock(int columns = 0);
+
+    int rowCount() const
+    {
+        return m_rowCount;
+    }
+
+    bool isFull() const
+    {
+        return m_rowCount == Capacity;
+    }
+
+    void appendRow(const QVector<QVariant> &row);
+    QVariant value(int row, int column) const;
+
+    /// approximation of the heap memory used
+    qint64 memoryUsage() const;
+
+    friend QDataStream &operator<<(QDataStream &stream, const ResultBlock &block);
+    friend QDataStream &operator>>(QDataStream &stream, ResultBlock &block);
+
+private:
+    struct Column {
+        enum Storage : quint8 { Empty, Integer, Real, Text, Variant };
+
+        Storage storage = Empty;
+        int type = QVariant::Invalid;
+        QBitArray nulls{Capacity};
+        QVector<qint64> integers;
+        QVector<double> reals;
+        QByteArray text; // UTF-8 of all strings, textEnds has the end of each
+        QVector<quint32> textEnds;
+        QVector<QVariant> variants;
+
+        void append(const QVariant &value, int row);
+        void appendDefault();
+        QVariant value(int row) const;
+        void toVariants(int rows);
+    };
+
+    static Column::Storage storageFor(int type);
+
+    QVector<Column> m_columns;
+    int m_rowCount = 0;
+};
+
+#endif // RESULTBLOCK_H
@@ -6,26 +6,57 @@
 
 #include "sqlmanager.h"
 #include "connectionmodel.h"
+#include "queryworker.h"
 
 #include <KConfig>
 #include <KConfigGroup>
 #include <KLocalizedString>
 
+#include <QDeadlineTimer>
 #include <QDebug>
 #include <QSqlDatabase>
-#include <QSqlDriver>
 #include <QSqlError>
+#include <QThread>
 
 using KWallet::Wallet;
 
-SQLManager::SQLManager(QObject *parent)
+namespace
+{
+/**
+ * milliseconds to wait for running queries on destruction
+ */
+const int ShutdownTimeout = 3000;
+}
+
+SQLManager::SQLManager(QObject *threadOwner, QObject *parent)
     : QObject(parent)
+    , m_threadOwner(threadOwner)
     , m_model(new ConnectionModel(this))
 {
+    m_progressTimer.setInterval(500);
+    connect(&m_progressTimer, &QTimer::timeout, this, &SQLManager::slotProgress);
 }
 
 SQLManager::~SQLManager()
 {
+    // the fetching stops at the next row, running statements are interrupted where the server allows it
+    for (auto worker : qAsConst(m_queryWorkers)) {
+        disconnect(worker, nullptr, this, nullptr);
+        worker->cancel(m_queryId);
+        worker->interrupt();
+        worker->thread()->quit();
+    }
+
+    // a long running statement must not block closing the window, its thread finishes on its own
+    // the owner keeps it, it deletes itself and its worker with the connection clone once done
+    const QDeadlineTimer deadline(ShutdownTimeout);
+    const auto threads = findChildren<QThread *>();
+    for (auto thread : threads) {
+        if (!thread->wait(deadline)) {
+            thread->setParent(m_threadOwner);
+        }
+    }
+
     for (int i = 0; i < m_model->rowCount(); i++) {
         QString connection = m_model->data(m_model->index(i), Qt::DisplayRole).toString();
         QSqlDatabase::removeDatabase(connection);
@@ -39,6 +70,7 @@ void SQLManager::createConnection(const Connection &conn)
 {
     if (QSqlDatabase::contains(conn.name)) {
         qDebug() << "connection" << conn.name << "already exist";
+        stopQueryWorker(conn.name);
         QSqlDatabase::removeDatabase(conn.name);
     }
 
@@ -148,6 +180,8 @@ void SQLManager::reopenConnection(const QString &name)
 {
     Q_EMIT connectionAboutToBeClosed(name);
 
+    stopQueryWorker(name);
+
     QSqlDatabase db = QSqlDatabase::database(name);
 
     db.close();
@@ -233,6 +267,8 @@ void SQLManager::removeConnection(const QString &name)
 {
     Q_EMIT connectionAboutToBeClosed(name);
 
+    stopQueryWorker(name);
+
     m_model->removeConnection(name);
 
     QSqlDatabase::removeDatabase(name);
@@ -302,6 +338,55 @@ void SQLManager::saveConnection(KConfigGroup *connectionsGroup, const Connection
     group.writeEntry("port", conn.port);
 }
 
+QueryWorker *SQLManager::queryWorker(const QString &connection)
+{
+    if (QueryWorker *worker = m_queryWorkers.value(connection)) {
+        return worker;
+    }
+
+    auto thread = new QThread(this);
+    auto worker = new QueryWorker(connection);
+    worker->moveToThread(thread);
+
+    // the worker is deleted in its thread, the clone of the connection must be removed there
+    connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+
+    connect(worker, &QueryWorker::columnsFetched, this, &SQLManager::slotColumnsFetched);
+    connect(worker, &QueryWorker::rowsFetched, this, &SQLManager::slotRowsFetched);
+    connect(worker, &QueryWorker::finished, this, &SQLManager::slotQueryFinished);
+    connect(worker, &QueryWorker::failed, this, &SQLManager::slotQueryFailed);
+
+    thread->start();
+    m_queryWorkers.insert(connection, worker);
+
+    return worker;
+}
+
+void SQLManager::stopQueryWorker(const QString &connection)
+{
+    QueryWorker *worker = m_queryWorkers.take(connection);
+
+    if (!worker) {
+        return;
+    }
+
+    if (m_queryRunning && m_queryConnection == connection) {
+        endQuery();
+    }
+
+    // the thread ends once the current query returns, without blocking us
+    disconnect(worker, nullptr, this, nullptr);
+    worker->cancel(m_queryId);
+    worker->interrupt();
+    worker->thread()->quit();
+}
+
+bool SQLManager::isQueryRunning() const
+{
+    return m_queryRunning;
+}
+
 void SQLManager::runQuery(const QString &text, const QString &connection)
 {
     //    qDebug() << "connection:" << connection;
@@ -315,46 +400,129 @@ void SQLManager::runQuery(const QString &text, const QString &connection)
         return;
     }
 
-    QSqlDatabase db = QSqlDatabase::database(connection);
-    QSqlQuery query(db);
+    // only one query at a time, its results replace the ones of the previous query
+    if (m_queryRunning) {
+        QueryWorker *previous = m_queryWorkers.value(m_queryConnection);
+        previous->cancel(m_queryId);
+        previous->interrupt();
+    }
 
-    if (!query.prepare(text)) {
-        QSqlError err = query.lastError();
+    QueryWorker *worker = queryWorker(connection);
+    const int id = ++m_queryId;
+
+    m_queryConnection = connection;
+    m_queryRows = -1;
+    m_queryTotalRows = -1;
+    m_queryTimer.start();
+    m_progressTimer.start();
+
+    QMetaObject::invokeMethod(
+        worker,
+        [worker, id, text]() {
+            worker->exec(id, text);
+        },
+        Qt::QueuedConnection);
+
+    if (!m_queryRunning) {
+        m_queryRunning = true;
+        Q_EMIT queryRunningChanged(true);
+    }
 
-        if (err.type() == QSqlError::ConnectionError) {
-            m_model->setStatus(connection, Connection::OFFLINE);
-        }
+    slotProgress();
+}
 
-        Q_EMIT error(err.text());
+void SQLManager::cancelQuery()
+{
+    if (!m_queryRunning) {
         return;
     }
 
-    if (!query.exec()) {
-        QSqlError err = query.lastError();
+    QueryWorker *worker = m_queryWorkers.value(m_queryConnection);
+    worker->cancel(m_queryId);
+    worker->interrupt();
 
-        if (err.type() == QSqlError::ConnectionError) {
-            m_model->setStatus(connection, Connection::OFFLINE);
-        }
+    // the rows fetched so far stay visible
+    const bool hasResult = m_queryRows >= 0;
+
+    endQuery();
 
-        Q_EMIT error(err.text());
+    if (!hasResult) {
+        Q_EMIT error(i18nc("@info", "Query canceled"));
+    }
+}
+
+void SQLManager::endQuery()
+{
+    m_queryRunning = false;
+    m_progressTimer.stop();
+
+    Q_EMIT queryRunningChanged(false);
+}
+
+void SQLManager::slotProgress()
+{
+    Q_EMIT queryProgress(m_queryRows, m_queryTotalRows, m_queryTimer.elapsed());
+}
+
+void SQLManager::slotColumnsFetched(int id, const QStringList &columns, int totalRows)
+{
+    if (id != m_queryId || !m_queryRunning) {
+        return;
+    }
+
+    m_queryRows = 0;
+    m_queryTotalRows = totalRows;
+
+    Q_EMIT queryActivated(columns, m_queryConnection);
+
+    slotProgress();
+}
+
+void SQLManager::slotRowsFetched(int id, const QVector<QVector<QVariant>> &rows)
+{
+    if (id != m_queryId || !m_queryRunning) {
+        return;
+    }
+
+    m_queryRows += rows.size();
+
+    Q_EMIT queryRowsFetched(rows);
+
+    slotProgress();
+}
+
+void SQLManager::slotQueryFinished(int id, bool isSelect, int numRowsAffected)
+{
+    if (id != m_queryId || !m_queryRunning) {
         return;
     }
 
+    const QString seconds = QString::number(m_queryTimer.elapsed() / 1000.0, 'f', 2);
+
+    endQuery();
+
     QString message;
 
-    /// TODO: improve messages
-    if (query.isSelect()) {
-        if (!query.driver()->hasFeature(QSqlDriver::QuerySize)) {
-            message = i18nc("@info", "Query completed successfully");
-        } else {
-            int nRowsSelected = query.size();
-            message = i18ncp("@info", "%1 record selected", "%1 records selected", nRowsSelected);
-        }
+    if (isSelect) {
+        message = i18ncp("@info", "%1 record selected in %2 seconds", "%1 records selected in %2 seconds", m_queryRows, seconds);
     } else {
-        int nRowsAffected = query.numRowsAffected();
-        message = i18ncp("@info", "%1 row affected", "%1 rows affected", nRowsAffected);
+        message = i18ncp("@info", "%1 row affected in %2 seconds", "%1 rows affected in %2 seconds", numRowsAffected, seconds);
     }
 
     Q_EMIT success(message);
-    Q_EMIT queryActivated(query, connection);
+}
+
+void SQLManager::slotQueryFailed(int id, const QString &message, bool connectionError)
+{
+    if (id != m_queryId || !m_queryRunning) {
+        return;
+    }
+
+    if (connectionError) {
+        m_model->setStatus(m_queryConnection, Connection::OFFLINE);
+    }
+
+    endQuery();
+
+    Q_EMIT error(message);
 }
@@ -9,25 +9,36 @@
 
 class ConnectionModel;
 class KConfigGroup;
+class QueryWorker;
 class QUrl;
 
 #include "connection.h"
 #include <KWallet>
-#include <QSqlQuery>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSqlError>
+#include <QStringList>
+#include <QTimer>
 #include <QUrl>
+#include <QVariant>
+#include <QVector>
 
 class SQLManager : public QObject
 {
     Q_OBJECT
 
 public:
-    SQLManager(QObject *parent = nullptr);
+    /**
+     * @param threadOwner takes the query threads still running when we are destroyed, it must wait for them
+     */
+    SQLManager(QObject *threadOwner, QObject *parent = nullptr);
     ~SQLManager() override;
 
     ConnectionModel *connectionModel();
     void createConnection(const Connection &conn);
     static bool testConnection(const Connection &conn, QSqlError &error);
     bool isValidAndOpen(const QString &connection);
+    bool isQueryRunning() const;
 
     KWallet::Wallet *openWallet();
     int storeCredentials(const Connection &conn);
@@ -42,23 +53,56 @@ public Q_SLOTS:
     void loadConnections(const KConfigGroup &connectionsGroup);
     void saveConnections(KConfigGroup *connectionsGroup);
     void runQuery(const QString &text, const QString &connection);
+    void cancelQuery();
 
 protected:
     static void saveConnection(KConfigGroup *connectionsGroup, const Connection &conn);
 
+private Q_SLOTS:
+    void slotColumnsFetched(int id, const QStringList &columns, int totalRows);
+    void slotRowsFetched(int id, const QVector<QVector<QVariant>> &rows);
+    void slotQueryFinished(int id, bool isSelect, int numRowsAffected);
+    void slotQueryFailed(int id, const QString &message, bool connectionError);
+    void slotProgress();
+
 Q_SIGNALS:
     void connectionCreated(const QString &name);
     void connectionRemoved(const QString &name);
     void connectionAboutToBeClosed(const QString &name);
 
-    void queryActivated(QSqlQuery &query, const QString &connection);
+    /// a query is started or has ended
+    void queryRunningChanged(bool running);
+
+    /// the running query has a result set, its rows are streamed with queryRowsFetched
+    void queryActivated(const QStringList &columns, const QString &connection);
+    void queryRowsFetched(const QVector<QVector<QVariant>> &rows);
+
+    /// rows is -1 as long as there is no result set, totalRows is -1 if unknown
+    void queryProgress(int rows, int totalRows, qint64 msecs);
 
     void error(const QString &message);
     void success(const QString &message);
 
 private:
+    QueryWorker *queryWorker(const QString &connection);
+    void stopQueryWorker(const QString &connection);
+    void endQuery();
+
+    QObject *const m_threadOwner;
     ConnectionModel *m_model;
     KWallet::Wallet *m_wallet = nullptr;
+
+    /// workers by connection, each one lives in its own thread
+    QHash<QString, QueryWorker *> m_queryWorkers;
+
+    /// the running query, results of older ones are ignored
+    int m_queryId = 0;
+    bool m_queryRunning = false;
+    QString m_queryConnection;
+    int m_queryRows = -1;
+    int m_queryTotalRows = -1;
+    QElapsedTimer m_queryTimer;
+    QTimer m_progressTimer;
 };
 
 #endif // SQLMANAGER_H
@@ -7,13 +7,16 @@
 #include "lspclientserver.h"
 
 #include "lspclient_debug.h"
+#include "lspjsonreader.h"
 
 #include <QCoreApplication>
 #include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QMutex>
 #include <QProcess>
+#include <QThreadPool>
 
 #include <utility>
 
@@ -662,46 +665,174 @@ static QList<LSPLocation> parseDocumentLocation(const QJsonValue &result)
     return ret;
 }
 
-static QList<LSPCompletionItem> parseDocumentCompletion(const QJsonValue &result)
+// the large replies are decoded straight from the message, see LSPJsonReader
+
+static LSPPosition readPosition(LSPJsonReader &reader)
 {
-    QList<LSPCompletionItem> ret;
-    QJsonArray items = result.toArray();
-    // might be CompletionList
-    if (items.empty()) {
-        items = result.toObject().value(QStringLiteral("items")).toArray();
-    }
-
-    //     auto parseTextEdit = [](const QJsonObject &obj) -> LSPTextEdit {
-    //         auto newText = obj.value(QStringLiteral("newText")).toString();
-    //         auto range = parseRange(obj.value(QStringLiteral("range")).toObject());
-    //         return LSPTextEdit{range, newText};
-    //     };
-
-    for (const auto &vitem : qAsConst(items)) {
-        const auto &item = vitem.toObject();
-        auto label = item.value(MEMBER_LABEL).toString();
-        auto detail = item.value(MEMBER_DETAIL).toString();
-        auto doc = parseMarkupContent(item.value(MEMBER_DOCUMENTATION));
-        auto sortText = item.value(QStringLiteral("sortText")).toString();
-        if (sortText.isEmpty()) {
-            sortText = label;
+    int line = -1;
+    int column = -1;
+    if (reader.enterObject()) {
+        QLatin1String key;
+        while (reader.nextMember(key)) {
+            if (key == MEMBER_LINE) {
+                line = reader.readInt(-1);
+            } else if (key == MEMBER_CHARACTER) {
+                column = reader.readInt(-1);
+            } else {
+                reader.skip();
+            }
+        }
+    } else {
+        reader.skip();
+    }
+    return {line, column};
+}
+
+static LSPRange readRange(LSPJsonReader &reader)
+{
+    LSPPosition startpos = LSPPosition::invalid();
+    LSPPosition endpos = LSPPosition::invalid();
+    if (reader.enterObject()) {
+        QLatin1String key;
+        while (reader.nextMember(key)) {
+            if (key == MEMBER_START) {
+                startpos = readPosition(reader);
+            } else if (key == MEMBER_END) {
+                endpos = readPosition(reader);
+            } else {
+                reader.skip();
+            }
+        }
+    } else {
+        reader.skip();
+    }
+    return {startpos, endpos};
+}
+
+static LSPMarkupContent readMarkupContent(LSPJsonReader &reader)
+{
+    LSPMarkupContent ret;
+    if (reader.peek() == LSPJsonReader::Type::String) {
+        ret.kind = LSPMarkupKind::PlainText;
+        ret.value = reader.readString();
+    } else if (reader.enterObject()) {
+        QLatin1String key;
+        while (reader.nextMember(key)) {
+            if (key == QLatin1String("value")) {
+                ret.value = reader.readString();
+            } else if (key == MEMBER_KIND) {
+                const auto kind = reader.readString();
+                if (kind == QLatin1String("plaintext")) {
+                    ret.kind = LSPMarkupKind::PlainText;
+                } else if (kind == QLatin1String("markdown")) {
+                    ret.kind = LSPMarkupKind::MarkDown;
+                }
+            } else {
+                reader.skip();
+            }
         }
-        auto insertText = item.value(QStringLiteral("insertText")).toString();
-        if (insertText.isEmpty()) {
-            insertText = label;
+    } else {
+        reader.skip();
+    }
+    return ret;
+}
+
+static LSPTextEdit readTextEdit(LSPJsonReader &reader)
+{
+    LSPTextEdit ret{LSPRange::invalid(), QString()};
+    if (reader.enterObject()) {
+        QLatin1String key;
+        while (reader.nextMember(key)) {
+            if (key == MEMBER_RANGE) {
+                ret.range = readRange(reader);
+            } else if (key == QLatin1String("newText")) {
+                ret.newText = reader.readString();
+            } else {
+                reader.skip();
+            }
         }
-        const auto &textEdit = item.value(QStringLiteral("textEdit")).toObject();
-        if (!textEdit.empty()) {
+    } else {
+        reader.skip();
+    }
+    return ret;
+}
+
+static LSPCompletionItem readCompletionItem(LSPJsonReader &reader)
+{
+    LSPCompletionItem item{};
+    bool hasTextEdit = false;
+    QString newText;
+
+    QLatin1String key;
+    while (reader.nextMember(key)) {
+        if (key == MEMBER_LABEL) {
+            item.label = reader.readString();
+        } else if (key == MEMBER_KIND) {
+            item.kind = static_cast<LSPCompletionItemKind>(reader.readInt());
+        } else if (key == MEMBER_DETAIL) {
+            item.detail = reader.readString();
+        } else if (key == MEMBER_DOCUMENTATION) {
+            item.documentation = readMarkupContent(reader);
+        } else if (key == QLatin1String("sortText")) {
+            item.sortText = reader.readString();
+        } else if (key == QLatin1String("insertText")) {
+            item.insertText = reader.readString();
+        } else if (key == QLatin1String("textEdit") && reader.enterObject()) {
             // Not a proper implementation of textEdit, but a workaround for KDE bug #445085
-            auto newText = textEdit.value(QStringLiteral("newText")).toString();
-            insertText = newText;
+            QLatin1String editKey;
+            while (reader.nextMember(editKey)) {
+                hasTextEdit = true;
+                if (editKey == QLatin1String("newText")) {
+                    newText = reader.readString();
+                } else {
+                    reader.skip();
+                }
+            }
+        } else if (key == QLatin1String("additionalTextEdits") && reader.enterArray()) {
+            while (reader.nextElement()) {
+                item.additionalTextEdits.push_back(readTextEdit(reader));
+            }
+        } else {
+            reader.skip();
         }
-        auto kind = static_cast<LSPCompletionItemKind>(item.value(MEMBER_KIND).toInt());
-        //         auto textEdit = parseTextEdit(item.value(QStringLiteral("textEdit")).toObject());
+    }
 
-        const auto additionalTextEdits = parseTextEdit(item.value(QStringLiteral("additionalTextEdits")));
+    if (item.sortText.isEmpty()) {
+        item.sortText = item.label;
+    }
+    if (hasTextEdit) {
+        item.insertText = newText;
+    } else if (item.insertText.isEmpty()) {
+        item.insertText = item.label;
+    }
+    return item;
+}
+
+static QList<LSPCompletionItem> parseDocumentCompletion(LSPJsonReader &reader)
+{
+    QList<LSPCompletionItem> ret;
+    auto readItems = [&ret, &reader]() {
+        while (reader.nextElement()) {
+            if (reader.enterObject()) {
+                ret.push_back(readCompletionItem(reader));
+            } else {
+                reader.skip();
+            }
+        }
+    };
 
-        ret.push_back({label, kind, detail, doc, sortText, insertText, additionalTextEdits /*, textEdit*/});
+    // might be CompletionList
+    if (reader.enterArray()) {
+        readItems();
+    } else if (reader.enterObject()) {
+        QLatin1String key;
+        while (reader.nextMember(key)) {
+            if (key == QLatin1String("items") && reader.enterArray()) {
+                readItems();
+            } else {
+                reader.skip();
+            }
+        }
     }
     return ret;
 }
@@ -866,41 +997,48 @@ static QJsonArray supportedSemanticTokenTypes()
 
 /**
  * Used for both delta and full
+ * The token arrays can be huge, they are read directly into the vectors
  */
-static LSPSemanticTokensDelta parseSemanticTokensDelta(const QJsonValue &result)
+static LSPSemanticTokensDelta parseSemanticTokensDelta(LSPJsonReader &reader)
 {
     LSPSemanticTokensDelta ret;
-    auto json = result.toObject();
-    ret.resultId = json.value(QStringLiteral("resultId")).toString();
+    if (!reader.enterObject()) {
+        return ret;
+    }
 
-    auto edits = json.value(QStringLiteral("edits")).toArray();
+    QLatin1String key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("resultId")) {
+            ret.resultId = reader.readString();
+        } else if (key == QLatin1String("data")) {
+            reader.readUInt32Array(ret.data);
+        } else if (key == QLatin1String("edits") && reader.enterArray()) {
+            while (reader.nextElement()) {
+                if (!reader.enterObject()) {
+                    reader.skip();
+                    continue;
+                }
 
-    for (const auto &edit_jsonValue : edits) {
-        if (!edit_jsonValue.isObject()) {
-            continue;
+                LSPSemanticTokensEdit e;
+                QLatin1String editKey;
+                while (reader.nextMember(editKey)) {
+                    if (editKey == QLatin1String("start")) {
+                        e.start = reader.readInt();
+                    } else if (editKey == QLatin1String("deleteCount")) {
+                        e.deleteCount = reader.readInt();
+                    } else if (editKey == QLatin1String("data")) {
+                        reader.readUInt32Array(e.data);
+                    } else {
+                        reader.skip();
+                    }
+                }
+                ret.edits.push_back(std::move(e));
+            }
+        } else {
+            reader.skip();
         }
-
-        auto edit = edit_jsonValue.toObject();
-
-        LSPSemanticTokensEdit e;
-        e.start = edit.value(QStringLiteral("start")).toInt();
-        e.deleteCount = edit.value(QStringLiteral("deleteCount")).toInt();
-
-        auto data = edit.value(QStringLiteral("data")).toArray();
-        e.data.reserve(data.size());
-        std::transform(data.cbegin(), data.cend(), std::back_inserter(e.data), [](const QJsonValue &jv) {
-            return jv.toInt();
-        });
-
-        ret.edits.push_back(e);
     }
 
-    auto data = json.value(QStringLiteral("data")).toArray();
-    ret.data.reserve(data.size());
-    std::transform(data.cbegin(), data.cend(), std::back_inserter(ret.data), [](const QJsonValue &jv) {
-        return jv.toInt();
-    });
-
     return ret;
 }
 
@@ -965,33 +1103,68 @@ static LSPWorkDoneProgressParams parseWorkDone(const QJsonObject &json)
     return parseProgress<LSPWorkDoneProgressValue>(json);
 }
 
-static std::vector<LSPSymbolInformation> parseWorkspaceSymbols(const QJsonValue &result)
-{
-    auto res = result.toArray();
-
-    std::vector<LSPSymbolInformation> symbols;
-    symbols.reserve(res.size());
-
-    std::transform(res.cbegin(), res.cend(), std::back_inserter(symbols), [](const QJsonValue &jv) {
-        auto symbol = jv.toObject();
-
-        LSPSymbolInformation symInfo;
+static LSPSymbolInformation readWorkspaceSymbol(LSPJsonReader &reader)
+{
+    LSPSymbolInformation symInfo;
+    symInfo.kind = LSPSymbolKind(0);
+    symInfo.tags = LSPSymbolTag(0);
+    symInfo.range = LSPRange::invalid();
+
+    QString name;
+    QString containerName;
+    bool hasRange = false;
+
+    QLatin1String key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("name")) {
+            name = reader.readString();
+        } else if (key == QLatin1String("containerName")) {
+            containerName = reader.readString();
+        } else if (key == MEMBER_KIND) {
+            symInfo.kind = static_cast<LSPSymbolKind>(reader.readInt());
+        } else if (key == MEMBER_RANGE) {
+            symInfo.range = readRange(reader);
+            hasRange = true;
+        } else if (key == MEMBER_LOCATION && reader.enterObject()) {
+            QLatin1String locationKey;
+            while (reader.nextMember(locationKey)) {
+                if (locationKey == MEMBER_URI) {
+                    symInfo.url = QUrl(reader.readString());
+                } else if (locationKey == MEMBER_RANGE && !hasRange) {
+                    // a range of the symbol itself has precedence
+                    symInfo.range = readRange(reader);
+                } else {
+                    reader.skip();
+                }
+            }
+        } else if (key == QLatin1String("score")) {
+            symInfo.score = reader.readDouble();
+        } else if (key == QLatin1String("tags")) {
+            symInfo.tags = static_cast<LSPSymbolTag>(reader.readInt());
+        } else {
+            reader.skip();
+        }
+    }
 
-        const auto location = symbol.value(MEMBER_LOCATION).toObject();
-        const auto mrange = symbol.contains(MEMBER_RANGE) ? symbol.value(MEMBER_RANGE) : location.value(MEMBER_RANGE);
+    if (!containerName.isEmpty()) {
+        containerName.append(QStringLiteral("::"));
+    }
+    symInfo.name = containerName + name;
+    return symInfo;
+}
 
-        auto containerName = symbol.value(QStringLiteral("containerName")).toString();
-        if (!containerName.isEmpty()) {
-            containerName.append(QStringLiteral("::"));
+static std::vector<LSPSymbolInformation> parseWorkspaceSymbols(LSPJsonReader &reader)
+{
+    std::vector<LSPSymbolInformation> symbols;
+    if (reader.enterArray()) {
+        while (reader.nextElement()) {
+            if (reader.enterObject()) {
+                symbols.push_back(readWorkspaceSymbol(reader));
+            } else {
+                reader.skip();
+            }
         }
-        symInfo.name = containerName + symbol.value(QStringLiteral("name")).toString();
-        symInfo.kind = (LSPSymbolKind)symbol.value(MEMBER_KIND).toInt();
-        symInfo.range = parseRange(mrange.toObject());
-        symInfo.url = QUrl(location.value(MEMBER_URI).toString());
-        symInfo.score = symbol.value(QStringLiteral("score")).toDouble();
-        symInfo.tags = (LSPSymbolTag)symbol.value(QStringLiteral("tags")).toInt();
-        return symInfo;
-    });
+    }
 
     std::sort(symbols.begin(), symbols.end(), [](const LSPSymbolInformation &l, const LSPSymbolInformation &r) {
         return l.score > r.score;
@@ -1003,6 +1176,26 @@ static std::vector<LSPSymbolInformation> parseWorkspaceSymbols(const QJsonValue
 using GenericReplyType = QJsonValue;
 using GenericReplyHandler = ReplyHandler<GenericReplyType>;
 
+// reply handlers come in two parts
+// the decoder converts the raw reply in the message decoding thread and returns
+// the delivery of the converted result, which is run in the GUI thread
+// the decoder reads the reply straight from the message, most just turn it into a GenericReplyType
+using ReplyDelivery = std::function<void()>;
+using ReplyDecoder = std::function<ReplyDelivery(LSPJsonReader &)>;
+
+// decoder that just hands the raw reply to the GUI thread
+static ReplyDecoder raw_handler(const GenericReplyHandler &h)
+{
+    if (!h) {
+        return nullptr;
+    }
+    return [h](LSPJsonReader &reader) -> ReplyDelivery {
+        return [h, m = reader.readValue()]() {
+            h(m);
+        };
+    };
+}
+
 class LSPClientServer::LSPClientServerPrivate
 {
     typedef LSPClientServerPrivate self_type;
@@ -1026,11 +1219,19 @@ class LSPClientServer::LSPClientServerPrivate
     State m_state = State::None;
     // last msg id
     int m_id = 0;
-    // receive buffer
-    QByteArray m_receive;
+    // message framing state
+    // headers are read line by line, the payload is then read straight into its own buffer
+    int m_contentLength = -1;
+    bool m_readingPayload = false;
+    QByteArray m_payload;
+    int m_payloadReceived = 0;
     // registered reply handlers
     // (result handler, error result handler)
-    QHash<int, std::pair<GenericReplyHandler, GenericReplyHandler>> m_handlers;
+    // also looked up in the decoding thread, so guarded by the mutex
+    QMutex m_handlersMutex;
+    QHash<int, std::pair<ReplyDecoder, ReplyDecoder>> m_handlers;
+    // decodes the received messages, one at a time to keep their order
+    QThreadPool m_decodePool;
     // pending request responses
     static constexpr int MAX_REQUESTS = 5;
     QVector<int> m_requests{MAX_REQUESTS + 1};
@@ -1049,6 +1250,9 @@ public:
         , m_init(init)
         , m_folders(folders)
     {
+        // decode in order, one message after the other
+        m_decodePool.setMaxThreadCount(1);
+
         // setup async reading
         QObject::connect(&m_sproc, &QProcess::readyRead, utils::mem_fun(&self_type::read, this));
         QObject::connect(&m_sproc, &QProcess::stateChanged, utils::mem_fun(&self_type::onStateChanged, this));
@@ -1057,6 +1261,10 @@ public:
     ~LSPClientServerPrivate()
     {
         stop(TIMEOUT_SHUTDOWN, TIMEOUT_SHUTDOWN);
+
+        // the decoding thread uses this, nothing shall run afterwards
+        m_decodePool.clear();
+        m_decodePool.waitForDone();
     }
 
     const QStringList &cmdline() const
@@ -1086,7 +1294,9 @@ public:
 
     int cancel(int reqid)
     {
+        QMutexLocker locker(&m_handlersMutex);
         if (m_handlers.remove(reqid) > 0) {
+            locker.unlock();
             auto params = QJsonObject{{MEMBER_ID, reqid}};
             write(init_request(QStringLiteral("$/cancelRequest"), params));
         }
@@ -1102,7 +1312,7 @@ private:
         }
     }
 
-    RequestHandle write(const QJsonObject &msg, const GenericReplyHandler &h = nullptr, const GenericReplyHandler &eh = nullptr, const int *id = nullptr)
+    RequestHandle write(const QJsonObject &msg, const ReplyDecoder &h = nullptr, const ReplyDecoder &eh = nullptr, const int *id = nullptr)
     {
         RequestHandle ret;
         ret.m_server = q;
@@ -1117,6 +1327,7 @@ private:
         if (h) {
             ob.insert(MEMBER_ID, ++m_id);
             ret.m_id = m_id;
+            QMutexLocker locker(&m_handlersMutex);
             m_handlers[m_id] = {h, eh};
         } else if (id) {
             ob.insert(MEMBER_ID, *id);
@@ -1137,7 +1348,7 @@ private:
         return ret;
     }
 
-    RequestHandle send(const QJsonObject &msg, const GenericReplyHandler &h = nullptr, const GenericReplyHandler &eh = nullptr)
+    RequestHandle send(const QJsonObject &msg, const ReplyDecoder &h = nullptr, const ReplyDecoder &eh = nullptr)
     {
         if (m_state == State::Running) {
             return write(msg, h, eh);
@@ -1149,105 +1360,165 @@ private:
 
     void read()
     {
-        // accumulate in buffer
-        m_receive.append(m_sproc.readAllStandardOutput());
+        // headers are read line by line, the payload is then read straight into its own buffer
+        // that buffer is handed over to the decoding thread as is, no copying or shifting around
+        while (true) {
+            if (!m_readingPayload) {
+                if (!m_sproc.canReadLine()) {
+                    // avoid collecting junk
+                    if (m_sproc.bytesAvailable() > 1 << 20) {
+                        m_sproc.readAll();
+                    }
+                    break;
+                }
 
-        // try to get one (or more) message
-        QByteArray &buffer = m_receive;
+                const QByteArray line = m_sproc.readLine().trimmed();
+                if (line.isEmpty()) {
+                    // end of headers, onto payload, if we got a valid length
+                    if (m_contentLength >= 0) {
+                        m_payload = QByteArray(m_contentLength, Qt::Uninitialized);
+                        m_payloadReceived = 0;
+                        m_readingPayload = true;
+                        m_contentLength = -1;
+                    }
+                    continue;
+                }
 
-        while (true) {
-            qCDebug(LSPCLIENT) << "buffer size" << buffer.length();
-            auto header = QByteArray(CONTENT_LENGTH ":");
-            int index = buffer.indexOf(header);
-            if (index < 0) {
-                // avoid collecting junk
-                if (buffer.length() > 1 << 20) {
-                    buffer.clear();
+                // other headers and junk are skipped
+                if (line.startsWith(CONTENT_LENGTH ":")) {
+                    bool ok = false;
+                    m_contentLength = line.mid(sizeof(CONTENT_LENGTH)).trimmed().toInt(&ok, 10);
+                    // FIXME perhaps detect if no reply for some time
+                    // then again possibly better left to user to restart in such case
+                    if (!ok || m_contentLength < 0) {
+                        qCWarning(LSPCLIENT) << "invalid " CONTENT_LENGTH;
+                        m_contentLength = -1;
+                    } else if (m_contentLength > 1 << 29) {
+                        // sanity check to avoid extensive buffering
+                        qCWarning(LSPCLIENT) << "excessive size";
+                        m_contentLength = -1;
+                    }
                 }
-                break;
-            }
-            index += header.length();
-            int endindex = buffer.indexOf("\r\n", index);
-            auto msgstart = buffer.indexOf("\r\n\r\n", index);
-            if (endindex < 0 || msgstart < 0) {
-                break;
-            }
-            msgstart += 4;
-            bool ok = false;
-            auto length = buffer.mid(index, endindex - index).toInt(&ok, 10);
-            // FIXME perhaps detect if no reply for some time
-            // then again possibly better left to user to restart in such case
-            if (!ok) {
-                qCWarning(LSPCLIENT) << "invalid " CONTENT_LENGTH;
-                // flush and try to carry on to some next header
-                buffer.remove(0, msgstart);
-                continue;
-            }
-            // sanity check to avoid extensive buffering
-            if (length > 1 << 29) {
-                qCWarning(LSPCLIENT) << "excessive size";
-                buffer.clear();
                 continue;
             }
-            if (msgstart + length > buffer.length()) {
-                break;
+
+            if (m_payloadReceived < m_payload.size()) {
+                const qint64 received = m_sproc.read(m_payload.data() + m_payloadReceived, m_payload.size() - m_payloadReceived);
+                if (received <= 0) {
+                    break;
+                }
+                m_payloadReceived += received;
+                if (m_payloadReceived < m_payload.size()) {
+                    break;
+                }
             }
-            // now onto payload
-            auto payload = buffer.mid(msgstart, length);
-            buffer.remove(0, msgstart + length);
-            qCInfo(LSPCLIENT) << "got message payload size " << length;
+
+            qCInfo(LSPCLIENT) << "got message payload size " << m_payload.size();
+            m_readingPayload = false;
+            decode(m_payload);
+            m_payload = QByteArray();
+        }
+    }
+
+    // run in the GUI thread, in order
+    void deliver(std::function<void()> f)
+    {
+        QMetaObject::invokeMethod(q, std::move(f), Qt::QueuedConnection);
+    }
+
+    void decode(const QByteArray &payload)
+    {
+        // the JSON parsing and the conversion of replies are done in the decoding thread
+        // only the results are handed to the GUI thread
+        m_decodePool.start([this, payload]() {
             qCDebug(LSPCLIENT) << "message payload:\n" << payload;
-            QJsonParseError error{};
-            auto msg = QJsonDocument::fromJson(payload, &error);
-            if (error.error != QJsonParseError::NoError || !msg.isObject()) {
-                qCWarning(LSPCLIENT) << "invalid response payload";
-                continue;
-            }
-            auto result = msg.object();
-            // check if it is the expected result
+
+            // only look at the envelope here, replies are decoded by their handlers
+            // straight from the payload, without building a full JSON tree
+            LSPJsonReader reader(payload);
+            LSPJsonReader resultReader;
+            LSPJsonReader errorReader;
+            bool hasId = false;
+            bool hasMethod = false;
+            bool hasError = false;
             int msgid = -1;
-            if (result.contains(MEMBER_ID)) {
-                // allow id to be returned as a string value, happens e.g. for Perl LSP server
-                const auto idValue = result[MEMBER_ID];
-                if (idValue.isString()) {
-                    msgid = idValue.toString().toInt();
-                } else {
-                    msgid = idValue.toInt();
+            const bool isObject = reader.enterObject();
+            if (isObject) {
+                QLatin1String key;
+                while (reader.nextMember(key)) {
+                    if (key == MEMBER_ID) {
+                        // allow id to be returned as a string value, happens e.g. for Perl LSP server
+                        hasId = true;
+                        if (reader.peek() == LSPJsonReader::Type::String) {
+                            msgid = reader.readString().toInt();
+                        } else {
+                            msgid = reader.readInt();
+                        }
+                    } else if (key == MEMBER_METHOD) {
+                        hasMethod = true;
+                        reader.skip();
+                    } else if (key == MEMBER_RESULT) {
+                        resultReader = reader.valueReader();
+                    } else if (key == MEMBER_ERROR) {
+                        hasError = true;
+                        errorReader = reader.valueReader();
+                    } else {
+                        reader.skip();
+                    }
                 }
-            } else {
-                processNotification(result);
-                continue;
             }
-            // could be request
-            if (result.contains(MEMBER_METHOD)) {
-                processRequest(result);
-                continue;
+            if (!isObject || reader.hasError() || !reader.atEnd()) {
+                qCWarning(LSPCLIENT) << "invalid response payload";
+                return;
+            }
+
+            // notifications and requests are small, just use the generic representation
+            if (!hasId || hasMethod) {
+                const auto result = QJsonDocument::fromJson(payload).object();
+                deliver([this, result, hasId]() {
+                    if (hasId) {
+                        processRequest(result);
+                    } else {
+                        processNotification(result);
+                    }
+                });
+                return;
             }
 
             // a valid reply; what to do with it now
-            auto it = m_handlers.find(msgid);
-            if (it != m_handlers.end()) {
-                // copy handler to local storage
-                const auto handler = *it;
+            std::pair<ReplyDecoder, ReplyDecoder> handler;
+            {
+                QMutexLocker locker(&m_handlersMutex);
+                const auto it = m_handlers.constFind(msgid);
+                if (it == m_handlers.cend()) {
+                    // could have been canceled
+                    qCDebug(LSPCLIENT) << "unexpected reply id" << msgid;
+                    return;
+                }
+                handler = *it;
+            }
 
+            // process and provide error if caller interested,
+            // otherwise reply will resolve to 'empty' response
+            auto &h = handler.first;
+            auto &eh = handler.second;
+            const ReplyDelivery delivery = (hasError && eh) ? eh(errorReader) : h(resultReader);
+            deliver([this, msgid, delivery]() {
                 // remove handler from our set, do this pre handler execution to avoid races
-                m_handlers.erase(it);
+                // if it is gone, the request got canceled while decoding
+                {
+                    QMutexLocker locker(&m_handlersMutex);
+                    if (m_handlers.remove(msgid) == 0) {
+                        return;
+                    }
+                }
 
                 // run handler, might e.g. trigger some new LSP actions for this server
-                // process and provide error if caller interested,
-                // otherwise reply will resolve to 'empty' response
-                auto &h = handler.first;
-                auto &eh = handler.second;
-                if (result.contains(MEMBER_ERROR) && eh) {
-                    eh(result.value(MEMBER_ERROR));
-                } else {
-                    h(result.value(MEMBER_RESULT));
+                if (delivery) {
+                    delivery();
                 }
-            } else {
-                // could have been canceled
-                qCDebug(LSPCLIENT) << "unexpected reply id" << msgid;
-            }
-        }
+            });
+        });
     }
 
     static QJsonObject init_error(const LSPErrorCode code, const QString &msg)
@@ -1282,7 +1553,10 @@ private:
         if (m_state == State::Running) {
             qCInfo(LSPCLIENT) << "shutting down" << m_server;
             // cancel all pending
-            m_handlers.clear();
+            {
+                QMutexLocker locker(&m_handlersMutex);
+                m_handlers.clear();
+            }
             // shutdown sequence
             send(init_request(QStringLiteral("shutdown")));
             // maybe we will get/see reply on the above, maybe not
@@ -1349,7 +1623,7 @@ private:
             params[QStringLiteral("workspaceFolders")] = to_json(*m_folders);
         }
         //
-        write(init_request(QStringLiteral("initialize"), params), utils::mem_fun(&self_type::onInitializeReply, this));
+        write(init_request(QStringLiteral("initialize"), params), raw_handler(utils::mem_fun(&self_type::onInitializeReply, this)));
         // clang-format on
     }
 
@@ -1400,122 +1674,122 @@ public:
         }
     }
 
-    RequestHandle documentSymbols(const QUrl &document, const GenericReplyHandler &h, const GenericReplyHandler &eh)
+    RequestHandle documentSymbols(const QUrl &document, const ReplyDecoder &h, const ReplyDecoder &eh)
     {
         auto params = textDocumentParams(document);
         return send(init_request(QStringLiteral("textDocument/documentSymbol"), params), h, eh);
     }
 
-    RequestHandle documentDefinition(const QUrl &document, const LSPPosition &pos, const GenericReplyHandler &h)
+    RequestHandle documentDefinition(const QUrl &document, const LSPPosition &pos, const ReplyDecoder &h)
     {
         auto params = textDocumentPositionParams(document, pos);
         return send(init_request(QStringLiteral("textDocument/definition"), params), h);
     }
 
-    RequestHandle documentDeclaration(const QUrl &document, const LSPPosition &pos, const GenericReplyHandler &h)
+    RequestHandle documentDeclaration(const QUrl &document, const LSPPosition &pos, const ReplyDecoder &h)
     {
         auto params = textDocumentPositionParams(document, pos);
         return send(init_request(QStringLiteral("textDocument/declaration"), params), h);
     }
 
-    RequestHandle documentTypeDefinition(const QUrl &document, const LSPPosition &pos, const GenericReplyHandler &h)
+    RequestHandle documentTypeDefinition(const QUrl &document, const LSPPosition &pos, const ReplyDecoder &h)
     {
         auto params = textDocumentPositionParams(document, pos);
         return send(init_request(QStringLiteral("textDocument/typeDefinition"), params), h);
     }
 
-    RequestHandle documentImplementation(const QUrl &document, const LSPPosition &pos, const GenericReplyHandler &h)
+    RequestHandle documentImplementation(const QUrl &document, const LSPPosition &pos, const ReplyDecoder &h)
     {
         auto params = textDocumentPositionParams(document, pos);
         return send(init_request(QStringLiteral("textDocument/implementation"), params), h);
     }
 
-    RequestHandle documentHover(const QUrl &document, const LSPPosition &pos, const GenericReplyHandler &h)
+    RequestHandle documentHover(const QUrl &document, const LSPPosition &pos, const ReplyDecoder &h)
     {
         auto params = textDocumentPositionParams(document, pos);
         return send(init_request(QStringLiteral("textDocument/hover"), params), h);
     }
 
-    RequestHandle documentHighlight(const QUrl &document, const LSPPosition &pos, const GenericReplyHandler &h)
+    RequestHandle documentHighlight(const QUrl &document, const LSPPosition &pos, const ReplyDecoder &h)
     {
         auto params = textDocumentPositionParams(document, pos);
         return send(init_request(QStringLiteral("textDocument/documentHighlight"), params), h);
     }
 
-    RequestHandle documentReferences(const QUrl &document, const LSPPosition &pos, bool decl, const GenericReplyHandler &h)
+    RequestHandle documentReferences(const QUrl &document, const LSPPosition &pos, bool decl, const ReplyDecoder &h)
     {
         auto params = referenceParams(document, pos, decl);
         return send(init_request(QStringLiteral("textDocument/references"), params), h);
     }
 
-    RequestHandle documentCompletion(const QUrl &document, const LSPPosition &pos, const GenericReplyHandler &h)
+    RequestHandle documentCompletion(const QUrl &document, const LSPPosition &pos, const ReplyDecoder &h)
     {
         auto params = textDocumentPositionParams(document, pos);
         return send(init_request(QStringLiteral("textDocument/completion"), params), h);
     }
 
-    RequestHandle signatureHelp(const QUrl &document, const LSPPosition &pos, const GenericReplyHandler &h)
+    RequestHandle signatureHelp(const QUrl &document, const LSPPosition &pos, const ReplyDecoder &h)
     {
         auto params = textDocumentPositionParams(document, pos);
         return send(init_request(QStringLiteral("textDocument/signatureHelp"), params), h);
     }
 
-    RequestHandle selectionRange(const QUrl &document, const QVector<LSPPosition> &positions, const GenericReplyHandler &h)
+    RequestHandle selectionRange(const QUrl &document, const QVector<LSPPosition> &positions, const ReplyDecoder &h)
     {
         auto params = textDocumentPositionsParams(document, positions);
         return send(init_request(QStringLiteral("textDocument/selectionRange"), params), h);
     }
 
-    RequestHandle clangdSwitchSourceHeader(const QUrl &document, const GenericReplyHandler &h)
+    RequestHandle clangdSwitchSourceHeader(const QUrl &document, const ReplyDecoder &h)
     {
         auto params = QJsonObject{{MEMBER_URI, document.toString()}};
         return send(init_request(QStringLiteral("textDocument/switchSourceHeader"), params), h);
     }
 
-    RequestHandle clangdMemoryUsage(const GenericReplyHandler &h)
+    RequestHandle clangdMemoryUsage(const ReplyDecoder &h)
     {
         return send(init_request(QStringLiteral("$/memoryUsage"), QJsonObject()), h);
     }
 
-    RequestHandle rustAnalyzerExpandMacro(const QUrl &document, const LSPPosition &pos, const GenericReplyHandler &h)
+    RequestHandle rustAnalyzerExpandMacro(const QUrl &document, const LSPPosition &pos, const ReplyDecoder &h)
     {
         auto params = textDocumentPositionParams(document, pos);
         return send(init_request(QStringLiteral("rust-analyzer/expandMacro"), params), h);
     }
 
-    RequestHandle documentFormatting(const QUrl &document, const LSPFormattingOptions &options, const GenericReplyHandler &h)
+    RequestHandle documentFormatting(const QUrl &document, const LSPFormattingOptions &options, const ReplyDecoder &h)
     {
         auto params = documentRangeFormattingParams(document, nullptr, options);
         return send(init_request(QStringLiteral("textDocument/formatting"), params), h);
     }
 
-    RequestHandle documentRangeFormatting(const QUrl &document, const LSPRange &range, const LSPFormattingOptions &options, const GenericReplyHandler &h)
+    RequestHandle documentRangeFormatting(const QUrl &document, const LSPRange &range, const LSPFormattingOptions &options, const ReplyDecoder &h)
     {
         auto params = documentRangeFormattingParams(document, &range, options);
         return send(init_request(QStringLiteral("textDocument/rangeFormatting"), params), h);
     }
 
     RequestHandle
-    documentOnTypeFormatting(const QUrl &document, const LSPPosition &pos, QChar lastChar, const LSPFormattingOptions &options, const GenericReplyHandler &h)
+    documentOnTypeFormatting(const QUrl &document, const LSPPosition &pos, QChar lastChar, const LSPFormattingOptions &options, const ReplyDecoder &h)
     {
         auto params = documentOnTypeFormattingParams(document, pos, lastChar, options);
         return send(init_request(QStringLiteral("textDocument/onTypeFormatting"), params), h);
     }
 
-    RequestHandle documentRename(const QUrl &document, const LSPPosition &pos, const QString &newName, const GenericReplyHandler &h)
+    RequestHandle documentRename(const QUrl &document, const LSPPosition &pos, const QString &newName, const ReplyDecoder &h)
     {
         auto params = renameParams(document, pos, newName);
         return send(init_request(QStringLiteral("textDocument/rename"), params), h);
     }
 
     RequestHandle
-    documentCodeAction(const QUrl &document, const LSPRange &range, const QList<QString> &kinds, QList<LSPDiagnostic> diagnostics, const GenericReplyHandler &h)
+    documentCodeAction(const QUrl &document, const LSPRange &range, const QList<QString> &kinds, QList<LSPDiagnostic> diagnostics, const ReplyDecoder &h)
     {
         auto params = codeActionParams(document, range, kinds, std::move(diagnostics));
         return send(init_request(QStringLiteral("textDocument/codeAction"), params), h);
     }
 
-    RequestHandle documentSemanticTokensFull(const QUrl &document, bool delta, const QString requestId, const LSPRange &range, const GenericReplyHandler &h)
+    RequestHandle documentSemanticTokensFull(const QUrl &document, bool delta, const QString requestId, const LSPRange &range, const ReplyDecoder &h)
     {
         auto params = textDocumentParams(document);
         // Delta
@@ -1536,7 +1810,9 @@ public:
     {
         auto params = executeCommandParams(command, args);
         // Pass an empty lambda as reply handler because executeCommand is a Request, but we ignore the result
-        send(init_request(QStringLiteral("workspace/executeCommand"), params), [](const auto &) {});
+        send(init_request(QStringLiteral("workspace/executeCommand"), params), [](LSPJsonReader &) {
+            return ReplyDelivery();
+        });
     }
 
     void didOpen(const QUrl &document, int version, const QString &langId, const QString &text)
@@ -1580,7 +1856,7 @@ public:
         send(init_request(QStringLiteral("workspace/didChangeWorkspaceFolders"), params));
     }
 
-    void workspaceSymbol(const QString &symbol, const GenericReplyHandler &h)
+    void workspaceSymbol(const QString &symbol, const ReplyDecoder &h)
     {
         auto params = QJsonObject{{MEMBER_QUERY, symbol}};
         send(init_request(QStringLiteral("workspace/symbol"), params), h);
@@ -1669,22 +1945,38 @@ public:
 // not so likely relevant/needed due to typical sequence of events,
 // but in case the latter would be changed in surprising ways ...
 template<typename ReplyType>
-static GenericReplyHandler
-make_handler(const ReplyHandler<ReplyType> &h, const QObject *context, typename utils::identity<std::function<ReplyType(const GenericReplyType &)>>::type c)
+static ReplyDecoder
+make_handler(const ReplyHandler<ReplyType> &h, const QObject *context, typename utils::identity<std::function<ReplyType(LSPJsonReader &)>>::type c)
 {
     // empty provided handler leads to empty handler
     if (!h || !c) {
         return nullptr;
     }
 
+    // convert in the decoding thread, only hand the typed result to the GUI thread
     QPointer<const QObject> ctx(context);
-    return [ctx, h, c](const GenericReplyType &m) {
-        if (ctx) {
-            h(c(m));
-        }
+    return [ctx, h, c](LSPJsonReader &reader) -> ReplyDelivery {
+        return [ctx, h, result = c(reader)]() {
+            if (ctx) {
+                h(result);
+            }
+        };
     };
 }
 
+// convert handler for the parsers working on a GenericReplyType
+template<typename ReplyType>
+static ReplyDecoder
+make_handler(const ReplyHandler<ReplyType> &h, const QObject *context, typename utils::identity<std::function<ReplyType(const GenericReplyType &)>>::type c)
+{
+    if (!c) {
+        return nullptr;
+    }
+    return make_handler<ReplyType>(h, context, [c](LSPJsonReader &reader) {
+        return c(reader.readValue());
+    });
+}
+
 LSPClientServer::LSPClientServer(const QStringList &server, const QUrl &root, const QString &langId, const QJsonValue &init, const FoldersType &folders)
     : d(new LSPClientServerPrivate(this, server, root, langId, init, folders))
 {
@@ -0,0 +1,440 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspjsonreader.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+bool LSPJsonReader::atEnd()
+{
+    skipWhitespace();
+    return m_pos == m_end;
+}
+
+LSPJsonReader::Type LSPJsonReader::peek()
+{
+    skipWhitespace();
+    if (m_pos == m_end) {
+        return Type::Invalid;
+    }
+
+    const char c = *m_pos;
+    switch (c) {
+    case '{':
+        return Type::Object;
+    case '[':
+        return Type::Array;
+    case '"':
+        return Type::String;
+    case 't':
+    case 'f':
+        return Type::Bool;
+    case 'n':
+        return Type::Null;
+    default:
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            return Type::Number;
+        }
+        return Type::Invalid;
+    }
+}
+
+bool LSPJsonReader::enterObject()
+{
+    if (peek() != Type::Object) {
+        return false;
+    }
+    ++m_pos;
+    m_first = true;
+    return true;
+}
+
+bool LSPJsonReader::nextMember(QLatin1String &key)
+{
+    if (!nextItem('}')) {
+        return false;
+    }
+
+    if (m_pos == m_end || *m_pos != '"') {
+        setError();
+        return false;
+    }
+    const char *begin = m_pos + 1;
+    const char *end = skipString(m_pos);
+    if (!end) {
+        setError();
+        return false;
+    }
+
+    // member names are plain ASCII in practice, only unescape if needed
+    const int size = int(end - 1 - begin);
+    if (std::memchr(begin, '\\', size)) {
+        m_key = readString().toUtf8();
+        key = QLatin1String(m_key.constData(), m_key.size());
+    } else {
+        key = QLatin1String(begin, size);
+        m_pos = end;
+    }
+    return expect(':');
+}
+
+bool LSPJsonReader::enterArray()
+{
+    if (peek() != Type::Array) {
+        return false;
+    }
+    ++m_pos;
+    m_first = true;
+    return true;
+}
+
+bool LSPJsonReader::nextElement()
+{
+    return nextItem(']');
+}
+
+QString LSPJsonReader::readString()
+{
+    if (peek() != Type::String) {
+        skip();
+        return QString();
+    }
+
+    const char *begin = m_pos + 1;
+    const char *end = skipString(m_pos);
+    if (!end) {
+        setError();
+        return QString();
+    }
+    m_pos = end;
+    // exclude the closing quote
+    --end;
+
+    // fast path, most strings contain no escapes
+    if (!std::memchr(begin, '\\', end - begin)) {
+        return QString::fromUtf8(begin, int(end - begin));
+    }
+
+    QString ret;
+    ret.reserve(int(end - begin));
+    const char *p = begin;
+    while (p < end) {
+        const char *escape = static_cast<const char *>(std::memchr(p, '\\', end - p));
+        if (!escape) {
+            ret += QString::fromUtf8(p, int(end - p));
+            break;
+        }
+        ret += QString::fromUtf8(p, int(escape - p));
+
+        // skipString ensures the escaped character is there
+        p = escape + 1;
+        switch (*p++) {
+        case '"':
+            ret += QLatin1Char('"');
+            break;
+        case '\\':
+            ret += QLatin1Char('\\');
+            break;
+        case '/':
+            ret += QLatin1Char('/');
+            break;
+        case 'b':
+            ret += QLatin1Char('\b');
+            break;
+        case 'f':
+            ret += QLatin1Char('\f');
+            break;
+        case 'n':
+            ret += QLatin1Char('\n');
+            break;
+        case 'r':
+            ret += QLatin1Char('\r');
+            break;
+        case 't':
+            ret += QLatin1Char('\t');
+            break;
+        case 'u': {
+            // UTF-16 code unit, surrogate pairs just end up next to each other
+            bool ok = false;
+            const ushort unit = (end - p >= 4) ? QByteArray(p, 4).toUShort(&ok, 16) : 0;
+            if (!ok) {
+                setError();
+                return QString();
+            }
+            ret += QChar(unit);
+            p += 4;
+            break;
+        }
+        default:
+            setError();
+            return QString();
+        }
+    }
+    return ret;
+}
+
+double LSPJsonReader::readDouble(double defaultValue)
+{
+    if (peek() != Type::Number) {
+        skip();
+        return defaultValue;
+    }
+
+    double value = 0;
+    return parseNumber(value) ? value : defaultValue;
+}
+
+int LSPJsonReader::readInt(int defaultValue)
+{
+    if (peek() != Type::Number) {
+        skip();
+        return defaultValue;
+    }
+
+    // like QJsonValue::toInt, only integral values are accepted
+    double value = 0;
+    if (!parseNumber(value) || value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max() || value != std::trunc(value)) {
+        return defaultValue;
+    }
+    return int(value);
+}
+
+bool LSPJsonReader::readBool(bool defaultValue)
+{
+    if (peek() != Type::Bool) {
+        skip();
+        return defaultValue;
+    }
+
+    if (*m_pos == 't') {
+        return readLiteral(QLatin1String("true")) ? true : defaultValue;
+    }
+    return readLiteral(QLatin1String("false")) ? false : defaultValue;
+}
+
+bool LSPJsonReader::readUInt32Array(std::vector<uint32_t> &values)
+{
+    if (!enterArray()) {
+        skip();
+        return false;
+    }
+
+    while (nextElement()) {
+        if (peek() != Type::Number) {
+            skip();
+            values.push_back(0);
+            continue;
+        }
+
+        // the values are unsigned, readInt would reject everything above INT_MAX
+        double value = 0;
+        if (!parseNumber(value) || value < 0 || value > std::numeric_limits<uint32_t>::max() || value != std::trunc(value)) {
+            value = 0;
+        }
+        values.push_back(static_cast<uint32_t>(value));
+    }
+    return !m_error;
+}
+
+QJsonValue LSPJsonReader::readValue()
+{
+    skipWhitespace();
+    const char *begin = m_pos;
+    skip();
+    if (m_error) {
+        return QJsonValue(QJsonValue::Undefined);
+    }
+
+    // QJsonDocument only parses objects and arrays, wrap the value
+    QByteArray json;
+    json.reserve(int(m_pos - begin) + 2);
+    json += '[';
+    json.append(begin, int(m_pos - begin));
+    json += ']';
+    return QJsonDocument::fromJson(json).array().at(0);
+}
+
+LSPJsonReader LSPJsonReader::valueReader()
+{
+    skipWhitespace();
+    const char *begin = m_pos;
+    skip();
+    if (m_error) {
+        return LSPJsonReader();
+    }
+    return LSPJsonReader(begin, m_pos);
+}
+
+void LSPJsonReader::skip()
+{
+    switch (peek()) {
+    case Type::Object:
+    case Type::Array: {
+        // only keep track of the nesting, strings might contain brackets
+        int depth = 0;
+        const char *p = m_pos;
+        while (p < m_end) {
+            const char c = *p;
+            if (c == '"') {
+                p = skipString(p);
+                if (!p) {
+                    break;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                m_pos = p + 1;
+                return;
+            }
+            ++p;
+        }
+        setError();
+        return;
+    }
+    case Type::String: {
+        const char *end = skipString(m_pos);
+        if (!end) {
+            setError();
+            return;
+        }
+        m_pos = end;
+        return;
+    }
+    case Type::Number: {
+        double value = 0;
+        parseNumber(value);
+        return;
+    }
+    case Type::Bool:
+        readLiteral(*m_pos == 't' ? QLatin1String("true") : QLatin1String("false"));
+        return;
+    case Type::Null:
+        readLiteral(QLatin1String("null"));
+        return;
+    case Type::Invalid:
+        setError();
+        return;
+    }
+}
+
+void LSPJsonReader::skipWhitespace()
+{
+    while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t')) {
+        ++m_pos;
+    }
+}
+
+void LSPJsonReader::setError()
+{
+    m_error = true;
+    m_pos = m_end;
+}
+
+bool LSPJsonReader::expect(char c)
+{
+    skipWhitespace();
+    if (m_pos == m_end || *m_pos != c) {
+        setError();
+        return false;
+    }
+    ++m_pos;
+    return true;
+}
+
+bool LSPJsonReader::nextItem(char close)
+{
+    skipWhitespace();
+    if (m_pos == m_end) {
+        setError();
+        return false;
+    }
+
+    if (*m_pos == close) {
+        ++m_pos;
+        m_first = false;
+        return false;
+    }
+
+    // no separator before the first item
+    if (m_first) {
+        m_first = false;
+        return true;
+    }
+    if (!expect(',')) {
+        return false;
+    }
+    skipWhitespace();
+    return true;
+}
+
+const char *LSPJsonReader::skipString(const char *quote) const
+{
+    for (const char *p = quote + 1; p < m_end; ++p) {
+        if (*p == '"') {
+            return p + 1;
+        }
+        if (*p == '\\') {
+            ++p;
+        }
+    }
+    return nullptr;
+}
+
+bool LSPJsonReader::parseNumber(double &value)
+{
+    const char *p = m_pos;
+    const bool negative = (p < m_end && *p == '-');
+    if (negative) {
+        ++p;
+    }
+
+    // fast path for integers, that is all we get for positions, kinds, tokens, ...
+    const char *digits = p;
+    uint64_t integer = 0;
+    while (p < m_end && *p >= '0' && *p <= '9') {
+        integer = integer * 10 + uint64_t(*p - '0');
+        ++p;
+    }
+    if (p == digits) {
+        setError();
+        return false;
+    }
+    const bool integral = (p == m_end || (*p != '.' && *p != 'e' && *p != 'E'));
+    if (integral && p - digits <= 18) {
+        value = negative ? -double(integer) : double(integer);
+        m_pos = p;
+        return true;
+    }
+
+    while (p < m_end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '-' || *p == '+')) {
+        ++p;
+    }
+    bool ok = false;
+    value = QByteArray(m_pos, int(p - m_pos)).toDouble(&ok);
+    if (!ok) {
+        setError();
+        return false;
+    }
+    m_pos = p;
+    return true;
+}
+
+bool LSPJsonReader::readLiteral(QLatin1String literal)
+{
+    if (m_end - m_pos < literal.size() || std::memcmp(m_pos, literal.data(), literal.size()) != 0) {
+        setError();
+        return false;
+    }
+    m_pos += literal.size();
+    return true;
+}
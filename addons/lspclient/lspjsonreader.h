@@ -0,0 +1,158 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#ifndef LSPJSONREADER_H
+#define LSPJSONREADER_H
+
+#include <QByteArray>
+#include <QJsonValue>
+#include <QLatin1String>
+#include <QString>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Pull parser for the JSON messages of a language server.
+ *
+ * Values are decoded in place from the UTF-8 message, no QJsonValue tree is built.
+ * Used for the large replies, e.g. completions or semantic tokens, where the typed
+ * structs are filled directly and all unused members are just skipped.
+ *
+ * The reader doesn't copy the data, it must outlive the reader.
+ * Errors are sticky, after the first one all reads fail and return defaults.
+ *
+ * Objects and arrays are iterated like:
+ *
+ *   if (reader.enterObject()) {
+ *       QLatin1String key;
+ *       while (reader.nextMember(key)) {
+ *           if (key == QLatin1String("name")) {
+ *               name = reader.readString();
+ *           } else {
+ *               reader.skip();
+ *           }
+ *       }
+ *   }
+ *
+ * Each member or element value must be read or skipped exactly once.
+ */
+class LSPJsonReader
+{
+public:
+    enum class Type { Invalid, Null, Bool, Number, String, Array, Object };
+
+    /**
+     * Reader without data, all reads fail.
+     * Its values are read as undefined.
+     */
+    LSPJsonReader() = default;
+
+    LSPJsonReader(const char *begin, const char *end)
+        : m_pos(begin)
+        , m_end(end)
+    {
+    }
+
+    explicit LSPJsonReader(const QByteArray &data)
+        : LSPJsonReader(data.constData(), data.constData() + data.size())
+    {
+    }
+
+    bool hasError() const
+    {
+        return m_error;
+    }
+
+    /**
+     * @return true if only whitespace is left
+     */
+    bool atEnd();
+
+    /**
+     * Type of the next value, doesn't consume anything.
+     */
+    Type peek();
+
+    /**
+     * Consume the opening brace of an object.
+     * @return false if the next value is no object, it is not consumed then
+     */
+    bool enterObject();
+
+    /**
+     * Advance to the next member of the current object.
+     * @param key set to the member name, only valid until the next read
+     * @return false if the object is done, its closing brace is consumed then
+     */
+    bool nextMember(QLatin1String &key);
+
+    /**
+     * Consume the opening bracket of an array.
+     * @return false if the next value is no array, it is not consumed then
+     */
+    bool enterArray();
+
+    /**
+     * Advance to the next element of the current array.
+     * @return false if the array is done, its closing bracket is consumed then
+     */
+    bool nextElement();
+
+    /**
+     * The read functions behave like the QJsonValue conversions:
+     * values of another type are skipped and the default is returned.
+     */
+    QString readString();
+    double readDouble(double defaultValue = 0);
+    int readInt(int defaultValue = 0);
+    bool readBool(bool defaultValue = false);
+
+    /**
+     * Read an array of unsigned 32 bit integers, e.g. semantic tokens.
+     * Elements that are no such integer are read as 0.
+     * @param values the integers are appended here
+     * @return false if the next value is no array
+     */
+    bool readUInt32Array(std::vector<uint32_t> &values);
+
+    /**
+     * Read the next value into a QJsonValue, for the parts we don't decode ourselves.
+     * @return the value, undefined for a reader without data
+     */
+    QJsonValue readValue();
+
+    /**
+     * Reader for just the next value, which is skipped here.
+     * Allows to postpone the decoding.
+     */
+    LSPJsonReader valueReader();
+
+    /**
+     * Skip the next value.
+     * For nested values only the brackets are checked, not the full syntax.
+     */
+    void skip();
+
+private:
+    void skipWhitespace();
+    void setError();
+    bool expect(char c);
+    bool nextItem(char close);
+    const char *skipString(const char *quote) const;
+    bool parseNumber(double &value);
+    bool readLiteral(QLatin1String literal);
+
+    const char *m_pos = nullptr;
+    const char *m_end = nullptr;
+    bool m_error = false;
+    // true directly after entering an object or array, there is no comma before the first item
+    bool m_first = false;
+    // storage for member names that needed unescaping
+    QByteArray m_key;
+};
+
+#endif
@@ -0,0 +1,220 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "lspjsonreader.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QObject>
+#include <QTest>
+
+class LSPJsonReaderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testEscapes()
+    {
+        const QByteArray json = R"(["a\"b\\c\/d\b\f\n\r\t", "\u00e9t\u00E9", "\ud83d\ude00!", "été", "plain"])";
+        LSPJsonReader reader(json);
+
+        QVERIFY(reader.enterArray());
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readString(), QStringLiteral("a\"b\\c/d\b\f\n\r\t"));
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readString(), QString::fromUtf8("\xc3\xa9t\xc3\xa9"));
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readString(), QString::fromUtf8("\xf0\x9f\x98\x80!"));
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readString(), QString::fromUtf8("\xc3\xa9t\xc3\xa9"));
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readString(), QStringLiteral("plain"));
+        QVERIFY(!reader.nextElement());
+        QVERIFY(reader.atEnd());
+        QVERIFY(!reader.hasError());
+    }
+
+    void testNumbers()
+    {
+        const QByteArray json = "[-42, 1.5e3, -2.5E-2, 12345678901234567890, 0, 1.5, 3000000000, -7]";
+        LSPJsonReader reader(json);
+
+        QVERIFY(reader.enterArray());
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readInt(), -42);
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readDouble(), 1500.0);
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readDouble(), -0.025);
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readDouble(), 12345678901234567890.0);
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readInt(-1), 0);
+
+        // like QJsonValue::toInt, no fractions and nothing out of range
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readInt(-1), -1);
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readInt(-1), -1);
+
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readDouble(), -7.0);
+        QVERIFY(!reader.nextElement());
+        QVERIFY(!reader.hasError());
+    }
+
+    void testUInt32Array()
+    {
+        const QByteArray json = R"([0, 4294967295, 2147483648, 7, -1, 1.5, 4294967296, "x", null])";
+        LSPJsonReader reader(json);
+
+        std::vector<uint32_t> values;
+        QVERIFY(reader.readUInt32Array(values));
+        const std::vector<uint32_t> expected = {0, 4294967295u, 2147483648u, 7, 0, 0, 0, 0, 0};
+        QVERIFY(values == expected);
+        QVERIFY(reader.atEnd());
+    }
+
+    void testNesting()
+    {
+        const QByteArray json = R"({"a": {}, "b": [], "c": [[1, 2], {"d": [3]}], "e": true})";
+        LSPJsonReader reader(json);
+        QLatin1String key;
+
+        QVERIFY(reader.enterObject());
+
+        QVERIFY(reader.nextMember(key));
+        QCOMPARE(key, QLatin1String("a"));
+        QVERIFY(reader.enterObject());
+        QVERIFY(!reader.nextMember(key));
+
+        QVERIFY(reader.nextMember(key));
+        QCOMPARE(key, QLatin1String("b"));
+        QVERIFY(reader.enterArray());
+        QVERIFY(!reader.nextElement());
+
+        QVERIFY(reader.nextMember(key));
+        QCOMPARE(key, QLatin1String("c"));
+        QVERIFY(reader.enterArray());
+        QVERIFY(reader.nextElement());
+        QVERIFY(reader.enterArray());
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readInt(), 1);
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readInt(), 2);
+        QVERIFY(!reader.nextElement());
+        QVERIFY(reader.nextElement());
+        QVERIFY(reader.enterObject());
+        QVERIFY(reader.nextMember(key));
+        QCOMPARE(key, QLatin1String("d"));
+        QVERIFY(reader.enterArray());
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readInt(), 3);
+        QVERIFY(!reader.nextElement());
+        QVERIFY(!reader.nextMember(key));
+        QVERIFY(!reader.nextElement());
+
+        QVERIFY(reader.nextMember(key));
+        QCOMPARE(key, QLatin1String("e"));
+        QCOMPARE(reader.readBool(), true);
+
+        QVERIFY(!reader.nextMember(key));
+        QVERIFY(reader.atEnd());
+        QVERIFY(!reader.hasError());
+    }
+
+    void testSkip()
+    {
+        // brackets and escaped quotes inside of strings must not confuse the nesting
+        const QByteArray json = R"([{"x": "]}[{\"", "y": [1, {"z": "\\"}]}, 2, "[", null, false])";
+        LSPJsonReader reader(json);
+
+        QVERIFY(reader.enterArray());
+        QVERIFY(reader.nextElement());
+        reader.skip();
+        QVERIFY(reader.nextElement());
+        QCOMPARE(reader.readInt(), 2);
+        QVERIFY(reader.nextElement());
+        reader.skip();
+        QVERIFY(reader.nextElement());
+        reader.skip();
+        QVERIFY(reader.nextElement());
+        reader.skip();
+        QVERIFY(!reader.nextElement());
+        QVERIFY(reader.atEnd());
+        QVERIFY(!reader.hasError());
+    }
+
+    void testStickyError()
+    {
+        const QByteArray json = R"({"a" 1, "b": [2]})";
+        LSPJsonReader reader(json);
+        QLatin1String key;
+
+        QVERIFY(reader.enterObject());
+        QVERIFY(!reader.nextMember(key));
+        QVERIFY(reader.hasError());
+
+        // everything fails from now on and returns the defaults
+        QCOMPARE(reader.readInt(7), 7);
+        QCOMPARE(reader.readString(), QString());
+        QCOMPARE(reader.readBool(true), true);
+        QVERIFY(!reader.enterArray());
+        QVERIFY(!reader.nextMember(key));
+        QVERIFY(reader.readValue().isUndefined());
+        QVERIFY(reader.hasError());
+
+        // unterminated values
+        const QByteArray unterminatedJson = R"([1, "abc)";
+        LSPJsonReader unterminated(unterminatedJson);
+        QVERIFY(unterminated.enterArray());
+        QVERIFY(unterminated.nextElement());
+        QCOMPARE(unterminated.readInt(), 1);
+        QVERIFY(unterminated.nextElement());
+        QCOMPARE(unterminated.readString(), QString());
+        QVERIFY(unterminated.hasError());
+        QVERIFY(!unterminated.nextElement());
+    }
+
+    void testReadValue()
+    {
+        const QByteArray json = R"({"a": [1, "x", null, true, {"b": 2.5, "c": "é\n"}], "n": -3e2, "s": "t"})";
+        const QJsonObject expected = QJsonDocument::fromJson(json).object();
+        QVERIFY(!expected.isEmpty());
+
+        LSPJsonReader whole(json);
+        QCOMPARE(whole.readValue(), QJsonValue(expected));
+        QVERIFY(whole.atEnd());
+
+        LSPJsonReader reader(json);
+        QLatin1String key;
+        QVERIFY(reader.enterObject());
+        QVERIFY(reader.nextMember(key));
+        QCOMPARE(key, QLatin1String("a"));
+
+        // the postponed value reads the same, the outer reader continues after it
+        LSPJsonReader valueReader = reader.valueReader();
+        QCOMPARE(valueReader.readValue(), expected.value(QStringLiteral("a")));
+        QVERIFY(valueReader.atEnd());
+
+        QVERIFY(reader.nextMember(key));
+        QCOMPARE(key, QLatin1String("n"));
+        QCOMPARE(reader.readValue(), expected.value(QStringLiteral("n")));
+        QVERIFY(reader.nextMember(key));
+        QCOMPARE(key, QLatin1String("s"));
+        QCOMPARE(reader.readValue(), expected.value(QStringLiteral("s")));
+        QVERIFY(!reader.nextMember(key));
+        QVERIFY(!reader.hasError());
+
+        // a reader without data
+        QVERIFY(LSPJsonReader().readValue().isUndefined());
+    }
+};
+
+QTEST_MAIN(LSPJsonReaderTest)
+
+#include "lspjsonreadertest.moc"
@@ -7,11 +7,13 @@
 
 #include "test1.h"
 #include "fileutil.h"
+#include "kateprojecttrigramindex.h"
 #include "tools/shellcheck.h"
 
 #include <QTest>
 
 #include <QString>
+#include <QTemporaryDir>
 
 QTEST_MAIN(Test1)
 
@@ -39,4 +41,42 @@ void Test1::testShellCheckParsing()
     QCOMPARE(outList.size(), 4);
 }
 
+void Test1::testTrigramIndex()
+{
+    // trigrams are ASCII case-folded and never span lines
+    const auto trigrams = KateProjectTrigramIndex::trigrams(QByteArrayLiteral("AbcD\nef"));
+    QCOMPARE(trigrams.size(), size_t(2));
+    QCOMPARE(KateProjectTrigramIndex::literalTrigrams({QStringLiteral("abc"), QStringLiteral("bcd")}), trigrams);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fooFile = dir.filePath(QStringLiteral("foo.txt"));
+    const QString barFile = dir.filePath(QStringLiteral("bar.txt"));
+    const QString binaryFile = dir.filePath(QStringLiteral("binary.dat"));
+    for (const auto &[fileName, content] : {std::pair{fooFile, QByteArrayLiteral("int foo = 42;\n")},
+                                            std::pair{barFile, QByteArrayLiteral("double bar = 4.2;\n")},
+                                            std::pair{binaryFile, QByteArrayLiteral("foo\0bar")}}) {
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(content);
+    }
+
+    const QStringList files{fooFile, barFile, binaryFile};
+    const QString indexFile = dir.filePath(QStringLiteral("index"));
+    KateProjectTrigramIndex index;
+    index.load(indexFile, files);
+    QVERIFY(QFile::exists(indexFile));
+
+    // binary files are not indexed and always kept, short literals don't filter anything
+    QCOMPARE(index.filterFiles(files, {QStringLiteral("FOO")}), (QStringList{fooFile, binaryFile}));
+    QCOMPARE(index.filterFiles(files, {QStringLiteral("double"), QStringLiteral("4.2")}), (QStringList{barFile, binaryFile}));
+    QCOMPARE(index.filterFiles(files, {QStringLiteral("unknown")}), (QStringList{binaryFile}));
+    QCOMPARE(index.filterFiles(files, {QStringLiteral("fo")}), files);
+
+    // reloading re-uses the persistent index
+    KateProjectTrigramIndex reloaded;
+    reloaded.load(indexFile, files);
+    QCOMPARE(reloaded.filterFiles(files, {QStringLiteral("bar =")}), (QStringList{barFile, binaryFile}));
+}
+
 // kate: space-indent on; indent-width 4; replace-tabs on;
@@ -6,17 +6,21 @@
 
 #include "filehistorywidget.h"
 
-#include <gitprocess.h>
-
 #include <QDate>
 #include <QFileInfo>
 #include <QPainter>
 #include <QStyledItemDelegate>
 #include <QVBoxLayout>
+#include <functional>
 #include <optional>
 
 #include <KLocalizedString>
 
+/**
+ * Commits fetched per git log call
+ */
+static constexpr int CommitsPerPage = 200;
+
 struct Commit {
     QByteArray hash;
     QString authorName;
@@ -38,8 +42,10 @@ static std::optional<qint64> toLong(const QByteArray &input)
     return std::nullopt;
 }
 
-static QVector<Commit> parseCommits(const QList<QByteArray> &raw)
+static QVector<Commit> parseCommits(const QByteArray &out)
 {
+    // the output of a whole page, no partial commits
+    const auto raw = out.split(0x00);
     QVector<Commit> commits;
     commits.reserve(raw.size());
 
@@ -86,6 +92,28 @@ public:
     {
         return m_rows.count();
     }
+
+    bool canFetchMore(const QModelIndex &parent) const override
+    {
+        return !parent.isValid() && !m_atEnd && !m_fetching;
+    }
+
+    void fetchMore(const QModelIndex &parent) override
+    {
+        if (!canFetchMore(parent) || !m_fetchMore) {
+            return;
+        }
+        m_fetching = true;
+        m_fetchMore();
+    }
+
+    /**
+     * Called to fetch the next page, that must be passed to addCommits
+     */
+    void setFetchMore(const std::function<void()> &fetchMore)
+    {
+        m_fetchMore = fetchMore;
+    }
     QVariant data(const QModelIndex &index, int role) const override
     {
         if (!index.isValid()) {
@@ -113,22 +141,27 @@ public:
         endResetModel();
     }
 
-    void addCommit(Commit cmt)
-    {
-        beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size());
-        m_rows.push_back(cmt);
-        endInsertRows();
-    }
-
-    void addCommits(const QVector<Commit> &cmts)
+    /**
+     * Add a fetched page of commits
+     * @param atEnd was this the last page?
+     */
+    void addCommits(const QVector<Commit> &cmts, bool atEnd)
     {
-        for (const auto &commit : cmts) {
-            addCommit(commit);
+        m_fetching = false;
+        m_atEnd = atEnd;
+        if (cmts.isEmpty()) {
+            return;
         }
+        beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + cmts.size() - 1);
+        m_rows.append(cmts);
+        endInsertRows();
     }
 
 private:
     QVector<Commit> m_rows;
+    std::function<void()> m_fetchMore;
+    bool m_fetching = false;
+    bool m_atEnd = false;
 };
 
 class CommitDelegate : public QStyledItemDelegate
@@ -204,10 +237,13 @@ FileHistoryWidget::FileHistoryWidget(const QString &file, QWidget *parent)
     : QWidget(parent)
     , m_file(file)
 {
-    auto model = new CommitListModel(this);
+    m_model = new CommitListModel(this);
+    m_model->setFetchMore([this] {
+        fetchMoreHistory();
+    });
     m_listView = new QListView;
-    m_listView->setModel(model);
-    getFileHistory(file);
+    m_listView->setModel(m_model);
+    m_model->fetchMore(QModelIndex());
 
     setLayout(new QVBoxLayout);
 
@@ -224,55 +260,53 @@ FileHistoryWidget::FileHistoryWidget(const QString &file, QWidget *parent)
 
 FileHistoryWidget::~FileHistoryWidget()
 {
-    m_git.kill();
-    m_git.waitForFinished();
+    GitService::self().cancel(m_fetchRequest);
 }
 
-// git log --format=%H%n%aN%n%aE%n%at%n%ct%n%P%n%B --author-date-order
-void FileHistoryWidget::getFileHistory(const QString &file)
+// git log --format=%H%n%aN%n%aE%n%at%n%ct%n%P%n%s -z --skip=<rows> --max-count=<page>
+void FileHistoryWidget::fetchMoreHistory()
 {
-    if (!setupGitProcess(m_git,
-                         QFileInfo(file).absolutePath(),
-                         {QStringLiteral("log"), QStringLiteral("--format=%H%n%aN%n%aE%n%at%n%ct%n%P%n%B"), QStringLiteral("-z"), file})) {
-        Q_EMIT errorMessage(i18n("Failed to get file history: git executable not found in PATH"), true);
-        return;
-    }
-
-    connect(&m_git, &QProcess::readyReadStandardOutput, this, [this] {
-        auto commits = parseCommits(m_git.readAllStandardOutput().split(0x00));
-        if (!commits.isEmpty()) {
-            static_cast<CommitListModel *>(m_listView->model())->addCommits(commits);
-        }
-    });
-
-    connect(&m_git, &QProcess::finished, this, [this](int exitCode, QProcess::ExitStatus s) {
-        if (exitCode != 0 || s != QProcess::NormalExit) {
-            Q_EMIT errorMessage(i18n("Failed to get file history: %1", QString::fromUtf8(m_git.readAllStandardError())), true);
-        }
-    });
-
-    m_git.start(QProcess::ReadOnly);
+    const QStringList args{QStringLiteral("log"),
+                           QStringLiteral("--format=%H%n%aN%n%aE%n%at%n%ct%n%P%n%s"),
+                           QStringLiteral("-z"),
+                           QStringLiteral("--skip=%1").arg(m_model->rowCount(QModelIndex())),
+                           QStringLiteral("--max-count=%1").arg(CommitsPerPage),
+                           QStringLiteral("--"),
+                           m_file};
+
+    // the history only changes with the repository, pages can be reused
+    m_fetchRequest = GitService::self().request(
+        QFileInfo(m_file).absolutePath(),
+        args,
+        this,
+        [this](const GitResult &result) {
+            m_fetchRequest = 0;
+            if (!result.ok()) {
+                Q_EMIT errorMessage(i18n("Failed to get file history: %1", QString::fromUtf8(result.standardError)), true);
+                m_model->addCommits({}, true);
+                return;
+            }
+
+            const auto commits = parseCommits(result.standardOutput);
+            m_model->addCommits(commits, commits.size() < CommitsPerPage);
+        },
+        GitService::Interactive,
+        true);
 }
 
 void FileHistoryWidget::itemClicked(const QModelIndex &idx)
 {
-    QProcess git;
     QFileInfo fi(m_file);
 
     const auto commit = idx.data(CommitListModel::CommitRole).value<Commit>();
 
-    if (!setupGitProcess(git, fi.absolutePath(), {QStringLiteral("show"), QString::fromUtf8(commit.hash), QStringLiteral("--"), m_file})) {
+    // a commit never changes, the result can be reused
+    const GitResult result = GitService::self().run(fi.absolutePath(), {QStringLiteral("show"), QString::fromUtf8(commit.hash), QStringLiteral("--"), m_file}, true);
+    if (!result.ok()) {
         return;
     }
 
-    git.start(QProcess::ReadOnly);
-    if (git.waitForStarted() && git.waitForFinished(-1)) {
-        if (git.exitStatus() != QProcess::NormalExit || git.exitCode() != 0) {
-            return;
-        }
-        QByteArray contents(git.readAllStandardOutput());
-        // we send this signal to the parent, which will pass it on to
-        // the GitWidget from where a temporary file is opened
-        Q_EMIT commitClicked(contents);
-    }
+    // we send this signal to the parent, which will pass it on to
+    // the GitWidget from where a temporary file is opened
+    Q_EMIT commitClicked(result.standardOutput);
 }
@@ -7,10 +7,11 @@
 #define FILEHISTORYWIDGET_H
 
 #include <QListView>
-#include <QProcess>
 #include <QPushButton>
 #include <QWidget>
 
+#include <gitservice.h>
+
 class FileHistoryWidget : public QWidget
 {
     Q_OBJECT
@@ -22,12 +23,16 @@ private Q_SLOTS:
     void itemClicked(const QModelIndex &idx);
 
 private:
-    void getFileHistory(const QString &file);
+    /**
+     * Fetch the next page of commits, the model asks for it when the view is scrolled to the end
+     */
+    void fetchMoreHistory();
 
     QPushButton m_backBtn;
     QListView *m_listView;
+    class CommitListModel *m_model;
     QString m_file;
-    QProcess m_git;
+    GitService::RequestId m_fetchRequest = 0;
 
 Q_SIGNALS:
     void backClicked();
@@ -5,36 +5,95 @@
 */
 #include "gitstatus.h"
 
-#include <gitprocess.h>
+#include <gitservice.h>
 
 #include <KLocalizedString>
 #include <QByteArray>
-#include <QProcess>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
 #include <QScopeGuard>
 
 #include <charconv>
 #include <optional>
+#include <vector>
+
+/**
+ * With more paths we just diff all files, the command line would get too long
+ */
+static constexpr int MaxNumStatPaths = 1000;
 
 static void numStatForStatus(QVector<GitUtils::StatusItem> &list, const QString &workDir, bool modified)
 {
-    const auto args = modified ? QStringList{QStringLiteral("diff"), QStringLiteral("--numstat"), QStringLiteral("-z")}
-                               : QStringList{QStringLiteral("diff"), QStringLiteral("--numstat"), QStringLiteral("--staged"), QStringLiteral("-z")};
+    auto args = modified ? QStringList{QStringLiteral("--literal-pathspecs"), QStringLiteral("diff"), QStringLiteral("--numstat"), QStringLiteral("-z")}
+                         : QStringList{QStringLiteral("--literal-pathspecs"),
+                                       QStringLiteral("diff"),
+                                       QStringLiteral("--numstat"),
+                                       QStringLiteral("--staged"),
+                                       QStringLiteral("-z")};
+    if (list.size() <= MaxNumStatPaths) {
+        args.push_back(QStringLiteral("--"));
+        for (const auto &item : qAsConst(list)) {
+            args.push_back(QString::fromUtf8(item.file));
+        }
+    }
 
-    QProcess git;
-    if (!setupGitProcess(git, workDir, args)) {
+    // the staged numstat only depends on HEAD and the index, it can be reused
+    const GitResult result = GitService::self().run(workDir, args, !modified);
+    if (!result.ok()) {
         return;
     }
-    git.start(QProcess::ReadOnly);
-    if (git.waitForStarted() && git.waitForFinished(-1)) {
-        if (git.exitStatus() != QProcess::NormalExit || git.exitCode() != 0) {
-            return;
+
+    GitUtils::parseDiffNumStat(list, result.standardOutput);
+}
+
+/**
+ * Fill the line counts of the items from the cache, compute the missing ones.
+ * @param isValid is the cached entry still valid for the item?
+ * @param makeEntry cache entry for the item, line counts are filled in here
+ */
+template<typename IsValid, typename MakeEntry>
+static void updateNumStat(QVector<GitUtils::StatusItem> &items,
+                          const QString &workDir,
+                          bool modified,
+                          const QHash<QByteArray, GitUtils::NumStatCache::Entry> &previous,
+                          QHash<QByteArray, GitUtils::NumStatCache::Entry> &cache,
+                          IsValid isValid,
+                          MakeEntry makeEntry)
+{
+    QVector<GitUtils::StatusItem> outdated;
+    QVector<int> outdatedIndices;
+    std::vector<GitUtils::NumStatCache::Entry> entries;
+    entries.reserve(items.size());
+    for (int i = 0; i < items.size(); ++i) {
+        auto &item = items[i];
+        entries.push_back(makeEntry(item));
+        const auto it = previous.constFind(item.file);
+        if (it != previous.cend() && isValid(*it, entries.back())) {
+            item.linesAdded = it->linesAdded;
+            item.linesRemoved = it->linesRemoved;
+        } else {
+            outdated.push_back(item);
+            outdatedIndices.push_back(i);
         }
     }
 
-    GitUtils::parseDiffNumStat(list, git.readAllStandardOutput());
+    if (!outdated.isEmpty()) {
+        numStatForStatus(outdated, workDir, modified);
+        for (int i = 0; i < outdated.size(); ++i) {
+            items[outdatedIndices[i]] = outdated[i];
+        }
+    }
+
+    cache.reserve(items.size());
+    for (int i = 0; i < items.size(); ++i) {
+        entries[i].linesAdded = items[i].linesAdded;
+        entries[i].linesRemoved = items[i].linesRemoved;
+        cache.insert(items[i].file, entries[i]);
+    }
 }
 
-GitUtils::GitParsedStatus GitUtils::parseStatus(const QByteArray &raw, bool withNumStat, const QString &workingDir)
+GitUtils::GitParsedStatus GitUtils::parseStatus(const QByteArray &raw, bool withNumStat, const QString &workingDir, const NumStatCache &numStat)
 {
     QVector<GitUtils::StatusItem> untracked;
     QVector<GitUtils::StatusItem> unmerge;
@@ -126,12 +185,52 @@ GitUtils::GitParsedStatus GitUtils::parseStatus(const QByteArray &raw, bool with
         }
     }
 
+    NumStatCache newNumStat;
     if (withNumStat) {
-        numStatForStatus(changed, workingDir, true);
-        numStatForStatus(staged, workingDir, false);
+        // staged files only change with HEAD or the index
+        newNumStat.repositoryState = GitService::repositoryState(workingDir);
+        const bool sameState = !newNumStat.repositoryState.isEmpty() && newNumStat.repositoryState == numStat.repositoryState;
+
+        // modified files keep their status while being edited, check the file itself
+        // and the index they are compared to, e.g. a partial stage changes the diff
+        const QDir dir(workingDir);
+        updateNumStat(
+            changed,
+            workingDir,
+            true,
+            numStat.changed,
+            newNumStat.changed,
+            [sameState](const NumStatCache::Entry &cached, const NumStatCache::Entry &current) {
+                return sameState && cached.statusChar == current.statusChar && cached.lastModified == current.lastModified && cached.size == current.size;
+            },
+            [&dir](const StatusItem &item) {
+                const QFileInfo fi(dir.filePath(QString::fromUtf8(item.file)));
+                NumStatCache::Entry entry;
+                entry.statusChar = item.statusChar;
+                if (fi.exists()) {
+                    entry.lastModified = fi.lastModified().toMSecsSinceEpoch();
+                    entry.size = fi.size();
+                }
+                return entry;
+            });
+
+        updateNumStat(
+            staged,
+            workingDir,
+            false,
+            numStat.staged,
+            newNumStat.staged,
+            [sameState](const NumStatCache::Entry &cached, const NumStatCache::Entry &current) {
+                return sameState && cached.statusChar == current.statusChar;
+            },
+            [](const StatusItem &item) {
+                NumStatCache::Entry entry;
+                entry.statusChar = item.statusChar;
+                return entry;
+            });
     }
 
-    return {untracked, unmerge, staged, changed};
+    return {untracked, unmerge, staged, changed, newNumStat};
 }
 
 QString GitUtils::statusString(GitUtils::GitStatus s)
@@ -6,6 +6,7 @@
 #ifndef GITSTATUS_H
 #define GITSTATUS_H
 
+#include <QHash>
 #include <QString>
 #include <QVector>
 
@@ -57,14 +58,38 @@ struct StatusItem {
     int linesRemoved;
 };
 
+/**
+ * Line counts of the last status, to only compute them again for files that changed.
+ */
+struct NumStatCache {
+    struct Entry {
+        char statusChar = 0;
+        // working tree file, only for the changed files
+        qint64 lastModified = 0;
+        qint64 size = 0;
+        int linesAdded = 0;
+        int linesRemoved = 0;
+    };
+
+    // HEAD and index the staged line counts belong to
+    QByteArray repositoryState;
+    QHash<QByteArray, Entry> staged;
+    QHash<QByteArray, Entry> changed;
+};
+
 struct GitParsedStatus {
     QVector<StatusItem> untracked;
     QVector<StatusItem> unmerge;
     QVector<StatusItem> staged;
     QVector<StatusItem> changed;
+    NumStatCache numStat;
 };
 
-GitParsedStatus parseStatus(const QByteArray &raw, bool withNumStat, const QString &workingDir);
+/**
+ * Parse the output of git status -z.
+ * @param withNumStat compute the added/removed lines, the ones in @p numStat are reused if the file didn't change
+ */
+GitParsedStatus parseStatus(const QByteArray &raw, bool withNumStat, const QString &workingDir, const NumStatCache &numStat = NumStatCache());
 
 void parseDiffNumStat(QVector<GitUtils::StatusItem> &items, const QByteArray &raw);
 
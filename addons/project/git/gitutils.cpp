@@ -7,6 +7,7 @@
 #include "gitutils.h"
 
 #include <gitprocess.h>
+#include <gitservice.h>
 
 #include <QDateTime>
 #include <QDebug>
@@ -134,8 +135,6 @@ static GitUtils::Branch parseRemoteBranch(const QString &raw)
 QVector<GitUtils::Branch> GitUtils::getAllBranchesAndTags(const QString &repo, RefType ref)
 {
     // git for-each-ref --format '%(refname)' --sort=-committerdate ...
-    QProcess git;
-
     QStringList args{QStringLiteral("for-each-ref"), QStringLiteral("--format"), QStringLiteral("%(refname)"), QStringLiteral("--sort=-committerdate")};
     if (ref & RefType::Head) {
         args.append(QStringLiteral("refs/heads"));
@@ -148,14 +147,11 @@ QVector<GitUtils::Branch> GitUtils::getAllBranchesAndTags(const QString &repo, R
         args.append(QStringLiteral("--sort=-taggerdate"));
     }
 
-    if (!setupGitProcess(git, repo, args)) {
-        return {};
-    }
-
-    git.start(QProcess::ReadOnly);
+    // the refs are part of the repository state, the result can be reused until they change
+    const GitResult result = GitService::self().run(repo, args, true);
     QVector<Branch> branches;
-    if (git.waitForStarted() && git.waitForFinished(-1)) {
-        QString gitout = QString::fromUtf8(git.readAllStandardOutput());
+    if (result.ok()) {
+        QString gitout = QString::fromUtf8(result.standardOutput);
         QStringList out = gitout.split(QLatin1Char('\n'));
 
         branches.reserve(out.size());
@@ -179,22 +175,16 @@ QVector<GitUtils::Branch> GitUtils::getAllBranchesAndTags(const QString &repo, R
 QVector<GitUtils::Branch> GitUtils::getAllLocalBranchesWithLastCommitSubject(const QString &repo)
 {
     // git for-each-ref --format '%(refname)' --sort=-committerdate ...
-    QProcess git;
-
     QStringList args{QStringLiteral("for-each-ref"),
                      QStringLiteral("--format"),
                      QStringLiteral("%(refname)[--]%(contents:subject)"),
                      QStringLiteral("--sort=-committerdate"),
                      QStringLiteral("refs/heads")};
 
-    if (!setupGitProcess(git, repo, args)) {
-        return {};
-    }
-
-    git.start(QProcess::ReadOnly);
+    const GitResult result = GitService::self().run(repo, args, true);
     QVector<Branch> branches;
-    if (git.waitForStarted() && git.waitForFinished(-1)) {
-        QByteArray gitout = git.readAllStandardOutput();
+    if (result.ok()) {
+        const QByteArray &gitout = result.standardOutput;
         QByteArrayList rows = gitout.split('\n');
 
         branches.reserve(rows.size());
@@ -19,6 +19,7 @@
 #include "stashdialog.h"
 
 #include <gitprocess.h>
+#include <gitservice.h>
 
 #include <KColorScheme>
 #include <QContextMenuEvent>
@@ -399,8 +400,9 @@ QProcess *GitWidget::gitp(const QStringList &arguments)
     return git;
 }
 
-void GitWidget::updateStatus()
+void GitWidget::updateStatus(bool force)
 {
+    m_forceStatusUpdate = m_forceStatusUpdate || force;
     m_updateTrigger.start();
 }
 
@@ -410,21 +412,28 @@ void GitWidget::slotUpdateStatus()
         return; // No need to update
     }
 
+    // a few stat calls are way cheaper than git status on a large repository
+    if (!m_forceStatusUpdate && !m_statusRepositoryState.isEmpty() && m_statusRepositoryState == GitService::repositoryState(m_gitPath)) {
+        return;
+    }
+    m_forceStatusUpdate = false;
+
     const auto args = QStringList{QStringLiteral("status"), QStringLiteral("-z"), QStringLiteral("-u"), QStringLiteral("--ignore-submodules")};
 
-    auto git = gitp(args);
-    connect(git, &QProcess::finished, this, [this, git](int exitCode, QProcess::ExitStatus es) {
-        if (es != QProcess::NormalExit || exitCode != 0) {
+    // shared with other status queries for this repository, e.g. of other main windows
+    GitService::self().request(m_gitPath, args, this, [this](const GitResult &result) {
+        if (!result.ok()) {
             // no error on status failure
-            //            sendMessage(QString::fromUtf8(git->readAllStandardError()), true);
+            //            sendMessage(QString::fromUtf8(result.standardError), true);
         } else {
+            // watcher events for changes we already see here must not trigger a new update
+            // the state git started with, changes while it did run trigger another update
+            m_statusRepositoryState = result.repositoryState;
             const bool withNumStat = m_pluginView->plugin()->showGitStatusWithNumStat();
-            auto future = QtConcurrent::run(GitUtils::parseStatus, git->readAllStandardOutput(), withNumStat, m_gitPath);
+            auto future = QtConcurrent::run(GitUtils::parseStatus, result.standardOutput, withNumStat, m_gitPath, m_numStatCache);
             m_gitStatusWatcher.setFuture(future);
         }
-        git->deleteLater();
     });
-    git->start(QProcess::ReadOnly);
 }
 
 void GitWidget::runGitCmd(const QStringList &args, const QString &i18error)
@@ -794,6 +803,7 @@ void GitWidget::parseStatusReady()
 
     // Set new data
     GitUtils::GitParsedStatus s = m_gitStatusWatcher.result();
+    m_numStatCache = std::move(s.numStat);
     m_model->setStatusItems(std::move(s), m_pluginView->plugin()->showGitStatusWithNumStat());
 
     // Restore collapse/expand state
@@ -50,8 +50,9 @@ public:
     /**
      * Trigger the GitWidget to update itself.
      * It is safe to call it repeatedly in a short time, due to delayed update after the last call.
+     * @param force update even if HEAD and the index didn't change, e.g. after the working tree changed
      */
-    void updateStatus();
+    void updateStatus(bool force = true);
 
     KTextEditor::MainWindow *mainWindow();
 
@@ -82,6 +83,12 @@ private:
     /** This ends with "/", always remember this */
     QString m_gitPath;
     QFutureWatcher<GitUtils::GitParsedStatus> m_gitStatusWatcher;
+    /** Line counts of the last status, reused for unchanged files */
+    GitUtils::NumStatCache m_numStatCache;
+    /** HEAD and index state after the last status, to skip updates for changes already seen */
+    QByteArray m_statusRepositoryState;
+    /** Must the next update run even if HEAD and the index didn't change? */
+    bool m_forceStatusUpdate = true;
     QString m_commitMessage;
     KTextEditor::MainWindow *m_mainWin;
     QMenu *m_gitMenu;
@@ -23,7 +23,10 @@
 #include <QJsonObject>
 #include <QJsonParseError>
 #include <QPlainTextDocumentLayout>
+#include <QSet>
+#include <QtConcurrent>
 #include <utility>
+#include <vector>
 
 KateProject::KateProject(QThreadPool &threadPool, KateProjectPlugin *plugin, const QString &fileName)
     : m_threadPool(threadPool)
@@ -32,6 +35,8 @@ KateProject::KateProject(QThreadPool &threadPool, KateProjectPlugin *plugin, con
     , m_fileName(QFileInfo(fileName).canonicalFilePath())
     , m_baseDir(QFileInfo(fileName).canonicalPath())
 {
+    initDirectoryWatch();
+
     // if canonicalFilePath already returned empty string, no need to try to load this
     if (m_fileName.isEmpty()) {
         return;
@@ -53,6 +58,8 @@ KateProject::KateProject(QThreadPool &threadPool, KateProjectPlugin *plugin, con
     , m_baseDir(QDir(directory).canonicalPath())
     , m_globalProject(globalProject)
 {
+    initDirectoryWatch();
+
     // try to load the project map, will start worker thread, too
     load(globalProject);
 }
@@ -67,6 +74,15 @@ KateProject::~KateProject()
     }
 }
 
+void KateProject::initDirectoryWatch()
+{
+    m_refreshFilesTimer.setSingleShot(true);
+    m_refreshFilesTimer.setInterval(1000);
+    connect(&m_refreshFilesTimer, &QTimer::timeout, this, &KateProject::refreshFiles);
+    connect(&m_directoryWatcher, &QFileSystemWatcher::directoryChanged, &m_refreshFilesTimer, qOverload<>(&QTimer::start));
+    connect(m_plugin, &KateProjectPlugin::configUpdated, this, &KateProject::updateDirectoryWatch);
+}
+
 bool KateProject::reload(bool force)
 {
     const QVariantMap map = readProjectFile();
@@ -234,24 +250,163 @@ bool KateProject::load(const QVariantMap &globalProject, bool force)
     return true;
 }
 
+/**
+ * key to match items of the old and the new project tree, unique per parent
+ */
+static QString itemKey(const QStandardItem *item)
+{
+    return QString::number(item->data(KateProjectItem::TypeRole).toInt()) + QLatin1Char('/') + item->text();
+}
+
+/**
+ * Merge the children of a new tree level into the existing model level.
+ * Only inserts & removes changed rows, existing items stay, that keeps expansion & selection intact.
+ * Items taken over from the new tree are moved, matching items of the new tree stay there and are deleted with it.
+ * @param oldParent item in the model
+ * @param newParent matching item in the new tree, both levels are sorted the same way
+ * @param file2Item mapping of the new tree, fixed up to point to the items kept in the model
+ */
+static void mergeChildren(QStandardItem *oldParent, QStandardItem *newParent, QHash<QString, KateProjectItem *> &file2Item)
+{
+    /**
+     * remove all rows no longer there
+     */
+    QSet<QString> newKeys;
+    newKeys.reserve(newParent->rowCount());
+    for (int i = 0; i < newParent->rowCount(); ++i) {
+        newKeys.insert(itemKey(newParent->child(i)));
+    }
+    QHash<QString, QStandardItem *> oldItems;
+    for (int i = oldParent->rowCount() - 1; i >= 0; --i) {
+        QStandardItem *oldItem = oldParent->child(i);
+        const QString key = itemKey(oldItem);
+        if (newKeys.contains(key)) {
+            oldItems[key] = oldItem;
+        } else {
+            oldParent->removeRow(i);
+        }
+    }
+
+    /**
+     * walk both sorted levels in parallel, insert missing rows, recurse into matching ones
+     */
+    int oldRow = 0;
+    for (int i = 0; i < newParent->rowCount(); ++i) {
+        QStandardItem *newItem = newParent->child(i);
+        const QString key = itemKey(newItem);
+        QStandardItem *oldItem = oldItems.value(key);
+        if (!oldItem) {
+            oldParent->insertRow(oldRow++, newParent->takeChild(i));
+            continue;
+        }
+
+        // only names differing in case might be sorted differently, don't move them around
+        if (oldRow < oldParent->rowCount() && oldParent->child(oldRow) == oldItem) {
+            ++oldRow;
+        }
+
+        if (newItem->data(KateProjectItem::TypeRole).toInt() == KateProjectItem::File) {
+            file2Item[newItem->data(Qt::UserRole).toString()] = static_cast<KateProjectItem *>(oldItem);
+        } else {
+            mergeChildren(oldItem, newItem, file2Item);
+        }
+    }
+}
+
 void KateProject::loadProjectDone(const KateProjectSharedQStandardItem &topLevel, KateProjectSharedQHashStringItem file2Item)
 {
-    m_model.clear();
-    m_model.invisibleRootItem()->appendColumn(topLevel->takeColumn(0));
+    /**
+     * the untracked documents are re-added below, tracked state might have changed
+     */
+    if (m_untrackedDocumentsRoot) {
+        m_model.removeRow(m_untrackedDocumentsRoot->row());
+        m_untrackedDocumentsRoot = nullptr;
+    }
+
+    /**
+     * initial load: just take the new tree
+     * reload: apply the differences to the existing model, a reset would collapse the views
+     */
+    if (m_model.rowCount() == 0) {
+        m_model.invisibleRootItem()->appendColumn(topLevel->takeColumn(0));
+    } else {
+        mergeChildren(m_model.invisibleRootItem(), topLevel.data(), *file2Item);
+    }
 
     m_file2Item = std::move(file2Item);
 
     /**
      * readd the documents that are open atm
      */
-    m_untrackedDocumentsRoot = nullptr;
     for (auto i = m_documents.constBegin(); i != m_documents.constEnd(); i++) {
         registerDocument(i.key());
     }
 
+    updateDirectoryWatch();
+
     Q_EMIT modelChanged();
 }
 
+void KateProject::updateDirectoryWatch()
+{
+    /**
+     * collect all directories of the tree, limited, each one costs an inotify watch
+     */
+    static const int MaxWatchedDirectories = 8192;
+    QSet<QString> directories;
+    if (m_plugin->watchProjectDirectories() && m_model.rowCount() > 0) {
+        directories.insert(m_baseDir);
+        std::vector<const QStandardItem *> pending{m_model.invisibleRootItem()};
+        while (!pending.empty() && directories.size() < MaxWatchedDirectories) {
+            const QStandardItem *parent = pending.back();
+            pending.pop_back();
+            for (int i = 0; i < parent->rowCount(); ++i) {
+                const QStandardItem *item = parent->child(i);
+                if (item == m_untrackedDocumentsRoot || item->data(KateProjectItem::TypeRole).toInt() == KateProjectItem::File) {
+                    continue;
+                }
+                const QString path = item->data(Qt::UserRole).toString();
+                if (!path.isEmpty()) {
+                    directories.insert(path);
+                }
+                pending.push_back(item);
+            }
+        }
+    }
+
+    /**
+     * only touch changed paths, adding watches is expensive
+     */
+    const QStringList watched = m_directoryWatcher.directories();
+    QStringList removed;
+    for (const auto &directory : watched) {
+        if (!directories.remove(directory)) {
+            removed.push_back(directory);
+        }
+    }
+    if (!removed.isEmpty()) {
+        m_directoryWatcher.removePaths(removed);
+    }
+    if (!directories.isEmpty()) {
+        m_directoryWatcher.addPaths(directories.values());
+    }
+    if (m_directoryWatcher.directories().isEmpty()) {
+        m_refreshFilesTimer.stop();
+    }
+}
+
+void KateProject::refreshFiles()
+{
+    // project not loaded or closed meanwhile
+    if (m_projectMap.isEmpty() || m_directoryWatcher.directories().isEmpty()) {
+        return;
+    }
+
+    auto w = new KateProjectWorker(m_baseDir, QString(), m_projectMap, false, true);
+    connect(w, &KateProjectWorker::loadDone, this, &KateProject::loadProjectDone, Qt::QueuedConnection);
+    m_threadPool.start(w);
+}
+
 void KateProject::loadIndexDone(KateProjectSharedProjectIndex projectIndex)
 {
     /**
@@ -383,6 +538,24 @@ void KateProject::slotModifiedOnDisk(KTextEditor::Document *document, bool isMod
     }
 
     item->slotModifiedOnDisk(document, isModified, reason);
+
+    // content on disk changed behind our back, update the index
+    if (m_projectIndex && reason != KTextEditor::ModificationInterface::OnDiskUnmodified) {
+        m_projectIndex->updateFile(m_documents.value(document));
+    }
+}
+
+void KateProject::slotDocumentSaved(KTextEditor::Document *document)
+{
+    if (m_projectIndex) {
+        const QString fileName = document->url().toLocalFile();
+        m_projectIndex->updateFile(fileName);
+
+        // running ctags is expensive, update the tags in the background, the index stays usable
+        QtConcurrent::run(&m_threadPool, [index = m_projectIndex, fileName]() {
+            index->updateCtags(fileName);
+        });
+    }
 }
 
 void KateProject::registerDocument(KTextEditor::Document *document)
@@ -399,6 +572,7 @@ void KateProject::registerDocument(KTextEditor::Document *document)
     // clang-format off
     if (item) {
         disconnect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
+        disconnect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateProject::slotDocumentSaved);
         disconnect(document,
                    SIGNAL(modifiedOnDisk(KTextEditor::Document*,bool,KTextEditor::ModificationInterface::ModifiedOnDiskReason)),
                    this,
@@ -409,6 +583,7 @@ void KateProject::registerDocument(KTextEditor::Document *document)
          * FIXME*/
 
         connect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
+        connect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateProject::slotDocumentSaved);
         connect(document,
                 SIGNAL(modifiedOnDisk(KTextEditor::Document*,bool,KTextEditor::ModificationInterface::ModifiedOnDiskReason)),
                 this,
@@ -469,6 +644,7 @@ void KateProject::unregisterDocument(KTextEditor::Document *document)
     }
 
     disconnect(document, &KTextEditor::Document::modifiedChanged, this, &KateProject::slotModifiedChanged);
+    disconnect(document, &KTextEditor::Document::documentSavedOrUploaded, this, &KateProject::slotDocumentSaved);
 
     const QString &file = m_documents.value(document);
 
@@ -13,9 +13,11 @@
 
 #include <KTextEditor/ModificationInterface>
 
+#include <QFileSystemWatcher>
 #include <QHash>
 #include <QSharedPointer>
 #include <QTextDocument>
+#include <QTimer>
 
 /**
  * Shared pointer data types.
@@ -249,12 +251,30 @@ private Q_SLOTS:
 
     void slotModifiedOnDisk(KTextEditor::Document *document, bool isModified, KTextEditor::ModificationInterface::ModifiedOnDiskReason reason);
 
+    /**
+     * document got saved, keep the index up-to-date
+     * @param document saved document
+     */
+    void slotDocumentSaved(KTextEditor::Document *document);
+
     /**
      * did some project file change?
      * @param file name of file that did change
      */
     void slotFileChanged(const QString &file);
 
+    /**
+     * Watch the directories of the project tree, if enabled in the plugin configuration.
+     * Called after each load and on configuration changes.
+     */
+    void updateDirectoryWatch();
+
+    /**
+     * Reload the files of the project after some watched directory changed.
+     * The index is kept, the model is updated incrementally.
+     */
+    void refreshFiles();
+
 Q_SIGNALS:
     /**
      * Emitted on project map changes.
@@ -275,6 +295,7 @@ Q_SIGNALS:
     void indexChanged();
 
 private:
+    void initDirectoryWatch();
     void registerUntrackedDocument(KTextEditor::Document *document);
     void unregisterUntrackedItem(const KateProjectItem *item);
     QVariantMap readProjectFile() const;
@@ -355,6 +376,16 @@ private:
      * project configuration (read from file or injected)
      */
     QVariantMap m_globalProject;
+
+    /**
+     * watcher for the directories of the project tree, only used if enabled
+     */
+    QFileSystemWatcher m_directoryWatcher;
+
+    /**
+     * compress directory changes, e.g. a checkout touches a lot of them
+     */
+    QTimer m_refreshFilesTimer;
 };
 
 #endif
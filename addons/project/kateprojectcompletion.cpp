@@ -13,6 +13,12 @@
 #include <KLocalizedString>
 
 #include <QIcon>
+#include <QSet>
+
+/**
+ * more matches are of no use in a completion popup
+ */
+static const int MaxCompletionMatches = 1000;
 
 KateProjectCompletion::KateProjectCompletion(KateProjectPlugin *plugin)
     : KTextEditor::CodeCompletionModel(nullptr)
@@ -47,7 +53,7 @@ QVariant KateProjectCompletion::data(const QModelIndex &index, int role) const
     }
 
     if (index.column() == KTextEditor::CodeCompletionModel::Name && role == Qt::DisplayRole) {
-        return m_matches.item(index.row())->data(Qt::DisplayRole);
+        return m_matches.at(index.row());
     }
 
     if (index.column() == KTextEditor::CodeCompletionModel::Icon && role == Qt::DecorationRole) {
@@ -80,7 +86,7 @@ QModelIndex KateProjectCompletion::index(int row, int column, const QModelIndex
         return QModelIndex();
     }
 
-    if (row < 0 || row >= m_matches.rowCount() || column < 0 || column >= ColumnCount) {
+    if (row < 0 || row >= m_matches.size() || column < 0 || column >= ColumnCount) {
         return QModelIndex();
     }
 
@@ -89,12 +95,12 @@ QModelIndex KateProjectCompletion::index(int row, int column, const QModelIndex
 
 int KateProjectCompletion::rowCount(const QModelIndex &parent) const
 {
-    if (!parent.isValid() && !(m_matches.rowCount() == 0)) {
+    if (!parent.isValid() && !(m_matches.size() == 0)) {
         return 1; // One root node to define the custom group
     } else if (parent.parent().isValid()) {
         return 0; // Completion-items have no children
     } else {
-        return m_matches.rowCount();
+        return m_matches.size();
     }
 }
 
@@ -165,7 +171,7 @@ void KateProjectCompletion::completionInvoked(KTextEditor::View *view, const KTe
 
 // Scan throughout the entire document for possible completions,
 // ignoring any dublets
-void KateProjectCompletion::allMatches(QStandardItemModel &model, KTextEditor::View *view, const KTextEditor::Range &range) const
+void KateProjectCompletion::allMatches(QStringList &matches, KTextEditor::View *view, const KTextEditor::Range &range) const
 {
     /**
      * get project scope for this document, else fail
@@ -181,12 +187,43 @@ void KateProjectCompletion::allMatches(QStandardItemModel &model, KTextEditor::V
     }
 
     /**
-     * let project index fill the completion for this document
+     * query the symbol tables of the project indices
+     * prefix matches first, the fuzzy ones fill up the remaining slots
      */
+    const QString word = view->document()->text(range);
+    if (word.isEmpty()) {
+        return;
+    }
+    QVector<QSharedPointer<const KateProjectSymbolIndex>> symbolIndices;
     for (const auto project : qAsConst(projects)) {
         if (project->projectIndex()) {
-            project->projectIndex()->findMatches(model, view->document()->text(range), KateProjectIndex::CompletionMatches);
+            if (auto symbols = project->projectIndex()->symbols()) {
+                symbolIndices.push_back(symbols);
+            }
+        }
+    }
+
+    QSet<QString> guard;
+    const auto addUnique = [&matches, &guard](const QStringList &found) {
+        for (const auto &match : found) {
+            if (matches.size() >= MaxCompletionMatches) {
+                return;
+            }
+            if (!guard.contains(match)) {
+                guard.insert(match);
+                matches.push_back(match);
+            }
         }
+    };
+    for (const auto &symbols : qAsConst(symbolIndices)) {
+        QStringList found;
+        symbols->prefixMatches(word, MaxCompletionMatches, found);
+        addUnique(found);
+    }
+    for (const auto &symbols : qAsConst(symbolIndices)) {
+        QStringList found;
+        symbols->fuzzyMatches(word, MaxCompletionMatches - matches.size(), found);
+        addUnique(found);
     }
 }
 
@@ -13,7 +13,7 @@
 #include <ktexteditor/codecompletionmodelcontrollerinterface.h>
 #include <ktexteditor/view.h>
 
-#include <QStandardItemModel>
+#include <QStringList>
 
 /**
  * Project wide completion support.
@@ -62,7 +62,13 @@ public:
 
     KTextEditor::Range completionRange(KTextEditor::View *view, const KTextEditor::Cursor &position) override;
 
-    void allMatches(QStandardItemModel &model, KTextEditor::View *view, const KTextEditor::Range &range) const;
+    /**
+     * Collect the completions for the word in the given range from the symbol tables of the projects.
+     * @param matches filled with the unique matches, prefix matches first, then the best fuzzy ones
+     * @param view view to complete in
+     * @param range range of the word to complete
+     */
+    void allMatches(QStringList &matches, KTextEditor::View *view, const KTextEditor::Range &range) const;
 
 private:
     /**
@@ -71,9 +77,9 @@ private:
     KateProjectPlugin *m_plugin;
 
     /**
-     * model with matching data
+     * matching symbols
      */
-    QStandardItemModel m_matches;
+    QStringList m_matches;
 
     /**
      * automatic invocation?
@@ -47,6 +47,9 @@ KateProjectConfigPage::KateProjectConfigPage(QWidget *parent, KateProjectPlugin
     group->setWhatsThis(i18n("Session settings for projects"));
     m_cbSessionRestoreOpenProjects = new QCheckBox(i18n("Restore Open Projects"), this);
     vbox->addWidget(m_cbSessionRestoreOpenProjects);
+    m_cbWatchProjectDirectories = new QCheckBox(i18n("Update project tree on file system changes"), this);
+    m_cbWatchProjectDirectories->setToolTip(i18n("Watches all project directories, this might exceed the system limits for very large repositories"));
+    vbox->addWidget(m_cbWatchProjectDirectories);
     vbox->addStretch(1);
     group->setLayout(vbox);
     layout->addWidget(group);
@@ -117,6 +120,7 @@ KateProjectConfigPage::KateProjectConfigPage(QWidget *parent, KateProjectPlugin
     connect(m_cbAutoMercurial, &QCheckBox::stateChanged, this, &KateProjectConfigPage::slotMyChanged);
     connect(m_cbAutoFossil, &QCheckBox::stateChanged, this, &KateProjectConfigPage::slotMyChanged);
     connect(m_cbSessionRestoreOpenProjects, &QCheckBox::stateChanged, this, &KateProjectConfigPage::slotMyChanged);
+    connect(m_cbWatchProjectDirectories, &QCheckBox::stateChanged, this, &KateProjectConfigPage::slotMyChanged);
     connect(m_cbIndexEnabled, &QCheckBox::stateChanged, this, &KateProjectConfigPage::slotMyChanged);
     connect(m_indexPath, &KUrlRequester::textChanged, this, &KateProjectConfigPage::slotMyChanged);
     connect(m_indexPath, &KUrlRequester::urlSelected, this, &KateProjectConfigPage::slotMyChanged);
@@ -165,6 +169,7 @@ void KateProjectConfigPage::apply()
     m_plugin->setDoubleClickAction((ClickAction)m_cmbDoubleClick->currentIndex());
 
     m_plugin->setRestoreProjectsForSession(m_cbSessionRestoreOpenProjects->isChecked());
+    m_plugin->setWatchProjectDirectories(m_cbWatchProjectDirectories->isChecked());
 }
 
 void KateProjectConfigPage::reset()
@@ -183,6 +188,7 @@ void KateProjectConfigPage::reset()
     m_cmbDoubleClick->setCurrentIndex((int)m_plugin->doubleClickAcion());
 
     m_cbSessionRestoreOpenProjects->setCheckState(m_plugin->restoreProjectsForSession() ? Qt::Checked : Qt::Unchecked);
+    m_cbWatchProjectDirectories->setCheckState(m_plugin->watchProjectDirectories() ? Qt::Checked : Qt::Unchecked);
 
     m_changed = false;
 }
@@ -39,6 +39,7 @@ private:
     void setupGitConfigUI();
 
     QCheckBox *m_cbSessionRestoreOpenProjects;
+    QCheckBox *m_cbWatchProjectDirectories;
     QCheckBox *m_cbAutoGit;
     QCheckBox *m_cbAutoSubversion;
     QCheckBox *m_cbAutoMercurial;
@@ -7,15 +7,84 @@
 
 #include "kateprojectindex.h"
 
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
+#include <QFileInfo>
 #include <QProcess>
+#include <QSaveFile>
 #include <QStandardPaths>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <string_view>
 
 /**
  * include ctags reading
  */
 #include "ctags/readtags.c"
 
+/**
+ * persistent per-file ctags cache format, bump version on changes
+ */
+static const quint32 CtagsCacheMagic = 0x4b435447;
+static const quint32 CtagsCacheVersion = 1;
+
+/**
+ * files passed to one ctags process, chunks are indexed in parallel
+ */
+static const int CtagsChunkSize = 1000;
+
+/**
+ * header of the tags files we write, the lines are sorted byte-wise
+ */
+static const char CtagsHeader[] =
+    "!_TAG_FILE_FORMAT\t2\t/extended format; --format=1 will not append ;\" to lines/\n"
+    "!_TAG_FILE_SORTED\t1\t/0=unsorted, 1=sorted, 2=foldcase/\n";
+
+/**
+ * File name for some persistent data of the project index.
+ * One file per project in the index directory, named by the hash of the base directory.
+ */
+static QString indexFileName(const QString &baseDir, const QString &indexDir, const QString &suffix)
+{
+    const QString projectHash = QString::fromLatin1(QCryptographicHash::hash(baseDir.toUtf8(), QCryptographicHash::Sha1).toHex().left(16));
+    return QDir(indexDir.isEmpty() ? QDir::tempPath() : indexDir).filePath(QStringLiteral("kate.project.%1.%2").arg(projectHash, suffix));
+}
+
+/**
+ * Get the file field of a tag line: name TAB file TAB address...
+ */
+static std::string_view tagFileField(std::string_view line)
+{
+    const auto start = line.find('\t');
+    if (start == std::string_view::npos) {
+        return {};
+    }
+    const auto end = line.find('\t', start + 1);
+    return line.substr(start + 1, (end == std::string_view::npos) ? std::string_view::npos : end - start - 1);
+}
+
+/**
+ * Split tags into lines, the views point into the given data.
+ */
+static void appendTagLines(const QByteArray &tags, std::vector<std::string_view> &lines)
+{
+    std::string_view data(tags.constData(), tags.size());
+    while (!data.empty()) {
+        const auto end = data.find('\n');
+        const auto line = data.substr(0, end);
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+        if (end == std::string_view::npos) {
+            break;
+        }
+        data.remove_prefix(end + 1);
+    }
+}
+
 KateProjectIndex::KateProjectIndex(const QString &baseDir, const QString &indexDir, const QStringList &files, const QVariantMap &ctagsMap, bool force)
     : m_ctagsIndexHandle(nullptr)
 {
@@ -34,9 +103,14 @@ KateProjectIndex::KateProjectIndex(const QString &baseDir, const QString &indexD
     }
 
     /**
-     * load ctags
+     * load ctags, re-uses the persistent per-file tags
      */
-    loadCtags(files, ctagsMap, force);
+    loadCtags(files, ctagsMap, force, indexFileName(baseDir, indexDir, QStringLiteral("ctags")));
+
+    /**
+     * load trigrams for searching
+     */
+    loadTrigrams(baseDir, indexDir, files);
 }
 
 KateProjectIndex::~KateProjectIndex()
@@ -50,14 +124,25 @@ KateProjectIndex::~KateProjectIndex()
     }
 }
 
-void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force)
+void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force, const QString &cacheFileName)
 {
+    const QString keyOptions = QStringLiteral("options");
+    const auto opts = ctagsMap[keyOptions].toList();
+    for (const QVariant &optVariant : opts) {
+        m_ctagsOptions << optVariant.toString();
+    }
+
     /**
      * only overwrite existing index upon reload
+     * an index file not written by us (no cache for it) is used as is
      * (a temporary index file will never exist)
      */
-    if (m_ctagsIndexFile->exists() && !force) {
-        openCtags();
+    if (m_ctagsIndexFile->exists() && !force && !QFile::exists(cacheFileName)) {
+        {
+            QMutexLocker locker(&m_ctagsMutex);
+            openCtags();
+        }
+        loadSymbols();
         return;
     }
 
@@ -70,7 +155,7 @@ void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ct
     }
 
     /**
-     * close file again, other process will use it
+     * close file again, we write it later
      */
     m_ctagsIndexFile->close();
 
@@ -81,20 +166,138 @@ void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ct
     }
 
     /**
-     * try to run ctags for all files in this project
-     * output to our ctags index file
+     * read the per-file tags of the last run, if any
+     * it is just a cache, on any error or other options we start from scratch
+     */
+    QHash<QString, CtagsEntry> cached;
+    QFile cacheFile(cacheFileName);
+    if (cacheFile.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&cacheFile);
+        quint32 magic = 0;
+        quint32 version = 0;
+        QStringList options;
+        quint32 count = 0;
+        stream >> magic >> version >> options >> count;
+        if (magic == CtagsCacheMagic && version == CtagsCacheVersion && options == m_ctagsOptions) {
+            for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+                QString fileName;
+                CtagsEntry entry;
+                stream >> fileName >> entry.lastModified >> entry.size >> entry.tags;
+                cached[fileName] = entry;
+            }
+        }
+        if (stream.status() != QDataStream::Ok) {
+            cached.clear();
+        }
+        cacheFile.close();
+    }
+
+    /**
+     * re-use cached tags of unchanged files, stat them in parallel
+     */
+    std::vector<std::pair<QString, CtagsEntry>> entries(files.size());
+    for (int i = 0; i < files.size(); ++i) {
+        entries[i].first = files[i];
+    }
+    QtConcurrent::blockingMap(entries, [&cached](std::pair<QString, CtagsEntry> &item) {
+        auto &[fileName, entry] = item;
+        const QFileInfo info(fileName);
+        entry.lastModified = info.lastModified().toMSecsSinceEpoch();
+        entry.size = info.size();
+        const auto it = cached.constFind(fileName);
+        if (it != cached.cend() && it->lastModified == entry.lastModified && it->size == entry.size) {
+            entry.tags = it->tags;
+        } else {
+            // mark as to be indexed
+            entry.size = -1;
+        }
+    });
+    cached.clear();
+
+    /**
+     * run ctags for all changed files, in chunks in parallel
+     * files that failed keep an invalid stamp, they are retried next time
+     */
+    QStringList changedFiles;
+    for (const auto &[fileName, entry] : entries) {
+        if (entry.size == -1) {
+            changedFiles.push_back(fileName);
+        }
+    }
+    if (!changedFiles.isEmpty()) {
+        QVector<QStringList> chunks;
+        for (int i = 0; i < changedFiles.size(); i += CtagsChunkSize) {
+            chunks.push_back(changedFiles.mid(i, CtagsChunkSize));
+        }
+        const auto options = m_ctagsOptions;
+        const auto results = QtConcurrent::blockingMapped<QVector<std::pair<bool, QHash<QString, QByteArray>>>>(chunks, [options](const QStringList &chunk) {
+            std::pair<bool, QHash<QString, QByteArray>> result;
+            result.first = runCtags(chunk, options, result.second);
+            return result;
+        });
+
+        QSet<QString> succeeded;
+        QHash<QString, QByteArray> tags;
+        for (int i = 0; i < results.size(); ++i) {
+            if (!results[i].first) {
+                continue;
+            }
+            for (const auto &file : chunks[i]) {
+                succeeded.insert(file);
+            }
+            tags.insert(results[i].second);
+        }
+        QtConcurrent::blockingMap(entries, [&succeeded, &tags](std::pair<QString, CtagsEntry> &item) {
+            auto &[fileName, entry] = item;
+            if (entry.size != -1 || !succeeded.contains(fileName)) {
+                return;
+            }
+            const QFileInfo info(fileName);
+            entry.lastModified = info.lastModified().toMSecsSinceEpoch();
+            entry.size = info.size();
+            entry.tags = tags.value(fileName);
+        });
+    }
+
+    /**
+     * write updated cache back, atomically
+     */
+    QSaveFile saveFile(cacheFileName);
+    if (saveFile.open(QIODevice::WriteOnly)) {
+        QDataStream stream(&saveFile);
+        stream << CtagsCacheMagic << CtagsCacheVersion << m_ctagsOptions << quint32(entries.size());
+        for (const auto &[fileName, entry] : entries) {
+            stream << fileName << entry.lastModified << entry.size << entry.tags;
+        }
+        saveFile.commit();
+    }
+
+    /**
+     * merge all into the sorted tags file, only the file names are kept in memory
+     */
+    writeCtags(entries);
+    m_ctagsFiles.reserve(files.size());
+    for (const auto &file : files) {
+        m_ctagsFiles.insert(file);
+    }
+}
+
+bool KateProjectIndex::runCtags(const QStringList &files, const QStringList &options, QHash<QString, QByteArray> &tags)
+{
+    static const auto fullExecutablePath = QStandardPaths::findExecutable(QStringLiteral("ctags"));
+    if (fullExecutablePath.isEmpty()) {
+        return false;
+    }
+
+    /**
+     * try to run ctags for the files, output to stdout
      */
     QProcess ctags;
     QStringList args;
-    args << QStringLiteral("-L") << QStringLiteral("-") << QStringLiteral("-f") << m_ctagsIndexFile->fileName() << QStringLiteral("--fields=+K+n");
-    const QString keyOptions = QStringLiteral("options");
-    const auto opts = ctagsMap[keyOptions].toList();
-    for (const QVariant &optVariant : opts) {
-        args << optVariant.toString();
-    }
+    args << QStringLiteral("-L") << QStringLiteral("-") << QStringLiteral("-f") << QStringLiteral("-") << QStringLiteral("--fields=+K+n") << options;
     ctags.start(fullExecutablePath, args);
     if (!ctags.waitForStarted()) {
-        return;
+        return false;
     }
 
     /**
@@ -106,36 +309,141 @@ void KateProjectIndex::loadCtags(const QStringList &files, const QVariantMap &ct
     /**
      * wait for done
      */
-    if (!ctags.waitForFinished(-1)) {
+    if (!ctags.waitForFinished(-1) || ctags.exitStatus() != QProcess::NormalExit) {
+        return false;
+    }
+
+    /**
+     * split the output per file, skip pseudo tags
+     */
+    const QByteArray output = ctags.readAllStandardOutput();
+    std::vector<std::string_view> lines;
+    appendTagLines(output, lines);
+    for (const auto &line : lines) {
+        if (line.substr(0, 2) == "!_") {
+            continue;
+        }
+        const auto file = tagFileField(line);
+        QByteArray &fileTags = tags[QString::fromLocal8Bit(file.data(), file.size())];
+        fileTags.append(line.data(), line.size());
+        fileTags.append('\n');
+    }
+    return true;
+}
+
+void KateProjectIndex::writeCtags(const std::vector<std::pair<QString, CtagsEntry>> &entries)
+{
+    std::vector<std::string_view> lines;
+    for (const auto &[fileName, entry] : entries) {
+        appendTagLines(entry.tags, lines);
+    }
+    std::sort(lines.begin(), lines.end());
+
+    QSaveFile file(m_ctagsIndexFile->fileName());
+    if (!file.open(QIODevice::WriteOnly)) {
         return;
     }
+    file.write(CtagsHeader);
+    for (const auto &line : lines) {
+        file.write(line.data(), line.size());
+        file.write("\n", 1);
+    }
 
-    openCtags();
+    replaceCtags(file);
 }
 
-void KateProjectIndex::openCtags()
+void KateProjectIndex::updateCtags(const QString &fileName)
 {
-    /**
-     * file not openable, bad
-     */
-    if (!m_ctagsIndexFile->open(QIODevice::ReadOnly)) {
+    // only care for indexed project files
+    if (!m_ctagsFiles.contains(fileName)) {
         return;
     }
 
-    /**
-     * get size
-     */
-    qint64 size = m_ctagsIndexFile->size();
+    QMutexLocker updateLocker(&m_ctagsUpdateMutex);
+    QHash<QString, QByteArray> tags;
+    if (!runCtags({fileName}, m_ctagsOptions, tags)) {
+        return;
+    }
+    const QByteArray fileTags = tags.value(fileName);
+    std::vector<std::string_view> newLines;
+    appendTagLines(fileTags, newLines);
+    std::sort(newLines.begin(), newLines.end());
 
     /**
-     * close again
+     * merge the new tags into the sorted tags file, dropping the old ones of this file
+     * the current file stays usable until the new one replaces it
      */
-    m_ctagsIndexFile->close();
+    const QString indexFileName = m_ctagsIndexFile->fileName();
+    QFile in(indexFileName);
+    if (!in.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QSaveFile out(indexFileName);
+    if (!out.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    const QByteArray localFileName = fileName.toLocal8Bit();
+    const std::string_view file(localFileName.constData(), localFileName.size());
+    auto newLine = newLines.cbegin();
+    const auto writeLine = [&out](std::string_view line) {
+        out.write(line.data(), line.size());
+        out.write("\n", 1);
+    };
+    while (!in.atEnd()) {
+        const QByteArray data = in.readLine();
+        std::string_view line(data.constData(), data.size());
+        if (!line.empty() && line.back() == '\n') {
+            line = line.substr(0, line.size() - 1);
+        }
+        if (line.substr(0, 2) == "!_") {
+            writeLine(line);
+            continue;
+        }
+        if (line.empty() || tagFileField(line) == file) {
+            continue;
+        }
+        for (; newLine != newLines.cend() && *newLine < line; ++newLine) {
+            writeLine(*newLine);
+        }
+        writeLine(line);
+    }
+    for (; newLine != newLines.cend(); ++newLine) {
+        writeLine(*newLine);
+    }
+    in.close();
+
+    replaceCtags(out);
+}
 
+void KateProjectIndex::replaceCtags(QSaveFile &file)
+{
+    {
+        QMutexLocker locker(&m_ctagsMutex);
+        if (m_ctagsIndexHandle) {
+            tagsClose(m_ctagsIndexHandle);
+            m_ctagsIndexHandle = nullptr;
+        }
+        file.commit();
+        openCtags();
+    }
+    loadSymbols();
+}
+
+void KateProjectIndex::loadSymbols()
+{
+    // read outside of the lock, completion stays usable meanwhile
+    QSharedPointer<const KateProjectSymbolIndex> symbols(new KateProjectSymbolIndex(m_ctagsIndexFile->fileName()));
+    QMutexLocker locker(&m_ctagsMutex);
+    m_symbols = symbols;
+}
+
+void KateProjectIndex::openCtags()
+{
     /**
-     * empty file, bad
+     * empty or not existing file, bad
      */
-    if (!size) {
+    const QString fileName = m_ctagsIndexFile->fileName();
+    if (QFileInfo(fileName).size() <= 0) {
         return;
     }
 
@@ -152,14 +460,24 @@ void KateProjectIndex::openCtags()
      */
     tagFileInfo info;
     memset(&info, 0, sizeof(tagFileInfo));
-    m_ctagsIndexHandle = tagsOpen(m_ctagsIndexFile->fileName().toLocal8Bit().constData(), &info);
+    m_ctagsIndexHandle = tagsOpen(fileName.toLocal8Bit().constData(), &info);
+}
+
+void KateProjectIndex::loadTrigrams(const QString &baseDir, const QString &indexDir, const QStringList &files)
+{
+    /**
+     * unlike the ctags file, this index shall survive the session
+     */
+    m_trigramIndex.load(indexFileName(baseDir, indexDir, QStringLiteral("trigrams")), files);
 }
 
 void KateProjectIndex::findMatches(QStandardItemModel &model, const QString &searchWord, MatchType type, int options)
 {
     /**
      * abort if no ctags index
+     * the tags file might be updated in the background
      */
+    QMutexLocker locker(&m_ctagsMutex);
     if (!m_ctagsIndexHandle) {
         return;
     }
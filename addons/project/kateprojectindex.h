@@ -11,10 +11,20 @@
 #include <ktexteditor/document.h>
 #include <ktexteditor/view.h>
 
+#include <QMutex>
+#include <QSaveFile>
+#include <QSet>
+#include <QSharedPointer>
 #include <QStandardItemModel>
 #include <QStringList>
 #include <QTemporaryFile>
 
+#include <utility>
+#include <vector>
+
+#include "kateprojectsymbolindex.h"
+#include "kateprojecttrigramindex.h"
+
 /**
  * ctags reading
  */
@@ -75,22 +85,107 @@ public:
      */
     bool isValid() const
     {
+        QMutexLocker locker(&m_ctagsMutex);
         return m_ctagsIndexHandle;
     }
 
+    /**
+     * Symbol names of the ctags index, for fast code completion.
+     * The table is replaced on tags updates, hold the returned pointer while using it.
+     * @return symbol table, null if no tags loaded
+     */
+    QSharedPointer<const KateProjectSymbolIndex> symbols() const
+    {
+        QMutexLocker locker(&m_ctagsMutex);
+        return m_symbols;
+    }
+
+    /**
+     * Trigram index of the project files content.
+     * Used to reduce the files to look at for a project wide search.
+     * @return trigram index, empty if not yet loaded
+     */
+    const KateProjectTrigramIndex &trigramIndex() const
+    {
+        return m_trigramIndex;
+    }
+
+    /**
+     * Update the index for a changed file, e.g. after it got saved.
+     * @param fileName changed file
+     */
+    void updateFile(const QString &fileName)
+    {
+        m_trigramIndex.updateFile(fileName);
+    }
+
+    /**
+     * Re-run ctags for a changed file and merge its tags into the tags file.
+     * Expensive, shall be called in a background thread, the index stays usable meanwhile.
+     * Files not known to the ctags index are ignored.
+     * @param fileName changed file
+     */
+    void updateCtags(const QString &fileName);
+
 private:
     /**
      * Load ctags tags.
+     * Only files changed since the last load are passed to ctags, the tags of the others are
+     * taken from the persistent per-file cache.
      * @param files files to index
      * @param ctagsMap ctags section for extra options
+     * @param cacheFileName file to store the per-file tags in
      */
-    void loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force);
+    void loadCtags(const QStringList &files, const QVariantMap &ctagsMap, bool force, const QString &cacheFileName);
 
     /**
-     * Open ctags tags.
+     * Open ctags tags, m_ctagsMutex must be locked.
      */
     void openCtags();
 
+    /**
+     * Replace the tags file with the written one and re-open it.
+     * @param file new tags file, will be committed
+     */
+    void replaceCtags(QSaveFile &file);
+
+    /**
+     * Load the symbol table from the current tags file.
+     */
+    void loadSymbols();
+
+    /**
+     * tags of one file, as cached between loads
+     */
+    struct CtagsEntry {
+        qint64 lastModified = 0;
+        qint64 size = -1;
+        QByteArray tags;
+    };
+
+    /**
+     * Run ctags for the given files.
+     * @param files files to index
+     * @param options extra ctags options
+     * @param tags filled with the tag lines per file, only files with tags get an entry
+     * @return success? on errors, the tags are incomplete
+     */
+    static bool runCtags(const QStringList &files, const QStringList &options, QHash<QString, QByteArray> &tags);
+
+    /**
+     * Write the sorted tags file from the tags of all files and open it.
+     * @param entries tags per file
+     */
+    void writeCtags(const std::vector<std::pair<QString, CtagsEntry>> &entries);
+
+    /**
+     * Load trigram index, re-uses the persistent index for this project, if any.
+     * @param baseDir project base directory
+     * @param indexDir directory to store the index in
+     * @param files files to index
+     */
+    void loadTrigrams(const QString &baseDir, const QString &indexDir, const QStringList &files);
+
 private:
     /**
      * ctags index file
@@ -101,6 +196,36 @@ private:
      * handle to ctags file for querying, if possible
      */
     tagFile *m_ctagsIndexHandle;
+
+    /**
+     * guards the ctags handle, the tags file is updated in the background
+     */
+    mutable QMutex m_ctagsMutex;
+
+    /**
+     * serializes tags file updates
+     */
+    QMutex m_ctagsUpdateMutex;
+
+    /**
+     * extra ctags options of the project
+     */
+    QStringList m_ctagsOptions;
+
+    /**
+     * files in the ctags index, only these are updated
+     */
+    QSet<QString> m_ctagsFiles;
+
+    /**
+     * symbol names of the current tags file, guarded by m_ctagsMutex
+     */
+    QSharedPointer<const KateProjectSymbolIndex> m_symbols;
+
+    /**
+     * trigram index for the file contents
+     */
+    KateProjectTrigramIndex m_trigramIndex;
 };
 
 #endif
@@ -522,6 +522,17 @@ bool KateProjectPlugin::restoreProjectsForSession() const
     return m_restoreProjectsForSession;
 }
 
+void KateProjectPlugin::setWatchProjectDirectories(bool enabled)
+{
+    m_watchProjectDirectories = enabled;
+    writeConfig();
+}
+
+bool KateProjectPlugin::watchProjectDirectories() const
+{
+    return m_watchProjectDirectories;
+}
+
 void KateProjectPlugin::readConfig()
 {
     KConfigGroup config(KSharedConfig::openConfig(), "project");
@@ -544,6 +555,8 @@ void KateProjectPlugin::readConfig()
 
     m_restoreProjectsForSession = config.readEntry("restoreProjectsForSession", true);
 
+    m_watchProjectDirectories = config.readEntry("watchProjectDirectories", false);
+
     Q_EMIT configUpdated();
 }
 
@@ -582,6 +595,8 @@ void KateProjectPlugin::writeConfig()
 
     config.writeEntry("restoreProjectsForSession", m_restoreProjectsForSession);
 
+    config.writeEntry("watchProjectDirectories", m_watchProjectDirectories);
+
     Q_EMIT configUpdated();
 }
 
@@ -142,6 +142,9 @@ public:
     void setRestoreProjectsForSession(bool enabled);
     bool restoreProjectsForSession() const;
 
+    void setWatchProjectDirectories(bool enabled);
+    bool watchProjectDirectories() const;
+
     /**
      * filesystem watcher to keep track of all project files
      * and auto-reload
@@ -259,6 +262,9 @@ private:
     // restore projects on session loading?
     bool m_restoreProjectsForSession = true;
 
+    // keep the project trees up-to-date with the file system, costs inotify watches, default off
+    bool m_watchProjectDirectories = false;
+
     // indexing is expensive, default off
     bool m_indexEnabled = false;
     QUrl m_indexDirectory;
@@ -128,7 +128,8 @@ KateProjectPluginView::KateProjectPluginView(KateProjectPlugin *plugin, KTextEdi
     });
 
     connect(&m_gitChangedWatcher, &QFileSystemWatcher::fileChanged, this, [this] {
-        slotUpdateStatus(true);
+        // one git command touches several files and our own commands already update, only update if HEAD or the index changed since
+        updateGitStatus(false);
     });
 
     /**
@@ -421,6 +422,20 @@ QStringList KateProjectPluginView::allProjectsFiles() const
     return fileList;
 }
 
+QStringList KateProjectPluginView::filterFilesByContent(const QStringList &files, const QStringList &literals) const
+{
+    QStringList filteredFiles = files;
+
+    const auto projectList = m_plugin->projects();
+    for (auto project : projectList) {
+        if (const auto index = project->projectIndex()) {
+            filteredFiles = index->trigramIndex().filterFiles(filteredFiles, literals);
+        }
+    }
+
+    return filteredFiles;
+}
+
 QMap<QString, QString> KateProjectPluginView::allProjects() const
 {
     QMap<QString, QString> projectMap;
@@ -787,11 +802,17 @@ void KateProjectPluginView::slotUpdateStatus(bool visible)
         return;
     }
 
+    updateGitStatus(true);
+}
+
+void KateProjectPluginView::updateGitStatus(bool force)
+{
     if (auto widget = static_cast<GitWidget *>(m_stackedGitViews->currentWidget())) {
         // To support separate-git-dir always use dotGitPath
-        // We need to add the path every time again because it's always a different file
+        // We need to add the paths every time again because they are always different files
         m_gitChangedWatcher.addPath(widget->dotGitPath() + QStringLiteral(".git/index"));
-        widget->updateStatus();
+        m_gitChangedWatcher.addPath(widget->dotGitPath() + QStringLiteral(".git/HEAD"));
+        widget->updateStatus(force);
     }
 }
 
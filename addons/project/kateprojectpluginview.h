@@ -143,6 +143,16 @@ public:
      */
     Q_INVOKABLE QString projectBaseDirForUrl(const QUrl &url);
 
+    /**
+     * Filter files down to the ones that might contain all given literals.
+     * Uses the trigram indices of the open projects, files not in any index are kept.
+     * Used for the Search&Replace plugin to avoid reading all project files.
+     * @param files files to filter
+     * @param literals literal strings each match must contain
+     * @return files that need to be searched
+     */
+    Q_INVOKABLE QStringList filterFilesByContent(const QStringList &files, const QStringList &literals) const;
+
 public Q_SLOTS:
     /**
      * Create views for given project.
@@ -339,9 +349,15 @@ private:
      */
     QString currentWord() const;
 
+    /**
+     * Watch the git index and HEAD of the current project and update its git status
+     * @param force update even if the index and HEAD didn't change
+     */
+    void updateGitStatus(bool force);
+
 private:
     /**
-     * Watches for changes to .git/indiex
+     * Watches for changes to .git/index and .git/HEAD
      */
     QFileSystemWatcher m_gitChangedWatcher;
 
@@ -0,0 +1,157 @@
+/*  This file is part of the Kate project.
+ *
+ *  SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "kateprojectsymbolindex.h"
+
+#include <kfts_fuzzy_match.h>
+
+#include <QFile>
+#include <QMutex>
+#include <QSet>
+
+#include <algorithm>
+#include <numeric>
+
+/**
+ * process wide pool of symbol names, shared by the symbol indices of all projects
+ */
+struct SymbolPool {
+    QMutex mutex;
+    QSet<QString> names;
+};
+
+static SymbolPool &symbolPool()
+{
+    static SymbolPool pool;
+    return pool;
+}
+
+KateProjectSymbolIndex::KateProjectSymbolIndex(const QString &tagsFileName)
+{
+    QFile file(tagsFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    /**
+     * the name is the first field of each line
+     * the tags file is sorted, all tags with the same name are grouped
+     */
+    std::vector<QString> names;
+    QByteArray lastName;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (line.startsWith("!_")) {
+            continue;
+        }
+        const int tab = line.indexOf('\t');
+        if (tab <= 0 || (tab == lastName.size() && line.startsWith(lastName))) {
+            continue;
+        }
+        lastName = line.left(tab);
+        names.push_back(QString::fromLocal8Bit(lastName));
+    }
+
+    /**
+     * the byte order of the tags file might differ from the QString one
+     */
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    /**
+     * share the names with the other projects
+     */
+    {
+        auto &pool = symbolPool();
+        QMutexLocker locker(&pool.mutex);
+        for (auto &name : names) {
+            const auto it = pool.names.constFind(name);
+            if (it != pool.names.cend()) {
+                name = *it;
+            } else {
+                pool.names.insert(name);
+            }
+        }
+    }
+    m_names = std::move(names);
+
+    /**
+     * fuzzy matching needs the names grouped by case-folded first character
+     */
+    m_byFoldedFirstChar.resize(m_names.size());
+    std::iota(m_byFoldedFirstChar.begin(), m_byFoldedFirstChar.end(), 0);
+    std::stable_sort(m_byFoldedFirstChar.begin(), m_byFoldedFirstChar.end(), [this](quint32 l, quint32 r) {
+        return m_names[l].at(0).toCaseFolded() < m_names[r].at(0).toCaseFolded();
+    });
+}
+
+KateProjectSymbolIndex::~KateProjectSymbolIndex()
+{
+    /**
+     * drop all names only the pool still references
+     */
+    m_names.clear();
+    auto &pool = symbolPool();
+    QMutexLocker locker(&pool.mutex);
+    for (auto it = pool.names.begin(); it != pool.names.end();) {
+        if (it->isDetached()) {
+            it = pool.names.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void KateProjectSymbolIndex::prefixMatches(const QString &prefix, int maxMatches, QStringList &matches) const
+{
+    int found = 0;
+    for (auto it = std::lower_bound(m_names.cbegin(), m_names.cend(), prefix); it != m_names.cend() && found < maxMatches; ++it, ++found) {
+        if (!it->startsWith(prefix)) {
+            break;
+        }
+        matches.push_back(*it);
+    }
+}
+
+void KateProjectSymbolIndex::fuzzyMatches(const QString &pattern, int maxMatches, QStringList &matches) const
+{
+    if (pattern.isEmpty() || maxMatches <= 0) {
+        return;
+    }
+
+    /**
+     * only look at the names with the right first character
+     */
+    const QChar first = pattern.at(0).toCaseFolded();
+    const auto firstChar = [this](quint32 index) {
+        return m_names[index].at(0).toCaseFolded();
+    };
+    const auto begin = std::lower_bound(m_byFoldedFirstChar.cbegin(), m_byFoldedFirstChar.cend(), first, [&firstChar](quint32 index, QChar c) {
+        return firstChar(index) < c;
+    });
+    const auto end = std::upper_bound(begin, m_byFoldedFirstChar.cend(), first, [&firstChar](QChar c, quint32 index) {
+        return c < firstChar(index);
+    });
+
+    /**
+     * score all candidates, keep the best ones
+     */
+    std::vector<std::pair<int, quint32>> scored;
+    for (auto it = begin; it != end; ++it) {
+        int score = 0;
+        if (kfts::fuzzy_match(pattern, m_names[*it], score)) {
+            scored.emplace_back(score, *it);
+        }
+    }
+    const auto last = scored.begin() + std::min<size_t>(maxMatches, scored.size());
+    std::partial_sort(scored.begin(), last, scored.end(), [](const auto &l, const auto &r) {
+        return l.first > r.first || (l.first == r.first && l.second < r.second);
+    });
+    for (auto it = scored.begin(); it != last; ++it) {
+        matches.push_back(m_names[it->second]);
+    }
+}
@@ -0,0 +1,79 @@
+/*  This file is part of the Kate project.
+ *
+ *  SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef KATE_PROJECT_SYMBOL_INDEX_H
+#define KATE_PROJECT_SYMBOL_INDEX_H
+
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+/**
+ * In-memory table of the symbol names of a ctags index.
+ * Used for code completion, queries don't touch the tags file.
+ *
+ * The names are interned process wide, projects sharing symbols, e.g. from common
+ * headers or multiple checkouts, share their storage.
+ */
+class KateProjectSymbolIndex
+{
+public:
+    /**
+     * Load all symbol names of a tags file.
+     * Expensive, is done in the thread creating or updating the project index.
+     * @param tagsFileName ctags file to read
+     */
+    explicit KateProjectSymbolIndex(const QString &tagsFileName);
+
+    /**
+     * Release our names, drops them from the process wide pool if no longer used elsewhere.
+     */
+    ~KateProjectSymbolIndex();
+
+    KateProjectSymbolIndex(const KateProjectSymbolIndex &) = delete;
+    KateProjectSymbolIndex &operator=(const KateProjectSymbolIndex &) = delete;
+
+    /**
+     * Number of unique symbol names.
+     * @return symbol count
+     */
+    int size() const
+    {
+        return int(m_names.size());
+    }
+
+    /**
+     * Find all symbols starting with the given prefix, case-sensitive.
+     * @param prefix prefix to search for
+     * @param maxMatches stop after that many matches
+     * @param matches matches are appended here, in sorted order
+     */
+    void prefixMatches(const QString &prefix, int maxMatches, QStringList &matches) const;
+
+    /**
+     * Find all symbols fuzzy matching the given pattern, like the quick open does.
+     * Only symbols starting with the first character of the pattern are considered, case-insensitive.
+     * @param pattern pattern to match
+     * @param maxMatches only keep that many best matches
+     * @param matches matches are appended here, best ones first
+     */
+    void fuzzyMatches(const QString &pattern, int maxMatches, QStringList &matches) const;
+
+private:
+    /**
+     * unique symbol names, sorted
+     */
+    std::vector<QString> m_names;
+
+    /**
+     * indices into m_names, sorted by the case-folded first character of the names
+     */
+    std::vector<quint32> m_byFoldedFirstChar;
+};
+
+#endif
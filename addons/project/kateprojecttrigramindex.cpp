@@ -0,0 +1,284 @@
+/*  This file is part of the Kate project.
+ *
+ *  SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "kateprojecttrigramindex.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+/**
+ * persistent index format, bump version on changes
+ */
+static const quint32 TrigramIndexMagic = 0x4b545249;
+static const quint32 TrigramIndexVersion = 1;
+
+/**
+ * larger files are not indexed, but always searched
+ */
+static const qint64 MaxIndexedFileSize = 16 * 1024 * 1024;
+
+static inline quint32 asciiLower(uchar c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+std::vector<quint32> KateProjectTrigramIndex::trigrams(const QByteArray &content)
+{
+    std::vector<quint32> result;
+    if (content.size() < 3) {
+        return result;
+    }
+
+    result.reserve(content.size() - 2);
+    const auto *data = reinterpret_cast<const uchar *>(content.constData());
+    for (int i = 0; i + 2 < content.size(); ++i) {
+        // search literals never span multiple lines
+        if (data[i] == '\n' || data[i + 1] == '\n' || data[i + 2] == '\n') {
+            continue;
+        }
+        result.push_back((asciiLower(data[i]) << 16) | (asciiLower(data[i + 1]) << 8) | asciiLower(data[i + 2]));
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    result.shrink_to_fit();
+    return result;
+}
+
+std::vector<quint32> KateProjectTrigramIndex::literalTrigrams(const QStringList &literals)
+{
+    std::vector<quint32> result;
+    const auto addRun = [&result](const QByteArray &run) {
+        const auto runTrigrams = trigrams(run);
+        result.insert(result.end(), runTrigrams.begin(), runTrigrams.end());
+    };
+
+    for (const auto &literal : literals) {
+        QByteArray run;
+        for (const QChar c : literal) {
+            if (c.unicode() < 128 && c != QLatin1Char('\n')) {
+                run += c.toLatin1();
+            } else {
+                addRun(run);
+                run.clear();
+            }
+        }
+        addRun(run);
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+void KateProjectTrigramIndex::indexFile(FileEntry &entry)
+{
+    entry.indexed = false;
+    entry.trigrams.clear();
+
+    // stat before reading: if the file changes in between, the index is considered outdated, not wrong
+    const QFileInfo info(entry.fileName);
+    entry.lastModified = info.lastModified().toMSecsSinceEpoch();
+    entry.size = info.size();
+    if (entry.size > MaxIndexedFileSize) {
+        return;
+    }
+
+    QFile file(entry.fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    // binary or UTF-16 encoded files are not indexed, they are always searched
+    const QByteArray content = file.readAll();
+    if (content.startsWith("\xFF\xFE") || content.startsWith("\xFE\xFF") || content.contains('\0')) {
+        return;
+    }
+
+    entry.trigrams = trigrams(content);
+    entry.indexed = true;
+}
+
+void KateProjectTrigramIndex::addFile(FileEntry &entry)
+{
+    // new id, postings stay sorted as we only append larger ids
+    const quint32 id = m_files.size();
+    m_files.push_back(FileState{entry.lastModified, entry.size, entry.indexed});
+    m_fileIds[entry.fileName] = id;
+    for (const quint32 trigram : entry.trigrams) {
+        m_postings[trigram].push_back(id);
+    }
+    entry.trigrams = std::vector<quint32>();
+}
+
+void KateProjectTrigramIndex::load(const QString &indexFileName, const QStringList &files)
+{
+    /**
+     * read the old index, if any
+     * it is just a cache, on any error we start from scratch
+     */
+    QHash<QString, FileEntry> cached;
+    QFile indexFile(indexFileName);
+    if (indexFile.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&indexFile);
+        quint32 magic = 0;
+        quint32 version = 0;
+        quint32 byteOrder = 0;
+        quint32 count = 0;
+        stream >> magic >> version >> byteOrder >> count;
+        if (magic == TrigramIndexMagic && version == TrigramIndexVersion && byteOrder == quint32(QSysInfo::ByteOrder)) {
+            for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+                FileEntry entry;
+                quint32 trigramCount = 0;
+                stream >> entry.fileName >> entry.lastModified >> entry.size >> entry.indexed >> trigramCount;
+                if (trigramCount > (1u << 24)) {
+                    stream.setStatus(QDataStream::ReadCorruptData);
+                    break;
+                }
+                entry.trigrams.resize(trigramCount);
+                const int bytes = trigramCount * sizeof(quint32);
+                if (stream.readRawData(reinterpret_cast<char *>(entry.trigrams.data()), bytes) != bytes) {
+                    stream.setStatus(QDataStream::ReadPastEnd);
+                    break;
+                }
+                const QString fileName = entry.fileName;
+                cached[fileName] = std::move(entry);
+            }
+        }
+        if (stream.status() != QDataStream::Ok) {
+            cached.clear();
+        }
+        indexFile.close();
+    }
+
+    /**
+     * re-use cached trigrams of unchanged files, index the others in parallel
+     */
+    std::vector<FileEntry> entries(files.size());
+    for (int i = 0; i < files.size(); ++i) {
+        entries[i].fileName = files[i];
+    }
+    QtConcurrent::blockingMap(entries, [&cached](FileEntry &entry) {
+        const auto it = cached.constFind(entry.fileName);
+        if (it != cached.cend()) {
+            const QFileInfo info(entry.fileName);
+            if (it->lastModified == info.lastModified().toMSecsSinceEpoch() && it->size == info.size()) {
+                entry = *it;
+                return;
+            }
+        }
+        indexFile(entry);
+    });
+    cached.clear();
+
+    /**
+     * write updated index back, atomically
+     */
+    QSaveFile saveFile(indexFileName);
+    if (saveFile.open(QIODevice::WriteOnly)) {
+        QDataStream stream(&saveFile);
+        stream << TrigramIndexMagic << TrigramIndexVersion << quint32(QSysInfo::ByteOrder) << quint32(entries.size());
+        for (const auto &entry : entries) {
+            stream << entry.fileName << entry.lastModified << entry.size << entry.indexed << quint32(entry.trigrams.size());
+            stream.writeRawData(reinterpret_cast<const char *>(entry.trigrams.data()), entry.trigrams.size() * sizeof(quint32));
+        }
+        saveFile.commit();
+    }
+
+    /**
+     * build the in-memory postings
+     */
+    m_files.clear();
+    m_fileIds.clear();
+    m_postings.clear();
+    m_files.reserve(entries.size());
+    m_fileIds.reserve(entries.size());
+    for (auto &entry : entries) {
+        addFile(entry);
+    }
+}
+
+void KateProjectTrigramIndex::updateFile(const QString &fileName)
+{
+    // only care for project files
+    if (!m_fileIds.contains(fileName)) {
+        return;
+    }
+
+    FileEntry entry;
+    entry.fileName = fileName;
+    indexFile(entry);
+    addFile(entry);
+}
+
+QStringList KateProjectTrigramIndex::filterFiles(const QStringList &files, const QStringList &literals) const
+{
+    // nothing to filter with?
+    const auto required = literalTrigrams(literals);
+    if (required.empty() || m_fileIds.isEmpty()) {
+        return files;
+    }
+
+    /**
+     * intersect the postings of all required trigrams, shortest ones first
+     */
+    std::vector<quint32> candidates;
+    std::vector<const std::vector<quint32> *> postings;
+    bool missingTrigram = false;
+    for (const quint32 trigram : required) {
+        const auto it = m_postings.constFind(trigram);
+        if (it == m_postings.cend()) {
+            missingTrigram = true;
+            break;
+        }
+        postings.push_back(&it.value());
+    }
+    if (!missingTrigram) {
+        std::sort(postings.begin(), postings.end(), [](const std::vector<quint32> *l, const std::vector<quint32> *r) {
+            return l->size() < r->size();
+        });
+        candidates = *postings.front();
+        for (size_t i = 1; i < postings.size() && !candidates.empty(); ++i) {
+            std::vector<quint32> intersection;
+            std::set_intersection(candidates.begin(), candidates.end(), postings[i]->begin(), postings[i]->end(), std::back_inserter(intersection));
+            candidates.swap(intersection);
+        }
+    }
+
+    /**
+     * keep all candidates and files we know nothing about
+     */
+    QStringList result;
+    QStringList excluded;
+    for (const auto &file : files) {
+        const auto it = m_fileIds.constFind(file);
+        if (it == m_fileIds.cend() || !m_files[it.value()].indexed || std::binary_search(candidates.begin(), candidates.end(), it.value())) {
+            result.push_back(file);
+        } else {
+            excluded.push_back(file);
+        }
+    }
+
+    /**
+     * only trust the index for files that did not change since they got indexed
+     * stat them in parallel, that is still a lot cheaper than reading them
+     */
+    QtConcurrent::blockingFilter(excluded, [this](const QString &file) {
+        const QFileInfo info(file);
+        const FileState &state = m_files[m_fileIds.value(file)];
+        return state.lastModified != info.lastModified().toMSecsSinceEpoch() || state.size != info.size();
+    });
+    result += excluded;
+    return result;
+}
@@ -0,0 +1,116 @@
+/*  This file is part of the Kate project.
+ *
+ *  SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef KATE_PROJECT_TRIGRAM_INDEX_H
+#define KATE_PROJECT_TRIGRAM_INDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+/**
+ * Trigram index over the content of the project files.
+ * Maps each (ASCII lower-cased) byte trigram to the files containing it.
+ * Used to reduce the list of files a project wide search needs to look at.
+ *
+ * The index is persisted in the index directory and re-used on the next load for all files
+ * whose modification time and size didn't change.
+ */
+class KateProjectTrigramIndex
+{
+public:
+    /**
+     * Load the persistent index from the given file, update it for the given files
+     * and write it back.
+     * Expensive, is done in the worker thread creating the project index.
+     * @param indexFileName file to store the index in
+     * @param files files to index
+     */
+    void load(const QString &indexFileName, const QStringList &files);
+
+    /**
+     * Re-index one file, e.g. after it was saved.
+     * Files not known to the index are ignored.
+     * @param fileName file to update
+     */
+    void updateFile(const QString &fileName);
+
+    /**
+     * Filter the given files down to the ones that might contain all given literals.
+     * Files unknown to the index or changed on disk since they got indexed are always kept.
+     * @param files files to filter
+     * @param literals literal strings all matches must contain
+     * @return files that might contain the literals
+     */
+    QStringList filterFiles(const QStringList &files, const QStringList &literals) const;
+
+    /**
+     * Compute the trigrams of some file content.
+     * @param content file content
+     * @return sorted & unique trigrams
+     */
+    static std::vector<quint32> trigrams(const QByteArray &content);
+
+    /**
+     * Compute the trigrams of some literals.
+     * Only ASCII parts are used, non-ASCII text might be encoded differently in the files.
+     * @param literals literals to split
+     * @return sorted & unique trigrams
+     */
+    static std::vector<quint32> literalTrigrams(const QStringList &literals);
+
+private:
+    /**
+     * one file to index, used during loading & updating
+     */
+    struct FileEntry {
+        QString fileName;
+        qint64 lastModified = 0;
+        qint64 size = -1;
+        bool indexed = false;
+        std::vector<quint32> trigrams;
+    };
+
+    /**
+     * Index one file, fills in all fields of the entry but the file name.
+     * Binary or too large files are marked as not indexed.
+     * @param entry file to index
+     */
+    static void indexFile(FileEntry &entry);
+
+    /**
+     * Add file to the index, will get a new id.
+     * @param entry entry with data, trigrams will be moved to the postings
+     */
+    void addFile(FileEntry &entry);
+
+private:
+    /**
+     * state of an indexed file, position is the file id
+     */
+    struct FileState {
+        qint64 lastModified = 0;
+        qint64 size = -1;
+        bool indexed = false;
+    };
+    std::vector<FileState> m_files;
+
+    /**
+     * file name => current id
+     * on update files get a new id, old ids stay dangling in the postings
+     */
+    QHash<QString, quint32> m_fileIds;
+
+    /**
+     * trigram => sorted ids of files containing it
+     */
+    QHash<quint32, std::vector<quint32>> m_postings;
+};
+
+#endif
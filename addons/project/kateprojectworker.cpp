@@ -24,14 +24,16 @@
 #include <QtConcurrent>
 
 #include <algorithm>
+#include <cstring>
 #include <tuple>
 #include <vector>
 
-KateProjectWorker::KateProjectWorker(const QString &baseDir, const QString &indexDir, const QVariantMap &projectMap, bool force)
+KateProjectWorker::KateProjectWorker(const QString &baseDir, const QString &indexDir, const QVariantMap &projectMap, bool force, bool modelOnly)
     : m_baseDir(baseDir)
     , m_indexDir(indexDir)
     , m_projectMap(projectMap)
     , m_force(force)
+    , m_modelOnly(modelOnly)
 {
     Q_ASSERT(!m_baseDir.isEmpty());
 }
@@ -70,7 +72,7 @@ void KateProjectWorker::run()
      * this is expensive, therefore only really do this if required!
      */
     QStringList files;
-    if (indexEnabled) {
+    if (indexEnabled && !m_modelOnly) {
         files = file2Item->keys();
     }
 
@@ -80,6 +82,13 @@ void KateProjectWorker::run()
      */
     Q_EMIT loadDone(topLevel, file2Item);
 
+    /**
+     * refresh after file system changes: keep the current index
+     */
+    if (m_modelOnly) {
+        return;
+    }
+
     /**
      * without indexing, we are even done with all stuff here
      */
@@ -287,74 +296,80 @@ void KateProjectWorker::loadFilesEntry(QStandardItem *parent,
     }
 
     /**
-     * get list of files for this directory, might query the VCS
-     */
-    QVector<QString> files = findFiles(dir, filesEntry);
-
-    /**
-     * sort out non-files
-     * even for git, that just reports non-directories, we need to filter out e.g. sym-links to directories
-     * we use map, not filter, less locking!
-     * we compute here already the KateProjectItem items we want to use later
-     * this happens in the threads, we later skip all nullptr entries
+     * add the files of this directory in chunks, they might be streamed from the VCS
+     * the file items are hung into the tree as they arrive, with the needed directory items
      */
+    QHash<QString, QStandardItem *> dir2Item;
+    dir2Item[QString()] = parent;
     const QString dirPath = dir.path() + QLatin1Char('/');
-    std::vector<std::tuple<QString, QString, KateProjectItem *>> preparedItems;
-    preparedItems.reserve(files.size());
-    for (const auto &item : files)
-        preparedItems.emplace_back(item, QString(), nullptr);
-    QtConcurrent::blockingMap(preparedItems, [dirPath](std::tuple<QString, QString, KateProjectItem *> &item) {
+    const auto addFiles = [&dir, &dir2Item, &dirPath, file2Item](const QVector<QString> &files, bool checkFiles) {
         /**
-         * cheap file name computation
-         * we do this A LOT, QFileInfo is very expensive just for this operation
-         * we remember fullFilePath for later use and overwrite filePath with the part without the filename for later use, too
+         * sort out non-files, if the source can't tell us
+         * even for git, that just reports non-directories, we need to filter out e.g. sym-links to directories
+         * we use map, not filter, less locking!
+         * we compute here already the KateProjectItem items we want to use later
+         * this happens in the threads, we later skip all nullptr entries
          */
-        auto &[filePath, fullFilePath, projectItem] = item;
-        fullFilePath = dirPath + filePath;
-        const int slashIndex = filePath.lastIndexOf(QLatin1Char('/'));
-        const QString fileName = (slashIndex < 0) ? filePath : filePath.mid(slashIndex + 1);
-        filePath = (slashIndex < 0) ? QString() : filePath.left(slashIndex);
+        std::vector<std::tuple<QString, QString, KateProjectItem *>> preparedItems;
+        preparedItems.reserve(files.size());
+        for (const auto &item : files)
+            preparedItems.emplace_back(item, QString(), nullptr);
+        QtConcurrent::blockingMap(preparedItems, [&dirPath, checkFiles](std::tuple<QString, QString, KateProjectItem *> &item) {
+            /**
+             * cheap file name computation
+             * we do this A LOT, QFileInfo is very expensive just for this operation
+             * we remember fullFilePath for later use and overwrite filePath with the part without the filename for later use, too
+             */
+            auto &[filePath, fullFilePath, projectItem] = item;
+            fullFilePath = dirPath + filePath;
+            const int slashIndex = filePath.lastIndexOf(QLatin1Char('/'));
+            const QString fileName = (slashIndex < 0) ? filePath : filePath.mid(slashIndex + 1);
+            filePath = (slashIndex < 0) ? QString() : filePath.left(slashIndex);
 
-        /**
-         * don't create a KateProjectItem object if no file!
-         */
-        if (!QFileInfo(fullFilePath).isFile()) {
-            return;
-        }
+            /**
+             * don't create a KateProjectItem object if no file!
+             */
+            if (checkFiles && !QFileInfo(fullFilePath).isFile()) {
+                return;
+            }
 
-        /**
-         * construct the item with info about filename + full file path
-         */
-        projectItem = new KateProjectItem(KateProjectItem::File, fileName);
-        projectItem->setData(fullFilePath, Qt::UserRole);
-    });
+            /**
+             * construct the item with info about filename + full file path
+             */
+            projectItem = new KateProjectItem(KateProjectItem::File, fileName);
+            projectItem->setData(fullFilePath, Qt::UserRole);
+        });
 
-    /**
-     * put the pre-computed file items in our file2Item hash + create the needed directory items
-     * all other stuff was already handled inside the worker threads to avoid main thread stalling
-     */
-    QHash<QString, QStandardItem *> dir2Item;
-    dir2Item[QString()] = parent;
-    file2Item->reserve(file2Item->size() + preparedItems.size());
-    for (const auto &item : preparedItems) {
         /**
-         * skip all entries without an item => that are filtered out non-files
+         * put the pre-computed file items in our file2Item hash + create the needed directory items
+         * all other stuff was already handled inside the worker threads to avoid main thread stalling
          */
-        const auto &[filePath, fullFilePath, projectItem] = item;
-        if (!projectItem) {
-            continue;
+        file2Item->reserve(file2Item->size() + preparedItems.size());
+        for (const auto &item : preparedItems) {
+            /**
+             * skip all entries without an item => that are filtered out non-files
+             */
+            const auto &[filePath, fullFilePath, projectItem] = item;
+            if (!projectItem) {
+                continue;
+            }
+
+            /**
+             * register the item in the full file path => item hash
+             * create needed directory parents
+             */
+            (*file2Item)[fullFilePath] = projectItem;
+            directoryParent(dir, dir2Item, filePath)->appendRow(projectItem);
         }
+    };
 
-        /**
-         * register the item in the full file path => item hash
-         * create needed directory parents
-         */
-        (*file2Item)[fullFilePath] = projectItem;
-        directoryParent(dir, dir2Item, filePath)->appendRow(projectItem);
-    }
+    /**
+     * get list of files for this directory, might query the VCS
+     */
+    findFiles(dir, filesEntry, addFiles);
 }
 
-QVector<QString> KateProjectWorker::findFiles(const QDir &dir, const QVariantMap &filesEntry)
+void KateProjectWorker::findFiles(const QDir &dir, const QVariantMap &filesEntry, const FilesHandler &handleFiles)
 {
     /**
      * shall we collect files recursively or not?
@@ -366,23 +381,28 @@ QVector<QString> KateProjectWorker::findFiles(const QDir &dir, const QVariantMap
      */
 
     if (filesEntry[QStringLiteral("git")].toBool()) {
-        return filesFromGit(dir, recursive);
+        filesFromGit(dir, recursive, handleFiles);
+        return;
     }
 
     if (filesEntry[QStringLiteral("svn")].toBool()) {
-        return filesFromSubversion(dir, recursive);
+        handleFiles(filesFromSubversion(dir, recursive), true);
+        return;
     }
 
     if (filesEntry[QStringLiteral("hg")].toBool()) {
-        return filesFromMercurial(dir, recursive);
+        handleFiles(filesFromMercurial(dir, recursive), true);
+        return;
     }
 
     if (filesEntry[QStringLiteral("darcs")].toBool()) {
-        return filesFromDarcs(dir, recursive);
+        handleFiles(filesFromDarcs(dir, recursive), true);
+        return;
     }
 
     if (filesEntry[QStringLiteral("fossil")].toBool()) {
-        return filesFromFossil(dir, recursive);
+        handleFiles(filesFromFossil(dir, recursive), true);
+        return;
     }
 
     /**
@@ -407,20 +427,21 @@ QVector<QString> KateProjectWorker::findFiles(const QDir &dir, const QVariantMap
          * users might have specified duplicates, this can't happen for the other ways
          */
         userGivenFilesList.removeDuplicates();
-        return userGivenFilesList.toVector();
+        handleFiles(userGivenFilesList.toVector(), true);
+        return;
     }
 
     /**
      * if nothing found for that, try to use filters to scan the directory
      * here we only get files
      */
-    return filesFromDirectory(dir, recursive, filesEntry[QStringLiteral("filters")].toStringList());
+    handleFiles(filesFromDirectory(dir, recursive, filesEntry[QStringLiteral("filters")].toStringList()), true);
 }
 
-QVector<QString> KateProjectWorker::filesFromGit(const QDir &dir, bool recursive)
+void KateProjectWorker::filesFromGit(const QDir &dir, bool recursive, const FilesHandler &handleFiles)
 {
     /**
-     * query files via ls-files and make them absolute afterwards
+     * query files via ls-files, the output is parsed while git is still running
      */
 
     /**
@@ -429,68 +450,146 @@ QVector<QString> KateProjectWorker::filesFromGit(const QDir &dir, bool recursive
      *
      * use --recurse-submodules, there since git 2.11 (released 2016)
      * our own submodules handling code leads to file duplicates
+     *
+     * use --stage, this gives us the file modes, no need to stat all regular files
      */
-
-    QStringList lsFilesArgs{QStringLiteral("ls-files"), QStringLiteral("-z"), QStringLiteral("--recurse-submodules"), QStringLiteral(".")};
+    const QStringList lsFilesArgs{QStringLiteral("ls-files"),
+                                  QStringLiteral("-z"),
+                                  QStringLiteral("--stage"),
+                                  QStringLiteral("--recurse-submodules"),
+                                  QStringLiteral(".")};
 
     /**
      * ls-files untracked
      */
     QStringList lsFilesUntrackedArgs{QStringLiteral("ls-files"),
-                                           QStringLiteral("-z"),
-                                           QStringLiteral("--others"),
-                                           QStringLiteral("--exclude-standard"),
-                                           QStringLiteral(".")};
+                                     QStringLiteral("-z"),
+                                     QStringLiteral("--others"),
+                                     QStringLiteral("--exclude-standard"),
+                                     QStringLiteral(".")};
 
     /**
      * for recent enough git versions ensure we don't show duplicated files
+     * --deduplicate has no effect together with --stage, gitFiles skips the duplicates there
      */
     const auto [major, minor] = getGitVersion(dir.absolutePath());
     if (major > 2 || (major == 2 && minor >= 31)) {
-        lsFilesArgs.insert(3, QStringLiteral("--deduplicate"));
         lsFilesUntrackedArgs.insert(4, QStringLiteral("--deduplicate"));
     }
 
+    /**
+     * tracked files deleted in the working copy must be skipped, as we don't stat them
+     * git can answer that from its index, that is a lot cheaper
+     * --deleted doesn't support submodules, stat all files if there are some
+     */
+    QSet<QString> deletedFiles;
+    const QStringList lsFilesDeletedArgs{QStringLiteral("ls-files"), QStringLiteral("-z"), QStringLiteral("--deleted"), QStringLiteral(".")};
+    gitFiles(dir, recursive, lsFilesDeletedArgs, false, [&deletedFiles](const QVector<QString> &files, bool) {
+        for (const auto &file : files) {
+            deletedFiles.insert(file);
+        }
+    });
+    const bool hasSubmodules = QFileInfo::exists(dir.filePath(QStringLiteral(".gitmodules")));
+
     // ls-files + ls-files untracked
-    return gitFiles(dir, recursive, lsFilesArgs, false) << gitFiles(dir, recursive, lsFilesUntrackedArgs, true);
+    gitFiles(dir, recursive, lsFilesArgs, true, [&deletedFiles, hasSubmodules, &handleFiles](const QVector<QString> &files, bool checkFiles) {
+        if (deletedFiles.isEmpty()) {
+            handleFiles(files, checkFiles || hasSubmodules);
+            return;
+        }
+        QVector<QString> existingFiles;
+        existingFiles.reserve(files.size());
+        for (const auto &file : files) {
+            if (!deletedFiles.contains(file)) {
+                existingFiles.append(file);
+            }
+        }
+        handleFiles(existingFiles, checkFiles || hasSubmodules);
+    });
+    gitFiles(dir, recursive, lsFilesUntrackedArgs, false, handleFiles);
 }
 
-QVector<QString> KateProjectWorker::gitFiles(const QDir &dir, bool recursive, const QStringList &args, bool ignoreBinaryFiles)
+void KateProjectWorker::gitFiles(const QDir &dir, bool recursive, const QStringList &args, bool withStage, const FilesHandler &handleFiles)
 {
-    QVector<QString> files;
     QProcess git;
     if (!setupGitProcess(git, dir.absolutePath(), args)) {
-        return files;
+        return;
     }
     git.start(QProcess::ReadOnly);
-    if (!git.waitForStarted() || !git.waitForFinished(-1)) {
-        return files;
+    if (!git.waitForStarted()) {
+        return;
     }
 
-    const QList<QByteArray> byteArrayList = git.readAllStandardOutput().split('\0');
-    files.reserve(byteArrayList.size());
-    for (const QByteArray &byteArray : byteArrayList) {
-        if (byteArray.isEmpty()) {
-            continue;
+    /**
+     * hand out the files in chunks, regular files reported by --stage need no check
+     * without mode or for symlinks, we must check if this is no directory
+     */
+    static const int ChunkSize = 16 * 1024;
+    QVector<QString> files;
+    QVector<QString> filesToCheck;
+    QByteArray lastPath;
+    const auto addEntry = [&](const char *entry, int size) {
+        bool checkFile = true;
+        if (withStage) {
+            // <mode> SP <object> SP <stage> TAB <file>
+            const char *tab = static_cast<const char *>(memchr(entry, '\t', size));
+            if (!tab) {
+                return;
+            }
+            const QByteArray mode(entry, std::min<int>(size, 6));
+            size -= tab + 1 - entry;
+            entry = tab + 1;
+
+            // submodule entries are directories, their content is reported, too
+            if (mode == "160000") {
+                return;
+            }
+            checkFile = (mode == "120000");
+
+            // unmerged files are reported once per stage
+            if (lastPath.size() == size && memcmp(lastPath.constData(), entry, size) == 0) {
+                return;
+            }
+            lastPath = QByteArray(entry, size);
         }
-        if (!recursive && (byteArray.indexOf('/') != -1)) {
-            continue;
+
+        if (size == 0 || (!recursive && memchr(entry, '/', size))) {
+            return;
         }
-        files.append(QString::fromUtf8(byteArray));
-    }
 
-    // Filter out binary files
-    if (ignoreBinaryFiles) {
-        QtConcurrent::blockingMap(files, [dir](const QString &file) {
-            const QMimeType mimeType = QMimeDatabase().mimeTypeForFile(dir.filePath(file));
-            if (!mimeType.inherits(QStringLiteral("text/plain"))) {
-                return QString();
-            }
-            return file;
-        });
+        auto &target = checkFile ? filesToCheck : files;
+        target.append(QString::fromUtf8(entry, size));
+        if (target.size() >= ChunkSize) {
+            handleFiles(target, checkFile);
+            target.clear();
+        }
+    };
+
+    /**
+     * parse all complete entries as they arrive, keep the incomplete rest
+     */
+    QByteArray pending;
+    bool running = true;
+    while (running) {
+        running = git.waitForReadyRead(-1);
+        pending += git.readAllStandardOutput();
+        const char *begin = pending.constData();
+        const char *end = begin + pending.size();
+        const char *entry = begin;
+        while (const char *terminator = static_cast<const char *>(memchr(entry, '\0', end - entry))) {
+            addEntry(entry, terminator - entry);
+            entry = terminator + 1;
+        }
+        pending.remove(0, entry - begin);
     }
+    git.waitForFinished(-1);
 
-    return files;
+    if (!files.isEmpty()) {
+        handleFiles(files, false);
+    }
+    if (!filesToCheck.isEmpty()) {
+        handleFiles(filesToCheck, true);
+    }
 }
 
 QVector<QString> KateProjectWorker::filesFromMercurial(const QDir &dir, bool recursive)
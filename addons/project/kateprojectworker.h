@@ -14,6 +14,8 @@
 #include <QRunnable>
 #include <QStandardItemModel>
 
+#include <functional>
+
 class QDir;
 class KateProjectItem;
 
@@ -31,7 +33,15 @@ public:
      */
     typedef QHash<QString, KateProjectItem *> MapString2Item;
 
-    explicit KateProjectWorker(const QString &baseDir, const QString &indexDir, const QVariantMap &projectMap, bool force);
+    /**
+     * Construct worker, will be deleted by the thread pool after run().
+     * @param baseDir project base directory
+     * @param indexDir directory for the index files, empty if indexing is disabled
+     * @param projectMap project configuration
+     * @param force enforce update of files list and index
+     * @param modelOnly only reload the files, skip the index, used to refresh the tree after file system changes
+     */
+    explicit KateProjectWorker(const QString &baseDir, const QString &indexDir, const QVariantMap &projectMap, bool force, bool modelOnly = false);
 
     void run() override;
 
@@ -59,16 +69,27 @@ private:
      */
     static void loadFilesEntry(QStandardItem *parent, const QVariantMap &filesEntry, QHash<QString, KateProjectItem *> *file2Item, const QString &baseDir);
 
-    static QVector<QString> findFiles(const QDir &dir, const QVariantMap &filesEntry);
+    /**
+     * Callback to hand out found files, relative to the directory of the files entry.
+     * Might be called multiple times, e.g. for the chunks of streamed VCS output.
+     * checkFiles is set if it is unknown whether the entries are regular files.
+     */
+    typedef std::function<void(const QVector<QString> &files, bool checkFiles)> FilesHandler;
+
+    static void findFiles(const QDir &dir, const QVariantMap &filesEntry, const FilesHandler &handleFiles);
 
-    static QVector<QString> filesFromGit(const QDir &dir, bool recursive);
+    static void filesFromGit(const QDir &dir, bool recursive, const FilesHandler &handleFiles);
     static QVector<QString> filesFromMercurial(const QDir &dir, bool recursive);
     static QVector<QString> filesFromSubversion(const QDir &dir, bool recursive);
     static QVector<QString> filesFromDarcs(const QDir &dir, bool recursive);
     static QVector<QString> filesFromFossil(const QDir &dir, bool recursive);
     static QVector<QString> filesFromDirectory(const QDir &dir, bool recursive, const QStringList &filters);
 
-    static QVector<QString> gitFiles(const QDir &dir, bool recursive, const QStringList &args, bool ignoreBinaryFiles);
+    /**
+     * Run some git ls-files variant and hand out the files while it is still running.
+     * @param withStage output has the --stage format, regular files will need no check
+     */
+    static void gitFiles(const QDir &dir, bool recursive, const QStringList &args, bool withStage, const FilesHandler &handleFiles);
 
 private:
     /**
@@ -88,6 +109,11 @@ private:
 
     const QVariantMap m_projectMap;
     const bool m_force;
+
+    /**
+     * only refresh the model, no index update?
+     */
+    const bool m_modelOnly;
 };
 
 #endif
@@ -6,20 +6,35 @@
 
 #include "FolderFilesList.h"
 
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
 #include <QElapsedTimer>
 #include <QFileInfoList>
+#include <QMutexLocker>
 #include <QtConcurrent>
 
 #include <unordered_set>
 #include <vector>
 
+/**
+ * limits for the directory cache, we don't want to use up all inotify watches or memory
+ */
+static const int MaxWatchedDirectories = 4096;
+static const int MaxCachedDirectories = 100000;
+
 FolderFilesList::FolderFilesList(QObject *parent)
     : QThread(parent)
 {
     // ensure we have a proper thread name during e.g. perf profiling
     setObjectName(QStringLiteral("FolderFilesList"));
+
+    // drop changed directories from the cache, the modification time has a too coarse resolution on some file systems
+    connect(&m_directoryWatcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString &path) {
+        m_directoryWatcher.removePath(path);
+        QMutexLocker locker(&m_cacheMutex);
+        m_directoryCache.remove(path);
+    });
 }
 
 FolderFilesList::~FolderFilesList()
@@ -32,6 +47,25 @@ void FolderFilesList::run()
 {
     m_files.clear();
 
+    // excludes match any path component, the ones below the folder are checked while traversing
+    if (!m_excludes.pattern().isEmpty()) {
+        const QStringList folderParts = m_folder.split(QLatin1Char('/'), Qt::SkipEmptyParts);
+        for (const auto &part : folderParts) {
+            if (m_excludes.match(part).hasMatch()) {
+                Q_EMIT fileListReady();
+                return;
+            }
+        }
+    }
+
+    // keep the cache bounded
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (m_directoryCache.size() > MaxCachedDirectories) {
+            m_directoryCache.clear();
+        }
+    }
+
     /**
      * iterative algorithm, in each round, we put in X directories to traverse
      * we will get as output X times: new directories + found files
@@ -62,7 +96,15 @@ void FolderFilesList::run()
          * collect the results to create new worklist for next round
          */
         std::vector<DirectoryWithResults> nextRound;
+        QStringList listedDirectories;
         for (const auto &result : directoriesWithResults) {
+            /**
+             * remember freshly listed directories to watch them
+             */
+            if (result.listed) {
+                listedDirectories.push_back(result.directory);
+            }
+
             /**
              * one new item for the next round for each new directory
              */
@@ -78,6 +120,21 @@ void FolderFilesList::run()
             m_files << result.newFiles;
         }
 
+        /**
+         * watch the new cached directories, the watcher belongs to the main thread
+         */
+        if (!listedDirectories.isEmpty()) {
+            QMetaObject::invokeMethod(
+                this,
+                [this, listedDirectories]() {
+                    const int freeWatches = MaxWatchedDirectories - m_directoryWatcher.directories().size();
+                    if (freeWatches > 0) {
+                        m_directoryWatcher.addPaths(listedDirectories.mid(0, freeWatches));
+                    }
+                },
+                Qt::QueuedConnection);
+        }
+
         /**
          * let's get next round going
          */
@@ -101,24 +158,71 @@ void FolderFilesList::generateList(const QString &folder, bool recursive, bool h
     m_hidden = hidden;
     m_symlinks = symlinks;
 
-    m_types.clear();
-    const auto typesList = types.split(QLatin1Char(','), Qt::SkipEmptyParts);
-    for (const QString &type : typesList) {
-        m_types << type.trimmed();
+    // name filters of QDir are case-insensitive, keep that
+    QStringList typesList = types.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    for (QString &type : typesList) {
+        type = type.trimmed();
     }
-    if (m_types.isEmpty()) {
-        m_types << QStringLiteral("*");
+    m_types = compileWildcards(typesList, QRegularExpression::CaseInsensitiveOption);
+    if (m_types.pattern().isEmpty()) {
+        m_types = compileWildcards({QStringLiteral("*")}, QRegularExpression::CaseInsensitiveOption);
     }
 
-    QStringList tmpExcludes = excludes.split(QLatin1Char(','));
-    m_excludes.clear();
-    for (int i = 0; i < tmpExcludes.size(); i++) {
-        m_excludes << QRegularExpression(QRegularExpression::wildcardToRegularExpression(tmpExcludes[i].trimmed()));
+    QStringList excludesList = excludes.split(QLatin1Char(','));
+    for (QString &exclude : excludesList) {
+        exclude = exclude.trimmed();
     }
+    m_excludes = compileWildcards(excludesList, QRegularExpression::NoPatternOption);
 
     start();
 }
 
+QRegularExpression FolderFilesList::compileWildcards(const QStringList &wildcards, QRegularExpression::PatternOptions options)
+{
+    QStringList patterns;
+    for (const auto &wildcard : wildcards) {
+        if (!wildcard.isEmpty()) {
+            patterns << QRegularExpression::wildcardToRegularExpression(wildcard);
+        }
+    }
+    if (patterns.isEmpty()) {
+        return QRegularExpression();
+    }
+
+    // one alternation, each pattern is anchored on its own
+    QRegularExpression regExp(QLatin1String("(?:") + patterns.join(QLatin1String(")|(?:")) + QLatin1Char(')'), options);
+    regExp.optimize();
+    return regExp;
+}
+
+QVector<FolderFilesList::DirectoryEntry> FolderFilesList::directoryEntries(const QString &directory, bool &listed) const
+{
+    listed = false;
+    const qint64 lastModified = QFileInfo(directory).lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        const auto it = m_directoryCache.constFind(directory);
+        if (it != m_directoryCache.cend() && it->lastModified == lastModified) {
+            return it->entries;
+        }
+    }
+
+    // list everything, the filters are applied on the cached listing
+    CachedDirectory cached;
+    cached.lastModified = lastModified;
+    const QFileInfoList infos =
+        QDir(directory).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System, QDir::Name | QDir::LocaleAware);
+    cached.entries.reserve(infos.size());
+    for (const auto &info : infos) {
+        cached.entries.push_back(DirectoryEntry{info.fileName(), info.isDir(), info.isFile(), info.isSymLink(), info.isHidden(), info.isReadable()});
+    }
+
+    listed = true;
+    QMutexLocker locker(&m_cacheMutex);
+    m_directoryCache.insert(directory, cached);
+    return cached.entries;
+}
+
 void FolderFilesList::terminateSearch()
 {
     m_cancelSearch = true;
@@ -151,41 +255,26 @@ void FolderFilesList::checkNextItem(DirectoryWithResults &handleOnFolder) const
         return;
     }
 
-    QDir::Filters filter = QDir::Files | QDir::NoDotAndDotDot | QDir::Readable;
-    if (m_hidden) {
-        filter |= QDir::Hidden;
-    }
-    if (m_recursive) {
-        filter |= QDir::AllDirs;
-    }
-    if (!m_symlinks) {
-        filter |= QDir::NoSymLinks;
-    }
-
-    const QFileInfoList entries = currentDir.entryInfoList(m_types, filter, QDir::Name | QDir::LocaleAware);
+    // apply the same filtering QDir would do for Files | AllDirs (if recursive) | Readable & the hidden/symlink options
+    const QString dirPrefix = handleOnFolder.directory.endsWith(QLatin1Char('/')) ? handleOnFolder.directory : handleOnFolder.directory + QLatin1Char('/');
+    const bool checkExcludes = !m_excludes.pattern().isEmpty();
+    const auto entries = directoryEntries(handleOnFolder.directory, handleOnFolder.listed);
     for (const auto &entry : entries) {
-        const QString absFilePath = entry.absoluteFilePath();
-        bool skip{false};
-        const QStringList pathSplit = absFilePath.split(QLatin1Char('/'), Qt::SkipEmptyParts);
-        for (const auto &regex : m_excludes) {
-            for (const auto &part : pathSplit) {
-                QRegularExpressionMatch match = regex.match(part);
-                if (match.hasMatch()) {
-                    skip = true;
-                    break;
-                }
-            }
-        }
-        if (skip) {
+        if (!entry.isReadable || (!m_hidden && entry.isHidden) || (!m_symlinks && entry.isSymLink)) {
             continue;
         }
 
-        if (entry.isDir()) {
-            handleOnFolder.newDirectories.append(absFilePath);
+        // parent directories are already checked, only the name is left
+        if (checkExcludes && m_excludes.match(entry.name).hasMatch()) {
+            continue;
         }
 
-        if (entry.isFile()) {
-            handleOnFolder.newFiles.append(absFilePath);
+        if (entry.isDir) {
+            if (m_recursive) {
+                handleOnFolder.newDirectories.append(dirPrefix + entry.name);
+            }
+        } else if (entry.isFile && m_types.match(entry.name).hasMatch()) {
+            handleOnFolder.newFiles.append(dirPrefix + entry.name);
         }
     }
 }
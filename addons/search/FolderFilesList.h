@@ -7,6 +7,9 @@
 #ifndef FolderFilesList_h
 #define FolderFilesList_h
 
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QMutex>
 #include <QRegularExpression>
 #include <QStringList>
 #include <QThread>
@@ -37,10 +40,49 @@ private:
         QString directory;
         QStringList newDirectories;
         QStringList newFiles;
+        bool listed = false; // did we list the directory or was it cached?
+    };
+
+    /**
+     * one entry of a directory listing, unfiltered
+     */
+    struct DirectoryEntry {
+        QString name;
+        bool isDir = false;
+        bool isFile = false;
+        bool isSymLink = false;
+        bool isHidden = false;
+        bool isReadable = false;
+    };
+
+    /**
+     * cached directory listing, valid as long as the directory modification time didn't change
+     * and the file system watcher didn't report a change
+     */
+    struct CachedDirectory {
+        qint64 lastModified = 0;
+        QVector<DirectoryEntry> entries;
     };
 
     void checkNextItem(DirectoryWithResults &handleOnFolder) const;
 
+    /**
+     * Get the unfiltered entries of the given directory, from the cache if still valid.
+     * Called by multiple threads.
+     * @param directory directory to list
+     * @param listed set to true if the directory had to be listed
+     * @return entries, sorted by name
+     */
+    QVector<DirectoryEntry> directoryEntries(const QString &directory, bool &listed) const;
+
+    /**
+     * Compile a list of wildcards into one expression matching any of them.
+     * @param wildcards wildcards, empty ones are ignored
+     * @param options pattern options
+     * @return expression, invalid if no wildcards given
+     */
+    static QRegularExpression compileWildcards(const QStringList &wildcards, QRegularExpression::PatternOptions options);
+
 private:
     QString m_folder;
     QStringList m_files;
@@ -49,8 +91,21 @@ private:
     bool m_recursive = false;
     bool m_hidden = false;
     bool m_symlinks = false;
-    QStringList m_types;
-    QVector<QRegularExpression> m_excludes;
+    QRegularExpression m_types;
+    QRegularExpression m_excludes;
+
+    /**
+     * directory listings of previous runs, shared by the threads listing directories
+     * guarded by m_cacheMutex
+     */
+    mutable QMutex m_cacheMutex;
+    mutable QHash<QString, CachedDirectory> m_directoryCache;
+
+    /**
+     * watches the cached directories, to drop changed ones even if their modification time looks unchanged
+     * only used in the main thread
+     */
+    QFileSystemWatcher m_directoryWatcher;
 };
 
 #endif
@@ -10,6 +10,9 @@
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
+#include <QSaveFile>
+#include <QTextCodec>
+#include <QtConcurrent>
 #include <algorithm> // std::count_if
 
 #include <ktexteditor/movinginterface.h>
@@ -45,10 +48,19 @@ MatchModel::MatchModel(QObject *parent)
     connect(&m_infoUpdateTimer, &QTimer::timeout, this, [this]() {
         dataChanged(createIndex(0, 0, InfoItemId), createIndex(0, 0, InfoItemId));
     });
+
+    connect(&m_bulkReplaceWatcher, &QFutureWatcherBase::resultReadyAt, this, &MatchModel::bulkReplaceResultReady);
+    connect(&m_bulkReplaceWatcher, &QFutureWatcherBase::finished, this, &MatchModel::bulkReplaceFinished);
 }
 
 MatchModel::~MatchModel()
 {
+    // the workers don't access the model, but we must not get their results delivered anymore
+    if (m_bulkReplaceCanceled) {
+        *m_bulkReplaceCanceled = true;
+    }
+    m_bulkReplaceWatcher.cancel();
+    m_bulkReplaceWatcher.waitForFinished();
 }
 
 void MatchModel::setDocumentManager(KTextEditor::Application *manager)
@@ -115,6 +127,11 @@ void MatchModel::setProjectName(const QString &projectName)
     }
 }
 
+void MatchModel::setMaxMatches(int maxMatches)
+{
+    m_maxMatches = maxMatches;
+}
+
 void MatchModel::clear()
 {
     beginResetModel();
@@ -122,9 +139,34 @@ void MatchModel::clear()
     m_matchFileIndexHash.clear();
     m_matchUnsavedFileIndexHash.clear();
     m_lastMatchUrl.clear();
+    m_matchCount = 0;
+    m_matchLimitReached = false;
     endResetModel();
 }
 
+void MatchModel::appendMatch(QVector<KateSearchMatch> &matches, QStringList &lines, const QString &text, int column, int length, const KTextEditor::Range &range)
+{
+    if (text.size() <= MaxCachedTextLength) {
+        // consecutive matches in the same text share the cache entry
+        if (lines.isEmpty() || lines.constLast() != text) {
+            lines.push_back(text);
+        }
+    } else {
+        // very long text, only keep the part we will display, the context computation gives the same result on it
+        const int matchEnd = column + length;
+        int lineEnd = text.indexOf(QLatin1Char('\n'), matchEnd);
+        if (lineEnd == -1) {
+            lineEnd = text.size();
+        }
+        const auto [preContextStart, postContextLen] = contextLengths(lineEnd, column, matchEnd);
+        const int snippetEnd = qMin(lineEnd, matchEnd + postContextLen);
+        lines.push_back(text.mid(preContextStart, snippetEnd - preContextStart));
+        column -= preContextStart;
+    }
+
+    matches.push_back(KateSearchMatch{QString(), range, int(lines.size()) - 1, column, length, true, true});
+}
+
 /** This function returns the row index of the specified file.
  * If the file does not exist in the model, the file will be added to the model. */
 int MatchModel::matchFileRow(const QUrl &fileUrl, KTextEditor::Document *doc) const
@@ -137,7 +179,7 @@ int MatchModel::matchFileRow(const QUrl &fileUrl, KTextEditor::Document *doc) co
 }
 
 /** This function is used to add a match to a new file */
-void MatchModel::addMatches(const QUrl &fileUrl, const QVector<KateSearchMatch> &searchMatches, KTextEditor::Document *doc)
+void MatchModel::addMatches(const QUrl &fileUrl, const QVector<KateSearchMatch> &searchMatches, const QStringList &lines, KTextEditor::Document *doc)
 {
     m_lastMatchUrl = fileUrl;
     m_searchState = Searching;
@@ -146,7 +188,14 @@ void MatchModel::addMatches(const QUrl &fileUrl, const QVector<KateSearchMatch>
         m_infoUpdateTimer.start();
     }
 
-    if (searchMatches.isEmpty()) {
+    // only collect up to m_maxMatches matches, we would just waste memory on results nobody will look at
+    int count = searchMatches.size();
+    if (m_maxMatches > 0 && m_matchCount + count > m_maxMatches) {
+        count = m_maxMatches - m_matchCount;
+        m_matchLimitReached = true;
+    }
+
+    if (count <= 0) {
         return;
     }
 
@@ -176,9 +225,19 @@ void MatchModel::addMatches(const QUrl &fileUrl, const QVector<KateSearchMatch>
         endInsertRows();
     }
 
-    int matchIndex = m_matchFiles[fileIndex].matches.size();
-    beginInsertRows(createIndex(fileIndex, 0, FileItemId), matchIndex, matchIndex + searchMatches.size() - 1);
-    m_matchFiles[fileIndex].matches += searchMatches;
+    // the matches reference the lines passed together with them, shift them behind the already cached ones
+    MatchFile &matchFile = m_matchFiles[fileIndex];
+    const int lineOffset = matchFile.lines.size();
+    matchFile.lines += lines;
+
+    const int matchIndex = matchFile.matches.size();
+    beginInsertRows(createIndex(fileIndex, 0, FileItemId), matchIndex, matchIndex + count - 1);
+    matchFile.matches.reserve(matchIndex + count);
+    for (int i = 0; i < count; ++i) {
+        matchFile.matches.push_back(searchMatches[i]);
+        matchFile.matches.back().lineIndex += lineOffset;
+    }
+    m_matchCount += count;
     endInsertRows();
 }
 
@@ -386,9 +445,9 @@ void MatchModel::doReplaceNextMatch()
 {
     Q_ASSERT(m_docManager);
 
-    if (m_cancelReplace || m_replaceFile >= m_matchFiles.size()) {
+    if (m_cancelReplace || m_replaceFile < 0 || m_replaceFile >= m_documentReplaceRows.size()) {
         m_replaceFile = -1;
-        Q_EMIT replaceDone();
+        finishReplace();
         return;
     }
 
@@ -396,7 +455,14 @@ void MatchModel::doReplaceNextMatch()
     // cancelReplace(). A closed file could lead to a crash if it is not handled.
     // this is now done in setDocumentManager()
 
-    MatchFile &matchFile = m_matchFiles[m_replaceFile];
+    const int fileRow = m_documentReplaceRows.at(m_replaceFile);
+    if (fileRow >= m_matchFiles.size()) {
+        m_replaceFile++;
+        QTimer::singleShot(0, this, &MatchModel::doReplaceNextMatch);
+        return;
+    }
+
+    MatchFile &matchFile = m_matchFiles[fileRow];
 
     if (matchFile.checkState == Qt::Unchecked) {
         m_replaceFile++;
@@ -445,7 +511,7 @@ void MatchModel::doReplaceNextMatch()
 
     for (int i = 0; i < matches.size(); ++i) {
         if (matches[i].checked && matches[i].matchesFilter) {
-            replaceMatch(doc, createIndex(i, 0, m_replaceFile), m_regExp, m_replaceText);
+            replaceMatch(doc, createIndex(i, 0, fileRow), m_regExp, m_replaceText);
         }
         // The document has been modified -> make sure the next match has the correct range
         if (i < matches.size() - 1) {
@@ -453,28 +519,257 @@ void MatchModel::doReplaceNextMatch()
         }
     }
 
-    dataChanged(createIndex(0, 0, m_replaceFile), createIndex(matches.size() - 1, 0, m_replaceFile));
+    dataChanged(createIndex(0, 0, fileRow), createIndex(matches.size() - 1, 0, fileRow));
 
     // free our moving ranges
     qDeleteAll(matchRanges);
 
     m_replaceFile++;
+    m_replaceFilesDone++;
+    if (!m_infoUpdateTimer.isActive()) {
+        m_infoUpdateTimer.start();
+    }
     QTimer::singleShot(0, this, &MatchModel::doReplaceNextMatch);
 }
 
+MatchModel::BulkReplaceResult
+MatchModel::replaceInFile(const BulkReplaceJob &job, const QRegularExpression &regExp, const QString &replaceString, const std::atomic<bool> &canceled)
+{
+    BulkReplaceResult result;
+    result.fileRow = job.fileRow;
+    result.fileUrl = job.fileUrl;
+    result.replaceTexts.resize(job.ranges.size());
+
+    if (canceled) {
+        return result;
+    }
+
+    QFile file(job.fileUrl.toLocalFile());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return result;
+    }
+    const QByteArray content = file.readAll();
+    file.close();
+
+    // we only handle UTF-8 here, like the mapped search, everything else is left to the editor
+    const bool hasBom = content.startsWith("\xEF\xBB\xBF");
+    const int bomSize = hasBom ? 3 : 0;
+    QTextCodec::ConverterState state;
+    const QString text = QTextCodec::codecForMib(106)->toUnicode(content.constData() + bomSize, content.size() - bomSize, &state);
+    if (state.invalidChars > 0 || state.remainingChars > 0) {
+        return result;
+    }
+
+    // lines are separated by \n, a \r before it is part of the line ending
+    QVector<int> lineStarts{0};
+    for (int i = 0; i < text.size(); ++i) {
+        if (text.at(i) == QLatin1Char('\n')) {
+            lineStarts.push_back(i + 1);
+        }
+    }
+    const bool crlf = lineStarts.size() > 1 && lineStarts[1] >= 2 && text.at(lineStarts[1] - 2) == QLatin1Char('\r');
+    const auto offset = [&text, &lineStarts](const KTextEditor::Cursor &cursor) {
+        if (cursor.line() < 0 || cursor.line() >= lineStarts.size()) {
+            return -1;
+        }
+        int lineEnd = cursor.line() + 1 < lineStarts.size() ? lineStarts[cursor.line() + 1] - 1 : text.size();
+        if (lineEnd > lineStarts[cursor.line()] && text.at(lineEnd - 1) == QLatin1Char('\r')) {
+            --lineEnd;
+        }
+        const int pos = lineStarts[cursor.line()] + cursor.column();
+        return pos <= lineEnd ? pos : -1;
+    };
+
+    // assemble the new content, matches are sorted and don't overlap
+    QString newText;
+    newText.reserve(text.size());
+    int copied = 0;
+    for (int i = 0; i < job.ranges.size(); ++i) {
+        const KTextEditor::Range &range = job.ranges.at(i);
+        if (!range.isValid()) {
+            continue;
+        }
+        const int start = offset(range.start());
+        const int end = offset(range.end());
+        if (start < copied || end < start) {
+            continue;
+        }
+
+        // Check that the text has not been modified and still matches + get captures for the replace
+        QString rangeText = text.mid(start, end - start);
+        rangeText.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+        const QRegularExpressionMatch match = rangeTextMatches(rangeText, regExp);
+        if (match.capturedStart() != 0) {
+            continue;
+        }
+
+        const QString replaceText = generateReplaceString(match, replaceString);
+        newText += text.midRef(copied, start - copied);
+        if (crlf) {
+            newText += QString(replaceText).replace(QLatin1Char('\n'), QLatin1String("\r\n"));
+        } else {
+            newText += replaceText;
+        }
+        copied = end;
+        result.replaceTexts[i] = replaceText;
+    }
+    newText += text.midRef(copied);
+
+    // nothing to do? no need to touch the file
+    result.handled = true;
+    if (copied == 0) {
+        return result;
+    }
+
+    // write back atomically, either the file is fully replaced or untouched
+    QSaveFile saveFile(job.fileUrl.toLocalFile());
+    if (!saveFile.open(QIODevice::WriteOnly)) {
+        result.handled = false;
+        result.replaceTexts.fill(QString());
+        return result;
+    }
+    if (hasBom) {
+        saveFile.write(content.constData(), bomSize);
+    }
+    saveFile.write(newText.toUtf8());
+
+    // the last point to back out, a committed file is always reported as replaced
+    if (canceled) {
+        saveFile.cancelWriting();
+        result.handled = false;
+        result.replaceTexts.fill(QString());
+        return result;
+    }
+    if (!saveFile.commit()) {
+        result.handled = false;
+        result.replaceTexts.fill(QString());
+    }
+    return result;
+}
+
+void MatchModel::bulkReplaceResultReady(int resultIndex)
+{
+    const BulkReplaceResult result = m_bulkReplaceWatcher.resultAt(resultIndex);
+
+    // the model might have been changed in between
+    if (result.fileRow < 0 || result.fileRow >= m_matchFiles.size() || m_matchFiles[result.fileRow].fileUrl != result.fileUrl) {
+        return;
+    }
+
+    // couldn't handle that file on disk, let the editor do it
+    if (!result.handled) {
+        if (!m_cancelReplace) {
+            m_documentReplaceRows.push_back(result.fileRow);
+            if (m_replaceFile == -1) {
+                m_replaceFile = m_documentReplaceRows.size() - 1;
+                QTimer::singleShot(0, this, &MatchModel::doReplaceNextMatch);
+            }
+        }
+        return;
+    }
+
+    auto &matches = m_matchFiles[result.fileRow].matches;
+    if (matches.size() != result.replaceTexts.size()) {
+        return;
+    }
+
+    // update the matches like replaceMatch() does
+    for (int i = 0; i < matches.size(); ++i) {
+        const QString &replaceText = result.replaceTexts.at(i);
+        if (replaceText.isNull()) {
+            continue;
+        }
+        Match &match = matches[i];
+        int newEndLine = match.range.start().line() + replaceText.count(QLatin1Char('\n'));
+        int lastNL = replaceText.lastIndexOf(QLatin1Char('\n'));
+        int newEndColumn = lastNL == -1 ? match.range.start().column() + replaceText.length() : replaceText.length() - lastNL - 1;
+        match.range.setEnd(KTextEditor::Cursor{newEndLine, newEndColumn});
+        match.replaceText = replaceText;
+    }
+    dataChanged(createIndex(0, 0, result.fileRow), createIndex(matches.size() - 1, 0, result.fileRow));
+
+    m_replaceFilesDone++;
+    if (!m_infoUpdateTimer.isActive()) {
+        m_infoUpdateTimer.start();
+    }
+}
+
+void MatchModel::bulkReplaceFinished()
+{
+    m_bulkReplacing = false;
+    finishReplace();
+}
+
+void MatchModel::finishReplace()
+{
+    if (!m_replacing || m_bulkReplacing || m_replaceFile != -1) {
+        return;
+    }
+
+    m_replacing = false;
+    if (!m_infoUpdateTimer.isActive()) {
+        m_infoUpdateTimer.start();
+    }
+    Q_EMIT replaceDone();
+}
+
 /** Initiate a replace of all matches that have been checked */
 void MatchModel::replaceChecked(const QRegularExpression &regExp, const QString &replaceString)
 {
     Q_ASSERT(m_docManager != nullptr);
-    if (m_replaceFile != -1) {
-        Q_ASSERT(m_replaceFile != -1);
+    if (m_replacing) {
         return; // already replacing
     }
 
-    m_replaceFile = 0;
     m_regExp = regExp;
     m_replaceText = replaceString;
     m_cancelReplace = false;
+    m_replacing = true;
+
+    // files not open in the editor are replaced on disk in parallel, that avoids loading them all as documents
+    // open documents go through the editor to respect unsaved changes and to allow undo
+    QVector<BulkReplaceJob> jobs;
+    m_documentReplaceRows.clear();
+    for (int i = 0; i < m_matchFiles.size(); ++i) {
+        const MatchFile &matchFile = m_matchFiles.at(i);
+        if (matchFile.checkState == Qt::Unchecked) {
+            continue;
+        }
+        if (!matchFile.fileUrl.isLocalFile() || m_docManager->findUrl(matchFile.fileUrl)) {
+            m_documentReplaceRows.push_back(i);
+            continue;
+        }
+
+        BulkReplaceJob job;
+        job.fileRow = i;
+        job.fileUrl = matchFile.fileUrl;
+        job.ranges.reserve(matchFile.matches.size());
+        for (const auto &match : matchFile.matches) {
+            const bool replace = match.checked && match.matchesFilter && match.replaceText.isEmpty();
+            job.ranges.push_back(replace ? match.range : KTextEditor::Range::invalid());
+        }
+        jobs.push_back(job);
+    }
+
+    m_replaceFilesDone = 0;
+    m_replaceFilesTotal = m_documentReplaceRows.size() + jobs.size();
+    if (!m_infoUpdateTimer.isActive()) {
+        m_infoUpdateTimer.start();
+    }
+
+    if (!jobs.isEmpty()) {
+        m_bulkReplacing = true;
+        m_bulkReplaceCanceled = std::make_shared<std::atomic<bool>>(false);
+        const QString pattern = regExp.pattern();
+        const QRegularExpression::PatternOptions options = regExp.patternOptions();
+        m_bulkReplaceWatcher.setFuture(QtConcurrent::mapped(jobs, [pattern, options, replaceString, canceled = m_bulkReplaceCanceled](const BulkReplaceJob &job) {
+            // an own expression per job, copies share the private data and with it the JIT lock
+            const QRegularExpression jobRegExp(pattern, options);
+            return replaceInFile(job, jobRegExp, replaceString, *canceled);
+        }));
+    }
+
+    m_replaceFile = 0;
     doReplaceNextMatch();
 }
 
@@ -482,6 +777,11 @@ void MatchModel::cancelReplace()
 {
     m_replaceFile = -1;
     m_cancelReplace = true;
+
+    // running workers finish their file, they still report it, files not started yet are skipped
+    if (m_bulkReplaceCanceled) {
+        *m_bulkReplaceCanceled = true;
+    }
 }
 
 void MatchModel::setFilterText(const QString &text)
@@ -530,6 +830,10 @@ QString MatchModel::infoHtmlString() const
         return QString();
     }
 
+    if (m_replacing) {
+        return i18n("<b><i>Replacing matches: %1 of %2 files done</i></b>", m_replaceFilesDone, m_replaceFilesTotal);
+    }
+
     int matchesTotal = 0;
     int checkedTotal = 0;
     for (const auto &matchFile : qAsConst(m_matchFiles)) {
@@ -568,6 +872,9 @@ QString MatchModel::infoHtmlString() const
     }
 
     QString checkedStr = i18np("One checked", "%1 checked", checkedTotal);
+    if (m_matchLimitReached) {
+        checkedStr = i18n("%1, search stopped at the limit of %2 matches", checkedStr, m_maxMatches);
+    }
 
     switch (m_searchPlace) {
     case CurrentFile:
@@ -635,16 +942,35 @@ QString MatchModel::fileToHtmlString(const MatchFile &matchFile) const
     return tmpStr;
 }
 
-QString MatchModel::matchToHtmlString(const Match &match) const
+MatchModel::MatchContext MatchModel::matchContext(const MatchFile &matchFile, const Match &match)
 {
-    QString pre = match.preMatchStr;
-    if (match.preMatchStr.size() == PreContextLen) {
+    if (match.lineIndex < 0 || match.lineIndex >= matchFile.lines.size()) {
+        return {};
+    }
+
+    // the cached text starts at the first line of the match, the context ends with the last line of it
+    const QString &text = matchFile.lines.at(match.lineIndex);
+    const int matchEnd = match.column + match.length;
+    int lineEnd = text.indexOf(QLatin1Char('\n'), matchEnd);
+    if (lineEnd == -1) {
+        lineEnd = text.size();
+    }
+    const auto [preContextStart, postContextLen] = contextLengths(lineEnd, match.column, matchEnd);
+
+    return {text.mid(preContextStart, match.column - preContextStart), text.mid(match.column, match.length), text.mid(matchEnd, qMin(postContextLen, lineEnd - matchEnd))};
+}
+
+QString MatchModel::matchToHtmlString(const MatchFile &matchFile, const Match &match) const
+{
+    const MatchContext context = matchContext(matchFile, match);
+
+    QString pre = context.pre;
+    if (context.pre.size() == PreContextLen) {
         pre.replace(0, 3, QLatin1String("..."));
     }
     pre = pre.toHtmlEscaped();
 
-    QString matchStr = match.matchStr.toHtmlEscaped();
-    ;
+    QString matchStr = context.match.toHtmlEscaped();
 
     QString replaceStr = match.replaceText.toHtmlEscaped();
 
@@ -660,7 +986,7 @@ QString MatchModel::matchToHtmlString(const Match &match) const
     matchStr.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
     matchStr.replace(QLatin1Char('\t'), QStringLiteral("\\t"));
 
-    QString post = match.postMatchStr;
+    QString post = context.post;
     int nlIndex = post.indexOf(QLatin1Char('\n'));
     if (nlIndex != -1) {
         post = post.mid(0, nlIndex);
@@ -683,6 +1009,10 @@ QString MatchModel::infoToPlainText() const
         return QString();
     }
 
+    if (m_replacing) {
+        return i18n("Replacing matches: %1 of %2 files done", m_replaceFilesDone, m_replaceFilesTotal);
+    }
+
     int matchesTotal = 0;
     int checkedTotal = 0;
     for (const auto &matchFile : qAsConst(m_matchFiles)) {
@@ -711,6 +1041,9 @@ QString MatchModel::infoToPlainText() const
     }
 
     QString checkedStr = i18np("One checked", "%1 checked", checkedTotal);
+    if (m_matchLimitReached) {
+        checkedStr = i18n("%1, search stopped at the limit of %2 matches", checkedStr, m_maxMatches);
+    }
 
     switch (m_searchPlace) {
     case CurrentFile:
@@ -755,11 +1088,13 @@ QString MatchModel::fileToPlainText(const MatchFile &matchFile) const
     return tmpStr;
 }
 
-QString MatchModel::matchToPlainText(const Match &match)
+QString MatchModel::matchToPlainText(const MatchFile &matchFile, const Match &match)
 {
-    QString pre = match.preMatchStr;
+    const MatchContext context = matchContext(matchFile, match);
+
+    QString pre = context.pre;
 
-    QString matchStr = match.matchStr;
+    QString matchStr = context.match;
     matchStr.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
 
     QString replaceStr = match.replaceText;
@@ -767,7 +1102,7 @@ QString MatchModel::matchToPlainText(const Match &match)
         matchStr = QLatin1String("----") + matchStr + QLatin1String("----");
         matchStr += QLatin1String("++++") + replaceStr + QLatin1String("++++");
     }
-    QString post = match.postMatchStr;
+    QString post = context.post;
 
     matchStr.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
     matchStr.replace(QLatin1Char('\t'), QStringLiteral("\\t"));
@@ -987,7 +1322,7 @@ QVariant MatchModel::data(const QModelIndex &index, int role) const
         const Match &match = m_matchFiles[fileRow].matches[matchRow];
         switch (role) {
         case Qt::DisplayRole:
-            return matchToHtmlString(match);
+            return matchToHtmlString(m_matchFiles[fileRow], match);
         case Qt::CheckStateRole:
             return match.checked ? Qt::Checked : Qt::Unchecked;
         case FileUrlRole:
@@ -1003,17 +1338,17 @@ QVariant MatchModel::data(const QModelIndex &index, int role) const
         case EndColumnRole:
             return match.range.end().column();
         case PreMatchRole:
-            return match.preMatchStr;
+            return matchContext(m_matchFiles[fileRow], match).pre;
         case MatchRole:
-            return match.matchStr;
+            return matchContext(m_matchFiles[fileRow], match).match;
         case PostMatchRole:
-            return match.postMatchStr;
+            return matchContext(m_matchFiles[fileRow], match).post;
         case ReplacedRole:
             return !match.replaceText.isEmpty();
         case ReplaceTextRole:
             return match.replaceText;
         case PlainTextRole:
-            return matchToPlainText(match);
+            return matchToPlainText(m_matchFiles[fileRow], match);
         case MatchItemRole:
             return QVariant::fromValue(match);
         case LastMatchedRangeInFileRole:
@@ -9,12 +9,16 @@
 
 #include <QAbstractItemModel>
 #include <QBrush>
+#include <QFutureWatcher>
 #include <QPointer>
 #include <QRegularExpression>
 #include <QString>
 #include <QTimer>
 #include <QUrl>
 
+#include <atomic>
+#include <memory>
+
 #include <KTextEditor/Cursor>
 #include <KTextEditor/MovingRange>
 #include <KTextEditor/Range>
@@ -23,15 +27,16 @@
 /**
  * data holder for one match in one file
  * used to transfer and hold multiple matches at once via signals to avoid heavy costs for files with a lot of matches
+ * the match doesn't store its text, that is computed on demand from the line cache of its file
  */
 class KateSearchMatch
 {
 public:
-    QString preMatchStr;
-    QString matchStr;
-    QString postMatchStr;
     QString replaceText;
     KTextEditor::Range range;
+    int lineIndex; // index of the text containing the match in the line cache of the file
+    int column; // start of the match in that text
+    int length; // length of the match in that text
     bool checked;
     bool matchesFilter;
 };
@@ -68,6 +73,12 @@ public:
     static constexpr int PreContextLen = 80;
     static constexpr int PostContextLen = 100;
 
+    /// Longer texts are not cached as a whole, only the context of each match is kept
+    static constexpr int MaxCachedTextLength = 1024;
+
+    /// Default for the maximal number of matches we collect per search
+    static constexpr int DefaultMaxMatches = 100000;
+
     typedef KateSearchMatch Match;
 
     /// Utility function that is used to figure out how much context text we want to show
@@ -98,14 +109,30 @@ public:
         return {preContextStart, postContextLen};
     }
 
+    /// Utility function for the searchers to append a match together with the text it needs for display
+    /// @p matches matches to append to
+    /// @p lines line cache to append to, consecutive matches in the same text share one entry
+    /// @p text text containing the match, from the start of its first line to the end of its last line
+    /// @p column start of the match in @p text
+    /// @p length length of the match
+    /// @p range range of the match in the document
+    static void appendMatch(QVector<KateSearchMatch> &matches, QStringList &lines, const QString &text, int column, int length, const KTextEditor::Range &range);
+
 private:
     struct MatchFile {
         QUrl fileUrl;
         QVector<KateSearchMatch> matches;
+        QStringList lines;
         QPointer<KTextEditor::Document> doc;
         Qt::CheckState checkState = Qt::Checked;
     };
 
+    struct MatchContext {
+        QString pre;
+        QString match;
+        QString post;
+    };
+
 public:
     MatchModel(QObject *parent = nullptr);
     ~MatchModel() override;
@@ -122,6 +149,21 @@ public:
 
     void setProjectName(const QString &projectName);
 
+    /** Set the maximal number of matches to collect, further matches are dropped. 0 means no limit */
+    void setMaxMatches(int maxMatches);
+
+    /** Total number of matches collected */
+    int matchCount() const
+    {
+        return m_matchCount;
+    }
+
+    /** Did we drop matches because we reached the limit? */
+    bool matchLimitReached() const
+    {
+        return m_matchLimitReached;
+    }
+
     /** This function clears all matches in all files */
     void clear();
 
@@ -145,15 +187,17 @@ public Q_SLOTS:
     int matchFileRow(const QUrl &fileUrl, KTextEditor::Document *doc) const;
 
     /** This function is used to add a new file */
+    /** @p lines is the line cache referenced by the matches */
     /** @p doc may be null if we are searching disk files for instance */
-    void addMatches(const QUrl &fileUrl, const QVector<KateSearchMatch> &searchMatches, KTextEditor::Document *doc);
+    void addMatches(const QUrl &fileUrl, const QVector<KateSearchMatch> &searchMatches, const QStringList &lines, KTextEditor::Document *doc);
 
     /** This function is used to set the last added file to the search list.
      * This is done to update the match tree when we generate the search file list. */
     void setFileListUpdate(const QString &path);
 
     /** Initiate a replace of all matches that have been checked.
-     * The actual replacing is split up into slot calls that are added to the event loop */
+     * Files not open in the editor are replaced directly on disk in worker threads.
+     * Open documents are replaced in slot calls that are added to the event loop */
     void replaceChecked(const QRegularExpression &regExp, const QString &replaceString);
 
     /** Cancel the replacing of checked matches. NOTE: This will only be handled when the next file is handled */
@@ -199,17 +243,46 @@ public:
 
 private Q_SLOTS:
     void doReplaceNextMatch();
+    void bulkReplaceResultReady(int resultIndex);
+    void bulkReplaceFinished();
 
 private:
+    /** Replace job for one file that is not open in the editor */
+    struct BulkReplaceJob {
+        int fileRow = -1;
+        QUrl fileUrl;
+        /** range per match, invalid for matches not to replace */
+        QVector<KTextEditor::Range> ranges;
+    };
+
+    /** Result of a BulkReplaceJob */
+    struct BulkReplaceResult {
+        int fileRow = -1;
+        QUrl fileUrl;
+        /** false if the file could not be handled on disk, it must be replaced via the editor then */
+        bool handled = false;
+        /** replacement text per match, null for matches not replaced */
+        QVector<QString> replaceTexts;
+    };
+
+    /** Replace the matches of one file directly on disk, called in worker threads, nothing is written once canceled */
+    static BulkReplaceResult
+    replaceInFile(const BulkReplaceJob &job, const QRegularExpression &regExp, const QString &replaceString, const std::atomic<bool> &canceled);
+
+    /** Emit replaceDone() if both the document and the on-disk replace are done */
+    void finishReplace();
+
     bool replaceMatch(KTextEditor::Document *doc, const QModelIndex &matchIndex, const QRegularExpression &regExp, const QString &replaceString);
 
     QString infoHtmlString() const;
     QString fileToHtmlString(const MatchFile &matchFile) const;
-    QString matchToHtmlString(const Match &match) const;
+    QString matchToHtmlString(const MatchFile &matchFile, const Match &match) const;
 
     QString infoToPlainText() const;
     QString fileToPlainText(const MatchFile &matchFile) const;
-    static QString matchToPlainText(const Match &match);
+    static QString matchToPlainText(const MatchFile &matchFile, const Match &match);
+
+    static MatchContext matchContext(const MatchFile &matchFile, const Match &match);
 
     bool setFileChecked(int fileRow, bool checked);
 
@@ -232,13 +305,24 @@ private:
     QString m_lastSearchPath;
     QTimer m_infoUpdateTimer;
     QString m_filterText;
+    int m_maxMatches = DefaultMaxMatches;
+    int m_matchCount = 0;
+    bool m_matchLimitReached = false;
 
     // Replacing related objects
     KTextEditor::Application *m_docManager = nullptr;
-    int m_replaceFile = -1;
+    int m_replaceFile = -1; // index in m_documentReplaceRows
+    QVector<int> m_documentReplaceRows; // rows of files replaced via the editor
     QRegularExpression m_regExp;
     QString m_replaceText;
     bool m_cancelReplace = true;
+    bool m_replacing = false;
+    QFutureWatcher<BulkReplaceResult> m_bulkReplaceWatcher;
+    // shared with the workers of the running bulk replace
+    std::shared_ptr<std::atomic<bool>> m_bulkReplaceCanceled;
+    bool m_bulkReplacing = false;
+    int m_replaceFilesDone = 0;
+    int m_replaceFilesTotal = 0;
 };
 
 // tests
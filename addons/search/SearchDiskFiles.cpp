@@ -9,13 +9,19 @@
 
 #include <QDir>
 #include <QElapsedTimer>
+#include <QTextCodec>
 #include <QTextStream>
 #include <QUrl>
 
+#include <algorithm>
+#include <cstring>
+
 SearchDiskFiles::SearchDiskFiles(SearchDiskFilesWorkList &worklist, const QRegularExpression &regexp, const bool includeBinaryFiles)
     : m_worklist(worklist)
     , m_regExp(regexp.pattern(), regexp.patternOptions()) // we WANT to kill the sharing, ELSE WE LOCK US DEAD!
+    , m_literalFilter(m_regExp)
     , m_includeBinaryFiles(includeBinaryFiles)
+    , m_canMapFiles(QTextCodec::codecForLocale()->mibEnum() == 106) // QTextStream decodes with the locale codec, we want that to be UTF-8
 {
     // ensure we have a proper thread name during e.g. perf profiling
     setObjectName(QStringLiteral("SearchDiskFiles"));
@@ -47,16 +53,17 @@ void SearchDiskFiles::run()
 
         // let the right search algorithm compute the matches for this file
         QVector<KateSearchMatch> matches;
+        m_lines.clear();
         if (multiLineSearch) {
             matches = searchMultiLineRegExp(file);
-        } else {
+        } else if (!searchSingleLineMapped(file, matches)) {
             matches = searchSingleLineRegExp(file);
         }
 
         // if we have matches or didn't emit something long enough, do so
         // we don't emit for all file to not stall get GUI and lock us a lot ;)
         if (!matches.isEmpty() || emitTimer.hasExpired(100)) {
-            Q_EMIT matchesFound(QUrl::fromLocalFile(file.fileName()), matches);
+            Q_EMIT matchesFound(QUrl::fromLocalFile(file.fileName()), matches, m_lines);
             emitTimer.restart();
         }
     }
@@ -77,41 +84,8 @@ QVector<KateSearchMatch> SearchDiskFiles::searchSingleLineRegExp(QFile &file)
             return matches;
         }
 
-        // match all occurrences in the current line
-        int columnToStartMatch = 0;
-        bool canceled = false;
-        while (true) {
-            // handle canceling
-            if (m_worklist.isCanceled()) {
-                canceled = true;
-                break;
-            }
-
-            // try match at the current interesting column, abort search loop if nothing found!
-            const QRegularExpressionMatch match = m_regExp.match(line, columnToStartMatch);
-            const int column = match.capturedStart();
-            if (column == -1 || match.capturedLength() == 0)
-                break;
-
-            // remember match
-            const int endColumn = column + match.capturedLength();
-            const auto [preContextStart, postContextLen] = MatchModel::contextLengths(line.size(), column, endColumn);
-            const QString preContext = line.mid(preContextStart, column - preContextStart);
-            const QString postContext = line.mid(endColumn, postContextLen);
-            matches.push_back(KateSearchMatch{preContext,
-                                              match.captured(),
-                                              postContext,
-                                              QString(),
-                                              KTextEditor::Range{currentLineNumber, column, currentLineNumber, column + match.capturedLength()},
-                                              true,
-                                              true});
-
-            // advance match column
-            columnToStartMatch = column + match.capturedLength();
-        }
-
-        // handle canceling => above we only did break out of the matching loop!
-        if (canceled) {
+        // match all occurrences in the current line, stop if canceled
+        if (!matchLine(line, currentLineNumber, matches)) {
             break;
         }
 
@@ -121,6 +95,108 @@ QVector<KateSearchMatch> SearchDiskFiles::searchSingleLineRegExp(QFile &file)
     return matches;
 }
 
+bool SearchDiskFiles::searchSingleLineMapped(QFile &file, QVector<KateSearchMatch> &matches)
+{
+    // without literal we must look at each line anyways, empty files or special files can't be mapped
+    const qint64 size = file.size();
+    if (!m_canMapFiles || !m_literalFilter.isValid() || size <= 0) {
+        return false;
+    }
+
+    uchar *mapped = file.map(0, size);
+    if (!mapped) {
+        return false;
+    }
+    const char *begin = reinterpret_cast<const char *>(mapped);
+    const char *end = begin + size;
+
+    // QTextStream detects UTF-16 by BOM, leave such files to it
+    if (size >= 2 && ((mapped[0] == 0xFF && mapped[1] == 0xFE) || (mapped[0] == 0xFE && mapped[1] == 0xFF))) {
+        file.unmap(mapped);
+        return false;
+    }
+
+    // check if not binary data....
+    // same as the line based search: one NUL byte anywhere kills all matches
+    if (!m_includeBinaryFiles && memchr(begin, 0, size)) {
+        file.unmap(mapped);
+        return true;
+    }
+
+    // skip UTF-8 BOM, QTextStream does that, too
+    if (size >= 3 && mapped[0] == 0xEF && mapped[1] == 0xBB && mapped[2] == 0xBF) {
+        begin += 3;
+    }
+
+    // we always continue at some line start, lines before 'counted' are already included in currentLineNumber
+    int currentLineNumber = 0;
+    const char *counted = begin;
+    const char *pos = begin;
+    while (pos < end) {
+        // find next candidate, no literal => no further match possible
+        const char *hit = m_literalFilter.find(pos, end);
+        if (!hit) {
+            break;
+        }
+
+        // expand to the full line
+        const char *lineStart = hit;
+        while (lineStart > pos && lineStart[-1] != '\n') {
+            --lineStart;
+        }
+        const char *lineEnd = static_cast<const char *>(memchr(hit, '\n', end - hit));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        currentLineNumber += std::count(counted, lineStart, '\n');
+        counted = lineStart;
+
+        // only now decode the line, strip \r of \r\n line endings like QTextStream
+        int lineLength = lineEnd - lineStart;
+        if (lineLength > 0 && lineStart[lineLength - 1] == '\r') {
+            --lineLength;
+        }
+        if (!matchLine(QString::fromUtf8(lineStart, lineLength), currentLineNumber, matches)) {
+            break;
+        }
+
+        // continue after this line
+        pos = (lineEnd < end) ? lineEnd + 1 : end;
+    }
+
+    file.unmap(mapped);
+    return true;
+}
+
+bool SearchDiskFiles::matchLine(const QString &line, int lineNumber, QVector<KateSearchMatch> &matches)
+{
+    int columnToStartMatch = 0;
+    while (true) {
+        // handle canceling
+        if (m_worklist.isCanceled()) {
+            return false;
+        }
+
+        // try match at the current interesting column, abort search loop if nothing found!
+        const QRegularExpressionMatch match = m_regExp.match(line, columnToStartMatch);
+        const int column = match.capturedStart();
+        if (column == -1 || match.capturedLength() == 0)
+            break;
+
+        // remember match, the line text is cached once for all its matches
+        MatchModel::appendMatch(matches,
+                                m_lines,
+                                line,
+                                column,
+                                match.capturedLength(),
+                                KTextEditor::Range{lineNumber, column, lineNumber, column + match.capturedLength()});
+
+        // advance match column
+        columnToStartMatch = column + match.capturedLength();
+    }
+    return true;
+}
+
 QVector<KateSearchMatch> SearchDiskFiles::searchMultiLineRegExp(QFile &file)
 {
     int column = 0;
@@ -181,12 +257,14 @@ QVector<KateSearchMatch> SearchDiskFiles::searchMultiLineRegExp(QFile &file)
         int lastNL = match.captured().lastIndexOf(QLatin1Char('\n'));
         int endColumn = lastNL == -1 ? startColumn + match.captured().length() : match.captured().length() - lastNL - 1;
 
-        int preContextStart = qMax(lineStart[line], column - MatchModel::PreContextLen);
-        QString preContext = fullDoc.mid(preContextStart, column - preContextStart);
-        QString postContext = fullDoc.mid(column + match.captured().length(), MatchModel::PostContextLen);
-
-        matches.push_back(
-            KateSearchMatch{preContext, match.captured(), postContext, QString(), KTextEditor::Range{line, startColumn, endLine, endColumn}, true, true});
+        // cache the text of all lines the match spans
+        const int textEnd = endLine + 1 < lineStart.size() ? lineStart[endLine + 1] - 1 : fullDoc.size();
+        MatchModel::appendMatch(matches,
+                                m_lines,
+                                fullDoc.mid(lineStart[line], textEnd - lineStart[line]),
+                                startColumn,
+                                match.capturedLength(),
+                                KTextEditor::Range{line, startColumn, endLine, endColumn});
 
         match = tmpRegExp.match(fullDoc, column + match.capturedLength());
         column = match.capturedStart();
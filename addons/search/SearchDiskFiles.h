@@ -21,6 +21,7 @@
 
 // locals
 #include "MatchModel.h"
+#include "SearchLiteralFilter.h"
 
 class QString;
 class QUrl;
@@ -171,16 +172,45 @@ public:
     void run() override;
 
 Q_SIGNALS:
-    void matchesFound(const QUrl &url, const QVector<KateSearchMatch> &searchMatches, KTextEditor::Document *doc = nullptr);
+    void matchesFound(const QUrl &url, const QVector<KateSearchMatch> &searchMatches, const QStringList &lines, KTextEditor::Document *doc = nullptr);
 
 private:
     QVector<KateSearchMatch> searchSingleLineRegExp(QFile &file);
     QVector<KateSearchMatch> searchMultiLineRegExp(QFile &file);
 
+    /**
+     * Fast path for single line searches with some required literal.
+     * Maps the file, looks for the literal in the raw bytes and only decodes & matches the lines containing it.
+     * @param file file to search
+     * @param matches matches found
+     * @return false if the file can't be handled this way, use searchSingleLineRegExp then
+     */
+    bool searchSingleLineMapped(QFile &file, QVector<KateSearchMatch> &matches);
+
+    /**
+     * Match all occurrences in one line.
+     * @param line line text
+     * @param lineNumber line number in file
+     * @param matches matches found get appended, the line gets added to m_lines if it matched
+     * @return false if canceled
+     */
+    bool matchLine(const QString &line, int lineNumber, QVector<KateSearchMatch> &matches);
+
 private:
     SearchDiskFilesWorkList &m_worklist;
     const QRegularExpression m_regExp;
+    const SearchLiteralFilter m_literalFilter;
     bool m_includeBinaryFiles = false;
+
+    /**
+     * texts of the matches found in the current file, see MatchModel::appendMatch
+     */
+    QStringList m_lines;
+
+    /**
+     * can we decode mapped files as UTF-8 like QTextStream would do?
+     */
+    bool m_canMapFiles = false;
 };
 
 #endif
@@ -0,0 +1,287 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "SearchLiteralFilter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+/**
+ * Is the given character safe to be matched as ASCII case-insensitive literal?
+ * PCRE with Unicode case folding lets k and s match the Kelvin sign and the long s, too.
+ */
+static bool isCaseSafe(const QString &atom)
+{
+    if (atom.size() != 1 || atom[0].unicode() >= 128) {
+        return false;
+    }
+    const char c = atom[0].toLower().toLatin1();
+    return c != 'k' && c != 's';
+}
+
+/**
+ * Skip a character class starting at pattern[i] == '['.
+ * @return index of the closing ']' or -1 if unterminated
+ */
+static int skipCharacterClass(const QString &pattern, int i)
+{
+    ++i;
+    if (i < pattern.size() && pattern[i] == QLatin1Char('^')) {
+        ++i;
+    }
+    // a leading ] is literal
+    if (i < pattern.size() && pattern[i] == QLatin1Char(']')) {
+        ++i;
+    }
+    for (; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        if (c == QLatin1Char('\\')) {
+            ++i;
+        } else if (c == QLatin1Char('[') && i + 1 < pattern.size() && pattern[i + 1] == QLatin1Char(':')) {
+            // POSIX class like [:alpha:]
+            const int end = pattern.indexOf(QLatin1String(":]"), i + 2);
+            if (end == -1) {
+                return -1;
+            }
+            i = end + 1;
+        } else if (c == QLatin1Char(']')) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Skip a group starting at pattern[i] == '('.
+ * @return index of the matching ')' or -1 if unbalanced or some construct we don't handle
+ */
+static int skipGroup(const QString &pattern, int i)
+{
+    // only allow plain groups, non-capturing groups, named groups & lookarounds
+    // anything else like inline options or verbs might change the meaning of the remaining pattern
+    if (i + 1 < pattern.size() && pattern[i + 1] == QLatin1Char('*')) {
+        return -1;
+    }
+    if (i + 2 < pattern.size() && pattern[i + 1] == QLatin1Char('?')) {
+        const QChar c = pattern[i + 2];
+        if (c != QLatin1Char(':') && c != QLatin1Char('=') && c != QLatin1Char('!') && c != QLatin1Char('<') && c != QLatin1Char('P')
+            && c != QLatin1Char('\'')) {
+            return -1;
+        }
+    }
+
+    int depth = 0;
+    for (; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        if (c == QLatin1Char('\\')) {
+            ++i;
+        } else if (c == QLatin1Char('[')) {
+            i = skipCharacterClass(pattern, i);
+            if (i == -1) {
+                return -1;
+            }
+        } else if (c == QLatin1Char('(')) {
+            ++depth;
+        } else if (c == QLatin1Char(')')) {
+            if (--depth == 0) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * Parse a quantifier following some atom, starting at pattern[i].
+ * @param minRepeat filled with the minimal repeat count, untouched if no quantifier
+ * @return index after the quantifier, i if there is none
+ */
+static int parseQuantifier(const QString &pattern, int i, int &minRepeat)
+{
+    if (i >= pattern.size()) {
+        return i;
+    }
+
+    int next = i;
+    const QChar c = pattern[i];
+    if (c == QLatin1Char('*') || c == QLatin1Char('?')) {
+        minRepeat = 0;
+        next = i + 1;
+    } else if (c == QLatin1Char('+')) {
+        minRepeat = 1;
+        next = i + 1;
+    } else if (c == QLatin1Char('{')) {
+        // {n}, {n,} or {n,m}, else the brace is a literal
+        static const QRegularExpression braces(QStringLiteral("\\{(\\d+)(,\\d*)?\\}"));
+        const auto match = braces.match(pattern, i, QRegularExpression::NormalMatch, QRegularExpression::AnchoredMatchOption);
+        if (!match.hasMatch()) {
+            return i;
+        }
+        minRepeat = match.capturedRef(1).toInt();
+        next = match.capturedEnd();
+    } else {
+        return i;
+    }
+
+    // lazy or possessive modifier
+    if (next < pattern.size() && (pattern[next] == QLatin1Char('?') || pattern[next] == QLatin1Char('+'))) {
+        ++next;
+    }
+    return next;
+}
+
+QStringList SearchLiteralFilter::requiredLiterals(const QString &pattern, bool caseInsensitive)
+{
+    QStringList literals;
+    QString current;
+    const auto flush = [&literals, &current]() {
+        if (!current.isEmpty()) {
+            literals << current;
+            current.clear();
+        }
+    };
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        // parse one atom, either some literal character or something we can't use as literal
+        QString atom;
+        const QChar c = pattern[i];
+        if (c == QLatin1Char('\\')) {
+            if (++i >= pattern.size()) {
+                return {};
+            }
+            const QChar e = pattern[i];
+            if (e == QLatin1Char('t')) {
+                atom = QStringLiteral("\t");
+            } else if (e.unicode() < 128 && e.isLetterOrNumber()) {
+                // escapes with arguments or quoting: bail out, we don't want to parse them
+                static const QString withArguments = QStringLiteral("xopPNgkcQE0123456789");
+                if (withArguments.contains(e)) {
+                    return {};
+                }
+                // else some class or assertion, no literal
+            } else {
+                atom = e;
+                if (e.isHighSurrogate() && i + 1 < pattern.size()) {
+                    atom += pattern[++i];
+                }
+            }
+        } else if (c == QLatin1Char('|')) {
+            // top level alternation, nothing is required
+            return {};
+        } else if (c == QLatin1Char('(')) {
+            i = skipGroup(pattern, i);
+            if (i == -1) {
+                return {};
+            }
+        } else if (c == QLatin1Char('[')) {
+            i = skipCharacterClass(pattern, i);
+            if (i == -1) {
+                return {};
+            }
+        } else if (c == QLatin1Char('.') || c == QLatin1Char('^') || c == QLatin1Char('$')) {
+            // no literal
+        } else if (c == QLatin1Char('*') || c == QLatin1Char('+') || c == QLatin1Char('?') || c == QLatin1Char('{') || c == QLatin1Char(')')) {
+            // misplaced meta character, let the regular expression engine handle this
+            return {};
+        } else {
+            atom = c;
+            if (c.isHighSurrogate() && i + 1 < pattern.size()) {
+                atom += pattern[++i];
+            }
+        }
+
+        // handle quantifier, if any
+        int minRepeat = 1;
+        const int afterQuantifier = parseQuantifier(pattern, i + 1, minRepeat);
+        const bool hasQuantifier = afterQuantifier != i + 1;
+        i = afterQuantifier - 1;
+
+        // atom not usable or optional => literal ends here
+        if (atom.isEmpty() || minRepeat == 0 || (caseInsensitive && !isCaseSafe(atom))) {
+            flush();
+            continue;
+        }
+
+        // atom is required, if repeated, the literal can't continue after it
+        current += atom;
+        if (hasQuantifier) {
+            flush();
+        }
+    }
+
+    flush();
+    return literals;
+}
+
+SearchLiteralFilter::SearchLiteralFilter(const QRegularExpression &regExp)
+    : m_caseInsensitive(regExp.patternOptions() & QRegularExpression::CaseInsensitiveOption)
+{
+    // extended syntax allows whitespace & comments everywhere, don't try to handle that
+    if (!regExp.isValid() || (regExp.patternOptions() & QRegularExpression::ExtendedPatternSyntaxOption)) {
+        return;
+    }
+
+    // use the longest literal, that should result in the least false positives
+    const QStringList literals = requiredLiterals(regExp.pattern(), m_caseInsensitive);
+    for (const auto &literal : literals) {
+        const QByteArray utf8 = m_caseInsensitive ? literal.toLower().toUtf8() : literal.toUtf8();
+        if (utf8.size() > m_literal.size()) {
+            m_literal = utf8;
+        }
+    }
+}
+
+const char *SearchLiteralFilter::find(const char *begin, const char *end) const
+{
+    const size_t literalSize = m_literal.size();
+    if (literalSize == 0 || static_cast<size_t>(end - begin) < literalSize) {
+        return nullptr;
+    }
+
+    if (!m_caseInsensitive) {
+#ifdef __GLIBC__
+        // glibc memmem is vectorized
+        return static_cast<const char *>(memmem(begin, end - begin, m_literal.constData(), literalSize));
+#else
+        const auto it = std::search(begin, end, std::boyer_moore_horspool_searcher(m_literal.cbegin(), m_literal.cend()));
+        return (it == end) ? nullptr : it;
+#endif
+    }
+
+    // case-insensitive: memchr for both cases of the first character, then compare the rest
+    // the literal is lower case ASCII only
+    const char lower = m_literal[0];
+    const char upper = QChar::fromLatin1(lower).toUpper().toLatin1();
+    const char *last = end - literalSize + 1;
+    const char *nextLower = nullptr;
+    const char *nextUpper = nullptr;
+    const char *pos = begin;
+    while (pos < last) {
+        if (!nextLower || nextLower < pos) {
+            nextLower = static_cast<const char *>(memchr(pos, lower, last - pos));
+            if (!nextLower) {
+                nextLower = last;
+            }
+        }
+        if (!nextUpper || nextUpper < pos) {
+            nextUpper = (upper == lower) ? last : static_cast<const char *>(memchr(pos, upper, last - pos));
+            if (!nextUpper) {
+                nextUpper = last;
+            }
+        }
+
+        const char *candidate = std::min(nextLower, nextUpper);
+        if (candidate == last) {
+            return nullptr;
+        }
+        if (qstrnicmp(candidate + 1, m_literal.constData() + 1, literalSize - 1) == 0) {
+            return candidate;
+        }
+        pos = candidate + 1;
+    }
+    return nullptr;
+}
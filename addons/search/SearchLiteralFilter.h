@@ -0,0 +1,78 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef SearchLiteralFilter_h
+#define SearchLiteralFilter_h
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QStringList>
+
+/**
+ * Prefilter for single line searches.
+ *
+ * Extracts the literal substrings any match of a regular expression must contain
+ * and allows to look for the longest of them in raw UTF-8 bytes.
+ * Only lines containing that literal need to be decoded and matched against the real expression.
+ */
+class SearchLiteralFilter
+{
+public:
+    /**
+     * Construct the filter for the given expression.
+     * @param regExp expression we will search for, must not be a multi-line search
+     */
+    explicit SearchLiteralFilter(const QRegularExpression &regExp);
+
+    /**
+     * Did we find some required literal?
+     * If not, the filter can't be used and all lines must be matched.
+     * @return filter usable?
+     */
+    bool isValid() const
+    {
+        return !m_literal.isEmpty();
+    }
+
+    /**
+     * Required literal we search for, UTF-8 encoded, lower case for case-insensitive searches.
+     * @return literal to search
+     */
+    const QByteArray &literal() const
+    {
+        return m_literal;
+    }
+
+    /**
+     * Find the next occurrence of the literal in the given byte range.
+     * @param begin start of range
+     * @param end end of range
+     * @return start of the next occurrence or nullptr if none found
+     */
+    const char *find(const char *begin, const char *end) const;
+
+    /**
+     * Compute the literal substrings each match of the pattern must contain.
+     * This is conservative: if we are not sure about some construct, nothing is returned.
+     * @param pattern regular expression pattern
+     * @param caseInsensitive will the pattern be matched case-insensitive? then we only keep case-safe ASCII literals
+     * @return required literals, in pattern order, might be empty
+     */
+    static QStringList requiredLiterals(const QString &pattern, bool caseInsensitive);
+
+private:
+    /**
+     * required literal, empty if none
+     */
+    QByteArray m_literal;
+
+    /**
+     * shall we compare ASCII case-insensitive?
+     */
+    bool m_caseInsensitive = false;
+};
+
+#endif
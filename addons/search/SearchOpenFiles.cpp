@@ -6,14 +6,21 @@
 
 #include "SearchOpenFiles.h"
 
+#include <QPointer>
+#include <QThreadPool>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+
 SearchOpenFiles::SearchOpenFiles(QObject *parent)
     : QObject(parent)
 {
-    m_nextRunTimer.setInterval(0);
-    m_nextRunTimer.setSingleShot(true);
-    connect(&m_nextRunTimer, &QTimer::timeout, this, [this]() {
-        doSearchNextFile(m_nextLine);
-    });
+}
+
+void SearchOpenFiles::setThreadPool(QThreadPool *threadPool)
+{
+    m_threadPool = threadPool;
 }
 
 bool SearchOpenFiles::searching() const
@@ -23,60 +30,93 @@ bool SearchOpenFiles::searching() const
 
 void SearchOpenFiles::startSearch(const QList<KTextEditor::Document *> &list, const QRegularExpression &regexp)
 {
-    if (m_nextFileIndex != -1) {
+    if (searching()) {
         return;
     }
 
-    m_docList = list;
-    m_nextFileIndex = 0;
-    m_regExp = regexp;
     m_cancelSearch = false;
-    m_terminateSearch = false;
+    m_canceled = std::make_shared<std::atomic<bool>>(false);
+    m_pendingDocuments = list.size();
     m_statusTime.restart();
-    m_nextLine = 0;
-    m_nextRunTimer.start(0);
+
+    if (list.isEmpty()) {
+        m_cancelSearch = true;
+        QTimer::singleShot(0, this, &SearchOpenFiles::searchDone);
+        return;
+    }
+
+    Q_ASSERT(m_threadPool);
+    const QString pattern = regexp.pattern();
+    const QRegularExpression::PatternOptions options = regexp.patternOptions();
+    for (KTextEditor::Document *document : list) {
+        // snapshot the text, the lines are implicitly shared with the document and stay unchanged if it is edited
+        QStringList lines;
+        lines.reserve(document->lines());
+        for (int i = 0; i < document->lines(); ++i) {
+            lines.push_back(document->line(i));
+        }
+        const QUrl url = document->url();
+        const QPointer<KTextEditor::Document> doc(document);
+
+        // search it in the background, the results are handed back to the main thread
+        // the pool is destructed before us, this ensures this object exists as long as the workers run
+        QtConcurrent::run(m_threadPool, [this, canceled = m_canceled, doc, url, lines, pattern, options]() {
+            // an own expression per task, copies share the private data and with it the JIT lock
+            const QRegularExpression regexp(pattern, options);
+            QVector<KateSearchMatch> matches;
+            QStringList matchLines;
+            const auto stop = [&canceled]() {
+                return canceled->load();
+            };
+            searchLines(lines, regexp, 0, stop, matches, matchLines);
+            QMetaObject::invokeMethod(
+                this,
+                [this, canceled, doc, url, matches, matchLines]() {
+                    documentSearched(canceled, doc.data(), url, matches, matchLines);
+                },
+                Qt::QueuedConnection);
+        });
+    }
 }
 
-void SearchOpenFiles::terminateSearch()
+void SearchOpenFiles::documentSearched(const std::shared_ptr<std::atomic<bool>> &canceled,
+                                       KTextEditor::Document *doc,
+                                       const QUrl &url,
+                                       const QVector<KateSearchMatch> &matches,
+                                       const QStringList &matchLines)
 {
-    m_cancelSearch = true;
-    m_terminateSearch = true;
-    m_nextFileIndex = -1;
-    m_nextLine = -1;
-    m_nextRunTimer.stop();
+    // results of some old or canceled search?
+    if (canceled != m_canceled || canceled->load()) {
+        return;
+    }
+
+    if (m_statusTime.elapsed() > 100) {
+        m_statusTime.restart();
+        Q_EMIT searching(url.toString());
+    }
+
+    // the document might be closed in between, then we just drop its results
+    if (doc) {
+        Q_EMIT matchesFound(url, matches, matchLines, doc);
+    }
+
+    if (--m_pendingDocuments == 0) {
+        m_cancelSearch = true;
+        Q_EMIT searchDone();
+    }
 }
 
-void SearchOpenFiles::cancelSearch()
+void SearchOpenFiles::terminateSearch()
 {
-    m_cancelSearch = true;
+    cancelSearch();
 }
 
-void SearchOpenFiles::doSearchNextFile(int startLine)
+void SearchOpenFiles::cancelSearch()
 {
-    if (m_cancelSearch || m_nextFileIndex >= m_docList.size()) {
-        m_nextFileIndex = -1;
-        m_cancelSearch = true;
-        m_nextLine = -1;
-        return;
-    }
-
-    // NOTE The document managers signal documentWillBeDeleted() must be connected to
-    // cancelSearch(). A closed file could lead to a crash if it is not handled.
-    int line = searchOpenFile(m_docList[m_nextFileIndex], m_regExp, startLine);
-    if (line == 0) {
-        // file searched go to next
-        m_nextFileIndex++;
-        if (m_nextFileIndex == m_docList.size()) {
-            m_nextFileIndex = -1;
-            m_cancelSearch = true;
-            Q_EMIT searchDone();
-        } else {
-            m_nextLine = 0;
-        }
-    } else {
-        m_nextLine = line;
+    m_cancelSearch = true;
+    if (m_canceled) {
+        m_canceled->store(true);
     }
-    m_nextRunTimer.start();
 }
 
 int SearchOpenFiles::searchOpenFile(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine)
@@ -86,87 +126,107 @@ int SearchOpenFiles::searchOpenFile(KTextEditor::Document *doc, const QRegularEx
         Q_EMIT searching(doc->url().toString());
     }
 
+    QStringList lines;
+    lines.reserve(doc->lines());
+    for (int i = 0; i < doc->lines(); ++i) {
+        lines.push_back(doc->line(i));
+    }
+
+    QElapsedTimer time;
+    time.start();
+    QVector<KateSearchMatch> matches;
+    QStringList matchLines;
+    const int resultLine = searchLines(
+        lines,
+        regExp,
+        startLine,
+        [&time]() {
+            return time.elapsed() > 100;
+        },
+        matches,
+        matchLines);
+
+    // Q_EMIT all matches batched
+    Q_EMIT matchesFound(doc->url(), matches, matchLines, doc);
+
+    return resultLine;
+}
+
+int SearchOpenFiles::searchLines(const QStringList &lines,
+                                 const QRegularExpression &regExp,
+                                 int startLine,
+                                 const std::function<bool()> &stop,
+                                 QVector<KateSearchMatch> &matches,
+                                 QStringList &matchLines)
+{
     if (regExp.pattern().contains(QLatin1String("\\n"))) {
-        return searchMultiLineRegExp(doc, regExp, startLine);
+        return searchMultiLineRegExp(lines, regExp, startLine, stop, matches, matchLines);
     }
 
-    return searchSingleLineRegExp(doc, regExp, startLine);
+    return searchSingleLineRegExp(lines, regExp, startLine, stop, matches, matchLines);
 }
 
-int SearchOpenFiles::searchSingleLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine)
+int SearchOpenFiles::searchSingleLineRegExp(const QStringList &lines,
+                                            const QRegularExpression &regExp,
+                                            int startLine,
+                                            const std::function<bool()> &stop,
+                                            QVector<KateSearchMatch> &matches,
+                                            QStringList &matchLines)
 {
     int column;
-    QElapsedTimer time;
-
-    time.start();
-    int resultLine = 0;
-    QVector<KateSearchMatch> matches;
-    for (int line = startLine; line < doc->lines(); line++) {
-        if (time.elapsed() > 100) {
-            // qDebug() << "Search time exceeded" << time.elapsed() << line;
-            resultLine = line;
-            break;
+    for (int line = startLine; line < lines.size(); line++) {
+        if (stop()) {
+            return line;
         }
+        const QString &lineStr = lines.at(line);
         QRegularExpressionMatch match;
-        match = regExp.match(doc->line(line));
+        match = regExp.match(lineStr);
         column = match.capturedStart();
 
         while (column != -1 && !match.captured().isEmpty()) {
-            int endColumn = column + match.capturedLength();
-            const QString &lineStr = doc->line(line);
-            const auto [preContextStart, postContextLen] = MatchModel::contextLengths(lineStr.size(), column, endColumn);
-            QString preContext = lineStr.mid(preContextStart, column - preContextStart);
-            QString postContext = lineStr.mid(endColumn, postContextLen);
-
-            matches.push_back(KateSearchMatch{preContext,
-                                              match.captured(),
-                                              postContext,
-                                              QString(),
-                                              KTextEditor::Range{line, column, line, column + match.capturedLength()},
-                                              true,
-                                              true});
-            match = regExp.match(doc->line(line), column + match.capturedLength());
+            MatchModel::appendMatch(matches,
+                                    matchLines,
+                                    lineStr,
+                                    column,
+                                    match.capturedLength(),
+                                    KTextEditor::Range{line, column, line, column + match.capturedLength()});
+            match = regExp.match(lineStr, column + match.capturedLength());
             column = match.capturedStart();
         }
     }
 
-    // Q_EMIT all matches batched
-    Q_EMIT matchesFound(doc->url(), matches, doc);
-
-    return resultLine;
+    return 0;
 }
 
-int SearchOpenFiles::searchMultiLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int inStartLine)
+int SearchOpenFiles::searchMultiLineRegExp(const QStringList &lines,
+                                           const QRegularExpression &regExp,
+                                           int inStartLine,
+                                           const std::function<bool()> &stop,
+                                           QVector<KateSearchMatch> &matches,
+                                           QStringList &matchLines)
 {
-    int column = 0;
-    int startLine = 0;
-    QElapsedTimer time;
-    time.start();
     QRegularExpression tmpRegExp = regExp;
 
-    if (inStartLine == 0) {
-        // Copy the whole file to a temporary buffer to be able to search newlines
-        m_fullDoc.clear();
-        m_lineStart.clear();
-        m_lineStart << 0;
-        for (int i = 0; i < doc->lines(); i++) {
-            m_fullDoc += doc->line(i) + QLatin1Char('\n');
-            m_lineStart << m_fullDoc.size();
-        }
-        if (!regExp.pattern().endsWith(QLatin1Char('$'))) {
-            // if regExp ends with '$' leave the extra newline at the end as
-            // '$' will be replaced with (?=\\n), which needs the extra newline
-            m_fullDoc.remove(m_fullDoc.size() - 1, 1);
-        }
-    } else {
-        if (inStartLine > 0 && inStartLine < m_lineStart.size()) {
-            column = m_lineStart[inStartLine];
-            startLine = inStartLine;
-        } else {
-            return 0;
-        }
+    // Copy the whole file to a temporary buffer to be able to search newlines
+    QString fullDoc;
+    QVector<int> lineStart;
+    lineStart.reserve(lines.size() + 1);
+    lineStart << 0;
+    for (const QString &line : lines) {
+        fullDoc += line + QLatin1Char('\n');
+        lineStart << fullDoc.size();
+    }
+    if (!regExp.pattern().endsWith(QLatin1Char('$'))) {
+        // if regExp ends with '$' leave the extra newline at the end as
+        // '$' will be replaced with (?=\\n), which needs the extra newline
+        fullDoc.chop(1);
     }
 
+    if (inStartLine < 0 || inStartLine >= lineStart.size()) {
+        return 0;
+    }
+    int column = lineStart[inStartLine];
+
     if (regExp.pattern().endsWith(QLatin1Char('$'))) {
         QString newPatern = tmpRegExp.pattern();
         newPatern.replace(QStringLiteral("$"), QStringLiteral("(?=\\n)"));
@@ -174,47 +234,35 @@ int SearchOpenFiles::searchMultiLineRegExp(KTextEditor::Document *doc, const QRe
     }
 
     QRegularExpressionMatch match;
-    match = tmpRegExp.match(m_fullDoc, column);
+    match = tmpRegExp.match(fullDoc, column);
     column = match.capturedStart();
-    int resultLine = 0;
-    QVector<KateSearchMatch> matches;
     while (column != -1 && !match.captured().isEmpty()) {
         // search for the line number of the match
-        int i;
-        startLine = -1;
-        for (i = 1; i < m_lineStart.size(); i++) {
-            if (m_lineStart[i] > column) {
-                startLine = i - 1;
-                break;
-            }
-        }
-        if (startLine == -1) {
+        const int startLine = std::upper_bound(lineStart.cbegin() + 1, lineStart.cend(), column) - lineStart.cbegin() - 1;
+        if (startLine >= lines.size()) {
             break;
         }
 
-        int startColumn = (column - m_lineStart[startLine]);
+        int startColumn = (column - lineStart[startLine]);
         int endLine = startLine + match.captured().count(QLatin1Char('\n'));
         int lastNL = match.captured().lastIndexOf(QLatin1Char('\n'));
         int endColumn = lastNL == -1 ? startColumn + match.captured().length() : match.captured().length() - lastNL - 1;
 
-        int preContextStart = qMax(0, startColumn - MatchModel::PreContextLen);
-        QString preContext = doc->line(startLine).mid(preContextStart, startColumn - preContextStart);
-        QString postContext = doc->line(endLine).mid(endColumn, MatchModel::PostContextLen);
-
-        matches.push_back(
-            KateSearchMatch{preContext, match.captured(), postContext, QString(), KTextEditor::Range{startLine, startColumn, endLine, endColumn}, true, true});
-        match = tmpRegExp.match(m_fullDoc, column + match.capturedLength());
+        // cache the text of all lines the match spans
+        const int textEnd = endLine + 1 < lineStart.size() ? qMin(lineStart[endLine + 1] - 1, fullDoc.size()) : fullDoc.size();
+        MatchModel::appendMatch(matches,
+                                matchLines,
+                                fullDoc.mid(lineStart[startLine], textEnd - lineStart[startLine]),
+                                startColumn,
+                                match.capturedLength(),
+                                KTextEditor::Range{startLine, startColumn, endLine, endColumn});
+        match = tmpRegExp.match(fullDoc, column + match.capturedLength());
         column = match.capturedStart();
 
-        if (time.elapsed() > 100) {
-            // qDebug() << "Search time exceeded" << time.elapsed() << line;
-            resultLine = startLine;
-            break;
+        if (stop()) {
+            return startLine;
         }
     }
 
-    // Q_EMIT all matches batched
-    Q_EMIT matchesFound(doc->url(), matches, doc);
-
-    return resultLine;
+    return 0;
 }
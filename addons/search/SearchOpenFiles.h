@@ -10,11 +10,17 @@
 #include <QElapsedTimer>
 #include <QObject>
 #include <QRegularExpression>
-#include <QTimer>
+#include <QStringList>
 #include <ktexteditor/document.h>
 
+#include <atomic>
+#include <functional>
+#include <memory>
+
 #include "MatchModel.h"
 
+class QThreadPool;
+
 class SearchOpenFiles : public QObject
 {
     Q_OBJECT
@@ -22,6 +28,17 @@ class SearchOpenFiles : public QObject
 public:
     SearchOpenFiles(QObject *parent = nullptr);
 
+    /**
+     * Set the thread pool the documents are searched in.
+     * The pool must outlive all searches, e.g. by being destructed before this object.
+     * @param threadPool pool to use
+     */
+    void setThreadPool(QThreadPool *threadPool);
+
+    /**
+     * Search the given documents in the background.
+     * Each document's text is snapshotted here, the search itself runs in the thread pool.
+     */
     void startSearch(const QList<KTextEditor::Document *> &list, const QRegularExpression &regexp);
     bool searching() const;
     void terminateSearch();
@@ -29,31 +46,69 @@ public:
 public Q_SLOTS:
     void cancelSearch();
 
+    /// Search one document synchronously, limited to 100ms.
     /// return 0 on success or a line number where we stopped.
     int searchOpenFile(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine);
 
-private Q_SLOTS:
-    void doSearchNextFile(int startLine);
-
 private:
-    int searchSingleLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine);
-    int searchMultiLineRegExp(KTextEditor::Document *doc, const QRegularExpression &regExp, int startLine);
+    /**
+     * Search the given lines, used from the worker threads, too.
+     * @param lines text snapshot of a document
+     * @param regExp expression to search
+     * @param startLine first line to search
+     * @param stop polled between matches, returns true if we shall stop
+     * @param matches found matches get appended
+     * @param matchLines texts of the matches, see MatchModel::appendMatch
+     * @return 0 if done or the line number where we stopped
+     */
+    static int searchLines(const QStringList &lines,
+                           const QRegularExpression &regExp,
+                           int startLine,
+                           const std::function<bool()> &stop,
+                           QVector<KateSearchMatch> &matches,
+                           QStringList &matchLines);
+    static int searchSingleLineRegExp(const QStringList &lines,
+                                      const QRegularExpression &regExp,
+                                      int startLine,
+                                      const std::function<bool()> &stop,
+                                      QVector<KateSearchMatch> &matches,
+                                      QStringList &matchLines);
+    static int searchMultiLineRegExp(const QStringList &lines,
+                                     const QRegularExpression &regExp,
+                                     int startLine,
+                                     const std::function<bool()> &stop,
+                                     QVector<KateSearchMatch> &matches,
+                                     QStringList &matchLines);
+
+    /**
+     * Take the results of one document searched in the background, called in the main thread.
+     */
+    void documentSearched(const std::shared_ptr<std::atomic<bool>> &canceled,
+                          KTextEditor::Document *doc,
+                          const QUrl &url,
+                          const QVector<KateSearchMatch> &matches,
+                          const QStringList &matchLines);
 
 Q_SIGNALS:
-    void matchesFound(const QUrl &url, const QVector<KateSearchMatch> &searchMatches, KTextEditor::Document *doc);
+    void matchesFound(const QUrl &url, const QVector<KateSearchMatch> &searchMatches, const QStringList &lines, KTextEditor::Document *doc);
     void searchDone();
     void searching(const QString &file);
 
 private:
-    QList<KTextEditor::Document *> m_docList;
-    int m_nextFileIndex = -1;
-    QTimer m_nextRunTimer;
-    int m_nextLine = -1;
-    QRegularExpression m_regExp;
+    QThreadPool *m_threadPool = nullptr;
     bool m_cancelSearch = true;
-    bool m_terminateSearch = false;
-    QString m_fullDoc;
-    QVector<int> m_lineStart;
+
+    /**
+     * cancel flag of the running background search, shared with its workers
+     * each search gets a new one, results of older searches are ignored
+     */
+    std::shared_ptr<std::atomic<bool>> m_canceled;
+
+    /**
+     * documents of the running background search we still wait for
+     */
+    int m_pendingDocuments = 0;
+
     QElapsedTimer m_statusTime;
 };
 
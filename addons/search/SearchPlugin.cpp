@@ -10,6 +10,7 @@
 #include "MatchExportDialog.h"
 #include "MatchProxyModel.h"
 #include "Results.h"
+#include "SearchLiteralFilter.h"
 
 #include <ktexteditor/configinterface.h>
 #include <ktexteditor/document.h>
@@ -33,6 +34,7 @@
 #include <QComboBox>
 #include <QCompleter>
 #include <QFileInfo>
+#include <QInputDialog>
 #include <QKeyEvent>
 #include <QMenu>
 #include <QPoint>
@@ -40,6 +42,8 @@
 
 #include <ktexteditor_utils.h>
 
+#include <limits>
+
 static QUrl localFileDirUp(const QUrl &url)
 {
     if (!url.isLocalFile()) {
@@ -437,6 +441,7 @@ KatePluginSearchView::KatePluginSearchView(KTextEditor::Plugin *plugin, KTextEdi
 
     m_ui.displayOptions->setChecked(true);
 
+    m_searchOpenFiles.setThreadPool(&m_searchDiskFilePool);
     connect(&m_searchOpenFiles, &SearchOpenFiles::matchesFound, this, &KatePluginSearchView::matchesFound);
     connect(&m_searchOpenFiles, &SearchOpenFiles::searchDone, this, &KatePluginSearchView::searchDone);
 
@@ -563,6 +568,8 @@ KatePluginSearchView::KatePluginSearchView(KTextEditor::Plugin *plugin, KTextEdi
 
 KatePluginSearchView::~KatePluginSearchView()
 {
+    // the open files are searched in the disk file pool, too, don't wait for them to be done
+    m_searchOpenFiles.cancelSearch();
     cancelDiskFileSearch();
     clearMarksAndRanges();
     m_mainWindow->guiFactory()->removeClient(this);
@@ -882,14 +889,24 @@ void KatePluginSearchView::searchPlaceChanged()
     }
 }
 
-void KatePluginSearchView::matchesFound(const QUrl &url, const QVector<KateSearchMatch> &searchMatches, KTextEditor::Document *doc)
+void KatePluginSearchView::matchesFound(const QUrl &url, const QVector<KateSearchMatch> &searchMatches, const QStringList &lines, KTextEditor::Document *doc)
 {
     if (!m_curResults) {
         return;
     }
 
-    m_curResults->matchModel.addMatches(url, searchMatches, doc);
-    m_curResults->matches += searchMatches.size();
+    m_curResults->matchModel.addMatches(url, searchMatches, lines, doc);
+    m_curResults->matches = m_curResults->matchModel.matchCount();
+
+    // enough matches collected, stop searching, the model already drops all further ones
+    if (m_curResults->matchModel.matchLimitReached() && (searchingDiskFiles() || m_searchOpenFiles.searching())) {
+        m_folderFilesList.terminateSearch();
+        m_searchOpenFiles.cancelSearch();
+        cancelDiskFileSearch();
+
+        // the open files search doesn't signal it is done if canceled
+        QTimer::singleShot(0, this, &KatePluginSearchView::searchDone);
+    }
 }
 
 void KatePluginSearchView::stopClicked()
@@ -1036,6 +1053,7 @@ void KatePluginSearchView::startSearch()
     const bool inAllOpenProjects = m_ui.searchPlaceCombo->currentIndex() == MatchModel::AllProjects;
 
     m_curResults->matchModel.clear();
+    m_curResults->matchModel.setMaxMatches(m_maxMatches);
     m_curResults->matchModel.setSearchPlace(static_cast<MatchModel::SearchPlaces>(m_curResults->searchPlaceIndex));
     m_curResults->matchModel.setSearchState(MatchModel::Searching);
     m_curResults->expandRoot();
@@ -1105,6 +1123,19 @@ void KatePluginSearchView::startSearch()
                 files.removeAt(index);
             }
         }
+
+        // let the project index drop all files that can't contain the literals each match requires
+        // the index only knows the content on disk, open documents may have unsaved changes
+        if (m_projectPluginView && !files.isEmpty()) {
+            const QStringList literals = SearchLiteralFilter::requiredLiterals(reg.pattern(), !m_ui.matchCase->isChecked());
+            if (!literals.isEmpty()) {
+                QMetaObject::invokeMethod(m_projectPluginView,
+                                          "filterFilesByContent",
+                                          Q_RETURN_ARG(QStringList, files),
+                                          Q_ARG(QStringList, files),
+                                          Q_ARG(QStringList, literals));
+            }
+        }
         // search order is important: Open files starts immediately and should finish
         // earliest after first event loop.
         // The DiskFile might finish immediately
@@ -1210,6 +1241,7 @@ void KatePluginSearchView::startSearchWhileTyping()
     m_curResults->matches = 0;
 
     m_curResults->matchModel.clear();
+    m_curResults->matchModel.setMaxMatches(m_maxMatches);
     m_curResults->matchModel.setSearchPlace(MatchModel::CurrentFile);
     m_curResults->matchModel.setSearchState(MatchModel::Searching);
     m_curResults->expandRoot();
@@ -1928,6 +1960,8 @@ void KatePluginSearchView::readSessionConfig(const KConfigGroup &cg)
     m_searchAsYouType.insert(MatchModel::Folder, cg.readEntry("SearchAsYouTypeFolder", true));
     m_searchAsYouType.insert(MatchModel::Project, cg.readEntry("SearchAsYouTypeProject", true));
     m_searchAsYouType.insert(MatchModel::AllProjects, cg.readEntry("SearchAsYouTypeAllProjects", true));
+
+    m_maxMatches = cg.readEntry("MaxMatches", int(MatchModel::DefaultMaxMatches));
 }
 
 void KatePluginSearchView::writeSessionConfig(KConfigGroup &cg)
@@ -1978,6 +2012,8 @@ void KatePluginSearchView::writeSessionConfig(KConfigGroup &cg)
     cg.writeEntry("SearchAsYouTypeFolder", m_searchAsYouType.value(MatchModel::Folder, true));
     cg.writeEntry("SearchAsYouTypeProject", m_searchAsYouType.value(MatchModel::Project, true));
     cg.writeEntry("SearchAsYouTypeAllProjects", m_searchAsYouType.value(MatchModel::AllProjects, true));
+
+    cg.writeEntry("MaxMatches", m_maxMatches);
 }
 
 void KatePluginSearchView::addTab()
@@ -2273,6 +2309,23 @@ void KatePluginSearchView::searchContextMenu(const QPoint &pos)
         m_searchAsYouType[static_cast<MatchModel::SearchPlaces>(searchPlace)] = checked;
     });
 
+    // add option to limit the number of collected matches
+    a = contextMenu->addAction(i18n("Limit Matches..."));
+    connect(a, &QAction::triggered, this, [this]() {
+        bool ok = false;
+        const int maxMatches = QInputDialog::getInt(m_toolView,
+                                                    i18n("Limit Matches"),
+                                                    i18n("Stop searching after this number of matches (0 for no limit):"),
+                                                    m_maxMatches,
+                                                    0,
+                                                    std::numeric_limits<int>::max(),
+                                                    1000,
+                                                    &ok);
+        if (ok) {
+            m_maxMatches = maxMatches;
+        }
+    });
+
     // Show menu and act
     QAction *const result = contextMenu->exec(m_ui.searchCombo->mapToGlobal(pos));
     regexHelperActOnAction(result, actionPointers, m_ui.searchCombo->lineEdit());
@@ -118,7 +118,7 @@ private Q_SLOTS:
 
     void folderFileListChanged();
 
-    void matchesFound(const QUrl &url, const QVector<KateSearchMatch> &searchMatches, KTextEditor::Document *doc);
+    void matchesFound(const QUrl &url, const QVector<KateSearchMatch> &searchMatches, const QStringList &lines, KTextEditor::Document *doc);
 
     void addRangeAndMark(KTextEditor::Document *doc, const KateSearchMatch &match, KTextEditor::Attribute::Ptr attr, KTextEditor::MovingInterface *miface);
 
@@ -208,6 +208,11 @@ private:
 
     QHash<MatchModel::SearchPlaces, bool> m_searchAsYouType;
 
+    /**
+     * maximal number of matches we collect per search, 0 means no limit
+     */
+    int m_maxMatches = MatchModel::DefaultMaxMatches;
+
     /**
      * current project plugin view, if any
      */
@@ -107,12 +107,16 @@ void SearchResultsDelegate::paintMatchItem(QPainter *p, const QStyleOptionViewIt
 
     // match
     p->setPen(QPen(m_textColor, 1));
+    // the match only references its text, the model computes the context for us
+    const QString preMatchStr = index.data(MatchModel::PreMatchRole).toString();
+    const QString matchStr = index.data(MatchModel::MatchRole).toString();
+    const QString postMatchStr = index.data(MatchModel::PostMatchRole).toString();
     QString text;
     bool replacing = !match.replaceText.isEmpty();
     if (replacing) {
-        text = match.preMatchStr + match.matchStr + match.replaceText + match.postMatchStr;
+        text = preMatchStr + matchStr + match.replaceText + postMatchStr;
     } else {
-        text = match.preMatchStr + match.matchStr + match.postMatchStr;
+        text = preMatchStr + matchStr + postMatchStr;
     }
 
     QVector<QTextLayout::FormatRange> formats;
@@ -124,8 +128,8 @@ void SearchResultsDelegate::paintMatchItem(QPainter *p, const QStyleOptionViewIt
     formats << fontFmt;
 
     QTextLayout::FormatRange matchFmt;
-    matchFmt.start = match.preMatchStr.size();
-    matchFmt.length = match.matchStr.size();
+    matchFmt.start = preMatchStr.size();
+    matchFmt.length = matchStr.size();
     matchFmt.format.setBackground(m_searchColor);
     matchFmt.format.setFontItalic(replacing);
     matchFmt.format.setFontStrikeOut(replacing);
@@ -133,7 +137,7 @@ void SearchResultsDelegate::paintMatchItem(QPainter *p, const QStyleOptionViewIt
 
     if (replacing) {
         QTextLayout::FormatRange repFmt;
-        repFmt.start = match.preMatchStr.size() + match.matchStr.size();
+        repFmt.start = preMatchStr.size() + matchStr.size();
         repFmt.length = match.replaceText.size();
         repFmt.format.setBackground(m_replaceColor);
         formats << repFmt;
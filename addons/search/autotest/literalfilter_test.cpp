@@ -0,0 +1,84 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "literalfilter_test.h"
+#include "SearchLiteralFilter.h"
+
+#include <QTest>
+
+QTEST_MAIN(LiteralFilterTest)
+
+void LiteralFilterTest::testRequiredLiterals_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QStringList>("literals");
+
+    QTest::newRow("plain") << QStringLiteral("hello") << QStringList{QStringLiteral("hello")};
+    QTest::newRow("escaped") << QRegularExpression::escape(QStringLiteral("a.b(c)")) << QStringList{QStringLiteral("a.b(c)")};
+    QTest::newRow("word boundaries") << QStringLiteral("\\bint\\b") << QStringList{QStringLiteral("int")};
+    QTest::newRow("dot") << QStringLiteral("foo.bar") << QStringList{QStringLiteral("foo"), QStringLiteral("bar")};
+    QTest::newRow("optional char") << QStringLiteral("colou?r") << QStringList{QStringLiteral("colo"), QStringLiteral("r")};
+    QTest::newRow("plus") << QStringLiteral("ab+c") << QStringList{QStringLiteral("ab"), QStringLiteral("c")};
+    QTest::newRow("brace quantifiers") << QStringLiteral("ab{0,2}cd{2}e") << QStringList{QStringLiteral("a"), QStringLiteral("cd"), QStringLiteral("e")};
+    QTest::newRow("group skipped") << QStringLiteral("foo(bar|baz)qux") << QStringList{QStringLiteral("foo"), QStringLiteral("qux")};
+    QTest::newRow("class skipped") << QStringLiteral("x[]a-z]y[[:alpha:]]z") << QStringList{QStringLiteral("x"), QStringLiteral("y"), QStringLiteral("z")};
+    QTest::newRow("tab") << QStringLiteral("a\\tb") << QStringList{QStringLiteral("a\tb")};
+    QTest::newRow("alternation") << QStringLiteral("foo|bar") << QStringList{};
+    QTest::newRow("inline options") << QStringLiteral("(?i)foo") << QStringList{};
+    QTest::newRow("hex escape") << QStringLiteral("\\x41bc") << QStringList{};
+    QTest::newRow("back reference") << QStringLiteral("(a)\\1") << QStringList{};
+    QTest::newRow("only classes") << QStringLiteral("\\w+\\s*\\d") << QStringList{};
+}
+
+void LiteralFilterTest::testRequiredLiterals()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QStringList, literals);
+
+    QCOMPARE(SearchLiteralFilter::requiredLiterals(pattern, false), literals);
+}
+
+void LiteralFilterTest::testCaseInsensitiveLiterals()
+{
+    // k and s might match non-ASCII characters with Unicode case folding
+    QCOMPARE(SearchLiteralFilter::requiredLiterals(QStringLiteral("markdown"), true), (QStringList{QStringLiteral("mar"), QStringLiteral("down")}));
+    QCOMPARE(SearchLiteralFilter::requiredLiterals(QStringLiteral("größe"), true), (QStringList{QStringLiteral("gr"), QStringLiteral("e")}));
+
+    const SearchLiteralFilter filter(QRegularExpression(QStringLiteral("FooBar"), QRegularExpression::CaseInsensitiveOption));
+    QVERIFY(filter.isValid());
+    QCOMPARE(filter.literal(), QByteArray("foobar"));
+}
+
+void LiteralFilterTest::testFind()
+{
+    const SearchLiteralFilter filter(QRegularExpression(QStringLiteral("\\bnee.le\\b")));
+    QVERIFY(filter.isValid());
+    QCOMPARE(filter.literal(), QByteArray("nee"));
+
+    const QByteArray haystack("hay hay\nhay needle\n");
+    const char *hit = filter.find(haystack.cbegin(), haystack.cend());
+    QVERIFY(hit);
+    QCOMPARE(hit - haystack.cbegin(), 12);
+    QVERIFY(!filter.find(hit + 1, haystack.cend()));
+
+    const SearchLiteralFilter none(QRegularExpression(QStringLiteral("a|b")));
+    QVERIFY(!none.isValid());
+}
+
+void LiteralFilterTest::testFindCaseInsensitive()
+{
+    const SearchLiteralFilter filter(QRegularExpression(QStringLiteral("needle"), QRegularExpression::CaseInsensitiveOption));
+    QVERIFY(filter.isValid());
+
+    const QByteArray haystack("NEEDLE nEeDlE needl");
+    const char *hit = filter.find(haystack.cbegin(), haystack.cend());
+    QVERIFY(hit);
+    QCOMPARE(hit - haystack.cbegin(), 0);
+    hit = filter.find(hit + 1, haystack.cend());
+    QVERIFY(hit);
+    QCOMPARE(hit - haystack.cbegin(), 7);
+    QVERIFY(!filter.find(hit + 1, haystack.cend()));
+}
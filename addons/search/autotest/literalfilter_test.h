@@ -0,0 +1,21 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+
+class LiteralFilterTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testRequiredLiterals_data();
+    void testRequiredLiterals();
+    void testCaseInsensitiveLiterals();
+    void testFind();
+    void testFindCaseInsensitive();
+};
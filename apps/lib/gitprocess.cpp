@@ -30,9 +30,14 @@ bool setupGitProcess(QProcess &process, const QString &workingDirectory, const Q
      * Defaults to 1.
      *
      * we use the env var as this is compatible even for "ancient" git versions pre 2.15.2
+     *
+     * the environment is computed once, copying the whole system environment for each git call is expensive
      */
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-    env.insert(QStringLiteral("GIT_OPTIONAL_LOCKS"), QStringLiteral("0"));
+    static const QProcessEnvironment env = []() {
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        env.insert(QStringLiteral("GIT_OPTIONAL_LOCKS"), QStringLiteral("0"));
+        return env;
+    }();
     process.setProcessEnvironment(env);
     return true;
 }
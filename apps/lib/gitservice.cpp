@@ -0,0 +1,500 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#include "gitservice.h"
+#include "gitprocess.h"
+
+#include <QCache>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QSet>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <vector>
+
+/**
+ * not more git processes than that are started by the worker threads
+ */
+static constexpr int MaxProcesses = 4;
+
+/**
+ * cached results are limited by their size in bytes
+ */
+static constexpr int MaxCacheCost = 32 * 1024 * 1024;
+
+namespace
+{
+struct Waiter {
+    GitService::RequestId id;
+    QPointer<QObject> context;
+    GitService::Callback callback;
+};
+
+/**
+ * One git command, shared by all requests for it.
+ * All members besides canceled are guarded by the service mutex.
+ */
+struct Job {
+    QString key;
+    QString workingDirectory;
+    QStringList arguments;
+    GitService::Priority priority = GitService::Normal;
+
+    // cache the result for this repository state, if not empty
+    QByteArray state;
+
+    bool running = false;
+    bool done = false;
+    int syncWaiters = 0;
+    std::vector<Waiter> waiters;
+    GitResult result;
+
+    // set if nobody is interested any longer, polled while git runs
+    std::atomic<bool> canceled{false};
+};
+using JobPtr = std::shared_ptr<Job>;
+
+struct CacheEntry {
+    QByteArray state;
+    GitResult result;
+};
+}
+
+static QString jobKey(const QString &workingDirectory, const QStringList &arguments)
+{
+    return workingDirectory + QChar(0) + arguments.join(QChar(0));
+}
+
+/**
+ * Find the git directory for the given working directory.
+ * Linked worktrees and submodules have a .git file pointing to it.
+ */
+static QString findGitDir(const QString &workingDirectory)
+{
+    QDir dir(workingDirectory);
+    do {
+        const QFileInfo dotGit(dir.filePath(QStringLiteral(".git")));
+        if (dotGit.isDir()) {
+            return dotGit.absoluteFilePath();
+        }
+        if (dotGit.isFile()) {
+            QFile file(dotGit.absoluteFilePath());
+            if (!file.open(QIODevice::ReadOnly)) {
+                return QString();
+            }
+            const QByteArray line = file.readLine().trimmed();
+            if (!line.startsWith("gitdir: ")) {
+                return QString();
+            }
+            return QDir::cleanPath(dir.absoluteFilePath(QString::fromUtf8(line.mid(8))));
+        }
+    } while (dir.cdUp());
+    return QString();
+}
+
+/**
+ * Run git for the job, in the calling thread.
+ */
+static GitResult execute(const Job &job)
+{
+    GitResult result;
+    QProcess git;
+    if (!setupGitProcess(git, job.workingDirectory, job.arguments)) {
+        return result;
+    }
+
+    // the output reflects at least this state, changes while git runs might be seen or not
+    result.repositoryState = GitService::repositoryState(job.workingDirectory);
+    git.start(QProcess::ReadOnly);
+    if (!git.waitForStarted()) {
+        return result;
+    }
+
+    // poll to be able to kill canceled long running commands, e.g. a blame
+    while (git.state() != QProcess::NotRunning && !git.waitForFinished(100)) {
+        if (job.canceled) {
+            git.kill();
+            git.waitForFinished();
+            return result;
+        }
+    }
+
+    result.standardOutput = git.readAllStandardOutput();
+    result.standardError = git.readAllStandardError();
+    result.exitCode = git.exitCode();
+    result.exitStatus = git.exitStatus();
+    return result;
+}
+
+class GitServicePrivate
+{
+public:
+    GitServicePrivate()
+    {
+        pool.setMaxThreadCount(MaxProcesses);
+    }
+
+    ~GitServicePrivate()
+    {
+        {
+            QMutexLocker locker(&mutex);
+            for (auto &queue : queues) {
+                queue.clear();
+            }
+            for (const auto &job : qAsConst(jobs)) {
+                job->canceled = true;
+            }
+            // running jobs replaced by a newer one for the same command
+            for (const auto &job : qAsConst(requests)) {
+                job->canceled = true;
+            }
+        }
+        pool.waitForDone();
+    }
+
+    /**
+     * Queue a new job and start a worker for it.
+     * Needs the lock.
+     */
+    void enqueue(const JobPtr &job)
+    {
+        queues[job->priority].push_back(job);
+        pool.start([this]() {
+            runNext();
+        });
+    }
+
+    /**
+     * Remove a queued job from its queue.
+     * Needs the lock.
+     */
+    void dequeue(const JobPtr &job)
+    {
+        auto &queue = queues[job->priority];
+        queue.erase(std::remove(queue.begin(), queue.end(), job), queue.end());
+    }
+
+    /**
+     * Worker: run the queued job with the highest priority.
+     * There is one worker per queued job, canceled or stolen jobs just leave a worker without work.
+     */
+    void runNext()
+    {
+        QMutexLocker locker(&mutex);
+        JobPtr job;
+        for (int priority = GitService::Interactive; priority >= GitService::Background; --priority) {
+            if (!queues[priority].empty()) {
+                job = queues[priority].front();
+                queues[priority].pop_front();
+                break;
+            }
+        }
+        if (!job) {
+            return;
+        }
+
+        job->running = true;
+        locker.unlock();
+        const GitResult result = execute(*job);
+        locker.relock();
+        finish(job, result);
+    }
+
+    /**
+     * Store the result, hand it to all waiters.
+     * Needs the lock.
+     */
+    void finish(const JobPtr &job, const GitResult &result)
+    {
+        job->result = result;
+        job->done = true;
+        if (jobs.value(job->key) == job) {
+            jobs.remove(job->key);
+        }
+
+        // the state was taken before git did run, a later change of the repository just leads to a miss
+        if (!job->state.isEmpty() && !result.repositoryState.isEmpty() && !job->canceled && result.ok()) {
+            const int cost = std::max(1, result.standardOutput.size() + result.standardError.size());
+            cache.insert(job->key, new CacheEntry{result.repositoryState, result}, cost);
+        }
+
+        for (const auto &waiter : job->waiters) {
+            requests.remove(waiter.id);
+            deliver(waiter, result);
+        }
+        job->waiters.clear();
+        jobDone.wakeAll();
+    }
+
+    /**
+     * Post the result to the thread of the waiter.
+     * Needs the lock.
+     */
+    void deliver(const Waiter &waiter, const GitResult &result)
+    {
+        if (!waiter.context) {
+            return;
+        }
+
+        // might still be canceled until it arrives
+        pendingDeliveries.insert(waiter.id);
+        QMetaObject::invokeMethod(
+            waiter.context,
+            [this, id = waiter.id, callback = waiter.callback, result]() {
+                {
+                    QMutexLocker locker(&mutex);
+                    if (!pendingDeliveries.remove(id)) {
+                        return;
+                    }
+                }
+                callback(result);
+            },
+            Qt::QueuedConnection);
+    }
+
+    /**
+     * Running or queued job that a request may share.
+     * A running job has seen an older working tree or repository, only cached requests for the same state may join it.
+     * Needs the lock.
+     */
+    JobPtr joinableJob(const QString &key, const QByteArray &state)
+    {
+        const JobPtr job = jobs.value(key);
+        if (job && job->running && (state.isEmpty() || job->state != state)) {
+            return nullptr;
+        }
+        return job;
+    }
+
+    /**
+     * Cached result for the job key, if still valid for the given state.
+     * Needs the lock.
+     */
+    const GitResult *cachedResult(const QString &key, const QByteArray &state)
+    {
+        if (state.isEmpty()) {
+            return nullptr;
+        }
+        const CacheEntry *entry = cache.object(key);
+        return (entry && entry->state == state) ? &entry->result : nullptr;
+    }
+
+    QMutex mutex;
+    QWaitCondition jobDone;
+    GitService::RequestId lastId = 0;
+
+    // queued and running jobs by key, to merge identical requests
+    QHash<QString, JobPtr> jobs;
+
+    // job of each active request
+    QHash<GitService::RequestId, JobPtr> requests;
+
+    // requests whose result is on the way
+    QSet<GitService::RequestId> pendingDeliveries;
+
+    // queued jobs, one queue per priority
+    std::deque<JobPtr> queues[GitService::Interactive + 1];
+
+    QCache<QString, CacheEntry> cache{MaxCacheCost};
+
+    // workers running the queued jobs
+    QThreadPool pool;
+};
+
+GitService::GitService()
+    : d(new GitServicePrivate)
+{
+}
+
+GitService::~GitService() = default;
+
+GitService &GitService::self()
+{
+    static GitService service;
+    return service;
+}
+
+GitService::RequestId GitService::request(const QString &workingDirectory,
+                                          const QStringList &arguments,
+                                          const QObject *context,
+                                          const Callback &callback,
+                                          Priority priority,
+                                          bool cached)
+{
+    const QString key = jobKey(workingDirectory, arguments);
+    const QByteArray state = cached ? repositoryState(workingDirectory) : QByteArray();
+
+    QMutexLocker locker(&d->mutex);
+    const RequestId id = ++d->lastId;
+    const Waiter waiter{id, const_cast<QObject *>(context), callback};
+
+    if (const GitResult *result = d->cachedResult(key, state)) {
+        d->deliver(waiter, *result);
+        return id;
+    }
+
+    // a running job that can't be shared stays as it is, the new one replaces it for later requests
+    JobPtr job = d->joinableJob(key, state);
+    if (!job) {
+        job = std::make_shared<Job>();
+        job->key = key;
+        job->workingDirectory = workingDirectory;
+        job->arguments = arguments;
+        job->priority = priority;
+        job->state = state;
+        d->jobs.insert(key, job);
+        d->enqueue(job);
+    } else if (!job->running) {
+        // not yet started, we can still adjust it
+        if (!state.isEmpty()) {
+            job->state = state;
+        }
+        if (priority > job->priority) {
+            d->dequeue(job);
+            job->priority = priority;
+            d->queues[priority].push_back(job);
+        }
+    }
+
+    job->waiters.push_back(waiter);
+    d->requests.insert(id, job);
+    return id;
+}
+
+void GitService::cancel(RequestId id)
+{
+    QMutexLocker locker(&d->mutex);
+    d->pendingDeliveries.remove(id);
+    const JobPtr job = d->requests.take(id);
+    if (!job) {
+        return;
+    }
+
+    auto &waiters = job->waiters;
+    waiters.erase(std::remove_if(waiters.begin(),
+                                 waiters.end(),
+                                 [id](const Waiter &waiter) {
+                                     return waiter.id == id;
+                                 }),
+                  waiters.end());
+    if (!waiters.empty() || job->syncWaiters > 0) {
+        return;
+    }
+
+    // nobody is interested any longer, new requests need a new job
+    if (d->jobs.value(job->key) == job) {
+        d->jobs.remove(job->key);
+    }
+    if (job->running) {
+        job->canceled = true;
+    } else {
+        d->dequeue(job);
+    }
+}
+
+GitResult GitService::run(const QString &workingDirectory, const QStringList &arguments, bool cached)
+{
+    const QString key = jobKey(workingDirectory, arguments);
+    const QByteArray state = cached ? repositoryState(workingDirectory) : QByteArray();
+
+    QMutexLocker locker(&d->mutex);
+    if (const GitResult *result = d->cachedResult(key, state)) {
+        return *result;
+    }
+
+    JobPtr job = d->joinableJob(key, state);
+    if (job && job->running) {
+        // just wait for the identical running command, it is cached for our state
+        ++job->syncWaiters;
+        while (!job->done) {
+            d->jobDone.wait(&d->mutex);
+        }
+        --job->syncWaiters;
+        return job->result;
+    }
+
+    if (job) {
+        // run the queued one here, the waiters get our result
+        d->dequeue(job);
+        if (!state.isEmpty()) {
+            job->state = state;
+        }
+    } else {
+        job = std::make_shared<Job>();
+        job->key = key;
+        job->workingDirectory = workingDirectory;
+        job->arguments = arguments;
+        job->state = state;
+        d->jobs.insert(key, job);
+    }
+
+    job->running = true;
+    ++job->syncWaiters;
+    locker.unlock();
+    const GitResult result = execute(*job);
+    locker.relock();
+    --job->syncWaiters;
+    d->finish(job, result);
+    return result;
+}
+
+QByteArray GitService::repositoryState(const QString &workingDirectory)
+{
+    const QString gitDir = findGitDir(workingDirectory);
+    if (gitDir.isEmpty()) {
+        return QByteArray();
+    }
+
+    // linked worktrees share the refs with the main repository
+    QString commonDir = gitDir;
+    QFile commonDirFile(gitDir + QStringLiteral("/commondir"));
+    if (commonDirFile.open(QIODevice::ReadOnly)) {
+        commonDir = QDir::cleanPath(QDir(gitDir).absoluteFilePath(QString::fromUtf8(commonDirFile.readAll().trimmed())));
+    }
+
+    QStringList files{gitDir + QStringLiteral("/HEAD"), gitDir + QStringLiteral("/index"), commonDir + QStringLiteral("/packed-refs")};
+
+    // loose refs, e.g. refs/heads/feature/x only touches its own directory, so all of them are looked at
+    // refs/remotes is updated by push, too, which doesn't write FETCH_HEAD
+    const QString refsDirs[] = {QStringLiteral("/refs/heads"), QStringLiteral("/refs/tags"), QStringLiteral("/refs/remotes")};
+    for (const auto &refsDir : refsDirs) {
+        files.push_back(commonDir + refsDir);
+        QStringList refs;
+        QDirIterator it(commonDir + refsDir, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            refs.push_back(it.next());
+        }
+        // the order of the iteration is not defined
+        refs.sort();
+        files += refs;
+    }
+
+    // HEAD itself, plus the ref it points to
+    QByteArray state;
+    QFile head(gitDir + QStringLiteral("/HEAD"));
+    if (head.open(QIODevice::ReadOnly)) {
+        state = head.readLine().trimmed();
+        if (state.startsWith("ref: ")) {
+            files.push_back(commonDir + QLatin1Char('/') + QString::fromUtf8(state.mid(5)));
+        }
+    }
+
+    for (const auto &file : qAsConst(files)) {
+        const QFileInfo fi(file);
+        state += ';' + QByteArray::number(fi.lastModified().toMSecsSinceEpoch()) + ' ' + QByteArray::number(fi.size());
+    }
+    return state;
+}
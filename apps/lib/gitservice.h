@@ -0,0 +1,119 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kate Developers <kwrite-devel@kde.org>
+
+    SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QProcess>
+#include <QStringList>
+
+#include <functional>
+#include <memory>
+
+#include "kateprivate_export.h"
+
+/**
+ * Result of a git command run by the GitService.
+ */
+struct GitResult {
+    QByteArray standardOutput;
+    QByteArray standardError;
+    int exitCode = -1;
+    QProcess::ExitStatus exitStatus = QProcess::CrashExit;
+
+    /**
+     * GitService::repositoryState taken right before git was started, the output reflects at least that state
+     */
+    QByteArray repositoryState;
+
+    /**
+     * @return did git run and exit with success?
+     */
+    bool ok() const
+    {
+        return exitStatus == QProcess::NormalExit && exitCode == 0;
+    }
+};
+
+/**
+ * Central service to run git queries, shared by all git features of the application and the plugins.
+ *
+ * - git is run by a small pool of worker threads, not more than a few processes run at the same time
+ * - queued requests are started by priority and can be canceled
+ * - identical requests that are still queued are merged, only one git process is started
+ *   a running process is only shared by cached requests for the same repository state
+ * - results of requests marked as cached are reused until HEAD, the index or the refs of the repository change
+ *
+ * Only use this for queries, commands that change the repository or need interaction
+ * should use their own process, see setupGitProcess.
+ */
+class KATE_PRIVATE_EXPORT GitService
+{
+public:
+    enum Priority { Background, Normal, Interactive };
+
+    using RequestId = quint64;
+    using Callback = std::function<void(const GitResult &)>;
+
+    /**
+     * @return the process wide service
+     */
+    static GitService &self();
+
+    /**
+     * Queue a git command.
+     * Must be called from the thread of the context object.
+     *
+     * @param workingDirectory working directory to use for git
+     * @param arguments arguments to pass to git
+     * @param context the callback is run in the thread of this object, not at all if it is destroyed before
+     * @param callback called with the result, never called before this function returns
+     * @param priority requests with higher priority are started first
+     * @param cached may the result be reused? only for commands whose output depends just on the repository state, not on the working tree
+     * @return id of the request, to cancel it
+     */
+    RequestId request(const QString &workingDirectory,
+                      const QStringList &arguments,
+                      const QObject *context,
+                      const Callback &callback,
+                      Priority priority = Normal,
+                      bool cached = false);
+
+    /**
+     * Cancel a request, its callback won't be called.
+     * The git process is killed if no other request waits for it.
+     * @param id request to cancel, unknown or finished ids are ignored
+     */
+    void cancel(RequestId id);
+
+    /**
+     * Run a git command and wait for its result.
+     * Can be called from any thread, an identical queued request is reused,
+     * an identical running one only if cached for the same repository state.
+     *
+     * @param workingDirectory working directory to use for git
+     * @param arguments arguments to pass to git
+     * @param cached may the result be reused? see request
+     * @return result of the git command
+     */
+    GitResult run(const QString &workingDirectory, const QStringList &arguments, bool cached = false);
+
+    /**
+     * Cheap fingerprint of the repository state: HEAD, the index and all refs.
+     * Just some stat calls, one per loose ref, no git process is started.
+     * This is what cached results are validated against.
+     *
+     * @param workingDirectory some directory inside the repository
+     * @return fingerprint, empty if this is no git repository
+     */
+    static QByteArray repositoryState(const QString &workingDirectory);
+
+private:
+    GitService();
+    ~GitService();
+
+    std::unique_ptr<class GitServicePrivate> d;
+};
@@ -22,6 +22,7 @@
 #include <KPluginFactory>
 #include <KSharedConfig>
 
+#include <QAbstractProxyModel>
 #include <QBoxLayout>
 #include <QCoreApplication>
 #include <QEvent>
@@ -30,48 +31,194 @@
 #include <QLabel>
 #include <QPainter>
 #include <QPointer>
-#include <QSortFilterProxyModel>
+#include <QSemaphore>
 #include <QStandardItemModel>
 #include <QStyledItemDelegate>
 #include <QTextDocument>
+#include <QThread>
+#include <QThreadPool>
 #include <QTreeView>
 
+#include <algorithm>
+#include <numeric>
+
 #include <drawing_utils.h>
 #include <kfts_fuzzy_match.h>
 
-class QuickOpenFilterProxyModel final : public QSortFilterProxyModel
+/**
+ * Filters and ranks the quick open entries for the current pattern.
+ * The candidates are scored in parallel chunks, only the best matches are kept, sorted.
+ * If the pattern is extended while typing, only the matches of the previous pattern are scored again.
+ */
+class QuickOpenFilterProxyModel final : public QAbstractProxyModel
 {
 public:
     QuickOpenFilterProxyModel(QObject *parent = nullptr)
-        : QSortFilterProxyModel(parent)
+        : QAbstractProxyModel(parent)
     {
     }
 
-protected:
-    bool lessThan(const QModelIndex &sourceLeft, const QModelIndex &sourceRight) const override
+    void setSourceModel(QAbstractItemModel *model) override
     {
-        auto sm = sourceModel();
-        if (pattern.isEmpty()) {
-            const bool l = static_cast<KateQuickOpenModel *>(sm)->isOpened(sourceLeft);
-            const bool r = static_cast<KateQuickOpenModel *>(sm)->isOpened(sourceRight);
-            return l < r;
+        beginResetModel();
+        if (sourceModel()) {
+            disconnect(sourceModel(), nullptr, this, nullptr);
         }
-        const int l = static_cast<KateQuickOpenModel *>(sm)->idxScore(sourceLeft);
-        const int r = static_cast<KateQuickOpenModel *>(sm)->idxScore(sourceRight);
-        return l < r;
+        QAbstractProxyModel::setSourceModel(model);
+        connect(model, &QAbstractItemModel::modelAboutToBeReset, this, [this]() {
+            beginResetModel();
+        });
+        connect(model, &QAbstractItemModel::modelReset, this, [this]() {
+            m_rows = filter(false);
+            endResetModel();
+        });
+        m_rows = filter(false);
+        endResetModel();
     }
 
-    bool filterAcceptsRow(int sourceRow, const QModelIndex &) const override
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override
     {
-        if (pattern.isEmpty()) {
-            return true;
+        if (parent.isValid() || row < 0 || (size_t)row >= m_rows.size() || column != 0) {
+            return {};
         }
+        return createIndex(row, column);
+    }
 
-        auto sm = static_cast<KateQuickOpenModel *>(sourceModel());
-        if (!sm->isValid(sourceRow)) {
+    QModelIndex parent(const QModelIndex &) const override
+    {
+        return {};
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : int(m_rows.size());
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : 1;
+    }
+
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override
+    {
+        if (!proxyIndex.isValid() || (size_t)proxyIndex.row() >= m_rows.size()) {
+            return {};
+        }
+        return sourceModel()->index(m_rows[proxyIndex.row()], proxyIndex.column());
+    }
+
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override
+    {
+        // only used for rare things like selection mapping, no need for a reverse lookup table
+        const auto it = std::find(m_rows.cbegin(), m_rows.cend(), sourceIndex.row());
+        if (!sourceIndex.isValid() || it == m_rows.cend()) {
+            return {};
+        }
+        return createIndex(int(it - m_rows.cbegin()), sourceIndex.column());
+    }
+
+public Q_SLOTS:
+    bool setFilterText(const QString &text)
+    {
+        // we don't want to trigger filtering if the user is just entering line:col
+        const auto splitted = text.split(QLatin1Char(':')).at(0);
+        if (splitted == pattern) {
             return false;
         }
 
+        // an extended pattern only matches a subset of the current matches
+        // not true if we switch between name and path matching
+        const bool wasMatchPath = matchPath;
+        const bool narrow = !pattern.isEmpty() && splitted.startsWith(pattern);
+        pattern = splitted;
+        matchPath = pattern.contains(QLatin1Char('/'));
+
+        publish(filter(narrow && matchPath == wasMatchPath));
+        return true;
+    }
+
+private:
+    struct Match {
+        int score;
+        int row;
+    };
+
+    /**
+     * Results of scoring one chunk of candidates
+     */
+    struct ChunkResult {
+        // all matching rows, in source order
+        std::vector<int> rows;
+        // the best matches, sorted
+        std::vector<Match> best;
+    };
+
+    /**
+     * Compute the sorted rows to show for the current pattern.
+     * @param narrow only rescore the current matches
+     * @return source rows to show
+     */
+    std::vector<int> filter(bool narrow)
+    {
+        auto sm = static_cast<KateQuickOpenModel *>(sourceModel());
+
+        // nothing to match, show all, the model has the opened files first
+        if (pattern.isEmpty()) {
+            m_matches.clear();
+            std::vector<int> rows(sm->rowCount());
+            std::iota(rows.begin(), rows.end(), 0);
+            return rows;
+        }
+
+        std::vector<int> candidates;
+        if (narrow) {
+            candidates = std::move(m_matches);
+        } else {
+            candidates.resize(sm->rowCount());
+            std::iota(candidates.begin(), candidates.end(), 0);
+        }
+
+        // score in parallel chunks, this thread does the first one
+        const size_t chunkCount = std::clamp<size_t>(candidates.size() / MinChunkSize, 1, std::max(1, QThread::idealThreadCount()));
+        const size_t chunkSize = (candidates.size() + chunkCount - 1) / chunkCount;
+        std::vector<ChunkResult> results(chunkCount);
+        const auto scoreChunk = [this, sm, &candidates, &results, chunkSize](size_t chunk) {
+            const auto begin = candidates.cbegin() + std::min(candidates.size(), chunk * chunkSize);
+            const auto end = candidates.cbegin() + std::min(candidates.size(), (chunk + 1) * chunkSize);
+            scoreRows(sm, begin, end, results[chunk]);
+        };
+        QSemaphore done;
+        for (size_t chunk = 1; chunk < chunkCount; ++chunk) {
+            m_pool.start([&scoreChunk, &done, chunk]() {
+                scoreChunk(chunk);
+                done.release();
+            });
+        }
+        scoreChunk(0);
+        done.acquire(int(chunkCount - 1));
+
+        // merge the chunks, the matches stay in source order for the next narrowing
+        m_matches.clear();
+        std::vector<Match> best;
+        for (const auto &result : results) {
+            m_matches.insert(m_matches.end(), result.rows.cbegin(), result.rows.cend());
+            best.insert(best.end(), result.best.cbegin(), result.best.cend());
+        }
+        keepBest(best);
+
+        std::vector<int> rows;
+        rows.reserve(best.size());
+        for (const auto &match : best) {
+            rows.push_back(match.row);
+        }
+        return rows;
+    }
+
+    /**
+     * Score the given rows against the current pattern, might run in any thread.
+     */
+    void scoreRows(const KateQuickOpenModel *sm, std::vector<int>::const_iterator begin, std::vector<int>::const_iterator end, ChunkResult &result) const
+    {
         QStringView fileNameMatchPattern = pattern;
         // When matching path, we want to match the last section of the pattern
         // with filenames. /path/to/file => pattern: file
@@ -82,29 +229,31 @@ protected:
             }
         }
 
-        const QString &name = sm->idxToFileName(sourceRow);
+        for (auto it = begin; it != end; ++it) {
+            const int sourceRow = *it;
+            const QString &name = sm->idxToFileName(sourceRow);
+
+            int score = 0;
+            bool res;
+            // dont use the QStringView(QString) ctor
+            if (fileNameMatchPattern.isEmpty()) {
+                res = true;
+            } else {
+                res = filterByName(QStringView(name.data(), name.size()), fileNameMatchPattern, score);
+            }
 
-        int score = 0;
-        bool res;
-        // dont use the QStringView(QString) ctor
-        if (fileNameMatchPattern.isEmpty()) {
-            res = true;
-        } else {
-            res = filterByName(QStringView(name.data(), name.size()), fileNameMatchPattern, score);
-        }
+            // only match file path if needed
+            if (matchPath && res) {
+                int scorep = 0;
+                QStringView path{sm->idxToFilePath(sourceRow)};
+                res = filterByPath(path, QStringView(pattern.data(), pattern.size()), scorep);
+                score += scorep;
+            }
 
-        // only match file path if needed
-        if (matchPath && res) {
-            int scorep = 0;
-            QStringView path{sm->idxToFilePath(sourceRow)};
-            bool resp = filterByPath(path, QStringView(pattern.data(), pattern.size()), scorep);
-            score += scorep;
-            res = resp;
-            // zero out the score if didn't match
-            score *= res;
-        }
+            if (!res) {
+                continue;
+            }
 
-        if (res) {
             // +1 point for opened files
             score += (sm->isOpened(sourceRow));
 
@@ -116,31 +265,52 @@ protected:
             if (!matchPath) {
                 score += (sm->idxToFilePath(sourceRow) == name) + name.size();
             }
+
+            result.rows.push_back(sourceRow);
+            result.best.push_back({score, sourceRow});
         }
 
-        sm->setScoreForIndex(sourceRow, score);
+        keepBest(result.best);
+    }
 
-        return res;
+    /**
+     * Shrink to the best matches, best first.
+     * Equal scores keep the source order, the opened files come first there.
+     */
+    static void keepBest(std::vector<Match> &matches)
+    {
+        const auto last = matches.begin() + std::min<size_t>(matches.size(), MaxMatches);
+        std::partial_sort(matches.begin(), last, matches.end(), [](const Match &l, const Match &r) {
+            return l.score > r.score || (l.score == r.score && l.row < r.row);
+        });
+        matches.erase(last, matches.end());
     }
 
-public Q_SLOTS:
-    bool setFilterText(const QString &text)
+    /**
+     * Show the new rows, only the changed part of the model is signaled.
+     */
+    void publish(std::vector<int> rows)
     {
-        // we don't want to trigger filtering if the user is just entering line:col
-        const auto splitted = text.split(QLatin1Char(':')).at(0);
-        if (splitted == pattern) {
-            return false;
+        const int oldSize = int(m_rows.size());
+        const int newSize = int(rows.size());
+        if (newSize < oldSize) {
+            beginRemoveRows(QModelIndex(), newSize, oldSize - 1);
+            m_rows = std::move(rows);
+            endRemoveRows();
+        } else if (newSize > oldSize) {
+            beginInsertRows(QModelIndex(), oldSize, newSize - 1);
+            m_rows = std::move(rows);
+            endInsertRows();
+        } else {
+            m_rows = std::move(rows);
         }
 
-        beginResetModel();
-        pattern = splitted;
-        matchPath = pattern.contains(QLatin1Char('/'));
-        endResetModel();
-
-        return true;
+        const int changed = std::min(oldSize, newSize);
+        if (changed > 0) {
+            Q_EMIT dataChanged(index(0, 0), index(changed - 1, 0));
+        }
     }
 
-private:
     static inline bool filterByPath(QStringView path, QStringView pattern, int &score)
     {
         return kfts::fuzzy_match(pattern, path, score);
@@ -152,8 +322,33 @@ private:
     }
 
 private:
+    /**
+     * only that many best matches are shown
+     */
+    static constexpr size_t MaxMatches = 1000;
+
+    /**
+     * don't bother other threads for less candidates than that
+     */
+    static constexpr size_t MinChunkSize = 8192;
+
     QString pattern;
     bool matchPath = false;
+
+    /**
+     * source rows shown, best match first
+     */
+    std::vector<int> m_rows;
+
+    /**
+     * all source rows matching the current pattern, in source order
+     */
+    std::vector<int> m_matches;
+
+    /**
+     * threads to score the chunks
+     */
+    QThreadPool m_pool;
 };
 
 class QuickOpenStyleDelegate : public QStyledItemDelegate
@@ -264,11 +459,6 @@ KateQuickOpen::KateQuickOpen(KateMainWindow *mainWindow)
     m_base_model = new KateQuickOpenModel(this);
 
     m_model = new QuickOpenFilterProxyModel(this);
-    m_model->setFilterRole(Qt::DisplayRole);
-    m_model->setSortRole(KateQuickOpenModel::Score);
-    m_model->setFilterCaseSensitivity(Qt::CaseInsensitive);
-    m_model->setSortCaseSensitivity(Qt::CaseInsensitive);
-    m_model->setFilterKeyColumn(Qt::DisplayRole);
 
     m_styleDelegate = new QuickOpenStyleDelegate(this);
     m_listView->setItemDelegate(m_styleDelegate);
@@ -287,9 +477,8 @@ KateQuickOpen::KateQuickOpen(KateMainWindow *mainWindow)
     connect(m_listView, &QTreeView::activated, this, &KateQuickOpen::slotReturnPressed);
     connect(m_listView, &QTreeView::clicked, this, &KateQuickOpen::slotReturnPressed); // for single click
 
-    m_listView->setModel(m_model);
-    m_listView->setSortingEnabled(true);
     m_model->setSourceModel(m_base_model);
+    m_listView->setModel(m_model);
 
     m_inputLine->installEventFilter(this);
     m_listView->installEventFilter(this);
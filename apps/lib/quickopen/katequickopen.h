@@ -16,7 +16,6 @@ class KateMainWindow;
 
 class QModelIndex;
 class QStandardItemModel;
-class QSortFilterProxyModel;
 class QuickOpenStyleDelegate;
 class QTreeView;
 class KateQuickOpenModel;
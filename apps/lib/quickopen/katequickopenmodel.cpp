@@ -66,8 +66,6 @@ QVariant KateQuickOpenModel::data(const QModelIndex &idx, int role) const
         return QIcon::fromTheme(QMimeDatabase().mimeTypeForFile(entry.fileName, QMimeDatabase::MatchExtension).iconName());
     case Qt::UserRole:
         return entry.url.isEmpty() ? QUrl::fromLocalFile(entry.filePath) : entry.url;
-    case Role::Score:
-        return entry.score;
     case Role::Document:
         return QVariant::fromValue(entry.document);
     default:
@@ -125,12 +123,12 @@ void KateQuickOpenModel::refresh(KateMainWindow *mainWindow)
         if (!doc->url().isEmpty()) {
             auto path = doc->url().toString(QUrl::NormalizePathSegments | QUrl::PreferLocalFile);
             openedDocUrls.insert(path);
-            allDocuments.push_back({doc->url(), QFileInfo(path).fileName(), path, doc, -1});
+            allDocuments.push_back({doc->url(), QFileInfo(path).fileName(), path, doc});
             return;
         }
 
         // untitled document
-        allDocuments.push_back({doc->url(), doc->documentName(), QString(), doc, -1});
+        allDocuments.push_back({doc->url(), doc->documentName(), QString(), doc});
     };
 
     for (auto *view : sortedViews) {
@@ -150,7 +148,7 @@ void KateQuickOpenModel::refresh(KateMainWindow *mainWindow)
         // QFileInfo is too expensive just for fileName computation
         const int slashIndex = filePath.lastIndexOf(QLatin1Char('/'));
         QString fileName = filePath.mid(slashIndex + 1);
-        allDocuments.push_back({QUrl(), std::move(fileName), filePath, nullptr, -1});
+        allDocuments.push_back({QUrl(), std::move(fileName), filePath, nullptr});
     }
 
     beginResetModel();
@@ -24,7 +24,6 @@ struct ModelEntry {
     QString fileName; // display string for left column
     QString filePath; // display string for right column
     KTextEditor::Document *document = nullptr; // document for entry, if already open
-    int score = -1;
 };
 
 // needs to be defined outside of class to support forward declaration elsewhere
@@ -34,7 +33,7 @@ class KateQuickOpenModel : public QAbstractTableModel
 {
     Q_OBJECT
 public:
-    enum Role { FileName = Qt::UserRole + 1, FilePath, Score, Document };
+    enum Role { FileName = Qt::UserRole + 1, FilePath, Document };
     explicit KateQuickOpenModel(QObject *parent = nullptr);
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     int columnCount(const QModelIndex &parent) const override;
@@ -56,11 +55,6 @@ public:
         return row >= 0 && (size_t)row < m_modelEntries.size();
     }
 
-    void setScoreForIndex(int row, int score)
-    {
-        m_modelEntries[row].score = score;
-    }
-
     const QString &idxToFileName(int row) const
     {
         return m_modelEntries.at(row).fileName;
@@ -74,22 +68,6 @@ public:
         return pth.startsWith(QStringView(m_projectBase.data(), m_projectBase.size())) ? pth.mid(m_projectBase.size()) : pth;
     }
 
-    int idxScore(const QModelIndex &idx) const
-    {
-        if (!idx.isValid()) {
-            return {};
-        }
-        return m_modelEntries.at(idx.row()).score;
-    }
-
-    bool isOpened(const QModelIndex &idx) const
-    {
-        if (!idx.isValid()) {
-            return {};
-        }
-        return m_modelEntries.at(idx.row()).document;
-    }
-
     bool isOpened(int row) const
     {
         return m_modelEntries.at(row).document;